@@ -0,0 +1,372 @@
+#include "autosave.h"
+#include "platform.h"
+#include "project.h"
+#include "membudget.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static uint32_t autosave_checksum(const AutosaveRecord *rec) {
+    // FNV-1a su tutto il record tranne il campo check
+    const uint8_t *p = (const uint8_t *)rec;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(AutosaveRecord, check); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static int autosave_sync_file(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    int ret = fsync(fd);
+    close(fd);
+    return ret;
+}
+
+// log_bytes lo legge anche il thread di frame (autosave_update): va
+// aggiornato sotto lock
+static void autosave_add_log_bytes(Autosave *autosave, long bytes, int reset) {
+    pthread_mutex_lock(&autosave->lock);
+    autosave->log_bytes = (reset ? 0 : autosave->log_bytes) + bytes;
+    pthread_mutex_unlock(&autosave->lock);
+}
+
+// Apre il log vuoto, con il solo header
+static int autosave_open_log(Autosave *autosave) {
+    if (autosave->log_fd >= 0) close(autosave->log_fd);
+
+    autosave->log_fd = open(autosave->log_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    autosave_add_log_bytes(autosave, 0, 1);
+    if (autosave->log_fd < 0) return -1;
+
+    uint32_t header[2] = { AUTOSAVE_LOG_MAGIC, 0 };
+    if (write(autosave->log_fd, header, sizeof(header)) != (ssize_t)sizeof(header)) return -1;
+    autosave_add_log_bytes(autosave, sizeof(header), 1);
+    return fsync(autosave->log_fd);
+}
+
+// Scrive lo snapshot in ckpt_cmds come progetto e azzera il log.
+// Gira sul thread di I/O (o prima che parta). Ritorna -1 se il progetto
+// non è stato sostituito: il log resta quello di prima.
+static int autosave_write_checkpoint(Autosave *autosave) {
+    Journal snapshot;
+    memset(&snapshot, 0, sizeof(Journal));
+    snapshot.cmds = autosave->ckpt_cmds;
+    snapshot.count = autosave->ckpt_count;
+    snapshot.capacity = autosave->ckpt_capacity;
+    snapshot.cursor = autosave->ckpt_count;
+    snapshot.bg_color = autosave->ckpt_bg;
+    snapshot.seq = autosave->ckpt_seq;
+
+    char tmp_path[sizeof(autosave->project_path) + 4];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", autosave->project_path);
+
+    if (project_save(tmp_path, &snapshot, autosave->ckpt_pixels,
+                     autosave->ckpt_width, autosave->ckpt_height) != 0) return -1;
+    if (autosave_sync_file(tmp_path) != 0) return -1;
+#ifdef __vita__
+    // sceIoRename non sovrascrive: in caso di crash qui resta il .tmp
+    remove(autosave->project_path);
+#endif
+    if (rename(tmp_path, autosave->project_path) != 0) return -1;
+
+    // Solo ora il log precedente è ridondante
+    autosave_open_log(autosave);
+    autosave->checkpoints++;
+    return 0;
+}
+
+// Esito del checkpoint, sotto lock: dopo un fallimento autosave_update
+// aspetta il tempo o la crescita del log di AUTOSAVE_RETRY_*
+static void autosave_checkpoint_done(Autosave *autosave, int result) {
+    if (result == 0) {
+        autosave->ckpt_failures = 0;
+        return;
+    }
+    autosave->ckpt_failures++;
+    autosave->ckpt_retry_us = platform_time_us() + AUTOSAVE_RETRY_US;
+    autosave->ckpt_retry_bytes = autosave->log_bytes + AUTOSAVE_RETRY_LOG_BYTES;
+}
+
+static void autosave_write_batch(Autosave *autosave, AutosaveRecord *batch, int count) {
+    if (count == 0 || autosave->log_fd < 0) return;
+
+    for (int i = 0; i < count; i++) {
+        batch[i].check = autosave_checksum(&batch[i]);
+    }
+
+    size_t bytes = (size_t)count * sizeof(AutosaveRecord);
+    if (write(autosave->log_fd, batch, bytes) == (ssize_t)bytes) {
+        autosave_add_log_bytes(autosave, (long)bytes, 0);
+        autosave->records_written += count;
+    }
+
+    uint64_t t = platform_time_us();
+    fsync(autosave->log_fd);
+    uint64_t dt = platform_time_us() - t;
+    if (dt > autosave->max_sync_us) autosave->max_sync_us = dt;
+
+    autosave->batches++;
+    autosave->syncs++;
+}
+
+static void *autosave_thread(void *arg) {
+    Autosave *autosave = (Autosave *)arg;
+    AutosaveRecord *batch = (AutosaveRecord *)mem_alloc(MEM_AUTOSAVE,
+                                                        AUTOSAVE_QUEUE_SIZE * sizeof(AutosaveRecord));
+    if (!batch) return NULL;
+
+    pthread_mutex_lock(&autosave->lock);
+    for (;;) {
+        while (!autosave->stop && autosave->queue_count == 0) {
+            pthread_cond_wait(&autosave->cond, &autosave->lock);
+        }
+        if (autosave->queue_count == 0) break;
+
+        // Lascia accumulare altri record: un solo write + fsync per batch
+        if (!autosave->stop) {
+            pthread_mutex_unlock(&autosave->lock);
+            platform_sleep_us(AUTOSAVE_BATCH_US);
+            pthread_mutex_lock(&autosave->lock);
+        }
+
+        while (autosave->queue_count > 0) {
+            int count = 0;
+            int checkpoint = 0;
+            while (autosave->queue_count > 0) {
+                AutosaveRecord *rec = &autosave->queue[autosave->queue_head];
+                autosave->queue_head = (autosave->queue_head + 1) % AUTOSAVE_QUEUE_SIZE;
+                autosave->queue_count--;
+                if (rec->type == AUTOSAVE_REC_CHECKPOINT) {
+                    checkpoint = 1;
+                    break;
+                }
+                batch[count++] = *rec;
+            }
+            pthread_mutex_unlock(&autosave->lock);
+
+            autosave_write_batch(autosave, batch, count);
+            int result = checkpoint ? autosave_write_checkpoint(autosave) : 0;
+
+            pthread_mutex_lock(&autosave->lock);
+            if (checkpoint) {
+                autosave_checkpoint_done(autosave, result);
+                autosave->ckpt_pending = 0;
+            }
+        }
+    }
+    pthread_mutex_unlock(&autosave->lock);
+
+    mem_free(MEM_AUTOSAVE, batch, AUTOSAVE_QUEUE_SIZE * sizeof(AutosaveRecord));
+    return NULL;
+}
+
+static void autosave_on_event(void *user, const Journal *journal,
+                              JournalEvent event, const JournalCmd *cmd)
+{
+    Autosave *autosave = (Autosave *)user;
+    AutosaveRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.seq = journal->seq;
+    rec.type = (uint8_t)event;
+    if (cmd) rec.cmd = *cmd;
+
+    pthread_mutex_lock(&autosave->lock);
+    // Un posto resta sempre libero per il marker di checkpoint
+    if (autosave->queue_count >= AUTOSAVE_QUEUE_SIZE - 1) {
+        autosave->overflow = 1;
+    } else {
+        int idx = (autosave->queue_head + autosave->queue_count) % AUTOSAVE_QUEUE_SIZE;
+        autosave->queue[idx] = rec;
+        if (autosave->queue_count++ == 0) pthread_cond_signal(&autosave->cond);
+    }
+    pthread_mutex_unlock(&autosave->lock);
+}
+
+// Copia comandi attivi e pixel nel buffer di checkpoint (solo se nessuno è in corso)
+static int autosave_snapshot(Autosave *autosave, const Journal *journal, const Canvas *canvas) {
+    size_t bytes = (size_t)canvas->width * canvas->height * sizeof(unsigned int);
+    if (!autosave->ckpt_pixels) {
+        autosave->ckpt_pixels = mem_buffer_get(MEM_AUTOSAVE, bytes);
+        if (!autosave->ckpt_pixels) return -1;
+    }
+    memcpy(autosave->ckpt_pixels, canvas->pixels, bytes);
+    autosave->ckpt_width = canvas->width;
+    autosave->ckpt_height = canvas->height;
+
+    if (journal->cursor > autosave->ckpt_capacity) {
+        JournalCmd *cmds = (JournalCmd *)mem_realloc(MEM_AUTOSAVE, autosave->ckpt_cmds,
+                                                     (size_t)autosave->ckpt_capacity * sizeof(JournalCmd),
+                                                     (size_t)journal->cursor * sizeof(JournalCmd));
+        if (!cmds) return -1;
+        autosave->ckpt_cmds = cmds;
+        autosave->ckpt_capacity = journal->cursor;
+    }
+    if (journal->cursor > 0) {
+        memcpy(autosave->ckpt_cmds, journal->cmds, journal->cursor * sizeof(JournalCmd));
+    }
+    autosave->ckpt_count = journal->cursor;
+    autosave->ckpt_bg = journal->bg_color;
+    autosave->ckpt_seq = journal->seq;
+    return 0;
+}
+
+int autosave_checkpoint(Autosave *autosave, const Journal *journal, const Canvas *canvas) {
+    pthread_mutex_lock(&autosave->lock);
+    int busy = autosave->ckpt_pending || autosave->queue_count >= AUTOSAVE_QUEUE_SIZE;
+    pthread_mutex_unlock(&autosave->lock);
+    if (busy) return -1;
+
+    // Il thread di I/O non tocca ckpt_cmds finché ckpt_pending è 0
+    if (autosave_snapshot(autosave, journal, canvas) != 0) return -1;
+
+    pthread_mutex_lock(&autosave->lock);
+    int idx = (autosave->queue_head + autosave->queue_count) % AUTOSAVE_QUEUE_SIZE;
+    memset(&autosave->queue[idx], 0, sizeof(AutosaveRecord));
+    autosave->queue[idx].type = AUTOSAVE_REC_CHECKPOINT;
+    if (autosave->queue_count++ == 0) pthread_cond_signal(&autosave->cond);
+    autosave->ckpt_pending = 1;
+    autosave->overflow = 0;
+    pthread_mutex_unlock(&autosave->lock);
+    return 0;
+}
+
+int autosave_update(Autosave *autosave, const Journal *journal, const Canvas *canvas) {
+    pthread_mutex_lock(&autosave->lock);
+    int needed = !autosave->ckpt_pending &&
+                 (autosave->overflow || autosave->log_bytes > AUTOSAVE_MAX_LOG_BYTES);
+    // Dopo un fallimento non si rifà lo snapshot a ogni frame
+    if (needed && autosave->ckpt_failures > 0) {
+        needed = platform_time_us() >= autosave->ckpt_retry_us ||
+                 autosave->log_bytes >= autosave->ckpt_retry_bytes;
+    }
+    int failures = autosave->ckpt_failures;
+    pthread_mutex_unlock(&autosave->lock);
+
+    if (needed) autosave_checkpoint(autosave, journal, canvas);
+    return failures;
+}
+
+int autosave_start(Autosave *autosave, Journal *journal, const Canvas *canvas,
+                   const char *project_path, const char *log_path)
+{
+    memset(autosave, 0, sizeof(Autosave));
+    autosave->log_fd = -1;
+    snprintf(autosave->project_path, sizeof(autosave->project_path), "%s", project_path);
+    snprintf(autosave->log_path, sizeof(autosave->log_path), "%s", log_path);
+
+    autosave->queue = (AutosaveRecord *)mem_alloc(MEM_AUTOSAVE,
+                                                  AUTOSAVE_QUEUE_SIZE * sizeof(AutosaveRecord));
+    if (!autosave->queue) return -1;
+
+    pthread_mutex_init(&autosave->lock, NULL);
+    pthread_cond_init(&autosave->cond, NULL);
+    if (pthread_create(&autosave->thread, NULL, autosave_thread, autosave) != 0) {
+        pthread_mutex_destroy(&autosave->lock);
+        pthread_cond_destroy(&autosave->cond);
+        goto fail;
+    }
+    autosave->running = 1;
+
+    // Checkpoint iniziale, primo in coda: il log precedente resta valido
+    // finché il progetto non è scritto, poi riparte vuoto
+    if (autosave_checkpoint(autosave, journal, canvas) != 0) {
+        autosave_stop(autosave, NULL, NULL);
+        return -1;
+    }
+
+    journal->listener = autosave_on_event;
+    journal->listener_user = autosave;
+    return 0;
+
+fail:
+    mem_free(MEM_AUTOSAVE, autosave->queue, AUTOSAVE_QUEUE_SIZE * sizeof(AutosaveRecord));
+    autosave->queue = NULL;
+    return -1;
+}
+
+void autosave_stop(Autosave *autosave, Journal *journal, const Canvas *canvas) {
+    if (!autosave->running) return;
+
+    // Con journal == NULL si svuota solo la coda (il log resta da ripetere)
+    if (journal) {
+        journal->listener = NULL;
+        while (autosave_checkpoint(autosave, journal, canvas) != 0) {
+            platform_sleep_us(1000);
+        }
+    }
+
+    pthread_mutex_lock(&autosave->lock);
+    autosave->stop = 1;
+    pthread_cond_signal(&autosave->cond);
+    pthread_mutex_unlock(&autosave->lock);
+    pthread_join(autosave->thread, NULL);
+
+    pthread_mutex_destroy(&autosave->lock);
+    pthread_cond_destroy(&autosave->cond);
+    if (autosave->log_fd >= 0) close(autosave->log_fd);
+    mem_free(MEM_AUTOSAVE, autosave->queue, AUTOSAVE_QUEUE_SIZE * sizeof(AutosaveRecord));
+    mem_free(MEM_AUTOSAVE, autosave->ckpt_cmds,
+             (size_t)autosave->ckpt_capacity * sizeof(JournalCmd));
+    if (autosave->ckpt_pixels) {
+        mem_buffer_put(MEM_AUTOSAVE, autosave->ckpt_pixels,
+                       (size_t)autosave->ckpt_width * autosave->ckpt_height * sizeof(unsigned int));
+    }
+    autosave->queue = NULL;
+    autosave->ckpt_cmds = NULL;
+    autosave->ckpt_pixels = NULL;
+    autosave->running = 0;
+}
+
+int autosave_replay_log(Journal *journal, Canvas *canvas, const char *log_path) {
+    FILE *f = fopen(log_path, "rb");
+    if (!f) return -1;
+
+    uint32_t header[2];
+    if (fread(header, sizeof(header), 1, f) != 1 || header[0] != AUTOSAVE_LOG_MAGIC) {
+        fclose(f);
+        return -1;
+    }
+    int replayed = 0;
+    AutosaveRecord rec;
+    while (fread(&rec, sizeof(rec), 1, f) == 1) {
+        if (rec.check != autosave_checksum(&rec)) break;   // coda troncata
+        if (rec.seq <= journal->seq) continue;             // già nel checkpoint
+        if (rec.seq != journal->seq + 1) break;            // buco: record persi
+
+        switch (rec.type) {
+            case AUTOSAVE_REC_EXEC:
+                if (rec.cmd.op_start) journal_begin_op(journal, canvas);
+                journal_exec(journal, canvas, &rec.cmd);
+                break;
+            case AUTOSAVE_REC_UNDO:
+                journal_undo(journal, canvas);
+                break;
+            case AUTOSAVE_REC_REDO:
+                journal_redo(journal, canvas);
+                break;
+            default:
+                break;
+        }
+        // undo/redo a vuoto non incrementano seq: riallinea
+        journal->seq = rec.seq;
+        replayed++;
+    }
+    fclose(f);
+    return replayed;
+}
+
+int autosave_recover(Journal *journal, Canvas *canvas,
+                     const char *project_path, const char *log_path)
+{
+    int loaded = project_load(journal, canvas, project_path);
+    if (loaded == -2) return -1;  // il log non ha una base su cui ripartire
+    int found = (loaded == 0);
+    int replayed = autosave_replay_log(journal, canvas, log_path);
+    if (replayed < 0) return found ? 0 : -1;
+    return replayed;
+}
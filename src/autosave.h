@@ -0,0 +1,108 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "journal.h"
+
+// Record in coda verso il thread di I/O
+#define AUTOSAVE_QUEUE_SIZE    16384
+// Finestra di raccolta prima di scrivere un batch (e fare fsync)
+#define AUTOSAVE_BATCH_US      200000
+// Oltre questa dimensione il log viene compattato in un checkpoint
+#define AUTOSAVE_MAX_LOG_BYTES (1024 * 1024)
+// Dopo un checkpoint fallito (disco pieno, rename negato) si riprova dopo
+// questo tempo o quando il log è cresciuto di un altro passo
+#define AUTOSAVE_RETRY_US        (30 * 1000000ull)
+#define AUTOSAVE_RETRY_LOG_BYTES (256 * 1024)
+
+#define AUTOSAVE_LOG_MAGIC 0x4C575244u  // "DRWL"
+
+typedef enum {
+    AUTOSAVE_REC_EXEC = JEVENT_EXEC,
+    AUTOSAVE_REC_UNDO = JEVENT_UNDO,
+    AUTOSAVE_REC_REDO = JEVENT_REDO,
+    AUTOSAVE_REC_CHECKPOINT         // solo in coda, mai scritto nel log
+} AutosaveRecType;
+
+// Record del write-ahead log, 32 byte
+typedef struct {
+    uint32_t   seq;
+    uint8_t    type;
+    uint8_t    pad[3];
+    JournalCmd cmd;
+    uint32_t   check;     // checksum dei byte precedenti: scarta record troncati
+} AutosaveRecord;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int running;
+    int stop;
+
+    // Coda circolare riempita dal thread di frame
+    AutosaveRecord *queue;
+    int queue_head;
+    int queue_count;
+    int overflow;         // record persi: serve un checkpoint completo
+
+    // Snapshot di journal e canvas per il checkpoint in corso
+    JournalCmd *ckpt_cmds;
+    unsigned int *ckpt_pixels;
+    int ckpt_width;
+    int ckpt_height;
+    int ckpt_count;
+    int ckpt_capacity;
+    unsigned int ckpt_bg;
+    uint32_t ckpt_seq;
+    int ckpt_pending;
+
+    // Checkpoint falliti di fila (sotto lock) e quando riprovare
+    int ckpt_failures;
+    uint64_t ckpt_retry_us;
+    long ckpt_retry_bytes;
+
+    int log_fd;
+    long log_bytes;       // sotto lock: scritto dal thread di I/O
+
+    char project_path[256];
+    char log_path[256];
+
+    // Statistiche (scritte dal thread di I/O)
+    unsigned int batches;
+    unsigned int syncs;
+    unsigned int records_written;
+    unsigned int checkpoints;
+    uint64_t max_sync_us;
+} Autosave;
+
+// Ripete sul journal gli eventi del log più recenti del checkpoint caricato.
+// Ritorna il numero di eventi ripetuti, o -1 se il log non c'è.
+int  autosave_replay_log(Journal *journal, Canvas *canvas, const char *log_path);
+
+// Versione sincrona completa: project_load + autosave_replay_log.
+// Ritorna gli eventi ripetuti, o -1 se non c'era nulla da ripristinare o
+// il progetto c'è ma non si legge (il log non va ripetuto su un foglio vuoto).
+int  autosave_recover(Journal *journal, Canvas *canvas,
+                      const char *project_path, const char *log_path);
+
+// Avvia il thread di I/O e si aggancia al journal. Il primo lavoro del
+// thread è un checkpoint completo, dopo il quale il log riparte vuoto.
+int  autosave_start(Autosave *autosave, Journal *journal, const Canvas *canvas,
+                    const char *project_path, const char *log_path);
+
+// Da chiamare una volta per frame: chiede un checkpoint se il log è
+// cresciuto troppo o se la coda è andata in overflow (dopo un fallimento
+// solo passati AUTOSAVE_RETRY_US o altri AUTOSAVE_RETRY_LOG_BYTES di log).
+// Ritorna i checkpoint falliti di fila, 0 se l'ultimo è stato scritto.
+int  autosave_update(Autosave *autosave, const Journal *journal, const Canvas *canvas);
+
+// Accoda un checkpoint (progetto a tile) dello stato corrente
+int  autosave_checkpoint(Autosave *autosave, const Journal *journal, const Canvas *canvas);
+
+// Checkpoint finale, svuota la coda e chiude il thread.
+// Con journal == NULL si svuota solo la coda, senza checkpoint.
+void autosave_stop(Autosave *autosave, Journal *journal, const Canvas *canvas);
+
+#endif
@@ -1,52 +1,61 @@
 #include "canvas.h"
+#include "stroke.h"
+#include "membudget.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
 int canvas_init(Canvas *canvas) {
-    canvas->pixels = (unsigned int *)malloc(SCREEN_W * SCREEN_H * sizeof(unsigned int));
-    if (!canvas->pixels) return -1;
+    unsigned int *pixels = mem_buffer_get(MEM_CANVAS, MEM_FRAME_BYTES);
+    if (!pixels) return -1;
 
-    canvas->undo_buffer = (unsigned int *)malloc(SCREEN_W * SCREEN_H * sizeof(unsigned int));
-    if (!canvas->undo_buffer) {
-        free(canvas->pixels);
-        return -1;
-    }
+    canvas_init_buffer(canvas, pixels, SCREEN_W, SCREEN_H);
 
     canvas->texture = vita2d_create_empty_texture_format(SCREEN_W, SCREEN_H, SCE_GXM_TEXTURE_FORMAT_A8B8G8R8);
     if (!canvas->texture) {
-        free(canvas->pixels);
-        free(canvas->undo_buffer);
+        mem_buffer_put(MEM_CANVAS, canvas->pixels, MEM_FRAME_BYTES);
+        canvas->pixels = NULL;
         return -1;
     }
 
+    canvas_clear(canvas, canvas->bg_color);
+
+    return 0;
+}
+
+void canvas_init_buffer(Canvas *canvas, unsigned int *pixels, int width, int height) {
+    canvas->pixels = pixels;
+    canvas->texture = NULL;
+    canvas->width = width;
+    canvas->height = height;
+
     canvas->bg_color = RGBA8(255, 255, 255, 255);
     canvas->current_color = RGBA8(0, 0, 0, 255);
     canvas->brush_size = 3;
     canvas->tool = TOOL_PENCIL;
+    canvas->pressure_mode = PRESSURE_SIZE;
+    canvas->gradient_mode = GRADIENT_LINEAR;
+    canvas->shape_fill = 0;
+    canvas->shape_aa = 1;
+    canvas->symmetry_mode = SYMMETRY_OFF;
+    canvas->symmetry_order = 8;
     canvas->shape_drawing = 0;
-    canvas->has_undo = 0;
-
-    canvas_clear(canvas, canvas->bg_color);
-
-    return 0;
 }
 
 void canvas_destroy(Canvas *canvas) {
-    if (canvas->pixels) free(canvas->pixels);
-    if (canvas->undo_buffer) free(canvas->undo_buffer);
+    if (canvas->pixels) mem_buffer_put(MEM_CANVAS, canvas->pixels, MEM_FRAME_BYTES);
     if (canvas->texture) vita2d_free_texture(canvas->texture);
 }
 
 void canvas_clear(Canvas *canvas, unsigned int color) {
-    for (int i = 0; i < SCREEN_W * SCREEN_H; i++) {
+    for (int i = 0; i < canvas->width * canvas->height; i++) {
         canvas->pixels[i] = color;
     }
 }
 
 void canvas_draw_pixel(Canvas *canvas, int x, int y, unsigned int color) {
-    if (x >= 0 && x < SCREEN_W && y >= 0 && y < SCREEN_H) {
-        canvas->pixels[y * SCREEN_W + x] = color;
+    if (x >= 0 && x < canvas->width && y >= 0 && y < canvas->height) {
+        canvas->pixels[y * canvas->width + x] = color;
     }
 }
 
@@ -82,8 +91,10 @@ void canvas_draw_line(Canvas *canvas, int x0, int y0, int x1, int y1, int size,
     }
 }
 
+// Stessi pixel di canvas_draw_line, riempiti per span invece che timbro per timbro
 void canvas_draw_line_brush(Canvas *canvas, int x0, int y0, int x1, int y1, int size, unsigned int color) {
-    canvas_draw_line(canvas, x0, y0, x1, y1, size, color);
+    stroke_draw_segment(canvas, x0, y0, size * STROKE_SUBPIXEL,
+                        x1, y1, size * STROKE_SUBPIXEL, color, 255, 0);
 }
 
 void canvas_draw_rect(Canvas *canvas, int x0, int y0, int x1, int y1, unsigned int color) {
@@ -153,9 +164,17 @@ void canvas_draw_filled_circle(Canvas *canvas, int cx, int cy, int radius, unsig
 }
 
 void canvas_draw_spray(Canvas *canvas, int x, int y, int radius, unsigned int color) {
+    canvas_draw_spray_seeded(canvas, x, y, radius, color, (unsigned int)rand());
+}
+
+void canvas_draw_spray_seeded(Canvas *canvas, int x, int y, int radius, unsigned int color, unsigned int seed) {
+    // LCG locale: non tocca lo stato di rand() e si ripete identico nel replay
+    unsigned int state = seed;
     for (int i = 0; i < radius * radius; i++) {
-        int dx = (rand() % (radius * 2 + 1)) - radius;
-        int dy = (rand() % (radius * 2 + 1)) - radius;
+        state = state * 1103515245u + 12345u;
+        int dx = (int)((state >> 16) % (unsigned int)(radius * 2 + 1)) - radius;
+        state = state * 1103515245u + 12345u;
+        int dy = (int)((state >> 16) % (unsigned int)(radius * 2 + 1)) - radius;
         if (dx * dx + dy * dy <= radius * radius) {
             canvas_draw_pixel(canvas, x + dx, y + dy, color);
         }
@@ -163,6 +182,7 @@ void canvas_draw_spray(Canvas *canvas, int x, int y, int radius, unsigned int co
 }
 
 void canvas_update_texture(Canvas *canvas) {
+    if (!canvas->texture) return;
     unsigned int *tex_data = (unsigned int *)vita2d_texture_get_datap(canvas->texture);
     int stride = vita2d_texture_get_stride(canvas->texture) / sizeof(unsigned int);
 
@@ -174,21 +194,3 @@ void canvas_update_texture(Canvas *canvas) {
 void canvas_render(const Canvas *canvas) {
     vita2d_draw_texture(canvas->texture, 0, 0);
 }
-
-void canvas_save_undo(Canvas *canvas) {
-    memcpy(canvas->undo_buffer, canvas->pixels, SCREEN_W * SCREEN_H * sizeof(unsigned int));
-    canvas->has_undo = 1;
-}
-
-void canvas_undo(Canvas *canvas) {
-    if (canvas->has_undo) {
-        // Swap buffers
-        unsigned int *temp = (unsigned int *)malloc(SCREEN_W * SCREEN_H * sizeof(unsigned int));
-        if (temp) {
-            memcpy(temp, canvas->pixels, SCREEN_W * SCREEN_H * sizeof(unsigned int));
-            memcpy(canvas->pixels, canvas->undo_buffer, SCREEN_W * SCREEN_H * sizeof(unsigned int));
-            memcpy(canvas->undo_buffer, temp, SCREEN_W * SCREEN_H * sizeof(unsigned int));
-            free(temp);
-        }
-    }
-}
@@ -20,34 +20,80 @@ typedef enum {
     TOOL_FILL_RECT,
     TOOL_FILL_CIRCLE,
     TOOL_SPRAY,
+    TOOL_SELECT,       // selezione rettangolare
+    TOOL_LASSO,        // selezione a mano libera
+    TOOL_BLUR,         // blur lungo il tratto
+    TOOL_SMUDGE,       // sfumino
+    TOOL_GRADIENT,     // gradiente tra colore primario e secondario
+    TOOL_ERASE_OBJECT, // gomma a oggetti: toglie tratti interi
+    TOOL_ELLIPSE,      // ellisse centrata nel primo tocco
+    TOOL_ROUND_RECT,   // rettangolo con angoli arrotondati
+    TOOL_POLYGON,      // poligono: un vertice per tocco, si chiude sul primo
     TOOL_COUNT
 } ToolType;
 
+// Uso della pressione del touch nei tratti continui
+typedef enum {
+    PRESSURE_OFF,
+    PRESSURE_SIZE,          // spessore
+    PRESSURE_SIZE_OPACITY,  // spessore e opacità
+    PRESSURE_MODE_COUNT
+} PressureMode;
+
+// Forma dello strumento gradiente
+typedef enum {
+    GRADIENT_LINEAR,        // lineare su tutto il canvas
+    GRADIENT_RADIAL,        // radiale su tutto il canvas
+    GRADIENT_LINEAR_RECT,   // lineare dentro il rettangolo trascinato
+    GRADIENT_RADIAL_CIRCLE, // radiale dentro il cerchio trascinato
+    GRADIENT_MODE_COUNT
+} GradientMode;
+
+// Simmetria: ogni comando di disegno viene replicato (vedi symmetry.h)
+typedef enum {
+    SYMMETRY_OFF,
+    SYMMETRY_MIRROR_H,      // specchio sinistra/destra (asse verticale)
+    SYMMETRY_MIRROR_V,      // specchio alto/basso (asse orizzontale)
+    SYMMETRY_MIRROR_HV,     // entrambi gli specchi: 4 copie
+    SYMMETRY_RADIAL,        // symmetry_order copie ruotate attorno al centro
+    SYMMETRY_MODE_COUNT
+} SymmetryMode;
+
 typedef struct {
     // Buffer pixel del canvas (SCREEN_W * SCREEN_H)
     unsigned int *pixels;
-    vita2d_texture *texture;
+    vita2d_texture *texture;  // NULL per canvas offscreen
+    int width;
+    int height;
 
     // Stato corrente
     unsigned int current_color;
     unsigned int bg_color;
     int brush_size;
     ToolType tool;
+    PressureMode pressure_mode;
+    GradientMode gradient_mode;
+    // Stile delle forme: piene (Ellipse, RoundRect, Polygon) e antialiasing
+    int shape_fill;
+    int shape_aa;
+    // Simmetria dei comandi registrati, attorno al centro del canvas
+    SymmetryMode symmetry_mode;
+    int symmetry_order;
 
     // Per strumenti che richiedono 2 punti (linea, rettangolo, cerchio)
     int shape_start_x;
     int shape_start_y;
     int shape_drawing;  // 1 se stiamo definendo il secondo punto
-
-    // Undo: salvataggio di un singolo stato
-    unsigned int *undo_buffer;
-    int has_undo;
 } Canvas;
 
 int  canvas_init(Canvas *canvas);
+// Canvas offscreen su un buffer esterno (replay, export), senza texture
+void canvas_init_buffer(Canvas *canvas, unsigned int *pixels, int width, int height);
 void canvas_destroy(Canvas *canvas);
 void canvas_clear(Canvas *canvas, unsigned int color);
 void canvas_draw_pixel(Canvas *canvas, int x, int y, unsigned int color);
+// Riferimento un timbro alla volta: i percorsi a span (canvas_draw_line_brush,
+// stroke_draw_segment) devono dare gli stessi pixel, vedi drawrastercheck
 void canvas_draw_brush(Canvas *canvas, int x, int y, int size, unsigned int color);
 void canvas_draw_line(Canvas *canvas, int x0, int y0, int x1, int y1, int size, unsigned int color);
 void canvas_draw_rect(Canvas *canvas, int x0, int y0, int x1, int y1, unsigned int color);
@@ -55,12 +101,20 @@ void canvas_draw_filled_rect(Canvas *canvas, int x0, int y0, int x1, int y1, uns
 void canvas_draw_circle(Canvas *canvas, int cx, int cy, int radius, unsigned int color);
 void canvas_draw_filled_circle(Canvas *canvas, int cx, int cy, int radius, unsigned int color);
 void canvas_draw_spray(Canvas *canvas, int x, int y, int radius, unsigned int color);
+// Spray deterministico: stesso seed, stessi punti (necessario per il replay)
+void canvas_draw_spray_seeded(Canvas *canvas, int x, int y, int radius, unsigned int color, unsigned int seed);
 void canvas_update_texture(Canvas *canvas);
 void canvas_render(const Canvas *canvas);
-void canvas_save_undo(Canvas *canvas);
-void canvas_undo(Canvas *canvas);
 
 // Interpolazione per disegno continuo touch
 void canvas_draw_line_brush(Canvas *canvas, int x0, int y0, int x1, int y1, int size, unsigned int color);
 
+// Miscela per canale di due pixel: t in [0, 256], 0 = a, 256 = b, troncando.
+// Rosso/blu e alfa/verde si calcolano insieme nelle due metà di una word.
+static inline unsigned int canvas_lerp(unsigned int a, unsigned int b, int t) {
+    unsigned int rb = (((a & 0x00FF00FFu) * (256 - t) + (b & 0x00FF00FFu) * t) >> 8) & 0x00FF00FFu;
+    unsigned int ag = ((((a >> 8) & 0x00FF00FFu) * (256 - t) + ((b >> 8) & 0x00FF00FFu) * t) >> 8) & 0x00FF00FFu;
+    return rb | (ag << 8);
+}
+
 #endif
@@ -22,6 +22,7 @@ void palette_init(ColorPalette *palette) {
     palette->colors[18] = COLOR_LIME;
     palette->colors[19] = COLOR_TEAL;
     palette->selected = 0;
+    palette->secondary = 1;
 }
 
 unsigned int palette_get_current(const ColorPalette *palette) {
@@ -41,3 +42,13 @@ void palette_select_index(ColorPalette *palette, int index) {
         palette->selected = index;
     }
 }
+
+unsigned int palette_get_secondary(const ColorPalette *palette) {
+    return palette->colors[palette->secondary];
+}
+
+void palette_swap(ColorPalette *palette) {
+    int tmp = palette->selected;
+    palette->selected = palette->secondary;
+    palette->secondary = tmp;
+}
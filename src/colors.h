@@ -35,6 +35,7 @@
 typedef struct {
     unsigned int colors[NUM_PALETTE_COLORS];
     int selected;
+    int secondary;      // secondo colore (gradiente)
 } ColorPalette;
 
 void palette_init(ColorPalette *palette);
@@ -42,5 +43,8 @@ unsigned int palette_get_current(const ColorPalette *palette);
 void palette_select_next(ColorPalette *palette);
 void palette_select_prev(ColorPalette *palette);
 void palette_select_index(ColorPalette *palette, int index);
+unsigned int palette_get_secondary(const ColorPalette *palette);
+// Scambia colore primario e secondario
+void palette_swap(ColorPalette *palette);
 
 #endif
@@ -0,0 +1,444 @@
+#include "export.h"
+#include "membudget.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <png.h>
+
+// Area ridisegnata per una banda le cui dipendenze (trasformazioni, filtri)
+// arrivano lontano: oltre questo limite la banda si ingrandisce dal canvas
+// come in EXPORT_BILINEAR, invece di ridisegnare mezza immagine
+#define EXPORT_AREA_MAX_BYTES (4u * 1024 * 1024)
+
+typedef struct {
+    const Canvas *src;
+    int scale;
+    ExportFilter filter;
+    int out_w;
+    int out_h;
+    int num_bands;
+
+    // Re-raster: comandi dopo l'ultimo clear e il loro rettangolo (vuoto per
+    // quelli degli oggetti tolti con la gomma)
+    const JournalCmd *cmds;
+    int num_cmds;
+    unsigned int base_color;
+    int *cmd_bounds;
+
+    unsigned int *band_buf[WORKPOOL_MAX_THREADS + 1];
+    size_t band_bytes;
+    int upscaled_bands;
+    ExportWorker *worker;   // avanzamento dell'export asincrono (o NULL)
+
+    // Le bande si scrivono in ordine: chi ha finito aspetta il suo turno
+    png_structp png;
+    pthread_mutex_t turn_lock;
+    pthread_cond_t turn_cond;
+    int next_write;
+    int failed;
+} ExportJob;
+
+// Rettangolo da ridisegnare per avere corretto (x, y, w, h) dopo i comandi
+// del job. Trasformazioni, filtri e sfumino leggono pixel fuori da ciò che
+// scrivono: risalendo i comandi, l'area si allarga alla loro sorgente.
+static void export_needed_rect(const ExportJob *job, int *x, int *y, int *w, int *h) {
+    int x0 = *x, y0 = *y, x1 = *x + *w, y1 = *y + *h;
+    const JournalCmd *cmds = job->cmds;
+    for (int i = job->num_cmds - 1; i >= 0; i--) {
+        const int *b = &job->cmd_bounds[i * 4];
+        if (b[2] < x0 || b[0] >= x1 || b[3] < y0 || b[1] >= y1) continue;
+
+        int sx, sy, sw, sh;
+        if (!journal_cmd_source_rect(&cmds[i], job->scale, x0, y0, x1 - x0, y1 - y0,
+                                     &sx, &sy, &sw, &sh)) continue;
+        if (sx < x0) x0 = sx;
+        if (sy < y0) y0 = sy;
+        if (sx + sw > x1) x1 = sx + sw;
+        if (sy + sh > y1) y1 = sy + sh;
+        // Fuori dall'immagine non c'è nulla da leggere, come nel canvas intero
+        if (x0 < 0) x0 = 0;
+        if (y0 < 0) y0 = 0;
+        if (x1 > job->out_w) x1 = job->out_w;
+        if (y1 > job->out_h) y1 = job->out_h;
+    }
+    *x = x0;
+    *y = y0;
+    *w = x1 - x0;
+    *h = y1 - y0;
+}
+
+// Disegna il rettangolo (x, y, w, h) dell'output dopo i comandi del job
+static void export_render_region(ExportJob *job, unsigned int *buf, int x, int y, int w, int h) {
+    Canvas region;
+    canvas_init_buffer(&region, buf, w, h);
+    canvas_clear(&region, job->base_color);
+
+    const JournalCmd *cmds = job->cmds;
+    for (int i = 0; i < job->num_cmds; i++) {
+        const int *b = &job->cmd_bounds[i * 4];
+        if (b[2] < x || b[0] >= x + w || b[3] < y || b[1] >= y + h) continue;
+        journal_apply_offset(&cmds[i], &region, job->scale, -x, -y);
+    }
+}
+
+static void export_band_nearest(ExportJob *job, unsigned int *buf, int y0, int rows) {
+    const Canvas *src = job->src;
+    int s = job->scale;
+    for (int y = 0; y < rows; y++) {
+        const unsigned int *src_row = &src->pixels[((y0 + y) / s) * src->width];
+        unsigned int *dst = &buf[y * job->out_w];
+        for (int sx = 0; sx < src->width; sx++) {
+            unsigned int c = src_row[sx];
+            for (int k = 0; k < s; k++) *dst++ = c;
+        }
+    }
+}
+
+// Coordinata sorgente in 16.16 del centro del pixel di output, limitata al bordo
+static int export_src_coord(int out, int scale, int limit, int *frac) {
+    int fx = ((2 * out + 1) << 16) / (2 * scale) - 32768;
+    if (fx < 0) fx = 0;
+    int ix = fx >> 16;
+    if (ix >= limit - 1) {
+        *frac = 0;
+        return limit - 1;
+    }
+    *frac = (fx >> 8) & 0xFF;
+    return ix;
+}
+
+static void export_band_bilinear(ExportJob *job, unsigned int *buf, int y0, int rows) {
+    const Canvas *src = job->src;
+    int s = job->scale;
+    for (int y = 0; y < rows; y++) {
+        int fy;
+        int sy = export_src_coord(y0 + y, s, src->height, &fy);
+        const unsigned int *r0 = &src->pixels[sy * src->width];
+        const unsigned int *r1 = (sy + 1 < src->height) ? r0 + src->width : r0;
+        unsigned int *dst = &buf[y * job->out_w];
+
+        for (int x = 0; x < job->out_w; x++) {
+            int fx;
+            int sx = export_src_coord(x, s, src->width, &fx);
+            int sx1 = (sx + 1 < src->width) ? sx + 1 : sx;
+            unsigned int top = canvas_lerp(r0[sx], r0[sx1], fx);
+            unsigned int bottom = canvas_lerp(r1[sx], r1[sx1], fx);
+            dst[x] = canvas_lerp(top, bottom, fy);
+        }
+    }
+}
+
+// Ritorna 1 se la banda è stata ingrandita dal canvas invece che ridisegnata
+static int export_band_reraster(ExportJob *job, unsigned int *buf, int y0, int rows) {
+    int x = 0, y = y0, w = job->out_w, h = rows;
+    export_needed_rect(job, &x, &y, &w, &h);
+    if (w == job->out_w && h == rows) {
+        export_render_region(job, buf, 0, y0, w, rows);
+        return 0;
+    }
+
+    // La banda dipende da righe fuori di sé: si ridisegna l'area più alta
+    // (le bande sono già larghe quanto l'immagine), se sta nel limite
+    size_t area_bytes = (size_t)w * h * sizeof(unsigned int);
+    unsigned int *area = (area_bytes <= EXPORT_AREA_MAX_BYTES) ?
+                         (unsigned int *)mem_alloc(MEM_SCRATCH, area_bytes) : NULL;
+    if (!area) {
+        export_band_bilinear(job, buf, y0, rows);
+        return 1;
+    }
+    export_render_region(job, area, x, y, w, h);
+    memcpy(buf, &area[(y0 - y) * w], (size_t)rows * w * sizeof(unsigned int));
+    mem_free(MEM_SCRATCH, area, area_bytes);
+    return 0;
+}
+
+static void export_band_task(void *ctx, int band, int worker) {
+    ExportJob *job = (ExportJob *)ctx;
+    unsigned int *buf = job->band_buf[worker];
+    int y0 = band * EXPORT_BAND_HEIGHT;
+    int rows = (y0 + EXPORT_BAND_HEIGHT <= job->out_h) ? EXPORT_BAND_HEIGHT : job->out_h - y0;
+
+    int upscaled = 0;
+    switch (job->filter) {
+        case EXPORT_RERASTER: upscaled = export_band_reraster(job, buf, y0, rows); break;
+        case EXPORT_NEAREST:  export_band_nearest(job, buf, y0, rows);  break;
+        default:              export_band_bilinear(job, buf, y0, rows); break;
+    }
+
+    pthread_mutex_lock(&job->turn_lock);
+    while (job->next_write != band) {
+        pthread_cond_wait(&job->turn_cond, &job->turn_lock);
+    }
+    job->upscaled_bands += upscaled;
+    if (!job->failed) {
+        if (setjmp(png_jmpbuf(job->png))) {
+            job->failed = 1;
+        } else {
+            for (int y = 0; y < rows; y++) {
+                png_write_row(job->png, (png_const_bytep)&buf[y * job->out_w]);
+            }
+        }
+    }
+    job->next_write++;
+    if (job->worker) {
+        pthread_mutex_lock(&job->worker->lock);
+        job->worker->bands_done = job->next_write;
+        pthread_mutex_unlock(&job->worker->lock);
+    }
+    pthread_cond_broadcast(&job->turn_cond);
+    pthread_mutex_unlock(&job->turn_lock);
+}
+
+static size_t export_bounds_bytes(int num_cmds) {
+    return (size_t)(num_cmds > 0 ? num_cmds : 1) * 4 * sizeof(int);
+}
+
+// Comandi attivi dopo l'ultimo clear (ancora nel journal) e rettangolo (in
+// output) di ognuno, per saltarlo nelle bande che non tocca
+static int export_prepare_reraster(ExportJob *job, const Journal *journal) {
+    int first_cmd = 0;
+    job->base_color = journal->bg_color;
+    for (int i = journal->cursor - 1; i >= 0; i--) {
+        if (journal->cmds[i].type == JCMD_CLEAR) {
+            first_cmd = i + 1;
+            job->base_color = journal->cmds[i].color;
+            break;
+        }
+    }
+
+    int n = journal->cursor - first_cmd;
+    job->cmds = journal->cmds + first_cmd;
+    job->num_cmds = n;
+    job->cmd_bounds = (int *)mem_alloc(MEM_SCRATCH, export_bounds_bytes(n));
+    if (!job->cmd_bounds) return -1;
+
+    for (int i = 0; i < n; i++) {
+        int *b = &job->cmd_bounds[i * 4];
+        if (!journal_cmd_bounds(&job->cmds[i], job->scale, &b[0], &b[1], &b[2], &b[3])) {
+            b[0] = INT_MIN;
+            b[1] = INT_MIN;
+            b[2] = INT_MAX;
+            b[3] = INT_MAX;
+        }
+    }
+
+    // Oggetti tolti con la gomma: i loro comandi non toccano nessuna banda
+    const StrokeIndex *index = &journal->index;
+    int obj = stroke_index_find(index, first_cmd);
+    for (obj = (obj < 0) ? 0 : obj; obj < index->count; obj++) {
+        int first = index->objects[obj].first_cmd;
+        if (first >= journal->cursor) break;
+        if (!stroke_index_hidden(index, obj, journal->cursor)) continue;
+        int last = (obj + 1 < index->count) ? index->objects[obj + 1].first_cmd : journal->cursor;
+        if (first < first_cmd) first = first_cmd;
+        if (last > journal->cursor) last = journal->cursor;
+        for (int i = first; i < last; i++) {
+            int *b = &job->cmd_bounds[(i - first_cmd) * 4];
+            b[0] = INT_MAX;
+            b[1] = INT_MAX;
+            b[2] = INT_MIN;
+            b[3] = INT_MIN;
+        }
+    }
+    return 0;
+}
+
+static void export_job_init(ExportJob *job, const Canvas *canvas, int scale, ExportFilter filter) {
+    memset(job, 0, sizeof(ExportJob));
+    job->src = canvas;
+    job->scale = scale;
+    job->filter = filter;
+    job->out_w = canvas->width * scale;
+    job->out_h = canvas->height * scale;
+    job->num_bands = (job->out_h + EXPORT_BAND_HEIGHT - 1) / EXPORT_BAND_HEIGHT;
+    job->band_bytes = (size_t)job->out_w * EXPORT_BAND_HEIGHT * sizeof(unsigned int);
+}
+
+// Bande nel writer di libpng, una per worker alla volta
+static int export_run(ExportJob *job, const char *path, WorkPool *pool, ExportStats *stats,
+                      uint64_t start)
+{
+    int workers = pool ? workpool_size(pool) : 1;
+    int ok = 1;
+    for (int i = 0; i < workers && ok; i++) {
+        job->band_buf[i] = (unsigned int *)mem_alloc(MEM_SCRATCH, job->band_bytes);
+        ok = job->band_buf[i] != NULL;
+    }
+
+    FILE *f = ok ? fopen(path, "wb") : NULL;
+    png_infop info = NULL;
+    if (f) {
+        job->png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+        info = job->png ? png_create_info_struct(job->png) : NULL;
+    }
+    ok = f && info;
+
+    if (ok && setjmp(png_jmpbuf(job->png))) {
+        ok = 0;
+    } else if (ok) {
+        png_init_io(job->png, f);
+        png_set_compression_level(job->png, EXPORT_PNG_LEVEL);
+        png_set_IHDR(job->png, info, job->out_w, job->out_h, 8, PNG_COLOR_TYPE_RGBA,
+                     PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        png_write_info(job->png, info);
+
+        pthread_mutex_init(&job->turn_lock, NULL);
+        pthread_cond_init(&job->turn_cond, NULL);
+        if (pool) {
+            workpool_run(pool, job->num_bands, export_band_task, job);
+        } else {
+            for (int b = 0; b < job->num_bands; b++) export_band_task(job, b, 0);
+        }
+        pthread_mutex_destroy(&job->turn_lock);
+        pthread_cond_destroy(&job->turn_cond);
+
+        if (job->failed) {
+            ok = 0;
+        } else if (setjmp(png_jmpbuf(job->png))) {
+            ok = 0;
+        } else {
+            png_write_end(job->png, NULL);
+        }
+    }
+
+    if (job->png) png_destroy_write_struct(&job->png, info ? &info : NULL);
+    if (f && fclose(f) != 0) ok = 0;
+    if (!ok && f) remove(path);
+
+    for (int i = 0; i < workers; i++) {
+        if (job->band_buf[i]) mem_free(MEM_SCRATCH, job->band_buf[i], job->band_bytes);
+    }
+
+    if (stats) {
+        stats->seconds = (double)(platform_time_us() - start) / 1000000.0;
+        stats->band_bytes = job->band_bytes;
+        stats->bands = job->num_bands;
+        stats->upscaled_bands = job->upscaled_bands;
+        stats->workers = workers;
+    }
+    return ok ? 0 : -1;
+}
+
+int export_png(const char *path, const Journal *journal, const Canvas *canvas,
+               int scale, ExportFilter filter, WorkPool *pool, ExportStats *stats)
+{
+    if (scale < 1 || scale > EXPORT_SCALE_MAX) return -1;
+    if (filter == EXPORT_RERASTER && !journal) return -1;
+
+    uint64_t start = platform_time_us();
+    ExportJob job;
+    export_job_init(&job, canvas, scale, filter);
+    int ok = (filter != EXPORT_RERASTER || export_prepare_reraster(&job, journal) == 0);
+    if (ok) ok = export_run(&job, path, pool, stats, start) == 0;
+    if (job.cmd_bounds) mem_free(MEM_SCRATCH, job.cmd_bounds, export_bounds_bytes(job.num_cmds));
+    return ok ? 0 : -1;
+}
+
+static void *export_worker_thread(void *arg) {
+    ExportWorker *worker = (ExportWorker *)arg;
+    uint64_t start = platform_time_us();
+
+    ExportJob job;
+    export_job_init(&job, &worker->canvas, worker->scale, worker->filter);
+    job.cmds = worker->cmds;
+    job.num_cmds = worker->num_cmds;
+    job.base_color = worker->base_color;
+    job.cmd_bounds = worker->cmd_bounds;
+    job.worker = worker;
+
+    // Pool proprio: quello del thread di frame serve ai filtri del journal
+    WorkPool pool;
+    int pooled = worker->workers > 1 && workpool_init(&pool, worker->workers) == 0;
+    ExportStats stats;
+    int result = export_run(&job, worker->path, pooled ? &pool : NULL, &stats, start);
+    if (pooled) workpool_destroy(&pool);
+
+    pthread_mutex_lock(&worker->lock);
+    worker->result = result;
+    worker->stats = stats;
+    worker->finished = 1;
+    pthread_mutex_unlock(&worker->lock);
+    return NULL;
+}
+
+static void export_worker_free(ExportWorker *worker) {
+    if (worker->cmds) {
+        mem_free(MEM_SCRATCH, worker->cmds, (size_t)worker->num_cmds * sizeof(JournalCmd));
+    }
+    if (worker->cmd_bounds) {
+        mem_free(MEM_SCRATCH, worker->cmd_bounds, export_bounds_bytes(worker->num_cmds));
+    }
+    if (worker->pixels) {
+        mem_buffer_put(MEM_SCRATCH, worker->pixels,
+                       (size_t)worker->canvas.width * worker->canvas.height * sizeof(unsigned int));
+    }
+    worker->cmds = NULL;
+    worker->cmd_bounds = NULL;
+    worker->pixels = NULL;
+}
+
+int export_png_async(ExportWorker *worker, const char *path, const Journal *journal,
+                     const Canvas *canvas, int scale, ExportFilter filter, int workers)
+{
+    memset(worker, 0, sizeof(ExportWorker));
+    if (scale < 1 || scale > EXPORT_SCALE_MAX) return -1;
+    if (filter == EXPORT_RERASTER && !journal) return -1;
+    snprintf(worker->path, sizeof(worker->path), "%s", path);
+    worker->scale = scale;
+    worker->filter = filter;
+    worker->workers = workers;
+
+    // Copia dei pixel (bande ingrandite e filtri non-reraster) e dei comandi
+    // dopo l'ultimo clear, con i rettangoli già calcolati sull'indice
+    size_t pixel_bytes = (size_t)canvas->width * canvas->height * sizeof(unsigned int);
+    worker->pixels = mem_buffer_get(MEM_SCRATCH, pixel_bytes);
+    if (!worker->pixels) return -1;
+    memcpy(worker->pixels, canvas->pixels, pixel_bytes);
+    canvas_init_buffer(&worker->canvas, worker->pixels, canvas->width, canvas->height);
+
+    if (filter == EXPORT_RERASTER) {
+        ExportJob job;
+        export_job_init(&job, canvas, scale, filter);
+        int ok = export_prepare_reraster(&job, journal) == 0;
+        worker->cmd_bounds = job.cmd_bounds;
+        worker->num_cmds = job.num_cmds;
+        worker->base_color = job.base_color;
+        size_t cmd_bytes = (size_t)job.num_cmds * sizeof(JournalCmd);
+        if (ok && job.num_cmds > 0) {
+            worker->cmds = (JournalCmd *)mem_alloc(MEM_SCRATCH, cmd_bytes);
+            ok = worker->cmds != NULL;
+            if (ok) memcpy(worker->cmds, job.cmds, cmd_bytes);
+        }
+        if (!ok) {
+            export_worker_free(worker);
+            return -1;
+        }
+    }
+    worker->bands = (canvas->height * scale + EXPORT_BAND_HEIGHT - 1) / EXPORT_BAND_HEIGHT;
+
+    pthread_mutex_init(&worker->lock, NULL);
+    if (pthread_create(&worker->thread, NULL, export_worker_thread, worker) != 0) {
+        pthread_mutex_destroy(&worker->lock);
+        export_worker_free(worker);
+        return -1;
+    }
+    return 0;
+}
+
+int export_worker_done(ExportWorker *worker, int *bands_done) {
+    pthread_mutex_lock(&worker->lock);
+    int done = worker->finished;
+    if (bands_done) *bands_done = worker->bands_done;
+    pthread_mutex_unlock(&worker->lock);
+    return done;
+}
+
+int export_worker_finish(ExportWorker *worker, ExportStats *stats) {
+    pthread_join(worker->thread, NULL);
+    pthread_mutex_destroy(&worker->lock);
+    export_worker_free(worker);
+    if (stats) *stats = worker->stats;
+    return worker->result;
+}
@@ -0,0 +1,68 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stddef.h>
+#include "canvas.h"
+#include "journal.h"
+#include "workpool.h"
+
+// Righe di output per banda: la memoria di picco è una banda per worker
+// (più l'area di trasformazioni, filtri e sfumino che la banda attraversa)
+#define EXPORT_BAND_HEIGHT 32
+#define EXPORT_SCALE_MAX   8
+// Compressione PNG: più veloce del default, file poco più grandi
+#define EXPORT_PNG_LEVEL   3
+
+typedef enum {
+    EXPORT_RERASTER,   // ridisegna il journal alla nuova risoluzione
+    EXPORT_NEAREST,    // ingrandisce i pixel del canvas
+    EXPORT_BILINEAR,
+    EXPORT_FILTER_COUNT
+} ExportFilter;
+
+typedef struct {
+    double seconds;
+    size_t band_bytes;   // memoria di una banda
+    int bands;
+    int upscaled_bands;  // re-raster: bande con l'area da ridisegnare oltre il
+                         // limite, ingrandite dal canvas in bilineare
+    int workers;
+} ExportStats;
+
+// Export su un thread proprio, su una copia di pixel e comandi presa
+// all'avvio: il thread di frame continua a disegnare
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    char path[256];
+    int scale;
+    ExportFilter filter;
+    int workers;
+    Canvas canvas;           // sui pixel copiati
+    unsigned int *pixels;
+    JournalCmd *cmds;        // comandi attivi dopo l'ultimo clear
+    int num_cmds;
+    int *cmd_bounds;
+    unsigned int base_color;
+    int bands;
+    int bands_done;          // sotto lock
+    int finished;
+    int result;
+    ExportStats stats;
+} ExportWorker;
+
+// Esporta canvas (o journal, per EXPORT_RERASTER) a scale volte la sua
+// risoluzione, una banda alla volta direttamente nel writer di libpng.
+// pool può essere NULL (un solo thread); stats può essere NULL.
+int export_png(const char *path, const Journal *journal, const Canvas *canvas,
+               int scale, ExportFilter filter, WorkPool *pool, ExportStats *stats);
+
+// Come export_png, su un thread con un pool di workers thread (incluso il
+// suo). Dal thread di frame: la copia di journal e canvas si prende qui.
+int  export_png_async(ExportWorker *worker, const char *path, const Journal *journal,
+                      const Canvas *canvas, int scale, ExportFilter filter, int workers);
+// 1 a export finito; bands_done (può essere NULL) riceve le bande scritte
+int  export_worker_done(ExportWorker *worker, int *bands_done);
+int  export_worker_finish(ExportWorker *worker, ExportStats *stats);
+
+#endif
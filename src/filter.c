@@ -0,0 +1,339 @@
+#include "filter.h"
+#include "stroke.h"
+#include "membudget.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Porzione di immagine con passo di riga: area del canvas o buffer temporaneo
+typedef struct {
+    unsigned int *p;
+    int stride;
+} FilterPlane;
+
+// Una passata (orizzontale o verticale) divisa in bande di righe
+typedef struct {
+    FilterPlane src, dst;
+    int w, h;
+    int radius;
+    uint32_t mul;       // 2^24 / (2r + 1): la divisione per la finestra
+    int band_rows;
+    int num_bands;
+    int sharpen;        // dst = dst + (dst - blur) * amount / 64
+    int amount;
+    uint32_t *sums;     // somme per colonna, 4 canali * w per worker
+} FilterPass;
+
+int filter_halo(FilterType type, int radius) {
+    (void)type;
+    return FILTER_BLUR_PASSES * radius;
+}
+
+// sum <= 255 * (2r + 1), quindi sum * mul <= 255 * 2^24: sta in 32 bit
+static inline unsigned int filter_pack(uint32_t s0, uint32_t s1, uint32_t s2, uint32_t s3,
+                                       uint32_t mul)
+{
+    const uint32_t half = 1u << 23;
+    return ((s0 * mul + half) >> 24) |
+           (((s1 * mul + half) >> 24) << 8) |
+           (((s2 * mul + half) >> 24) << 16) |
+           (((s3 * mul + half) >> 24) << 24);
+}
+
+static unsigned int filter_sharpen_px(unsigned int orig, unsigned int blur, int amount) {
+    unsigned int out = orig & 0xFF000000u;  // l'alpha resta com'è
+    for (int shift = 0; shift < 24; shift += 8) {
+        int o = (int)((orig >> shift) & 0xFF);
+        int b = (int)((blur >> shift) & 0xFF);
+        int v = o + (o - b) * amount / 64;
+        if (v < 0) v = 0;
+        if (v > 255) v = 255;
+        out |= (unsigned int)v << shift;
+    }
+    return out;
+}
+
+static inline int filter_clamp(int v, int hi) {
+    return (v < 0) ? 0 : (v > hi ? hi : v);
+}
+
+// Box orizzontale di una riga: finestra scorrevole, il bordo si ripete
+static void filter_row_h(const unsigned int *src, unsigned int *dst, int w, int r, uint32_t mul) {
+    uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (int k = -r; k <= r; k++) {
+        unsigned int c = src[filter_clamp(k, w - 1)];
+        s0 += c & 0xFF;
+        s1 += (c >> 8) & 0xFF;
+        s2 += (c >> 16) & 0xFF;
+        s3 += c >> 24;
+    }
+    for (int x = 0; x < w; x++) {
+        dst[x] = filter_pack(s0, s1, s2, s3, mul);
+        unsigned int in = src[(x + r + 1 < w) ? x + r + 1 : w - 1];
+        unsigned int out = src[(x - r > 0) ? x - r : 0];
+        s0 += (in & 0xFF) - (out & 0xFF);
+        s1 += ((in >> 8) & 0xFF) - ((out >> 8) & 0xFF);
+        s2 += ((in >> 16) & 0xFF) - ((out >> 16) & 0xFF);
+        s3 += (in >> 24) - (out >> 24);
+    }
+}
+
+static void filter_task_h(void *ctx, int band, int worker) {
+    FilterPass *p = (FilterPass *)ctx;
+    (void)worker;
+    int y0 = band * p->band_rows;
+    int y1 = (y0 + p->band_rows < p->h) ? y0 + p->band_rows : p->h;
+    for (int y = y0; y < y1; y++) {
+        filter_row_h(&p->src.p[y * p->src.stride], &p->dst.p[y * p->dst.stride],
+                     p->w, p->radius, p->mul);
+    }
+}
+
+static inline void filter_sums_add(uint32_t *sums, const unsigned int *row, int w) {
+    for (int x = 0; x < w; x++) {
+        unsigned int c = row[x];
+        sums[4 * x]     += c & 0xFF;
+        sums[4 * x + 1] += (c >> 8) & 0xFF;
+        sums[4 * x + 2] += (c >> 16) & 0xFF;
+        sums[4 * x + 3] += c >> 24;
+    }
+}
+
+// Box verticale su una banda: le somme per colonna partono dalle r righe
+// di alone sopra la banda e scorrono riga per riga. Le bande leggono solo
+// src, quindi possono scrivere dst in parallelo.
+static void filter_task_v(void *ctx, int band, int worker) {
+    FilterPass *p = (FilterPass *)ctx;
+    int w = p->w, r = p->radius;
+    int y0 = band * p->band_rows;
+    int y1 = (y0 + p->band_rows < p->h) ? y0 + p->band_rows : p->h;
+    uint32_t *sums = &p->sums[(size_t)worker * w * 4];
+    const unsigned int *src = p->src.p;
+    int stride = p->src.stride;
+
+    memset(sums, 0, (size_t)w * 4 * sizeof(uint32_t));
+    for (int k = y0 - r; k <= y0 + r; k++) {
+        filter_sums_add(sums, &src[filter_clamp(k, p->h - 1) * stride], w);
+    }
+
+    for (int y = y0; y < y1; y++) {
+        unsigned int *dst = &p->dst.p[y * p->dst.stride];
+        const unsigned int *in = &src[((y + r + 1 < p->h) ? y + r + 1 : p->h - 1) * stride];
+        const unsigned int *out = &src[((y - r > 0) ? y - r : 0) * stride];
+        for (int x = 0; x < w; x++) {
+            uint32_t *s = &sums[4 * x];
+            unsigned int v = filter_pack(s[0], s[1], s[2], s[3], p->mul);
+            dst[x] = p->sharpen ? filter_sharpen_px(dst[x], v, p->amount) : v;
+
+            unsigned int a = in[x], b = out[x];
+            s[0] += (a & 0xFF) - (b & 0xFF);
+            s[1] += ((a >> 8) & 0xFF) - ((b >> 8) & 0xFF);
+            s[2] += ((a >> 16) & 0xFF) - ((b >> 16) & 0xFF);
+            s[3] += (a >> 24) - (b >> 24);
+        }
+    }
+}
+
+static void filter_run_pass(FilterPass *p, WorkFn fn, WorkPool *pool) {
+    if (pool) {
+        workpool_run(pool, p->num_bands, fn, p);
+    } else {
+        for (int b = 0; b < p->num_bands; b++) fn(p, b, 0);
+    }
+}
+
+// Filtra target (w x h) sul posto. Ogni passata di blur va da target (o dal
+// risultato intermedio) a tmp in orizzontale e torna indietro in verticale.
+static int filter_plane(FilterPlane target, int w, int h, FilterType type,
+                        int radius, int amount, WorkPool *pool)
+{
+    if (w <= 0 || h <= 0 || radius < 1) return 0;
+
+    int workers = pool ? workpool_size(pool) : 1;
+    size_t plane_bytes = (size_t)w * h * sizeof(unsigned int);
+    int need_mid = (type == FILTER_SHARPEN && FILTER_BLUR_PASSES > 1);
+    unsigned int *tmp = (unsigned int *)mem_scratch_alloc(plane_bytes);
+    unsigned int *mid = need_mid ? (unsigned int *)mem_scratch_alloc(plane_bytes) : NULL;
+    uint32_t *sums = (uint32_t *)mem_scratch_alloc((size_t)workers * w * 4 * sizeof(uint32_t));
+    if (!tmp || (need_mid && !mid) || !sums) {
+        mem_scratch_free(tmp);
+        mem_scratch_free(mid);
+        mem_scratch_free(sums);
+        return -1;
+    }
+
+    FilterPass p;
+    memset(&p, 0, sizeof(p));
+    p.w = w;
+    p.h = h;
+    p.radius = radius;
+    p.mul = (1u << 24) / (uint32_t)(2 * radius + 1);
+    p.amount = amount;
+    p.sums = sums;
+    // Bande alte almeno quanto la finestra: l'alone pesa al massimo metà
+    p.band_rows = (2 * radius + 1 > FILTER_BAND_ROWS) ? 2 * radius + 1 : FILTER_BAND_ROWS;
+    p.num_bands = (h + p.band_rows - 1) / p.band_rows;
+
+    FilterPlane tmp_plane = { tmp, w };
+    FilterPlane mid_plane = { mid, w };
+    FilterPlane src = target;
+    for (int pass = 0; pass < FILTER_BLUR_PASSES; pass++) {
+        int last = (pass == FILTER_BLUR_PASSES - 1);
+
+        p.src = src;
+        p.dst = tmp_plane;
+        p.sharpen = 0;
+        filter_run_pass(&p, filter_task_h, pool);
+
+        // Lo sharpen tiene l'originale in target fino all'ultima passata
+        p.src = tmp_plane;
+        p.dst = (type == FILTER_BLUR || last) ? target : mid_plane;
+        p.sharpen = (type == FILTER_SHARPEN && last);
+        filter_run_pass(&p, filter_task_v, pool);
+        src = p.dst;
+    }
+
+    mem_scratch_free(tmp);
+    mem_scratch_free(mid);
+    mem_scratch_free(sums);
+    return 0;
+}
+
+int filter_apply(Canvas *canvas, FilterType type, int radius, int amount,
+                 int x0, int y0, int x1, int y1, WorkPool *pool)
+{
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > canvas->width) x1 = canvas->width;
+    if (y1 > canvas->height) y1 = canvas->height;
+    if (x0 >= x1 || y0 >= y1) return 0;
+
+    FilterPlane target = { &canvas->pixels[y0 * canvas->width + x0], canvas->width };
+    return filter_plane(target, x1 - x0, y1 - y0, type, radius, amount, pool);
+}
+
+// Il pixel (px, py) è entro r dal segmento? (come l'unione dei timbri)
+static int filter_in_capsule(int px, int py, int x0, int y0, int dx, int dy,
+                             int64_t len2, int r)
+{
+    int64_t vx = px - x0, vy = py - y0;
+    int64_t proj = vx * dx + vy * dy;
+    int64_t r2 = (int64_t)r * r;
+    if (proj <= 0 || len2 == 0) return vx * vx + vy * vy <= r2;
+    if (proj >= len2) {
+        int64_t ex = vx - dx, ey = vy - dy;
+        return ex * ex + ey * ey <= r2;
+    }
+    // Distanza dalla retta: |v|^2 - proj^2 / len2 <= r^2
+    return (vx * vx + vy * vy - r2) * len2 <= proj * proj;
+}
+
+int filter_stroke_segment(Canvas *canvas, FilterType type, int radius, int amount,
+                          int x0, int y0, int x1, int y1, int size)
+{
+    int r = (size > 1) ? size / 2 : 0;
+    int halo = filter_halo(type, radius);
+    int lx = ((x0 < x1) ? x0 : x1) - r, hx = ((x0 > x1) ? x0 : x1) + r;
+    int ly = ((y0 < y1) ? y0 : y1) - r, hy = ((y0 > y1) ? y0 : y1) + r;
+
+    // Area filtrata: il tratto più l'alone, così il bordo del tratto vede i
+    // pixel veri attorno
+    int ax0 = lx - halo, ay0 = ly - halo, ax1 = hx + halo + 1, ay1 = hy + halo + 1;
+    if (ax0 < 0) ax0 = 0;
+    if (ay0 < 0) ay0 = 0;
+    if (ax1 > canvas->width) ax1 = canvas->width;
+    if (ay1 > canvas->height) ay1 = canvas->height;
+    if (ax0 >= ax1 || ay0 >= ay1) return 0;
+
+    int w = ax1 - ax0, h = ay1 - ay0;
+    unsigned int *buf = (unsigned int *)mem_scratch_alloc((size_t)w * h * sizeof(unsigned int));
+    if (!buf) return -1;
+    for (int y = 0; y < h; y++) {
+        memcpy(&buf[y * w], &canvas->pixels[(ay0 + y) * canvas->width + ax0],
+               w * sizeof(unsigned int));
+    }
+
+    FilterPlane plane = { buf, w };
+    if (filter_plane(plane, w, h, type, radius, amount, NULL) != 0) {
+        mem_scratch_free(buf);
+        return -1;
+    }
+
+    int dx = x1 - x0, dy = y1 - y0;
+    int64_t len2 = (int64_t)dx * dx + (int64_t)dy * dy;
+    if (lx < 0) lx = 0;
+    if (ly < 0) ly = 0;
+    if (hx >= canvas->width) hx = canvas->width - 1;
+    if (hy >= canvas->height) hy = canvas->height - 1;
+    for (int y = ly; y <= hy; y++) {
+        unsigned int *row = &canvas->pixels[y * canvas->width];
+        const unsigned int *filtered = &buf[(y - ay0) * w];
+        for (int x = lx; x <= hx; x++) {
+            if (filter_in_capsule(x, y, x0, y0, dx, dy, len2, r)) row[x] = filtered[x - ax0];
+        }
+    }
+
+    mem_scratch_free(buf);
+    return 0;
+}
+
+// Span della riga dy del timbro valido sia in (px, py) che in (cx, cy)
+static int filter_smudge_span(const Canvas *canvas, int px, int py, int cx, int cy,
+                              int r, int dy, int *lo, int *hi)
+{
+    if (py + dy < 0 || py + dy >= canvas->height ||
+        cy + dy < 0 || cy + dy >= canvas->height) return 0;
+    int hw = stroke_half_width(r, dy);
+    int minx = (px < cx) ? px : cx, maxx = (px > cx) ? px : cx;
+    *lo = (minx - hw < 0) ? -minx : -hw;
+    *hi = (maxx + hw >= canvas->width) ? canvas->width - 1 - maxx : hw;
+    return *lo <= *hi;
+}
+
+// Un timbro: preleva il disco in (px, py), poi lo mescola nel disco in (cx, cy).
+// La copia serve perché i due dischi si sovrappongono.
+static void filter_smudge_stamp(Canvas *canvas, unsigned int *buf, int px, int py,
+                                int cx, int cy, int r, int strength)
+{
+    int d = 2 * r + 1;
+    int lo, hi;
+    for (int dy = -r; dy <= r; dy++) {
+        if (!filter_smudge_span(canvas, px, py, cx, cy, r, dy, &lo, &hi)) continue;
+        memcpy(&buf[(dy + r) * d + r + lo], &canvas->pixels[(py + dy) * canvas->width + px + lo],
+               (hi - lo + 1) * sizeof(unsigned int));
+    }
+    for (int dy = -r; dy <= r; dy++) {
+        if (!filter_smudge_span(canvas, px, py, cx, cy, r, dy, &lo, &hi)) continue;
+        unsigned int *row = &canvas->pixels[(cy + dy) * canvas->width];
+        const unsigned int *picked = &buf[(dy + r) * d + r];
+        for (int x = lo; x <= hi; x++) {
+            row[cx + x] = canvas_lerp(row[cx + x], picked[x], strength);
+        }
+    }
+}
+
+int filter_smudge_segment(Canvas *canvas, int x0, int y0, int x1, int y1,
+                          int size, int strength)
+{
+    int r = (size > 2) ? size / 2 : 1;
+    int spacing = (r >= 8) ? r / 4 : 1;
+    int dx = x1 - x0, dy = y1 - y0;
+    int len = (abs(dx) > abs(dy)) ? abs(dx) : abs(dy);
+    int steps = (len + spacing - 1) / spacing;
+    if (steps == 0) return 0;
+
+    int d = 2 * r + 1;
+    unsigned int *buf = (unsigned int *)mem_scratch_alloc((size_t)d * d * sizeof(unsigned int));
+    if (!buf) return -1;
+
+    int px = x0, py = y0;
+    for (int i = 1; i <= steps; i++) {
+        int cx = x0 + dx * i / steps;
+        int cy = y0 + dy * i / steps;
+        filter_smudge_stamp(canvas, buf, px, py, cx, cy, r, strength);
+        px = cx;
+        py = cy;
+    }
+
+    mem_scratch_free(buf);
+    return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+#include "canvas.h"
+#include "workpool.h"
+
+// Passate di box blur: tre approssimano bene una gaussiana
+#define FILTER_BLUR_PASSES    3
+#define FILTER_RADIUS_MAX     64
+// Righe minime per banda nei filtri a tutto canvas
+#define FILTER_BAND_ROWS      32
+
+// Parametri usati dagli strumenti
+#define FILTER_BLUR_RADIUS     2
+#define FILTER_SHARPEN_RADIUS  1
+#define FILTER_SHARPEN_AMOUNT  64    // 64 = aggiunge 1x il dettaglio
+#define FILTER_SMUDGE_STRENGTH 160   // su 256: quanto colore trascina ogni timbro
+
+typedef enum {
+    FILTER_BLUR,
+    FILTER_SHARPEN,     // unsharp mask sul blur dello stesso raggio
+    FILTER_TYPE_COUNT
+} FilterType;
+
+// Parametri nel seed di JCMD_FILTER, JCMD_FILTER_STROKE e JCMD_SMUDGE
+#define FILTER_PARAMS(type, radius, amount) \
+    ((uint32_t)(type) | ((uint32_t)(radius) << 8) | ((uint32_t)(amount) << 16))
+#define FILTER_PARAM_TYPE(seed)    ((FilterType)((seed) & 0xFF))
+#define FILTER_PARAM_RADIUS(seed)  ((int)(((seed) >> 8) & 0xFF))
+#define FILTER_PARAM_AMOUNT(seed)  ((int)(((seed) >> 16) & 0xFF))
+
+// Righe/colonne attorno a un'area da cui dipende il risultato del filtro
+int  filter_halo(FilterType type, int radius);
+
+// Filtra il rettangolo [x0, x1) x [y0, y1) del canvas; fuori dal rettangolo
+// si ripete il pixel del bordo. Blur separabile a somme scorrevoli: il costo
+// non dipende dal raggio. Con pool il lavoro si divide in bande di righe.
+// Ritorna -1 (canvas intatto) se manca memoria.
+int  filter_apply(Canvas *canvas, FilterType type, int radius, int amount,
+                  int x0, int y0, int x1, int y1, WorkPool *pool);
+
+// Filtro locale lungo un segmento di pennello di spessore size
+int  filter_stroke_segment(Canvas *canvas, FilterType type, int radius, int amount,
+                           int x0, int y0, int x1, int y1, int size);
+
+// Sfumino: ogni timbro del segmento riprende i pixel sotto il timbro
+// precedente e li mescola con strength/256
+int  filter_smudge_segment(Canvas *canvas, int x0, int y0, int x1, int y1,
+                           int size, int strength);
+
+#endif
@@ -0,0 +1,301 @@
+#include "gradient.h"
+#include "stroke.h"
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GRAD_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define GRAD_SSE2 1
+#endif
+
+// Soglie del dither ordinato (Bayer 4x4), in sedicesimi di livello
+static const int bayer[4][4] = {
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 }
+};
+
+int gradient_is_full(GradientMode mode) {
+    return (mode == GRADIENT_LINEAR || mode == GRADIENT_RADIAL);
+}
+
+static inline int grad_channel(unsigned int c, int ch) {
+    return (int)((c >> (8 * ch)) & 0xFF);
+}
+
+static inline unsigned int grad_pack(int r, int g, int b, int a) {
+    if (r < 0) r = 0;
+    if (r > 255) r = 255;
+    if (g < 0) g = 0;
+    if (g > 255) g = 255;
+    if (b < 0) b = 0;
+    if (b > 255) b = 255;
+    if (a < 0) a = 0;
+    if (a > 255) a = 255;
+    return (unsigned int)r | ((unsigned int)g << 8) | ((unsigned int)b << 16) | ((unsigned int)a << 24);
+}
+
+static void grad_fill_span(unsigned int *row, int lo, int hi, unsigned int color) {
+    for (int x = lo; x <= hi; x++) row[x] = color;
+}
+
+static int64_t grad_floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0))) q--;
+    return q;
+}
+
+// Rampa lineare: v[] canali in 16.16 sul primo pixel, passo dv[] per pixel,
+// dither[k & 3] aggiunto prima del troncamento
+static void grad_row_linear(unsigned int *dst, int n, const int32_t v[4], const int32_t dv[4],
+                            const int32_t dither[4])
+{
+    int k = 0;
+    int32_t r = v[0], g = v[1], b = v[2], a = v[3];
+#if defined(GRAD_SSE2)
+    if (n >= 4) {
+        __m128i vr = _mm_setr_epi32(r, r + dv[0], r + 2 * dv[0], r + 3 * dv[0]);
+        __m128i vg = _mm_setr_epi32(g, g + dv[1], g + 2 * dv[1], g + 3 * dv[1]);
+        __m128i vb = _mm_setr_epi32(b, b + dv[2], b + 2 * dv[2], b + 3 * dv[2]);
+        __m128i va = _mm_setr_epi32(a, a + dv[3], a + 2 * dv[3], a + 3 * dv[3]);
+        __m128i sr = _mm_set1_epi32(4 * dv[0]), sg = _mm_set1_epi32(4 * dv[1]);
+        __m128i sb = _mm_set1_epi32(4 * dv[2]), sa = _mm_set1_epi32(4 * dv[3]);
+        __m128i d = _mm_loadu_si128((const __m128i *)dither);
+        for (; k + 4 <= n; k += 4) {
+            __m128i cr = _mm_srai_epi32(_mm_add_epi32(vr, d), 16);
+            __m128i cg = _mm_srai_epi32(_mm_add_epi32(vg, d), 16);
+            __m128i cb = _mm_srai_epi32(_mm_add_epi32(vb, d), 16);
+            __m128i ca = _mm_srai_epi32(_mm_add_epi32(va, d), 16);
+            // Saturazione a 0..255 come grad_pack, poi da planare a RGBA
+            __m128i p = _mm_packus_epi16(_mm_packs_epi32(cr, cg), _mm_packs_epi32(cb, ca));
+            __m128i rg = _mm_unpacklo_epi8(p, _mm_srli_si128(p, 4));
+            __m128i ba = _mm_unpacklo_epi8(_mm_srli_si128(p, 8), _mm_srli_si128(p, 12));
+            _mm_storeu_si128((__m128i *)&dst[k], _mm_unpacklo_epi16(rg, ba));
+            vr = _mm_add_epi32(vr, sr);
+            vg = _mm_add_epi32(vg, sg);
+            vb = _mm_add_epi32(vb, sb);
+            va = _mm_add_epi32(va, sa);
+        }
+        r += k * dv[0];
+        g += k * dv[1];
+        b += k * dv[2];
+        a += k * dv[3];
+    }
+#elif defined(GRAD_NEON)
+    if (n >= 4) {
+        const int32_t lane[4] = { 0, 1, 2, 3 };
+        int32x4_t l = vld1q_s32(lane);
+        int32x4_t vr = vmlaq_n_s32(vdupq_n_s32(r), l, dv[0]);
+        int32x4_t vg = vmlaq_n_s32(vdupq_n_s32(g), l, dv[1]);
+        int32x4_t vb = vmlaq_n_s32(vdupq_n_s32(b), l, dv[2]);
+        int32x4_t va = vmlaq_n_s32(vdupq_n_s32(a), l, dv[3]);
+        int32x4_t d = vld1q_s32(dither);
+        int32x4_t lo = vdupq_n_s32(0), hi = vdupq_n_s32(255);
+        for (; k + 4 <= n; k += 4) {
+            int32x4_t cr = vmaxq_s32(vminq_s32(vshrq_n_s32(vaddq_s32(vr, d), 16), hi), lo);
+            int32x4_t cg = vmaxq_s32(vminq_s32(vshrq_n_s32(vaddq_s32(vg, d), 16), hi), lo);
+            int32x4_t cb = vmaxq_s32(vminq_s32(vshrq_n_s32(vaddq_s32(vb, d), 16), hi), lo);
+            int32x4_t ca = vmaxq_s32(vminq_s32(vshrq_n_s32(vaddq_s32(va, d), 16), hi), lo);
+            uint32x4_t p = vreinterpretq_u32_s32(cr);
+            p = vorrq_u32(p, vshlq_n_u32(vreinterpretq_u32_s32(cg), 8));
+            p = vorrq_u32(p, vshlq_n_u32(vreinterpretq_u32_s32(cb), 16));
+            p = vorrq_u32(p, vshlq_n_u32(vreinterpretq_u32_s32(ca), 24));
+            vst1q_u32((uint32_t *)&dst[k], p);
+            vr = vaddq_s32(vr, vdupq_n_s32(4 * dv[0]));
+            vg = vaddq_s32(vg, vdupq_n_s32(4 * dv[1]));
+            vb = vaddq_s32(vb, vdupq_n_s32(4 * dv[2]));
+            va = vaddq_s32(va, vdupq_n_s32(4 * dv[3]));
+        }
+        r += k * dv[0];
+        g += k * dv[1];
+        b += k * dv[2];
+        a += k * dv[3];
+    }
+#endif
+    for (; k < n; k++) {
+        int32_t d = dither[k & 3];
+        dst[k] = grad_pack((r + d) >> 16, (g + d) >> 16, (b + d) >> 16, (a + d) >> 16);
+        r += dv[0];
+        g += dv[1];
+        b += dv[2];
+        a += dv[3];
+    }
+}
+
+// Rampa radiale: t = min(|p - centro| / r, 1), in float con le stesse
+// operazioni (e lo stesso ordine) nella versione scalare e in quella SSE2
+static void grad_row_radial(unsigned int *dst, int n, float fx, float fy2, float inv_r,
+                            const float c0[4], const float diff[4], const float dither[4])
+{
+    int k = 0;
+#if defined(GRAD_SSE2)
+    if (n >= 4) {
+        __m128i d = _mm_setzero_si128();
+        __m128 vx = _mm_setr_ps(fx, fx + 1.0f, fx + 2.0f, fx + 3.0f);
+        __m128 dth = _mm_loadu_ps(dither);
+        const __m128 one = _mm_set1_ps(1.0f), four = _mm_set1_ps(4.0f);
+        const __m128 vy2 = _mm_set1_ps(fy2), vinv = _mm_set1_ps(inv_r);
+        for (; k + 4 <= n; k += 4) {
+            __m128 t = _mm_mul_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vx, vx), vy2)), vinv);
+            t = _mm_min_ps(t, one);
+            __m128i c[4];
+            for (int ch = 0; ch < 4; ch++) {
+                __m128 v = _mm_add_ps(_mm_add_ps(_mm_set1_ps(c0[ch]),
+                                                 _mm_mul_ps(_mm_set1_ps(diff[ch]), t)), dth);
+                c[ch] = _mm_cvttps_epi32(v);
+            }
+            __m128i p = _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]), _mm_packs_epi32(c[2], c[3]));
+            __m128i rg = _mm_unpacklo_epi8(p, _mm_srli_si128(p, 4));
+            __m128i ba = _mm_unpacklo_epi8(_mm_srli_si128(p, 8), _mm_srli_si128(p, 12));
+            d = _mm_unpacklo_epi16(rg, ba);
+            _mm_storeu_si128((__m128i *)&dst[k], d);
+            vx = _mm_add_ps(vx, four);
+        }
+        fx += (float)k;
+    }
+#endif
+    for (; k < n; k++) {
+        float t = sqrtf(fx * fx + fy2) * inv_r;
+        if (t > 1.0f) t = 1.0f;
+        float d = dither[k & 3];
+        dst[k] = grad_pack((int)(c0[0] + diff[0] * t + d), (int)(c0[1] + diff[1] * t + d),
+                           (int)(c0[2] + diff[2] * t + d), (int)(c0[3] + diff[3] * t + d));
+        fx += 1.0f;
+    }
+}
+
+typedef struct {
+    GradientMode mode;
+    int x0, y0;
+    unsigned int c0, c1;
+
+    // Lineare: num(x, y) = (x - x0) * dx + (y - y0) * dy, rampa per 0 <= num <= len2
+    int dx, dy;
+    int64_t len2;
+    int32_t dv[4];
+
+    // Radiale
+    float inv_r;
+    float fc0[4], fdiff[4];
+} GradJob;
+
+static void grad_span_linear(const GradJob *g, unsigned int *row, int y, int lo, int hi) {
+    if (g->len2 == 0) {
+        grad_fill_span(row, lo, hi, g->c0);
+        return;
+    }
+    int64_t ny = (int64_t)(y - g->y0) * g->dy;
+    int64_t first, last;   // rampa in coordinate relative a x0
+    unsigned int left, right;
+    if (g->dx > 0) {
+        first = -grad_floor_div(ny, g->dx);                        // num >= 0
+        last = grad_floor_div(g->len2 - ny, g->dx);                // num <= len2
+        left = g->c0;
+        right = g->c1;
+    } else if (g->dx < 0) {
+        first = -grad_floor_div(g->len2 - ny, -g->dx);
+        last = grad_floor_div(ny, -g->dx);
+        left = g->c1;
+        right = g->c0;
+    } else {
+        // Gradiente verticale: riga costante o tutta in rampa
+        int in = (ny >= 0 && ny <= g->len2);
+        first = in ? INT32_MIN : INT32_MAX;
+        last = in ? INT32_MAX : INT32_MIN;
+        left = (ny < 0) ? g->c0 : g->c1;
+        right = left;
+    }
+
+    int64_t a = first + g->x0, b = last + g->x0;
+    if (a > hi || b < lo || a > b) {
+        grad_fill_span(row, lo, hi, (a > hi) ? left : right);
+        return;
+    }
+    if (a > lo) grad_fill_span(row, lo, (int)a - 1, left);
+    if (b < hi) grad_fill_span(row, (int)b + 1, hi, right);
+    int xs = (a > lo) ? (int)a : lo;
+    int xe = (b < hi) ? (int)b : hi;
+
+    // Valore della riga in x0 più i passi fino a xs: dipende solo da
+    // (x - x0, y - y0), non da dove inizia lo span (bande, aree ritagliate)
+    int32_t v[4], dither[4];
+    for (int ch = 0; ch < 4; ch++) {
+        int c0 = grad_channel(g->c0, ch);
+        int64_t diff = grad_channel(g->c1, ch) - c0;
+        int64_t row = c0 * 65536 + grad_floor_div(diff * ny * 65536 + g->len2 / 2, g->len2);
+        v[ch] = (int32_t)(row + (int64_t)(xs - g->x0) * g->dv[ch]);
+    }
+    const int *brow = bayer[(y - g->y0) & 3];
+    for (int i = 0; i < 4; i++) {
+        dither[i] = brow[(xs + i - g->x0) & 3] * 4096 + 2048;
+    }
+    grad_row_linear(&row[xs], xe - xs + 1, v, g->dv, dither);
+}
+
+static void grad_span_radial(const GradJob *g, unsigned int *row, int y, int lo, int hi) {
+    float fy = (float)(y - g->y0);
+    float dither[4];
+    const int *brow = bayer[(y - g->y0) & 3];
+    for (int i = 0; i < 4; i++) {
+        dither[i] = ((float)brow[(lo + i - g->x0) & 3] + 0.5f) / 16.0f;
+    }
+    grad_row_radial(&row[lo], hi - lo + 1, (float)(lo - g->x0), fy * fy, g->inv_r,
+                    g->fc0, g->fdiff, dither);
+}
+
+static void grad_span(const GradJob *g, Canvas *canvas, int y, int lo, int hi) {
+    if (y < 0 || y >= canvas->height) return;
+    if (lo < 0) lo = 0;
+    if (hi >= canvas->width) hi = canvas->width - 1;
+    if (lo > hi) return;
+
+    unsigned int *row = &canvas->pixels[y * canvas->width];
+    if (g->mode == GRADIENT_LINEAR || g->mode == GRADIENT_LINEAR_RECT) {
+        grad_span_linear(g, row, y, lo, hi);
+    } else {
+        grad_span_radial(g, row, y, lo, hi);
+    }
+}
+
+void gradient_fill(Canvas *canvas, GradientMode mode, int x0, int y0, int x1, int y1,
+                   int radius, unsigned int c0, unsigned int c1)
+{
+    GradJob g;
+    g.mode = mode;
+    g.x0 = x0;
+    g.y0 = y0;
+    g.c0 = c0;
+    g.c1 = c1;
+    g.dx = x1 - x0;
+    g.dy = y1 - y0;
+    g.len2 = (int64_t)g.dx * g.dx + (int64_t)g.dy * g.dy;
+    g.inv_r = (radius > 0) ? 1.0f / (float)radius : 0.0f;
+    for (int ch = 0; ch < 4; ch++) {
+        int64_t diff = grad_channel(c1, ch) - grad_channel(c0, ch);
+        g.dv[ch] = g.len2 ? (int32_t)grad_floor_div(diff * g.dx * 65536 + g.len2 / 2, g.len2) : 0;
+        g.fc0[ch] = (float)grad_channel(c0, ch);
+        g.fdiff[ch] = (float)diff;
+    }
+
+    switch (mode) {
+        case GRADIENT_LINEAR_RECT: {
+            int minx = (x0 < x1) ? x0 : x1, maxx = (x0 > x1) ? x0 : x1;
+            int miny = (y0 < y1) ? y0 : y1, maxy = (y0 > y1) ? y0 : y1;
+            for (int y = miny; y <= maxy; y++) grad_span(&g, canvas, y, minx, maxx);
+            break;
+        }
+        case GRADIENT_RADIAL_CIRCLE:
+            for (int dy = -radius; dy <= radius; dy++) {
+                int hw = stroke_half_width(radius, dy);
+                grad_span(&g, canvas, y0 + dy, x0 - hw, x0 + hw);
+            }
+            break;
+        default:
+            for (int y = 0; y < canvas->height; y++) grad_span(&g, canvas, y, 0, canvas->width - 1);
+            break;
+    }
+}
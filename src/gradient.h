@@ -0,0 +1,17 @@
+#ifndef GRADIENT_H
+#define GRADIENT_H
+
+#include "canvas.h"
+
+// Riempie con un gradiente da c0 a c1. Lineare: dal punto (x0, y0) a (x1, y1),
+// costante prima e dopo. Radiale: centro (x0, y0), c1 a distanza radius.
+// Le modalità *_RECT / *_CIRCLE limitano il riempimento alla forma del
+// trascinamento, con gli stessi pixel di canvas_draw_filled_rect/circle.
+// Un dither ordinato 4x4, in fase con (x0, y0), evita le bande.
+void gradient_fill(Canvas *canvas, GradientMode mode, int x0, int y0, int x1, int y1,
+                   int radius, unsigned int c0, unsigned int c1);
+
+// La modalità riempie tutto il canvas?
+int  gradient_is_full(GradientMode mode);
+
+#endif
@@ -0,0 +1,27 @@
+/*
+ * Minimal stand-in for <vita2d.h> used by the Linux host build.
+ * Only the pieces the raster core touches are provided: the RGBA8 macro
+ * and CPU-side textures. Drawing to screen and presenting are no-ops.
+ */
+#ifndef HOST_VITA2D_H
+#define HOST_VITA2D_H
+
+#define RGBA8(r, g, b, a) ((((a) & 0xFF) << 24) | (((b) & 0xFF) << 16) | \
+                           (((g) & 0xFF) << 8)  | (((r) & 0xFF) << 0))
+
+#define SCE_GXM_TEXTURE_FORMAT_A8B8G8R8 0
+
+typedef struct vita2d_texture {
+    unsigned int width;
+    unsigned int height;
+    unsigned int *data;
+} vita2d_texture;
+
+vita2d_texture *vita2d_create_empty_texture_format(unsigned int w, unsigned int h, int format);
+void vita2d_free_texture(vita2d_texture *texture);
+void *vita2d_texture_get_datap(const vita2d_texture *texture);
+unsigned int vita2d_texture_get_stride(const vita2d_texture *texture);
+void vita2d_draw_texture(const vita2d_texture *texture, float x, float y);
+void vita2d_swap_buffers(void);
+
+#endif
@@ -0,0 +1,39 @@
+#include "vita2d.h"
+#include <stdlib.h>
+
+vita2d_texture *vita2d_create_empty_texture_format(unsigned int w, unsigned int h, int format) {
+    (void)format;
+    vita2d_texture *texture = (vita2d_texture *)malloc(sizeof(vita2d_texture));
+    if (!texture) return NULL;
+    texture->data = (unsigned int *)calloc((size_t)w * h, sizeof(unsigned int));
+    if (!texture->data) {
+        free(texture);
+        return NULL;
+    }
+    texture->width = w;
+    texture->height = h;
+    return texture;
+}
+
+void vita2d_free_texture(vita2d_texture *texture) {
+    if (!texture) return;
+    free(texture->data);
+    free(texture);
+}
+
+void *vita2d_texture_get_datap(const vita2d_texture *texture) {
+    return texture->data;
+}
+
+unsigned int vita2d_texture_get_stride(const vita2d_texture *texture) {
+    return texture->width * sizeof(unsigned int);
+}
+
+void vita2d_draw_texture(const vita2d_texture *texture, float x, float y) {
+    (void)texture;
+    (void)x;
+    (void)y;
+}
+
+void vita2d_swap_buffers(void) {
+}
@@ -1,4 +1,5 @@
 #include "input.h"
+#include "platform.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -32,14 +33,27 @@ void input_update(InputState *state) {
 
     SceTouchData touch;
     sceTouchPeek(SCE_TOUCH_PORT_FRONT, &touch, 1);
+    state->front_time_us = platform_time_us();
 
     state->front_prev_x = state->front_x;
     state->front_prev_y = state->front_y;
+    state->front_prev_pressure = state->front_pressure;
 
     if (touch.reportNum > 0) {
         state->front_touching = 1;
         state->front_x = touch.report[0].x / 2;
         state->front_y = touch.report[0].y / 2;
+
+        state->front_force = touch.report[0].force;
+        int raw = state->front_force * 255 / INPUT_FORCE_MAX;
+        if (raw > 255) raw = 255;
+        if (!prev_front_touching) {
+            // Primo campione: niente storia da filtrare
+            state->front_pressure = raw;
+            state->front_prev_pressure = raw;
+        } else {
+            state->front_pressure += (raw - state->front_pressure) / INPUT_PRESSURE_SMOOTH;
+        }
     } else {
         state->front_touching = 0;
     }
@@ -3,10 +3,16 @@
 
 #include <psp2/ctrl.h>
 #include <psp2/touch.h>
+#include <stdint.h>
 
 #define TOUCH_FRONT  0
 #define TOUCH_BACK   1
 
+// Forza massima riportata dal touch frontale
+#define INPUT_FORCE_MAX       128
+// Media mobile della pressione: nuovo campione pesato 1/INPUT_PRESSURE_SMOOTH
+#define INPUT_PRESSURE_SMOOTH 4
+
 typedef struct {
     // Touch frontale
     int front_touching;
@@ -16,6 +22,10 @@ typedef struct {
     int front_prev_y;
     int front_just_pressed;
     int front_just_released;
+    int front_force;          // forza grezza dell'ultimo campione
+    int front_pressure;       // pressione filtrata 0-255
+    int front_prev_pressure;
+    uint64_t front_time_us;   // lettura dell'ultimo campione (platform_time_us)
 
     // Touch posteriore
     int back_touching;
@@ -0,0 +1,202 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "canvas.h"
+#include "workpool.h"
+#include "strokeindex.h"
+
+// Ogni quante operazioni salvare un keyframe (bitmap completa)
+#define JOURNAL_KEYFRAME_INTERVAL 16
+// Keyframe tenuti in memoria (2 MB ciascuno a 960x544)
+#define JOURNAL_MAX_KEYFRAMES     4
+
+// Tile delle aree cambiate sul canvas dell'app (come i tile di progetto)
+#define JOURNAL_DAMAGE_TILE 64
+#define JOURNAL_DAMAGE_COLS ((SCREEN_W + JOURNAL_DAMAGE_TILE - 1) / JOURNAL_DAMAGE_TILE)
+#define JOURNAL_DAMAGE_ROWS ((SCREEN_H + JOURNAL_DAMAGE_TILE - 1) / JOURNAL_DAMAGE_TILE)
+
+#define JOURNAL_FILE_MAGIC   0x4A575244u  // "DRWJ"
+#define JOURNAL_FILE_VERSION 2  // v2: aggiunge seq nell'header
+
+typedef enum {
+    JCMD_BRUSH,        // timbro singolo in (x0, y0)
+    JCMD_LINE,         // segmento di pennello (x0, y0) -> (x1, y1)
+    JCMD_RECT,
+    JCMD_FILL_RECT,
+    JCMD_CIRCLE,       // centro (x0, y0), raggio fino a (x1, y1)
+    JCMD_FILL_CIRCLE,
+    JCMD_SPRAY,        // centro (x0, y0), raggio = size, punti da seed
+    JCMD_CLEAR,
+    JCMD_STROKE,       // segmento a spessore variabile: size -> seed & 0xFFFF
+                       // (in 1/STROKE_SUBPIXEL px), opacità in (seed >> 16) & 0xFF
+    JCMD_SELECT,       // forma della selezione (vedi selection.h), non disegna
+    JCMD_TRANSFORM,    // sposta i pixel della selezione: traslazione (x0, y0),
+                       // scala 8.8 size/y1, angolo in seed, x1 = JCMD_SELECT
+                       // che lo precedono, color = colore del buco
+    JCMD_FILTER,       // filtro sul rettangolo [x0, x1) x [y0, y1), parametri
+                       // in seed (FILTER_PARAMS, vedi filter.h)
+    JCMD_FILTER_STROKE,// filtro lungo un segmento di pennello di spessore size
+    JCMD_SMUDGE,       // sfumino lungo il segmento, intensità in seed
+    JCMD_GRADIENT,     // gradiente da (x0, y0) a (x1, y1), modalità in size
+                       // (GradientMode), da color a seed
+    JCMD_ERASE_OBJECT, // nasconde l'operazione che inizia al comando seed;
+                       // (x0, y0)-(x1, y1) = la sua area
+    JCMD_SHAPE,        // forma del motore a scanline (vedi shape.h): spessore
+                       // in size (0 = piena), SHAPE_PARAMS in seed
+    JCMD_POINTS,       // due vertici di un poligono, (x0, y0) e (x1, y1); non disegna
+    JCMD_POLYGON,      // poligono sui x0 JCMD_POINTS che lo precedono, x1 vertici,
+                       // spessore in size (0 = pieno), flag SHAPE_FLAG_* in seed
+    JCMD_SYMMETRY,     // simmetria del comando che segue: centro (x0, y0),
+                       // SymmetryMode in size, copie radiali in x1; non disegna
+    JCMD_COUNT
+} JournalCmdType;
+
+// Bit del tipo: il comando si replica con il JCMD_SYMMETRY che lo precede
+// (fra i JCMD_POINTS e il loro JCMD_POLYGON)
+#define JCMD_SYMMETRIC  0x80
+#define JCMD_TYPE(cmd)  ((cmd)->type & ~JCMD_SYMMETRIC)
+
+// Comando compatto, 20 byte, scritto così com'è nel file di progetto
+typedef struct {
+    uint8_t  type;
+    uint8_t  op_start;  // 1 se è il primo comando di un'operazione utente
+    uint16_t size;
+    int16_t  x0, y0;
+    int16_t  x1, y1;
+    uint32_t color;
+    uint32_t seed;
+} JournalCmd;
+
+typedef struct {
+    unsigned int *pixels;
+    size_t bytes;       // dimensione di pixels, da restituire al pool
+    int cmd_index;      // comandi [0, cmd_index) già applicati in pixels
+} JournalKeyframe;
+
+typedef enum {
+    JEVENT_EXEC,
+    JEVENT_UNDO,
+    JEVENT_REDO
+} JournalEvent;
+
+struct Journal;
+
+// Notificato dopo ogni modifica (usato dall'autosave)
+typedef void (*JournalListener)(void *user, const struct Journal *journal,
+                                JournalEvent event, const JournalCmd *cmd);
+
+typedef struct Journal {
+    JournalCmd *cmds;
+    int count;          // comandi registrati (inclusa la coda di redo)
+    int capacity;
+    int cursor;         // comandi attivi: [0, cursor)
+    int pending_op;     // il prossimo comando apre una nuova operazione
+
+    unsigned int bg_color;
+
+    JournalKeyframe keyframes[JOURNAL_MAX_KEYFRAMES];
+    int num_keyframes;
+
+    // Comandi disegnati ma non registrati per mancanza di memoria
+    // (non si possono annullare)
+    unsigned int dropped_cmds;
+
+    // Numero progressivo di eventi (exec/undo/redo), salvato nel file
+    uint32_t seq;
+
+    JournalListener listener;
+    void *listener_user;
+
+    // Pool per i filtri a tutto canvas in exec/undo/redo (NULL = un thread).
+    // Va usato da un solo thread alla volta: l'export non lo passa mai.
+    WorkPool *pool;
+
+    // Un oggetto per operazione, in griglia: gomma a oggetti e ridisegno
+    // delle sole aree che cambiano
+    StrokeIndex index;
+
+    // Tile toccati da exec/undo/redo dall'ultima journal_take_damage:
+    // bit x della parola y (usato dal timelapse)
+    uint32_t damage[JOURNAL_DAMAGE_ROWS];
+} Journal;
+
+int  journal_init(Journal *journal, unsigned int bg_color);
+void journal_destroy(Journal *journal);
+void journal_reset(Journal *journal);
+
+// Segna l'inizio di una nuova operazione (tocco, shape, clear).
+// Se è il momento, salva un keyframe dello stato corrente del canvas.
+void journal_begin_op(Journal *journal, const Canvas *canvas);
+
+// Salva subito un keyframe dello stato corrente (es. dopo un caricamento)
+void journal_keyframe(Journal *journal, const Canvas *canvas);
+// Libera il buffer di un keyframe, prima quelli inattivi poi il più vecchio:
+// undo e redo ripetono più comandi. Ritorna 1 se ha liberato qualcosa.
+int  journal_trim(Journal *journal);
+
+// Registra il comando e lo rasterizza sul canvas. Con la simmetria del
+// canvas attiva i comandi di disegno si registrano con JCMD_SYMMETRY davanti.
+int  journal_exec(Journal *journal, Canvas *canvas, const JournalCmd *cmd);
+int  journal_record(Journal *journal, Canvas *canvas, JournalCmdType type,
+                    int x0, int y0, int x1, int y1, int size, unsigned int color);
+// Tratto sensibile alla pressione (JCMD_STROKE), spessori in 1/STROKE_SUBPIXEL px
+int  journal_record_stroke(Journal *journal, Canvas *canvas,
+                           int x0, int y0, int size0, int x1, int y1, int size1,
+                           unsigned int color, int alpha);
+// Filtri e sfumino (JCMD_FILTER, JCMD_FILTER_STROKE, JCMD_SMUDGE)
+int  journal_record_filter(Journal *journal, Canvas *canvas, JournalCmdType type,
+                           int x0, int y0, int x1, int y1, int size, uint32_t params);
+// Gradiente da c0 a c1 (JCMD_GRADIENT)
+int  journal_record_gradient(Journal *journal, Canvas *canvas, GradientMode mode,
+                             int x0, int y0, int x1, int y1, unsigned int c0, unsigned int c1);
+
+// Forma con il motore a scanline (JCMD_SHAPE)
+int  journal_record_shape(Journal *journal, Canvas *canvas, int x0, int y0, int x1, int y1,
+                          int thickness, unsigned int color, uint32_t params);
+// Poligono chiuso di n vertici (JCMD_POINTS + JCMD_POLYGON)
+int  journal_record_polygon(Journal *journal, Canvas *canvas, const int *xs, const int *ys,
+                            int n, int thickness, unsigned int color, int flags);
+
+// Oggetto visibile più in alto entro radius da (x, y) che la gomma a oggetti
+// può togliere, o -1 (anche se sopra c'è un filtro, un clear o simili)
+int  journal_hit_object(Journal *journal, int x, int y, int radius);
+// Gomma a oggetti: toglie l'oggetto (JCMD_ERASE_OBJECT) e ridisegna solo la
+// sua area dagli oggetti rimasti. Ritorna 1 se ha tolto qualcosa.
+int  journal_erase_at(Journal *journal, Canvas *canvas, int x, int y, int radius);
+
+// Copia in damage i tile cambiati dall'ultima chiamata e li azzera.
+// Dopo init e load risultano cambiati tutti.
+void journal_take_damage(Journal *journal, uint32_t damage[JOURNAL_DAMAGE_ROWS]);
+
+// Rasterizza un singolo comando, con coordinate e dimensioni moltiplicate per scale
+void journal_apply(const JournalCmd *cmd, Canvas *canvas, int scale);
+// Come sopra, poi trasla di (ox, oy): per disegnare una porzione (banda, tile)
+void journal_apply_offset(const JournalCmd *cmd, Canvas *canvas, int scale, int ox, int oy);
+// Rettangolo toccato dal comando alla scala data (estremi inclusi).
+// Ritorna 0 per i comandi che coprono tutto il canvas (clear).
+int  journal_cmd_bounds(const JournalCmd *cmd, int scale,
+                        int *min_x, int *min_y, int *max_x, int *max_y);
+// Area (sx, sy, sw, sh) da cui dipendono i pixel del rettangolo (x, y, w, h)
+// dopo il comando. Ritorna 0 se il comando legge solo i pixel che scrive.
+int  journal_cmd_source_rect(const JournalCmd *cmd, int scale,
+                             int x, int y, int w, int h,
+                             int *sx, int *sy, int *sw, int *sh);
+
+// Undo/redo di un'operazione intera. Ritornano 0 se non c'era nulla da fare.
+int  journal_undo(Journal *journal, Canvas *canvas);
+int  journal_redo(Journal *journal, Canvas *canvas);
+
+// Ridisegna da zero i comandi attivi su un canvas di dimensione qualsiasi
+void journal_rasterize(const Journal *journal, Canvas *canvas, int scale);
+
+int  journal_save(const Journal *journal, const char *path);
+int  journal_load(Journal *journal, const char *path);
+
+// Corpo del file: i soli comandi attivi, riusato dal formato di progetto
+int  journal_write_cmds(const Journal *journal, FILE *f);
+int  journal_read_cmds(Journal *journal, FILE *f, int count,
+                       unsigned int bg_color, uint32_t seq);
+
+#endif
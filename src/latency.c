@@ -0,0 +1,140 @@
+#include "latency.h"
+#include "platform.h"
+#include "membudget.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *stage_names[LATENCY_STAGE_COUNT] = {
+    "canvas", "upload", "swap", "vblank"
+};
+
+int latency_init(Latency *lat) {
+    memset(lat, 0, sizeof(Latency));
+    lat->records = (LatencyRecord *)mem_alloc(MEM_OTHER,
+                                              LATENCY_MAX_RECORDS * sizeof(LatencyRecord));
+    if (!lat->records) return -1;
+    return 0;
+}
+
+void latency_destroy(Latency *lat) {
+    mem_free(MEM_OTHER, lat->records, LATENCY_MAX_RECORDS * sizeof(LatencyRecord));
+    lat->records = NULL;
+}
+
+void latency_reset(Latency *lat) {
+    memset(lat->stages, 0, sizeof(lat->stages));
+    memset(&lat->total, 0, sizeof(lat->total));
+    lat->num_records = 0;
+    lat->next_record = 0;
+    lat->sample_us = 0;
+}
+
+static void dist_add(LatencyDist *dist, uint32_t us) {
+    uint32_t bucket = us / LATENCY_BUCKET_US;
+    if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+    dist->hist[bucket]++;
+    dist->count++;
+    dist->sum_us += us;
+    if (us > dist->max_us) dist->max_us = us;
+}
+
+void latency_begin(Latency *lat, uint64_t sample_us) {
+    lat->sample_us = sample_us;
+    memset(lat->mark_us, 0, sizeof(lat->mark_us));
+}
+
+void latency_mark_at(Latency *lat, LatencyStage stage, uint64_t t_us) {
+    if (!lat->sample_us) return;
+    // Le fasi valgono solo in ordine, a partire dall'inchiostro
+    if (stage > LATENCY_CANVAS && !lat->mark_us[stage - 1]) return;
+    if (!lat->mark_us[stage]) lat->mark_us[stage] = t_us;
+}
+
+void latency_mark(Latency *lat, LatencyStage stage) {
+    if (!lat->sample_us) return;
+    latency_mark_at(lat, stage, platform_time_us());
+}
+
+void latency_end(Latency *lat) {
+    if (!lat->sample_us || !lat->mark_us[LATENCY_STAGE_COUNT - 1]) {
+        lat->sample_us = 0;
+        return;
+    }
+
+    LatencyRecord rec;
+    rec.sample_us = lat->sample_us;
+    uint64_t prev = lat->sample_us;
+    for (int s = 0; s < LATENCY_STAGE_COUNT; s++) {
+        // Marche fuori ordine (tempi sintetici sbagliati): durata nulla
+        uint64_t t = (lat->mark_us[s] > prev) ? lat->mark_us[s] : prev;
+        rec.stage_us[s] = (uint32_t)(t - prev);
+        dist_add(&lat->stages[s], rec.stage_us[s]);
+        prev = t;
+    }
+    rec.total_us = (uint32_t)(prev - lat->sample_us);
+    dist_add(&lat->total, rec.total_us);
+
+    lat->records[lat->next_record] = rec;
+    lat->next_record = (lat->next_record + 1) % LATENCY_MAX_RECORDS;
+    if (lat->num_records < LATENCY_MAX_RECORDS) lat->num_records++;
+    lat->sample_us = 0;
+}
+
+uint32_t latency_percentile(const LatencyDist *dist, int pct) {
+    if (dist->count == 0) return 0;
+    uint64_t rank = ((uint64_t)dist->count * (uint64_t)pct + 99) / 100;
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS - 1; i++) {
+        seen += dist->hist[i];
+        if (seen >= rank) {
+            // Estremo superiore del bucket, ma mai oltre il massimo visto
+            uint32_t us = (uint32_t)(i + 1) * LATENCY_BUCKET_US;
+            return (us < dist->max_us) ? us : dist->max_us;
+        }
+    }
+    return dist->max_us;
+}
+
+const char *latency_stage_name(LatencyStage stage) {
+    return stage_names[stage];
+}
+
+static void dump_summary(FILE *f, const char *name, const LatencyDist *dist) {
+    fprintf(f, "# %-7s %8u %9.1f %8u %8u %8u %8u\n", name, dist->count,
+            dist->count ? (double)dist->sum_us / dist->count : 0.0,
+            latency_percentile(dist, 50), latency_percentile(dist, 95),
+            latency_percentile(dist, 99), dist->max_us);
+}
+
+int latency_dump(const Latency *lat, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+
+    fprintf(f, "# latenza touch -> schermo, microsecondi\n");
+    fprintf(f, "# %-7s %8s %9s %8s %8s %8s %8s\n",
+            "stage", "count", "mean", "p50", "p95", "p99", "max");
+    for (int s = 0; s < LATENCY_STAGE_COUNT; s++) {
+        dump_summary(f, stage_names[s], &lat->stages[s]);
+    }
+    dump_summary(f, "total", &lat->total);
+
+    fprintf(f, "sample_us");
+    for (int s = 0; s < LATENCY_STAGE_COUNT; s++) fprintf(f, ",%s_us", stage_names[s]);
+    fprintf(f, ",total_us\n");
+
+    // Dal più vecchio al più recente
+    int first = (lat->num_records < LATENCY_MAX_RECORDS) ? 0 : lat->next_record;
+    for (int i = 0; i < lat->num_records; i++) {
+        const LatencyRecord *rec = &lat->records[(first + i) % LATENCY_MAX_RECORDS];
+        fprintf(f, "%llu", (unsigned long long)rec->sample_us);
+        for (int s = 0; s < LATENCY_STAGE_COUNT; s++) fprintf(f, ",%u", rec->stage_us[s]);
+        fprintf(f, ",%u\n", rec->total_us);
+    }
+
+    int ret = ferror(f) ? -1 : 0;
+    if (fclose(f) != 0) ret = -1;
+    return ret;
+}
@@ -0,0 +1,80 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+/*
+ * Misura della latenza dal campione di touch all'inchiostro a schermo.
+ *
+ * input_update marca ogni campione con l'istante di acquisizione; il frame
+ * che lo trasforma in inchiostro marca le fasi successive. Un campione viene
+ * registrato solo se ha prodotto inchiostro e ha attraversato tutte le fasi.
+ * Sull'host le stesse funzioni ricevono campioni sintetici con il loro tempo.
+ */
+
+// Fasi della pipeline, nell'ordine in cui vengono completate
+typedef enum {
+    LATENCY_CANVAS,   // comando rasterizzato nel canvas
+    LATENCY_UPLOAD,   // canvas_update_texture
+    LATENCY_SWAP,     // vita2d_swap_buffers
+    LATENCY_VBLANK,   // vblank successivo: il frame va a schermo
+    LATENCY_STAGE_COUNT
+} LatencyStage;
+
+// Istogramma a passi di 100 us fino a 50 ms; oltre, nell'ultimo bucket
+#define LATENCY_BUCKET_US   100
+#define LATENCY_BUCKETS     500
+// Campioni completi tenuti per il dump (gli ultimi, ad anello)
+#define LATENCY_MAX_RECORDS 8192
+
+typedef struct {
+    uint32_t hist[LATENCY_BUCKETS];
+    uint32_t count;
+    uint64_t sum_us;
+    uint32_t max_us;
+} LatencyDist;
+
+typedef struct {
+    uint64_t sample_us;
+    uint32_t stage_us[LATENCY_STAGE_COUNT];  // durata di ogni fase
+    uint32_t total_us;
+} LatencyRecord;
+
+typedef struct {
+    int enabled;         // modalità attiva: la gestisce il chiamante
+
+    // Frame corrente: campione in volo e istanti delle fasi (0 = non ancora)
+    uint64_t sample_us;
+    uint64_t mark_us[LATENCY_STAGE_COUNT];
+
+    LatencyDist stages[LATENCY_STAGE_COUNT];
+    LatencyDist total;   // campione -> vblank
+
+    LatencyRecord *records;
+    int num_records;
+    int next_record;
+} Latency;
+
+int  latency_init(Latency *lat);
+void latency_destroy(Latency *lat);
+// Azzera le distribuzioni (non cambia enabled)
+void latency_reset(Latency *lat);
+
+// Inizio frame: il campione di touch che verrà usato, acquisito a sample_us
+// (0 = nessun tocco in questo frame)
+void latency_begin(Latency *lat, uint64_t sample_us);
+// Fase completata adesso, o all'istante t_us. Ignorata se il campione non ha
+// ancora prodotto inchiostro (LATENCY_CANVAS non marcata).
+void latency_mark(Latency *lat, LatencyStage stage);
+void latency_mark_at(Latency *lat, LatencyStage stage, uint64_t t_us);
+// Fine frame: registra il campione se ha completato tutte le fasi
+void latency_end(Latency *lat);
+
+// Percentile pct (0-100) in microsecondi, alla risoluzione dell'istogramma
+uint32_t latency_percentile(const LatencyDist *dist, int pct);
+const char *latency_stage_name(LatencyStage stage);
+
+// Scrive i campioni registrati (CSV) e il riepilogo per fase
+int  latency_dump(const Latency *lat, const char *path);
+
+#endif
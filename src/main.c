@@ -10,13 +10,229 @@
 #include "colors.h"
 #include "input.h"
 #include "ui.h"
+#include "journal.h"
+#include "stroke.h"
+#include "selection.h"
+#include "filter.h"
+#include "shape.h"
+#include "symmetry.h"
+#include "autosave.h"
+#include "project.h"
+#include "export.h"
+#include "timelapse.h"
+#include "latency.h"
+#include "membudget.h"
+#include "workpool.h"
+#include "platform.h"
+
+#define PROJECT_PATH  PLATFORM_DATA_DIR "/drawing.drwj"
+#define AUTOSAVE_PATH PLATFORM_DATA_DIR "/drawing.wal"
+#define TIMELAPSE_PATH PLATFORM_DATA_DIR "/drawing.tlp"
+#define BROKEN_PROJECT_PATH  PLATFORM_DATA_DIR "/drawing.broken.drwj"
+#define BROKEN_AUTOSAVE_PATH PLATFORM_DATA_DIR "/drawing.broken.wal"
+#define LATENCY_PATH   PLATFORM_DATA_DIR "/latency.csv"
+
+/* Export per la stampa: ridisegna il journal a 4x (3840x2176) */
+#define EXPORT_SCALE  4
+
+/* Tocco entro questa distanza dal primo vertice: chiude il poligono */
+#define POLYGON_CLOSE_RADIUS 12
+
+/* Ordini della simmetria radiale, dopo gli specchi */
+static const int symmetry_orders[] = { 3, 4, 6, 8, 12, 16 };
+#define SYMMETRY_ORDERS ((int)(sizeof(symmetry_orders) / sizeof(symmetry_orders[0])))
+
+static int is_selection_tool(ToolType tool) {
+    return (tool == TOOL_SELECT || tool == TOOL_LASSO);
+}
+
+static int is_filter_tool(ToolType tool) {
+    return (tool == TOOL_BLUR || tool == TOOL_SMUDGE);
+}
 
 static int is_shape_tool(ToolType tool) {
     return (tool == TOOL_LINE || tool == TOOL_RECT || tool == TOOL_CIRCLE ||
+            tool == TOOL_FILL_RECT || tool == TOOL_FILL_CIRCLE ||
+            tool == TOOL_GRADIENT || tool == TOOL_ELLIPSE ||
+            tool == TOOL_ROUND_RECT);
+}
+
+/* Forme del motore a scanline: il pulsante pressione sceglie lo stile */
+static int is_styled_shape_tool(ToolType tool) {
+    return (tool == TOOL_RECT || tool == TOOL_CIRCLE || tool == TOOL_FILL_RECT ||
+            tool == TOOL_FILL_CIRCLE || tool == TOOL_ELLIPSE ||
+            tool == TOOL_ROUND_RECT || tool == TOOL_POLYGON);
+}
+
+/* Lo strumento sceglie da solo fra contorno e pieno? */
+static int has_fixed_fill(ToolType tool) {
+    return (tool == TOOL_RECT || tool == TOOL_CIRCLE ||
             tool == TOOL_FILL_RECT || tool == TOOL_FILL_CIRCLE);
 }
 
+/* Limite della history raggiunto: il journal rinuncia a un keyframe
+   (undo e redo ripetono più comandi) invece di perdere operazioni */
+static int reclaim_history(void *user) {
+    return journal_trim((Journal *)user);
+}
+
+static int file_exists(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    fclose(f);
+    return 1;
+}
+
+/* Progetto presente ma illeggibile: lo sposta da parte con il suo log, così
+   né il replay del log né i checkpoint ci finiscono sopra. Ritorna 0 se il
+   percorso del progetto è di nuovo libero */
+static int set_aside_project(void) {
+    const char *project = file_exists(PROJECT_PATH) ? PROJECT_PATH
+                                                    : PROJECT_PATH ".tmp";
+    if (file_exists(AUTOSAVE_PATH) &&
+        rename(AUTOSAVE_PATH, BROKEN_AUTOSAVE_PATH) != 0) return -1;
+    return rename(project, BROKEN_PROJECT_PATH) == 0 ? 0 : -1;
+}
+
+/* Completa l'apertura del disegno: log di autosave, avvio dell'autosave
+   e del timelapse. Con un progetto illeggibile (load_result -2) che non si
+   riesce a spostare, niente log né autosave e *save_project a 0: il file
+   resta com'è anche all'uscita */
+static int start_session(Journal *journal, Canvas *canvas,
+                         Autosave *autosave, Timelapse *timelapse, UIState *ui,
+                         int load_result, int *save_project)
+{
+    /* Dopo il caricamento: il loader tocca i keyframe dal suo thread */
+    mem_set_reclaim(MEM_HISTORY, reclaim_history, journal);
+    timelapse_start(timelapse, TIMELAPSE_PATH);
+
+    if (load_result == -2 && set_aside_project() != 0) {
+        *save_project = 0;
+        ui_set_status(ui, "Project unreadable: autosave off, file kept");
+        return 0;
+    }
+
+    int recovered = autosave_replay_log(journal, canvas, AUTOSAVE_PATH);
+    int autosaving = (autosave_start(autosave, journal, canvas,
+                                     PROJECT_PATH, AUTOSAVE_PATH) == 0);
+
+    if (load_result == -2) {
+        ui_set_status(ui, "Project unreadable, moved to drawing.broken.drwj");
+    } else if (recovered > 0) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Recovered %d actions", recovered);
+        ui_set_status(ui, msg);
+    } else if (!autosaving) {
+        ui_set_status(ui, "Autosave unavailable!");
+    } else {
+        ui_set_status(ui, "Welcome to DrawApp!");
+    }
+    return autosaving;
+}
+
+/* Pulsante 'Sym': Off, specchi H, V, H+V, poi radiale 3..16 e di nuovo Off */
+static void cycle_symmetry(Canvas *canvas, UIState *ui) {
+    if (canvas->symmetry_mode != SYMMETRY_RADIAL) {
+        canvas->symmetry_mode = (SymmetryMode)(canvas->symmetry_mode + 1);
+        if (canvas->symmetry_mode == SYMMETRY_RADIAL) canvas->symmetry_order = symmetry_orders[0];
+    } else {
+        int i = 0;
+        while (i < SYMMETRY_ORDERS && symmetry_orders[i] <= canvas->symmetry_order) i++;
+        if (i < SYMMETRY_ORDERS) {
+            canvas->symmetry_order = symmetry_orders[i];
+        } else {
+            canvas->symmetry_mode = SYMMETRY_OFF;
+        }
+    }
+
+    const char *modes[] = { "Off", "Mirror H", "Mirror V", "Mirror H+V" };
+    char msg[64];
+    if (canvas->symmetry_mode == SYMMETRY_RADIAL) {
+        snprintf(msg, sizeof(msg), "Symmetry: Radial %d", canvas->symmetry_order);
+    } else {
+        snprintf(msg, sizeof(msg), "Symmetry: %s", modes[canvas->symmetry_mode]);
+    }
+    ui_set_status(ui, msg);
+}
+
+/* Applica la selezione flottante; avvisa se il journal non l'ha registrata */
+static int commit_selection(Selection *sel, Journal *journal, Canvas *canvas, UIState *ui) {
+    int moved = selection_commit(sel, journal, canvas);
+    if (moved < 0) ui_set_status(ui, "Out of memory: selection move not applied!");
+    return moved;
+}
+
+/* Modalità latenza (Triangle nell'help): spegnendola scrive i campioni */
+static void toggle_latency(Latency *latency, UIState *ui) {
+    if (!latency->records) {
+        ui_set_status(ui, "Latency mode unavailable!");
+        return;
+    }
+    latency->enabled = !latency->enabled;
+    if (latency->enabled) {
+        latency_reset(latency);
+        ui_set_status(ui, "Latency mode on");
+    } else if (latency_dump(latency, LATENCY_PATH) == 0) {
+        ui_set_status(ui, "Latency saved to latency.csv");
+    } else {
+        ui_set_status(ui, "Latency dump failed!");
+    }
+}
+
+/* Avvia l'export in export_NNN.png, primo numero libero, su un thread:
+   i worker sono quelli del pool meno il thread di frame */
+static int start_export(ExportWorker *exporter, const Journal *journal,
+                        const Canvas *canvas, const WorkPool *pool, UIState *ui)
+{
+    char path[128];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(path, sizeof(path), PLATFORM_DATA_DIR "/export_%03d.png", i);
+        FILE *f = fopen(path, "rb");
+        if (!f) break;
+        fclose(f);
+    }
+
+    int workers = workpool_size(pool) - 1;
+    if (export_png_async(exporter, path, journal, canvas, EXPORT_SCALE, EXPORT_RERASTER,
+                         workers > 1 ? workers : 1) != 0) {
+        ui_set_status(ui, "Export failed!");
+        return 0;
+    }
+    ui_set_status(ui, "Exporting... 0%");
+    return 1;
+}
+
+/* Avanzamento nella barra di stato; ritorna 0 a export finito */
+static int update_export(ExportWorker *exporter, UIState *ui, int *last_percent) {
+    int bands_done;
+    char msg[64];
+    if (!export_worker_done(exporter, &bands_done)) {
+        int percent = bands_done * 100 / exporter->bands;
+        if (percent != *last_percent) {
+            *last_percent = percent;
+            snprintf(msg, sizeof(msg), "Exporting... %d%%", percent);
+            ui_set_status(ui, msg);
+        }
+        return 1;
+    }
+
+    ExportStats stats;
+    if (export_worker_finish(exporter, &stats) != 0) {
+        snprintf(msg, sizeof(msg), "Export failed!");
+    } else if (stats.upscaled_bands > 0) {
+        snprintf(msg, sizeof(msg), "Exported %dx in %.1fs (%d bands upscaled)", EXPORT_SCALE,
+                 stats.seconds, stats.upscaled_bands);
+    } else {
+        snprintf(msg, sizeof(msg), "Exported %dx in %.1fs", EXPORT_SCALE, stats.seconds);
+    }
+    ui_set_status(ui, msg);
+    return 0;
+}
+
 int main(void) {
+    /* Budget di memoria: pool e arena riservati prima di tutto il resto */
+    mem_init();
+
     vita2d_init();
     vita2d_set_clear_color(RGBA8(50, 50, 50, 255));
     vita2d_set_vblank_wait(1);
@@ -31,25 +247,101 @@ int main(void) {
         return -1;
     }
 
+    Journal journal;
+    if (journal_init(&journal, canvas.bg_color) < 0) {
+        canvas_destroy(&canvas);
+        sceKernelExitProcess(0);
+        return -1;
+    }
+
+    /* Riapre l'ultimo disegno in background: i tile compaiono man mano */
+    platform_make_data_dir();
+    ProjectLoader loader;
+    int loading = (project_load_async(&loader, PROJECT_PATH,
+                                      &journal, &canvas) == 0);
+    int load_result = 0;
+    if (!loading) {
+        load_result = project_load(&journal, &canvas, PROJECT_PATH);
+    }
+
+    Autosave autosave;
+    int autosaving = 0;
+    int save_project = 1;
+
+    /* Registrazione del timelapse, avviata con la sessione */
+    Timelapse timelapse;
+    memset(&timelapse, 0, sizeof(Timelapse));
+
+    /* Latenza touch -> schermo, attivata dall'help (senza memoria per i
+       campioni resta non disponibile) */
+    Latency latency;
+    latency_init(&latency);
+
+    WorkPool pool;
+    workpool_init(&pool, 0);
+    journal.pool = &pool;  /* blur e sharpen a tutto canvas, anche in undo/redo */
+    ExportWorker exporter;
+    int exporting = 0;
+    int export_percent = 0;
+
     ColorPalette palette;
     palette_init(&palette);
     canvas.current_color = palette_get_current(&palette);
 
+    Selection selection;
+    selection_init(&selection);
+    int selection_dragging = 0;
+
+    /* Vertici del poligono in costruzione */
+    int poly_x[SHAPE_MAX_POINTS], poly_y[SHAPE_MAX_POINTS];
+    int poly_n = 0;
+
     UIState ui;
     ui_init(&ui);
-    ui_set_status(&ui, "Welcome to DrawApp!");
+    if (loading) {
+        ui_set_status(&ui, "Loading...");
+    } else {
+        autosaving = start_session(&journal, &canvas, &autosave, &timelapse, &ui,
+                                   load_result, &save_project);
+    }
 
     int running = 1;
+    unsigned int dropped_cmds = 0;
+    int autosave_failures = 0;
 
     while (running) {
+        /* Chiude le statistiche dell'arena del frame precedente */
+        mem_frame_end();
         input_update(&input);
 
         /* START = esci */
         if (input_button_pressed(&input, SCE_CTRL_START)) {
+            commit_selection(&selection, &journal, &canvas, &ui);
             running = 0;
             continue;
         }
 
+        /* Caricamento in corso: mostra i tile pronti, niente input */
+        if (loading) {
+            if (project_loader_done(&loader)) {
+                load_result = project_loader_finish(&loader);
+                loading = 0;
+                autosaving = start_session(&journal, &canvas, &autosave, &timelapse, &ui,
+                                           load_result, &save_project);
+            } else {
+                ui_update(&ui);
+                vita2d_start_drawing();
+                vita2d_clear_screen();
+                canvas_update_texture(&canvas);
+                canvas_render(&canvas);
+                ui_render_toolbar(&ui, &canvas, &palette);
+                vita2d_end_drawing();
+                vita2d_swap_buffers();
+                sceDisplayWaitVblankStart();
+                continue;
+            }
+        }
+
         /* SELECT = help */
         if (input_button_pressed(&input, SCE_CTRL_SELECT)) {
             ui.show_help = !ui.show_help;
@@ -57,6 +349,12 @@ int main(void) {
 
         /* Se help aperta, render e skip */
         if (ui.show_help) {
+            if (input_button_pressed(&input, SCE_CTRL_TRIANGLE)) {
+                toggle_latency(&latency, &ui);
+            }
+            if (input_button_pressed(&input, SCE_CTRL_SQUARE)) {
+                ui.show_memory = !ui.show_memory;
+            }
             vita2d_start_drawing();
             vita2d_clear_screen();
             canvas_update_texture(&canvas);
@@ -72,29 +370,62 @@ int main(void) {
 
         /* Triangle = cambia tool */
         if (input_button_pressed(&input, SCE_CTRL_TRIANGLE)) {
+            int committed = commit_selection(&selection, &journal, &canvas, &ui);
             canvas.tool = (canvas.tool + 1) % TOOL_COUNT;
             canvas.shape_drawing = 0;
+            poly_n = 0;
             const char *names[] = {
                 "Pencil", "Eraser", "Line", "Rect",
-                "Circle", "FillRect", "FillCircle", "Spray"
+                "Circle", "FillRect", "FillCircle", "Spray",
+                "Select", "Lasso", "Blur", "Smudge", "Gradient",
+                "Object Eraser", "Ellipse", "Rounded Rect", "Polygon"
             };
             char msg[64];
             snprintf(msg, sizeof(msg), "Tool: %s", names[canvas.tool]);
-            ui_set_status(&ui, msg);
+            if (committed >= 0) ui_set_status(&ui, msg);
         }
 
         /* Square = clear */
         if (input_button_pressed(&input, SCE_CTRL_SQUARE)) {
-            canvas_save_undo(&canvas);
-            canvas_clear(&canvas, canvas.bg_color);
+            selection_cancel(&selection);
+            journal_begin_op(&journal, &canvas);
+            journal_record(&journal, &canvas, JCMD_CLEAR, 0, 0, 0, 0, 0,
+                           canvas.bg_color);
             canvas.shape_drawing = 0;
+            poly_n = 0;
             ui_set_status(&ui, "Canvas cleared!");
         }
 
-        /* Circle = undo */
+        /* Circle = undo (o annulla la selezione flottante) */
         if (input_button_pressed(&input, SCE_CTRL_CIRCLE)) {
-            canvas_undo(&canvas);
-            ui_set_status(&ui, "Undo!");
+            canvas.shape_drawing = 0;
+            if (poly_n > 0) {
+                poly_n = 0;
+                ui_set_status(&ui, "Polygon cancelled");
+            } else if (selection.state != SEL_NONE) {
+                selection_cancel(&selection);
+                ui_set_status(&ui, "Selection cancelled");
+            } else if (journal_undo(&journal, &canvas))
+                ui_set_status(&ui, "Undo!");
+            else
+                ui_set_status(&ui, "Nothing to undo");
+        }
+
+        /* D-Pad RIGHT = redo */
+        if (input_button_pressed(&input, SCE_CTRL_RIGHT)) {
+            selection_cancel(&selection);
+            if (journal_redo(&journal, &canvas))
+                ui_set_status(&ui, "Redo!");
+            else
+                ui_set_status(&ui, "Nothing to redo");
+        }
+
+        /* D-Pad LEFT = export PNG ad alta risoluzione */
+        if (input_button_pressed(&input, SCE_CTRL_LEFT) && !exporting) {
+            if (commit_selection(&selection, &journal, &canvas, &ui) >= 0) {
+                exporting = start_export(&exporter, &journal, &canvas, &pool, &ui);
+                export_percent = 0;
+            }
         }
 
         /* Cross = toggle UI */
@@ -135,6 +466,25 @@ int main(void) {
             canvas.current_color = palette_get_current(&palette);
         }
 
+        /* Stick destro = ruota (X) e scala (Y) la selezione flottante */
+        if (selection.state == SEL_FLOATING) {
+            selection.transform.angle += input.rx * 4;
+            if (input.ry) {
+                int s = selection.transform.sx * (4096 - input.ry) / 4096;
+                if (s < SELECTION_SCALE_MIN) s = SELECTION_SCALE_MIN;
+                if (s > SELECTION_SCALE_MAX) s = SELECTION_SCALE_MAX;
+                selection.transform.sx = s;
+                selection.transform.sy = s;
+            }
+        }
+
+        /* Il campione di questo frame, se arriva a diventare inchiostro */
+        if (latency.enabled) {
+            int sampled = input.front_touching || input.front_just_released;
+            latency_begin(&latency, sampled ? input.front_time_us : 0);
+        }
+        uint32_t seq_before = journal.seq;
+
         /* ===== TOUCH DRAWING ===== */
         if (input.front_touching) {
             int tx = input.front_x;
@@ -148,7 +498,71 @@ int main(void) {
             }
             /* Tocco sulla toolbar? */
             else if (ui_toolbar_hit_test(&ui, tx, ty)) {
-                /* ignora */
+                /* Swatch: scambia colore primario e secondario */
+                if (input.front_just_pressed && ui_swatch_hit_test(&ui, tx, ty)) {
+                    palette_swap(&palette);
+                    canvas.current_color = palette_get_current(&palette);
+                }
+                /* Simmetria per tutti gli strumenti di disegno */
+                if (input.front_just_pressed && ui_symmetry_hit_test(&ui, tx, ty)) {
+                    cycle_symmetry(&canvas, &ui);
+                }
+                /* Con il gradiente il pulsante pressione cicla la forma */
+                if (input.front_just_pressed && ui_pressure_hit_test(&ui, tx, ty) &&
+                    canvas.tool == TOOL_GRADIENT) {
+                    canvas.gradient_mode = (canvas.gradient_mode + 1) % GRADIENT_MODE_COUNT;
+                    const char *modes[] = { "Linear", "Radial", "Linear in rect",
+                                            "Radial in circle" };
+                    char msg[64];
+                    snprintf(msg, sizeof(msg), "Gradient: %s", modes[canvas.gradient_mode]);
+                    ui_set_status(&ui, msg);
+                }
+                /* Con le forme cicla contorno/pieno e antialiasing */
+                else if (input.front_just_pressed && ui_pressure_hit_test(&ui, tx, ty) &&
+                         is_styled_shape_tool(canvas.tool)) {
+                    if (has_fixed_fill(canvas.tool)) {
+                        canvas.shape_aa = !canvas.shape_aa;
+                    } else {
+                        int style = (canvas.shape_fill | (canvas.shape_aa << 1)) + 1;
+                        canvas.shape_fill = style & 1;
+                        canvas.shape_aa = (style >> 1) & 1;
+                    }
+                    const char *styles[] = { "Outline", "Filled", "Outline AA", "Filled AA" };
+                    char msg[64];
+                    if (has_fixed_fill(canvas.tool)) {
+                        snprintf(msg, sizeof(msg), "Antialiasing: %s",
+                                 canvas.shape_aa ? "On" : "Off");
+                    } else {
+                        snprintf(msg, sizeof(msg), "Shape: %s",
+                                 styles[canvas.shape_fill | (canvas.shape_aa << 1)]);
+                    }
+                    ui_set_status(&ui, msg);
+                }
+                /* Pulsante pressione: cicla la modalità */
+                else if (input.front_just_pressed && ui_pressure_hit_test(&ui, tx, ty)) {
+                    canvas.pressure_mode = (canvas.pressure_mode + 1) % PRESSURE_MODE_COUNT;
+                    const char *modes[] = { "Off", "Size", "Size + Opacity" };
+                    char msg[64];
+                    snprintf(msg, sizeof(msg), "Pressure: %s", modes[canvas.pressure_mode]);
+                    ui_set_status(&ui, msg);
+                }
+                /* Blur/Sharpen: filtro su tutto il canvas, diviso fra i worker */
+                int filter = input.front_just_pressed ? ui_filter_hit_test(&ui, tx, ty) : -1;
+                if (filter >= 0) {
+                    commit_selection(&selection, &journal, &canvas, &ui);
+                    int radius = (filter == FILTER_BLUR) ? FILTER_BLUR_RADIUS
+                                                         : FILTER_SHARPEN_RADIUS;
+                    uint64_t t = platform_time_us();
+                    journal_begin_op(&journal, &canvas);
+                    journal_record_filter(&journal, &canvas, JCMD_FILTER,
+                                          0, 0, canvas.width, canvas.height, 0,
+                                          FILTER_PARAMS(filter, radius, FILTER_SHARPEN_AMOUNT));
+                    char msg[64];
+                    snprintf(msg, sizeof(msg), "%s: %d ms",
+                             (filter == FILTER_BLUR) ? "Blur" : "Sharpen",
+                             (int)((platform_time_us() - t) / 1000));
+                    ui_set_status(&ui, msg);
+                }
             }
             /* Disegno sul canvas */
             else {
@@ -157,134 +571,334 @@ int main(void) {
                     draw_color = canvas.bg_color;
                 }
 
-                if (is_shape_tool(canvas.tool)) {
+                if (is_selection_tool(canvas.tool)) {
+                    if (selection.state == SEL_FLOATING) {
+                        /* Trascina dentro la selezione, tocca fuori per applicarla */
+                        if (input.front_just_pressed) {
+                            selection_dragging = selection_hit(&selection, tx, ty);
+                            if (!selection_dragging &&
+                                commit_selection(&selection, &journal, &canvas, &ui) > 0) {
+                                ui_set_status(&ui, "Selection applied");
+                            }
+                        } else if (selection_dragging) {
+                            selection.transform.dx += tx - input.front_prev_x;
+                            selection.transform.dy += ty - input.front_prev_y;
+                        }
+                    } else if (input.front_just_pressed) {
+                        selection_begin(&selection, canvas.tool == TOOL_LASSO, tx, ty);
+                    } else {
+                        selection_add_point(&selection, tx, ty);
+                    }
+                } else if (is_filter_tool(canvas.tool)) {
+                    /* Blur lungo il tratto o sfumino: il tocco iniziale apre
+                     * l'operazione, lo sfumino lavora solo trascinando */
+                    JournalCmdType type = (canvas.tool == TOOL_BLUR) ? JCMD_FILTER_STROKE
+                                                                    : JCMD_SMUDGE;
+                    uint32_t params = (canvas.tool == TOOL_BLUR)
+                        ? FILTER_PARAMS(FILTER_BLUR, FILTER_BLUR_RADIUS, 0)
+                        : FILTER_PARAMS(0, 0, FILTER_SMUDGE_STRENGTH);
+                    if (input.front_just_pressed) {
+                        journal_begin_op(&journal, &canvas);
+                        if (type == JCMD_FILTER_STROKE) {
+                            journal_record_filter(&journal, &canvas, type, tx, ty, tx, ty,
+                                                  canvas.brush_size, params);
+                        }
+                    } else if (tx != input.front_prev_x || ty != input.front_prev_y) {
+                        journal_record_filter(&journal, &canvas, type,
+                                              input.front_prev_x, input.front_prev_y,
+                                              tx, ty, canvas.brush_size, params);
+                    }
+                } else if (canvas.tool == TOOL_ERASE_OBJECT) {
+                    /* Gomma a oggetti: toglie i tratti interi sotto il dito,
+                     * tutti in un'unica operazione per tocco */
+                    if (input.front_just_pressed) {
+                        journal_begin_op(&journal, &canvas);
+                    }
+                    /* Con la simmetria anche sotto le copie del dito */
+                    SymmetryXform sym[SYMMETRY_MAX_COPIES];
+                    int copies = symmetry_xforms(canvas.symmetry_mode, canvas.symmetry_order,
+                                                 canvas.width / 2, canvas.height / 2, sym);
+                    for (int k = 0; k < copies; k++) {
+                        int ex, ey;
+                        symmetry_map(&sym[k], tx, ty, &ex, &ey);
+                        journal_erase_at(&journal, &canvas, ex, ey, canvas.brush_size / 2);
+                    }
+                } else if (canvas.tool == TOOL_POLYGON) {
+                    /* Un vertice per tocco; toccare il primo chiude il poligono */
+                    if (input.front_just_pressed) {
+                        int close = (poly_n >= 3 &&
+                                     abs(tx - poly_x[0]) <= POLYGON_CLOSE_RADIUS &&
+                                     abs(ty - poly_y[0]) <= POLYGON_CLOSE_RADIUS);
+                        if (!close) {
+                            poly_x[poly_n] = tx;
+                            poly_y[poly_n] = ty;
+                            poly_n++;
+                        }
+                        if (close || poly_n == SHAPE_MAX_POINTS) {
+                            journal_begin_op(&journal, &canvas);
+                            journal_record_polygon(&journal, &canvas, poly_x, poly_y, poly_n,
+                                                   canvas.shape_fill ? 0 : canvas.brush_size,
+                                                   draw_color,
+                                                   canvas.shape_aa ? SHAPE_FLAG_AA : 0);
+                            poly_n = 0;
+                        }
+                    }
+                } else if (is_shape_tool(canvas.tool)) {
                     /* Primo tocco: salva punto iniziale */
                     if (input.front_just_pressed) {
-                        canvas_save_undo(&canvas);
                         canvas.shape_start_x = tx;
                         canvas.shape_start_y = ty;
                         canvas.shape_drawing = 1;
                     }
+                } else if (canvas.tool != TOOL_SPRAY &&
+                           canvas.pressure_mode != PRESSURE_OFF) {
+                    /* Tratto sensibile alla pressione */
+                    int size = stroke_pressure_size(canvas.brush_size, input.front_pressure);
+                    int alpha = 255;
+                    if (canvas.pressure_mode == PRESSURE_SIZE_OPACITY &&
+                        canvas.tool != TOOL_ERASER) {
+                        alpha = stroke_pressure_alpha(input.front_pressure);
+                    }
+                    if (input.front_just_pressed) {
+                        journal_begin_op(&journal, &canvas);
+                        journal_record_stroke(&journal, &canvas, tx, ty, size,
+                                              tx, ty, size, draw_color, alpha);
+                    } else {
+                        int prev_size = stroke_pressure_size(canvas.brush_size,
+                                                             input.front_prev_pressure);
+                        journal_record_stroke(&journal, &canvas,
+                                              input.front_prev_x, input.front_prev_y,
+                                              prev_size, tx, ty, size,
+                                              draw_color, alpha);
+                    }
                 } else {
                     /* Strumenti continui */
                     if (input.front_just_pressed) {
-                        canvas_save_undo(&canvas);
+                        journal_begin_op(&journal, &canvas);
                         if (canvas.tool == TOOL_SPRAY) {
-                            canvas_draw_spray(&canvas, tx, ty,
-                                              canvas.brush_size * 3,
-                                              draw_color);
+                            journal_record(&journal, &canvas, JCMD_SPRAY,
+                                           tx, ty, tx, ty,
+                                           canvas.brush_size * 3,
+                                           draw_color);
                         } else {
-                            canvas_draw_brush(&canvas, tx, ty,
-                                              canvas.brush_size,
-                                              draw_color);
+                            journal_record(&journal, &canvas, JCMD_BRUSH,
+                                           tx, ty, tx, ty,
+                                           canvas.brush_size,
+                                           draw_color);
                         }
                     } else {
                         /* Disegno continuo interpolato */
                         if (canvas.tool == TOOL_SPRAY) {
-                            canvas_draw_spray(&canvas, tx, ty,
-                                              canvas.brush_size * 3,
-                                              draw_color);
+                            journal_record(&journal, &canvas, JCMD_SPRAY,
+                                           tx, ty, tx, ty,
+                                           canvas.brush_size * 3,
+                                           draw_color);
                         } else {
-                            canvas_draw_line_brush(&canvas,
-                                                   input.front_prev_x,
-                                                   input.front_prev_y,
-                                                   tx, ty,
-                                                   canvas.brush_size,
-                                                   draw_color);
+                            journal_record(&journal, &canvas, JCMD_LINE,
+                                           input.front_prev_x,
+                                           input.front_prev_y,
+                                           tx, ty,
+                                           canvas.brush_size,
+                                           draw_color);
                         }
                     }
                 }
             }
         }
 
+        /* ===== RILASCIO TOUCH: SOLLEVA LA SELEZIONE ===== */
+        if (input.front_just_released) {
+            selection_dragging = 0;
+            if (selection.state == SEL_DEFINING &&
+                selection_lift(&selection, &canvas) != 0) {
+                selection_cancel(&selection);
+            }
+        }
+
         /* ===== RILASCIO TOUCH: FINALIZZA SHAPE ===== */
         if (input.front_just_released && canvas.shape_drawing) {
             int tx = input.front_prev_x;
             int ty = input.front_prev_y;
             unsigned int draw_color = canvas.current_color;
-            int dx, dy, r;
-
+            int flags = canvas.shape_aa ? SHAPE_FLAG_AA : 0;
+            int outline = canvas.shape_fill ? 0 : canvas.brush_size;
+            int corner = (abs(tx - canvas.shape_start_x) < abs(ty - canvas.shape_start_y))
+                         ? abs(tx - canvas.shape_start_x) / 4
+                         : abs(ty - canvas.shape_start_y) / 4;
+            int thickness = 0;
+            uint32_t params = 0;
+            int shape = 1;
+
+            /* Contorni spessi quanto il pennello, pieni con spessore 0 */
             switch (canvas.tool) {
-                case TOOL_LINE:
-                    canvas_draw_line(&canvas,
-                                     canvas.shape_start_x,
-                                     canvas.shape_start_y,
-                                     tx, ty,
-                                     canvas.brush_size, draw_color);
-                    break;
-
                 case TOOL_RECT:
-                    canvas_draw_rect(&canvas,
-                                     canvas.shape_start_x,
-                                     canvas.shape_start_y,
-                                     tx, ty, draw_color);
+                    thickness = canvas.brush_size;
+                    params = SHAPE_PARAMS(SHAPE_RECT, flags, 0);
                     break;
-
                 case TOOL_FILL_RECT:
-                    canvas_draw_filled_rect(&canvas,
-                                            canvas.shape_start_x,
-                                            canvas.shape_start_y,
-                                            tx, ty, draw_color);
+                    params = SHAPE_PARAMS(SHAPE_RECT, flags, 0);
                     break;
-
                 case TOOL_CIRCLE:
-                    dx = tx - canvas.shape_start_x;
-                    dy = ty - canvas.shape_start_y;
-                    r = (int)sqrtf((float)(dx * dx + dy * dy));
-                    canvas_draw_circle(&canvas,
-                                       canvas.shape_start_x,
-                                       canvas.shape_start_y,
-                                       r, draw_color);
+                    thickness = canvas.brush_size;
+                    params = SHAPE_PARAMS(SHAPE_CIRCLE, flags, 0);
                     break;
-
                 case TOOL_FILL_CIRCLE:
-                    dx = tx - canvas.shape_start_x;
-                    dy = ty - canvas.shape_start_y;
-                    r = (int)sqrtf((float)(dx * dx + dy * dy));
-                    canvas_draw_filled_circle(&canvas,
-                                              canvas.shape_start_x,
-                                              canvas.shape_start_y,
-                                              r, draw_color);
+                    params = SHAPE_PARAMS(SHAPE_CIRCLE, flags, 0);
+                    break;
+                case TOOL_ELLIPSE:
+                    thickness = outline;
+                    params = SHAPE_PARAMS(SHAPE_ELLIPSE, flags, 0);
+                    break;
+                case TOOL_ROUND_RECT:
+                    thickness = outline;
+                    params = SHAPE_PARAMS(SHAPE_RECT, flags, corner);
                     break;
-
                 default:
+                    shape = 0;
                     break;
             }
+
+            /* Gradiente dal primo tocco al rilascio, fra i due colori */
+            if (canvas.tool == TOOL_GRADIENT &&
+                (tx != canvas.shape_start_x || ty != canvas.shape_start_y)) {
+                journal_begin_op(&journal, &canvas);
+                journal_record_gradient(&journal, &canvas, canvas.gradient_mode,
+                                        canvas.shape_start_x, canvas.shape_start_y,
+                                        tx, ty, draw_color,
+                                        palette_get_secondary(&palette));
+            }
+
+            if (canvas.tool == TOOL_LINE) {
+                journal_begin_op(&journal, &canvas);
+                journal_record(&journal, &canvas, JCMD_LINE,
+                               canvas.shape_start_x, canvas.shape_start_y,
+                               tx, ty, canvas.brush_size, draw_color);
+            } else if (shape) {
+                journal_begin_op(&journal, &canvas);
+                journal_record_shape(&journal, &canvas,
+                                     canvas.shape_start_x, canvas.shape_start_y,
+                                     tx, ty, thickness, draw_color, params);
+            }
             canvas.shape_drawing = 0;
         }
+        if (journal.seq != seq_before) latency_mark(&latency, LATENCY_CANVAS);
+
+        /* Comandi disegnati senza spazio nel journal: non si annullano */
+        if (journal.dropped_cmds != dropped_cmds) {
+            dropped_cmds = journal.dropped_cmds;
+            ui_set_status(&ui, "Memory full: last action can't be undone");
+        }
+
+        if (exporting) exporting = update_export(&exporter, &ui, &export_percent);
 
         /* Aggiorna UI */
         ui_update(&ui);
 
+        if (autosaving) {
+            /* Checkpoint non scritto: il log resta valido, si riprova più tardi */
+            int failures = autosave_update(&autosave, &journal, &canvas);
+            if (failures != autosave_failures) {
+                autosave_failures = failures;
+                if (failures > 0) {
+                    char msg[64];
+                    snprintf(msg, sizeof(msg), "Autosave failed (disk full?), retry in %ds",
+                             (int)(AUTOSAVE_RETRY_US / 1000000));
+                    ui_set_status(&ui, msg);
+                } else {
+                    ui_set_status(&ui, "Autosave working again");
+                }
+            }
+        }
+        timelapse_update(&timelapse, &journal, &canvas);
+
         /* ===== RENDERING ===== */
         vita2d_start_drawing();
         vita2d_clear_screen();
 
         canvas_update_texture(&canvas);
+        latency_mark(&latency, LATENCY_UPLOAD);
+
+        /* Anteprima della selezione flottante direttamente nella texture */
+        if (selection.state == SEL_FLOATING) {
+            Canvas view;
+            canvas_init_buffer(&view, (unsigned int *)vita2d_texture_get_datap(canvas.texture),
+                               vita2d_texture_get_stride(canvas.texture) / sizeof(unsigned int),
+                               SCREEN_H);
+            selection_render_preview(&selection, &view, canvas.bg_color);
+        }
         canvas_render(&canvas);
+        ui_render_symmetry_guides(&canvas);
+        ui_render_selection(&selection);
 
         /* Preview shape */
         if (canvas.shape_drawing && input.front_touching) {
             ui_render_shape_preview(&canvas, input.front_x, input.front_y);
         }
+        if (poly_n > 0) {
+            ui_render_polygon_preview(poly_x, poly_y, poly_n, input.front_touching,
+                                      input.front_x, input.front_y);
+        }
 
         /* Cursore touch */
         if (input.front_touching) {
-            ui_render_cursor(input.front_x, input.front_y,
-                             canvas.brush_size, canvas.current_color);
+            int cursor_size = canvas.brush_size;
+            if (canvas.pressure_mode != PRESSURE_OFF && !is_filter_tool(canvas.tool) &&
+                canvas.tool != TOOL_ERASE_OBJECT) {
+                cursor_size = stroke_pressure_size(canvas.brush_size, input.front_pressure) /
+                              STROKE_SUBPIXEL;
+            }
+            /* Un cursore per copia: dove arriva anche il tratto replicato */
+            SymmetryXform sym[SYMMETRY_MAX_COPIES];
+            int copies = is_selection_tool(canvas.tool) ? 1 :
+                         symmetry_xforms(canvas.symmetry_mode, canvas.symmetry_order,
+                                         canvas.width / 2, canvas.height / 2, sym);
+            for (int k = copies - 1; k >= 0; k--) {
+                int cx = input.front_x, cy = input.front_y;
+                if (k > 0) symmetry_map(&sym[k], input.front_x, input.front_y, &cx, &cy);
+                ui_render_cursor(cx, cy, cursor_size, canvas.current_color);
+            }
         }
 
         /* Toolbar e palette */
         ui_render_toolbar(&ui, &canvas, &palette);
         ui_render_palette(&ui, &palette);
+        if (latency.enabled) ui_render_latency(&latency);
+        if (ui.show_memory) ui_render_memory();
 
         vita2d_end_drawing();
         vita2d_swap_buffers();
+        latency_mark(&latency, LATENCY_SWAP);
         sceDisplayWaitVblankStart();
+        latency_mark(&latency, LATENCY_VBLANK);
+        latency_end(&latency);
+    }
+
+    /* Un export in corso si finisce: il PNG a metà verrebbe perso */
+    if (exporting) export_worker_finish(&exporter, NULL);
+
+    /* Ultimo frame del timelapse */
+    timelapse_stop(&timelapse, &journal, &canvas);
+
+    /* Salva il disegno per la prossima sessione */
+    if (loading) {
+        /* Uscita prima della fine del caricamento: i file restano intatti */
+        project_loader_finish(&loader);
+    } else if (autosaving) {
+        autosave_stop(&autosave, &journal, &canvas);
+    } else if (save_project) {
+        project_save(PROJECT_PATH, &journal, canvas.pixels,
+                     canvas.width, canvas.height);
     }
 
+    if (latency.enabled) latency_dump(&latency, LATENCY_PATH);
+
     /* Cleanup */
+    latency_destroy(&latency);
+    workpool_destroy(&pool);
+    selection_cancel(&selection);
+    journal_destroy(&journal);
     canvas_destroy(&canvas);
+    mem_shutdown();
     vita2d_fini();
     sceKernelExitProcess(0);
     return 0;
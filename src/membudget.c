@@ -0,0 +1,367 @@
+#include "membudget.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEM_ALIGN       16
+#define MEM_ROUND(n)    (((n) + MEM_ALIGN - 1) & ~(size_t)(MEM_ALIGN - 1))
+
+// Blocco dell'arena: intestazione, poi i dati. prev collega i blocchi dal
+// più recente; quelli liberati escono quando arrivano in cima.
+#define MEM_NO_BLOCK    ((size_t)-1)
+#define MEM_HEAP_BLOCK  ((size_t)-2)   // temporaneo finito sull'heap
+
+typedef struct {
+    size_t size;
+    size_t prev;
+    int freed;
+} ScratchHeader;
+
+#define MEM_HEADER      MEM_ROUND(sizeof(ScratchHeader))
+
+static const char *subsystem_names[MEM_SUBSYSTEM_COUNT] = {
+    "canvas", "history", "index", "selection", "autosave",
+    "timelapse", "project", "scratch", "other"
+};
+
+// Limiti di mem_init: i pool coprono i buffer a dimensione fissa, il resto
+// è per comandi, indice e code che crescono con il disegno
+static const size_t default_limits[MEM_SUBSYSTEM_COUNT] = {
+    4u * 1024 * 1024,    // canvas: un frame
+    24u * 1024 * 1024,   // history: 4 keyframe più ~800k comandi
+    8u * 1024 * 1024,    // index
+    12u * 1024 * 1024,   // selection: buffer e anteprima
+    24u * 1024 * 1024,   // autosave: la copia dei comandi segue la storia
+    8u * 1024 * 1024,    // timelapse
+    4u * 1024 * 1024,    // project
+    0,                   // scratch: il limite è l'arena; oltre (worker, export
+                         // a 4x) si va sull'heap, solo contato
+    2u * 1024 * 1024     // other
+};
+
+static pthread_mutex_t mem_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct {
+    int ready;
+    pthread_t owner;
+
+    unsigned char *reserve;
+    size_t reserve_bytes;
+    unsigned char *frames;
+    unsigned char *tiles;
+    unsigned char *scratch;
+
+    int frame_list[MEM_FRAME_BUFFERS];
+    int frame_free;
+    int tile_list[MEM_TILE_BUFFERS];
+    int tile_free;
+    unsigned int pool_misses;
+
+    // Arena: solo il thread owner
+    size_t scratch_top;
+    size_t scratch_last;
+    size_t scratch_frame_peak;
+    size_t scratch_last_peak;
+    size_t scratch_peak;
+    unsigned int scratch_heap;
+
+    MemStats stats[MEM_SUBSYSTEM_COUNT];
+    MemReclaimFn reclaim[MEM_SUBSYSTEM_COUNT];
+    void *reclaim_user[MEM_SUBSYSTEM_COUNT];
+} mem;
+
+int mem_init(void) {
+    if (mem.ready) return 0;
+
+    size_t bytes = MEM_FRAME_BYTES * MEM_FRAME_BUFFERS + MEM_TILE_BYTES * MEM_TILE_BUFFERS +
+                   MEM_SCRATCH_BYTES + 64;
+    unsigned char *reserve = (unsigned char *)malloc(bytes);
+    if (!reserve) return -1;
+    // Tutte le pagine subito: niente page fault nei percorsi caldi
+    memset(reserve, 0, bytes);
+
+    pthread_mutex_lock(&mem_lock);
+    mem.reserve = reserve;
+    mem.reserve_bytes = bytes;
+    mem.frames = (unsigned char *)(((uintptr_t)reserve + 63) & ~(uintptr_t)63);
+    mem.tiles = mem.frames + MEM_FRAME_BYTES * MEM_FRAME_BUFFERS;
+    mem.scratch = mem.tiles + MEM_TILE_BYTES * MEM_TILE_BUFFERS;
+
+    for (int i = 0; i < MEM_FRAME_BUFFERS; i++) mem.frame_list[i] = MEM_FRAME_BUFFERS - 1 - i;
+    mem.frame_free = MEM_FRAME_BUFFERS;
+    for (int i = 0; i < MEM_TILE_BUFFERS; i++) mem.tile_list[i] = MEM_TILE_BUFFERS - 1 - i;
+    mem.tile_free = MEM_TILE_BUFFERS;
+
+    mem.scratch_top = 0;
+    mem.scratch_last = MEM_NO_BLOCK;
+    for (int s = 0; s < MEM_SUBSYSTEM_COUNT; s++) mem.stats[s].limit = default_limits[s];
+    mem.owner = pthread_self();
+    mem.ready = 1;
+    pthread_mutex_unlock(&mem_lock);
+    return 0;
+}
+
+void mem_shutdown(void) {
+    pthread_mutex_lock(&mem_lock);
+    unsigned char *reserve = mem.reserve;
+    mem.ready = 0;
+    mem.reserve = NULL;
+    mem.reserve_bytes = 0;
+    mem.frames = mem.tiles = mem.scratch = NULL;
+    mem.frame_free = 0;
+    mem.tile_free = 0;
+    for (int s = 0; s < MEM_SUBSYSTEM_COUNT; s++) {
+        mem.stats[s].limit = 0;
+        mem.reclaim[s] = NULL;
+        mem.reclaim_user[s] = NULL;
+    }
+    pthread_mutex_unlock(&mem_lock);
+    free(reserve);
+}
+
+void mem_set_limit(MemSubsystem sys, size_t bytes) {
+    pthread_mutex_lock(&mem_lock);
+    mem.stats[sys].limit = bytes;
+    pthread_mutex_unlock(&mem_lock);
+}
+
+void mem_set_reclaim(MemSubsystem sys, MemReclaimFn fn, void *user) {
+    pthread_mutex_lock(&mem_lock);
+    mem.reclaim[sys] = fn;
+    mem.reclaim_user[sys] = user;
+    pthread_mutex_unlock(&mem_lock);
+}
+
+static int mem_is_owner(void) {
+    return mem.ready && pthread_equal(pthread_self(), mem.owner);
+}
+
+// Conta bytes nel sottosistema; oltre il limite prova a farsi liberare
+// memoria dal sottosistema stesso (solo sul thread di frame)
+static int mem_charge(MemSubsystem sys, size_t bytes) {
+    MemStats *st = &mem.stats[sys];
+    for (;;) {
+        pthread_mutex_lock(&mem_lock);
+        if (st->limit == 0 || st->used + bytes <= st->limit) {
+            st->used += bytes;
+            if (st->used > st->peak) st->peak = st->used;
+            st->allocs++;
+            pthread_mutex_unlock(&mem_lock);
+            return 0;
+        }
+        MemReclaimFn fn = mem.reclaim[sys];
+        void *user = mem.reclaim_user[sys];
+        pthread_mutex_unlock(&mem_lock);
+
+        // Il reclaim restituisce memoria con mem_free/mem_buffer_put
+        if (!fn || !mem_is_owner() || !fn(user)) break;
+        pthread_mutex_lock(&mem_lock);
+        st->reclaims++;
+        pthread_mutex_unlock(&mem_lock);
+    }
+    pthread_mutex_lock(&mem_lock);
+    st->failures++;
+    pthread_mutex_unlock(&mem_lock);
+    return -1;
+}
+
+static void mem_uncharge(MemSubsystem sys, size_t bytes) {
+    pthread_mutex_lock(&mem_lock);
+    MemStats *st = &mem.stats[sys];
+    st->used = (st->used > bytes) ? st->used - bytes : 0;
+    pthread_mutex_unlock(&mem_lock);
+}
+
+static void mem_fail(MemSubsystem sys) {
+    pthread_mutex_lock(&mem_lock);
+    mem.stats[sys].failures++;
+    pthread_mutex_unlock(&mem_lock);
+}
+
+void *mem_alloc(MemSubsystem sys, size_t bytes) {
+    if (mem_charge(sys, bytes) != 0) return NULL;
+    void *p = malloc(bytes);
+    if (!p) {
+        mem_uncharge(sys, bytes);
+        mem_fail(sys);
+    }
+    return p;
+}
+
+void *mem_realloc(MemSubsystem sys, void *ptr, size_t old_bytes, size_t new_bytes) {
+    if (new_bytes > old_bytes && mem_charge(sys, new_bytes - old_bytes) != 0) return NULL;
+    void *p = realloc(ptr, new_bytes);
+    if (!p) {
+        if (new_bytes > old_bytes) mem_uncharge(sys, new_bytes - old_bytes);
+        mem_fail(sys);
+        return NULL;
+    }
+    if (new_bytes < old_bytes) mem_uncharge(sys, old_bytes - new_bytes);
+    return p;
+}
+
+void mem_free(MemSubsystem sys, void *ptr, size_t bytes) {
+    if (!ptr) return;
+    free(ptr);
+    mem_uncharge(sys, bytes);
+}
+
+unsigned int *mem_buffer_get(MemSubsystem sys, size_t bytes) {
+    if (mem_charge(sys, bytes) != 0) return NULL;
+
+    unsigned char *buf = NULL;
+    pthread_mutex_lock(&mem_lock);
+    if (mem.ready && bytes <= MEM_FRAME_BYTES) {
+        // Un tile non prende mai un blocco da frame
+        if (bytes <= MEM_TILE_BYTES) {
+            if (mem.tile_free > 0) buf = mem.tiles + MEM_TILE_BYTES * mem.tile_list[--mem.tile_free];
+        } else if (mem.frame_free > 0) {
+            buf = mem.frames + MEM_FRAME_BYTES * mem.frame_list[--mem.frame_free];
+        }
+        if (!buf) mem.pool_misses++;
+    }
+    pthread_mutex_unlock(&mem_lock);
+
+    if (!buf) {
+        buf = (unsigned char *)malloc(bytes);
+        if (!buf) {
+            mem_uncharge(sys, bytes);
+            mem_fail(sys);
+        }
+    }
+    return (unsigned int *)buf;
+}
+
+void mem_buffer_put(MemSubsystem sys, unsigned int *buf, size_t bytes) {
+    if (!buf) return;
+    mem_uncharge(sys, bytes);
+
+    unsigned char *p = (unsigned char *)buf;
+    pthread_mutex_lock(&mem_lock);
+    int pooled = 1;
+    if (mem.ready && p >= mem.frames && p < mem.tiles) {
+        mem.frame_list[mem.frame_free++] = (int)((size_t)(p - mem.frames) / MEM_FRAME_BYTES);
+    } else if (mem.ready && p >= mem.tiles && p < mem.scratch) {
+        mem.tile_list[mem.tile_free++] = (int)((size_t)(p - mem.tiles) / MEM_TILE_BYTES);
+    } else {
+        pooled = 0;
+    }
+    pthread_mutex_unlock(&mem_lock);
+    if (!pooled) free(buf);
+}
+
+static ScratchHeader *scratch_header(size_t offset) {
+    return (ScratchHeader *)(mem.scratch + offset);
+}
+
+void *mem_scratch_alloc(size_t bytes) {
+    size_t size = MEM_ROUND(bytes);
+    if (mem_charge(MEM_SCRATCH, size) != 0) return NULL;
+
+    if (mem_is_owner() && mem.scratch_top + MEM_HEADER + size <= MEM_SCRATCH_BYTES) {
+        size_t offset = mem.scratch_top;
+        ScratchHeader *h = scratch_header(offset);
+        h->size = size;
+        h->prev = mem.scratch_last;
+        h->freed = 0;
+        mem.scratch_last = offset;
+        mem.scratch_top = offset + MEM_HEADER + size;
+        if (mem.scratch_top > mem.scratch_frame_peak) mem.scratch_frame_peak = mem.scratch_top;
+        if (mem.scratch_top > mem.scratch_peak) mem.scratch_peak = mem.scratch_top;
+        return (unsigned char *)h + MEM_HEADER;
+    }
+
+    // Worker, thread di I/O o arena piena
+    ScratchHeader *h = (ScratchHeader *)malloc(MEM_HEADER + size);
+    if (!h) {
+        mem_uncharge(MEM_SCRATCH, size);
+        mem_fail(MEM_SCRATCH);
+        return NULL;
+    }
+    h->size = size;
+    h->prev = MEM_HEAP_BLOCK;
+    h->freed = 0;
+    pthread_mutex_lock(&mem_lock);
+    mem.scratch_heap++;
+    pthread_mutex_unlock(&mem_lock);
+    return (unsigned char *)h + MEM_HEADER;
+}
+
+void *mem_scratch_calloc(size_t bytes) {
+    void *p = mem_scratch_alloc(bytes);
+    if (p) memset(p, 0, bytes);
+    return p;
+}
+
+void mem_scratch_free(void *ptr) {
+    if (!ptr) return;
+    ScratchHeader *h = (ScratchHeader *)((unsigned char *)ptr - MEM_HEADER);
+    mem_uncharge(MEM_SCRATCH, h->size);
+    if (h->prev == MEM_HEAP_BLOCK) {
+        free(h);
+        return;
+    }
+
+    h->freed = 1;
+    while (mem.scratch_last != MEM_NO_BLOCK && scratch_header(mem.scratch_last)->freed) {
+        mem.scratch_top = mem.scratch_last;
+        mem.scratch_last = scratch_header(mem.scratch_last)->prev;
+    }
+}
+
+void *mem_scratch_realloc(void *ptr, size_t bytes) {
+    if (!ptr) return mem_scratch_alloc(bytes);
+    ScratchHeader *h = (ScratchHeader *)((unsigned char *)ptr - MEM_HEADER);
+    size_t size = MEM_ROUND(bytes);
+
+    // In cima all'arena: si allunga sul posto
+    if (h->prev != MEM_HEAP_BLOCK) {
+        size_t offset = (size_t)((unsigned char *)h - mem.scratch);
+        if (offset == mem.scratch_last && offset + MEM_HEADER + size <= MEM_SCRATCH_BYTES) {
+            if (size > h->size && mem_charge(MEM_SCRATCH, size - h->size) != 0) return NULL;
+            if (size < h->size) mem_uncharge(MEM_SCRATCH, h->size - size);
+            h->size = size;
+            mem.scratch_top = offset + MEM_HEADER + size;
+            if (mem.scratch_top > mem.scratch_frame_peak) mem.scratch_frame_peak = mem.scratch_top;
+            if (mem.scratch_top > mem.scratch_peak) mem.scratch_peak = mem.scratch_top;
+            return ptr;
+        }
+    }
+
+    void *p = mem_scratch_alloc(bytes);
+    if (!p) return NULL;
+    memcpy(p, ptr, (h->size < size) ? h->size : size);
+    mem_scratch_free(ptr);
+    return p;
+}
+
+void mem_frame_end(void) {
+    if (!mem_is_owner()) return;
+    mem.scratch_last_peak = mem.scratch_frame_peak;
+    mem.scratch_frame_peak = mem.scratch_top;
+}
+
+void mem_get_stats(MemSubsystem sys, MemStats *stats) {
+    pthread_mutex_lock(&mem_lock);
+    *stats = mem.stats[sys];
+    pthread_mutex_unlock(&mem_lock);
+}
+
+void mem_get_summary(MemSummary *summary) {
+    pthread_mutex_lock(&mem_lock);
+    summary->reserved = mem.reserve_bytes;
+    summary->frame_free = mem.frame_free;
+    summary->frame_total = mem.ready ? MEM_FRAME_BUFFERS : 0;
+    summary->tile_free = mem.tile_free;
+    summary->tile_total = mem.ready ? MEM_TILE_BUFFERS : 0;
+    summary->scratch_used = mem.scratch_top;
+    summary->scratch_frame_peak = mem.scratch_last_peak;
+    summary->scratch_peak = mem.scratch_peak;
+    summary->scratch_heap = mem.scratch_heap;
+    summary->pool_misses = mem.pool_misses;
+    pthread_mutex_unlock(&mem_lock);
+}
+
+const char *mem_subsystem_name(MemSubsystem sys) {
+    return subsystem_names[sys];
+}
@@ -0,0 +1,102 @@
+#ifndef MEMBUDGET_H
+#define MEMBUDGET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "canvas.h"
+
+/*
+ * Budget di memoria dell'app.
+ *
+ * mem_init riserva in un solo blocco, già toccato, i pool di buffer a
+ * dimensione fissa (canvas intero, tile di progetto) e l'arena dei buffer
+ * temporanei, e fissa un limite di byte per ogni sottosistema. Le strutture
+ * che crescono (comandi, indice, code) restano sull'heap ma sono contate nel
+ * limite del loro sottosistema.
+ *
+ * Quando un limite è raggiunto si chiede al sottosistema di liberare
+ * qualcosa (es. il journal scarta un keyframe) e si riprova; solo dopo la
+ * richiesta fallisce. Senza mem_init (tool host) tutto va sull'heap e si
+ * contano solo le statistiche.
+ */
+
+typedef enum {
+    MEM_CANVAS,       // pixel del canvas
+    MEM_HISTORY,      // comandi e keyframe del journal
+    MEM_INDEX,        // indice degli oggetti (gomma a oggetti)
+    MEM_SELECTION,    // buffer della selezione flottante
+    MEM_AUTOSAVE,     // coda e snapshot del checkpoint
+    MEM_TIMELAPSE,    // tile in attesa e ultimo frame registrato
+    MEM_PROJECT,      // tile e indice in lettura/scrittura
+    MEM_SCRATCH,      // buffer temporanei: filtri, forme, ridisegni
+    MEM_OTHER,
+    MEM_SUBSYSTEM_COUNT
+} MemSubsystem;
+
+// Blocchi dei pool
+#define MEM_FRAME_BYTES   ((size_t)SCREEN_W * SCREEN_H * sizeof(unsigned int))
+#define MEM_TILE_BYTES    ((size_t)64 * 64 * sizeof(unsigned int))
+// Canvas, 4 keyframe, 2 del timelapse, 1 snapshot dell'autosave
+#define MEM_FRAME_BUFFERS 8
+#define MEM_TILE_BUFFERS  16
+// Arena dei temporanei del thread di frame (blur a tutto canvas: 2 piani)
+#define MEM_SCRATCH_BYTES (8u * 1024 * 1024)
+
+typedef struct {
+    size_t used;
+    size_t peak;
+    size_t limit;            // 0 = senza limite
+    unsigned int allocs;
+    unsigned int failures;   // richieste rifiutate anche dopo il reclaim
+    unsigned int reclaims;   // volte in cui il sottosistema ha liberato memoria
+} MemStats;
+
+typedef struct {
+    size_t reserved;         // blocco riservato all'avvio (0 senza mem_init)
+    int frame_free;
+    int frame_total;
+    int tile_free;
+    int tile_total;
+    size_t scratch_used;
+    size_t scratch_frame_peak;   // picco dell'arena nell'ultimo frame
+    size_t scratch_peak;
+    unsigned int scratch_heap;   // temporanei finiti sull'heap
+    unsigned int pool_misses;    // buffer chiesti a pool vuoto (finiti sull'heap)
+} MemSummary;
+
+// Libera memoria del sottosistema; ritorna 1 se ha liberato qualcosa
+typedef int (*MemReclaimFn)(void *user);
+
+// Da chiamare prima di ogni allocazione, dal thread di frame: è l'unico che
+// usa l'arena e che esegue i reclaim
+int  mem_init(void);
+// Solo dopo aver restituito tutti i buffer
+void mem_shutdown(void);
+void mem_set_limit(MemSubsystem sys, size_t bytes);
+void mem_set_reclaim(MemSubsystem sys, MemReclaimFn fn, void *user);
+
+// Heap contato nel sottosistema (realloc: old_bytes è la dimensione attuale)
+void *mem_alloc(MemSubsystem sys, size_t bytes);
+void *mem_realloc(MemSubsystem sys, void *ptr, size_t old_bytes, size_t new_bytes);
+void  mem_free(MemSubsystem sys, void *ptr, size_t bytes);
+
+// Buffer di pixel: dal pool di tile o di frame se la dimensione ci sta,
+// altrimenti dall'heap. bytes va ripassato a mem_buffer_put.
+unsigned int *mem_buffer_get(MemSubsystem sys, size_t bytes);
+void mem_buffer_put(MemSubsystem sys, unsigned int *buf, size_t bytes);
+
+// Temporanei da liberare prima della fine del frame, in qualsiasi ordine.
+// Fuori dal thread di frame (o ad arena piena) vanno sull'heap.
+void *mem_scratch_alloc(size_t bytes);
+void *mem_scratch_calloc(size_t bytes);
+void *mem_scratch_realloc(void *ptr, size_t bytes);
+void  mem_scratch_free(void *ptr);
+
+// Fine frame: chiude le statistiche per frame dell'arena
+void mem_frame_end(void);
+
+void mem_get_stats(MemSubsystem sys, MemStats *stats);
+void mem_get_summary(MemSummary *summary);
+const char *mem_subsystem_name(MemSubsystem sys);
+
+#endif
@@ -0,0 +1,47 @@
+#include "platform.h"
+
+#ifdef __vita__
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/io/stat.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+uint64_t platform_time_us(void) {
+#ifdef __vita__
+    return (uint64_t)sceKernelGetProcessTimeWide();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000ull;
+#endif
+}
+
+int platform_num_cpus(void) {
+#ifdef __vita__
+    // Le app utente hanno a disposizione i core 0-2
+    return 3;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+#endif
+}
+
+void platform_sleep_us(uint32_t us) {
+#ifdef __vita__
+    sceKernelDelayThread(us);
+#else
+    usleep(us);
+#endif
+}
+
+void platform_make_data_dir(void) {
+#ifdef __vita__
+    sceIoMkdir(PLATFORM_DATA_DIR, 0777);
+#else
+    mkdir(PLATFORM_DATA_DIR, 0777);
+#endif
+}
@@ -0,0 +1,25 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdint.h>
+
+// Cartella dati dell'app (progetti, autosave, export)
+#ifdef __vita__
+#define PLATFORM_DATA_DIR "ux0:data/DrawApp"
+#else
+#define PLATFORM_DATA_DIR "."
+#endif
+
+// Tempo monotono in microsecondi
+uint64_t platform_time_us(void);
+
+// Core utilizzabili per i thread di lavoro
+int platform_num_cpus(void);
+
+// Sospende il thread corrente
+void platform_sleep_us(uint32_t us);
+
+// Crea PLATFORM_DATA_DIR se non esiste
+void platform_make_data_dir(void);
+
+#endif
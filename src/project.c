@@ -0,0 +1,331 @@
+#include "project.h"
+#include "membudget.h"
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define PROJECT_TILE_BYTES (PROJECT_TILE_SIZE * PROJECT_TILE_SIZE * sizeof(unsigned int))
+#define PROJECT_SCRATCH_BYTES (compressBound(PROJECT_TILE_BYTES) + PROJECT_TILE_BYTES)
+
+// Livello zlib: i checkpoint girano spesso, conta più la velocità
+#define PROJECT_ZLIB_LEVEL 1
+
+static void project_tile_rect(int width, int height, int tiles_x, int tile,
+                              int *x, int *y, int *w, int *h)
+{
+    *x = (tile % tiles_x) * PROJECT_TILE_SIZE;
+    *y = (tile / tiles_x) * PROJECT_TILE_SIZE;
+    *w = (*x + PROJECT_TILE_SIZE <= width)  ? PROJECT_TILE_SIZE : width - *x;
+    *h = (*y + PROJECT_TILE_SIZE <= height) ? PROJECT_TILE_SIZE : height - *y;
+}
+
+int project_save(const char *path, const Journal *journal,
+                 const unsigned int *pixels, int width, int height)
+{
+    int tiles_x = (width + PROJECT_TILE_SIZE - 1) / PROJECT_TILE_SIZE;
+    int tiles_y = (height + PROJECT_TILE_SIZE - 1) / PROJECT_TILE_SIZE;
+    int num_tiles = tiles_x * tiles_y;
+
+    size_t index_bytes = (size_t)num_tiles * sizeof(ProjectTile);
+    ProjectTile *index = (ProjectTile *)mem_alloc(MEM_PROJECT, index_bytes);
+    unsigned int *tile = mem_buffer_get(MEM_PROJECT, PROJECT_TILE_BYTES);
+    uLongf zbound = compressBound(PROJECT_TILE_BYTES);
+    unsigned char *zbuf = (unsigned char *)mem_alloc(MEM_PROJECT, zbound);
+    if (index) memset(index, 0, index_bytes);
+    FILE *f = fopen(path, "wb");
+    int ok = index && tile && zbuf && f;
+
+    ProjectHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = PROJECT_MAGIC;
+    header.version = PROJECT_VERSION;
+    header.width = width;
+    header.height = height;
+    header.tile_size = PROJECT_TILE_SIZE;
+    header.num_tiles = num_tiles;
+    header.bg_color = journal->bg_color;
+    header.seq = journal->seq;
+    header.journal_count = journal->cursor;
+
+    // Header e indice vengono riscritti alla fine con gli offset veri
+    long offset = (long)(sizeof(ProjectHeader) + num_tiles * sizeof(ProjectTile));
+    if (ok) ok = fseek(f, offset, SEEK_SET) == 0;
+
+    for (int i = 0; ok && i < num_tiles; i++) {
+        int tx, ty, tw, th;
+        project_tile_rect(width, height, tiles_x, i, &tx, &ty, &tw, &th);
+
+        int solid = 1;
+        unsigned int first = pixels[ty * width + tx];
+        for (int y = 0; y < th; y++) {
+            const unsigned int *src = &pixels[(ty + y) * width + tx];
+            memcpy(&tile[y * tw], src, tw * sizeof(unsigned int));
+            for (int x = 0; solid && x < tw; x++) {
+                if (src[x] != first) solid = 0;
+            }
+        }
+
+        ProjectTile *entry = &index[i];
+        if (solid) {
+            entry->flags = PROJECT_TILE_SOLID;
+            entry->color = first;
+            continue;
+        }
+
+        uLong raw_size = (uLong)tw * th * sizeof(unsigned int);
+        uLongf zlen = zbound;
+        const void *data = tile;
+        entry->flags = PROJECT_TILE_RAW;
+        entry->size = (uint32_t)raw_size;
+        if (compress2(zbuf, &zlen, (const Bytef *)tile, raw_size, PROJECT_ZLIB_LEVEL) == Z_OK &&
+            zlen < raw_size) {
+            entry->flags = PROJECT_TILE_ZLIB;
+            entry->size = (uint32_t)zlen;
+            data = zbuf;
+        }
+
+        entry->offset = (uint32_t)offset;
+        ok = fwrite(data, entry->size, 1, f) == 1;
+        offset += entry->size;
+    }
+
+    if (ok) {
+        header.journal_offset = (uint32_t)offset;
+        ok = journal_write_cmds(journal, f) == 0;
+    }
+    if (ok) {
+        ok = fseek(f, 0, SEEK_SET) == 0 &&
+             fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(index, sizeof(ProjectTile), num_tiles, f) == (size_t)num_tiles;
+    }
+    if (f && fclose(f) != 0) ok = 0;
+
+    mem_free(MEM_PROJECT, index, index_bytes);
+    if (tile) mem_buffer_put(MEM_PROJECT, tile, PROJECT_TILE_BYTES);
+    mem_free(MEM_PROJECT, zbuf, zbound);
+    return ok ? 0 : -1;
+}
+
+int project_open(ProjectReader *reader, const char *path) {
+    memset(reader, 0, sizeof(ProjectReader));
+    reader->file = fopen(path, "rb");
+    if (!reader->file) return -1;
+
+    ProjectHeader *h = &reader->header;
+    if (fread(h, sizeof(ProjectHeader), 1, reader->file) != 1 ||
+        h->magic != PROJECT_MAGIC || h->version != PROJECT_VERSION ||
+        h->tile_size != PROJECT_TILE_SIZE || h->width == 0 || h->height == 0) {
+        project_close(reader);
+        return -2;
+    }
+
+    reader->tiles_x = (h->width + PROJECT_TILE_SIZE - 1) / PROJECT_TILE_SIZE;
+    reader->tiles_y = (h->height + PROJECT_TILE_SIZE - 1) / PROJECT_TILE_SIZE;
+    if (h->num_tiles != (uint32_t)(reader->tiles_x * reader->tiles_y)) {
+        project_close(reader);
+        return -2;
+    }
+
+    reader->index = (ProjectTile *)mem_alloc(MEM_PROJECT, h->num_tiles * sizeof(ProjectTile));
+    reader->scratch = (unsigned char *)mem_alloc(MEM_PROJECT, PROJECT_SCRATCH_BYTES);
+    if (!reader->index || !reader->scratch ||
+        fread(reader->index, sizeof(ProjectTile), h->num_tiles, reader->file) != h->num_tiles) {
+        project_close(reader);
+        return -2;
+    }
+    return 0;
+}
+
+void project_close(ProjectReader *reader) {
+    if (reader->file) fclose(reader->file);
+    mem_free(MEM_PROJECT, reader->index, reader->header.num_tiles * sizeof(ProjectTile));
+    mem_free(MEM_PROJECT, reader->scratch, PROJECT_SCRATCH_BYTES);
+    memset(reader, 0, sizeof(ProjectReader));
+}
+
+int project_read_tile(ProjectReader *reader, int tile, unsigned int *dst, int stride) {
+    if (tile < 0 || tile >= (int)reader->header.num_tiles) return -1;
+
+    int tx, ty, tw, th;
+    project_tile_rect(reader->header.width, reader->header.height, reader->tiles_x,
+                      tile, &tx, &ty, &tw, &th);
+    const ProjectTile *entry = &reader->index[tile];
+
+    if (entry->flags == PROJECT_TILE_SOLID) {
+        for (int y = 0; y < th; y++) {
+            unsigned int *row = &dst[y * stride];
+            for (int x = 0; x < tw; x++) row[x] = entry->color;
+        }
+        return 0;
+    }
+
+    uLong raw_size = (uLong)tw * th * sizeof(unsigned int);
+    uLong zmax = compressBound(PROJECT_TILE_BYTES);
+    if (entry->size > zmax) return -1;
+
+    unsigned char *packed = reader->scratch;
+    unsigned char *raw = reader->scratch + zmax;
+    if (fseek(reader->file, entry->offset, SEEK_SET) != 0 ||
+        fread(packed, entry->size, 1, reader->file) != 1) {
+        return -1;
+    }
+
+    if (entry->flags == PROJECT_TILE_ZLIB) {
+        uLongf len = raw_size;
+        if (uncompress(raw, &len, packed, entry->size) != Z_OK || len != raw_size) return -1;
+    } else if (entry->size == raw_size) {
+        raw = packed;
+    } else {
+        return -1;
+    }
+
+    const unsigned int *src = (const unsigned int *)raw;
+    for (int y = 0; y < th; y++) {
+        memcpy(&dst[y * stride], &src[y * tw], tw * sizeof(unsigned int));
+    }
+    return 0;
+}
+
+int project_read_region(ProjectReader *reader, int x, int y, int w, int h,
+                        unsigned int *dst, int stride)
+{
+    // dst è il solo rettangolo richiesto: i tile di bordo vanno ritagliati
+    unsigned int *tile = mem_buffer_get(MEM_PROJECT, PROJECT_TILE_BYTES);
+    if (!tile) return -1;
+
+    int tx0 = x / PROJECT_TILE_SIZE;
+    int ty0 = y / PROJECT_TILE_SIZE;
+    int tx1 = (x + w - 1) / PROJECT_TILE_SIZE;
+    int ty1 = (y + h - 1) / PROJECT_TILE_SIZE;
+    if (tx1 >= reader->tiles_x) tx1 = reader->tiles_x - 1;
+    if (ty1 >= reader->tiles_y) ty1 = reader->tiles_y - 1;
+
+    int ret = 0;
+    for (int ty = ty0; ty <= ty1 && ret == 0; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            if (project_read_tile(reader, ty * reader->tiles_x + tx, tile, PROJECT_TILE_SIZE) != 0) {
+                ret = -1;
+                break;
+            }
+            int sx0 = tx * PROJECT_TILE_SIZE, sy0 = ty * PROJECT_TILE_SIZE;
+            int cx0 = (sx0 > x) ? sx0 : x;
+            int cy0 = (sy0 > y) ? sy0 : y;
+            int cx1 = (sx0 + PROJECT_TILE_SIZE < x + w) ? sx0 + PROJECT_TILE_SIZE : x + w;
+            int cy1 = (sy0 + PROJECT_TILE_SIZE < y + h) ? sy0 + PROJECT_TILE_SIZE : y + h;
+            if (cx1 > (int)reader->header.width)  cx1 = reader->header.width;
+            if (cy1 > (int)reader->header.height) cy1 = reader->header.height;
+            for (int py = cy0; py < cy1; py++) {
+                memcpy(&dst[(py - y) * stride + (cx0 - x)],
+                       &tile[(py - sy0) * PROJECT_TILE_SIZE + (cx0 - sx0)],
+                       (cx1 - cx0) * sizeof(unsigned int));
+            }
+        }
+    }
+
+    mem_buffer_put(MEM_PROJECT, tile, PROJECT_TILE_BYTES);
+    return ret;
+}
+
+int project_read_journal(ProjectReader *reader, Journal *journal) {
+    if (fseek(reader->file, reader->header.journal_offset, SEEK_SET) != 0) return -1;
+    return journal_read_cmds(journal, reader->file, (int)reader->header.journal_count,
+                             reader->header.bg_color, reader->header.seq);
+}
+
+static int project_load_file(Journal *journal, Canvas *canvas, const char *path) {
+    ProjectReader reader;
+    int ret = project_open(&reader, path);
+
+    if (ret == -2) {
+        // File solo-journal delle versioni precedenti
+        if (journal_load(journal, path) != 0) return -2;
+        journal_rasterize(journal, canvas, 1);
+        return 0;
+    }
+    if (ret < 0) return ret;
+
+    if ((int)reader.header.width != canvas->width || (int)reader.header.height != canvas->height) {
+        project_close(&reader);
+        return -2;
+    }
+
+    // Prima i tile a tinta unita (immediati), poi quelli da decomprimere
+    int num_tiles = (int)reader.header.num_tiles;
+    for (int pass = 0; pass < 2 && ret == 0; pass++) {
+        for (int i = 0; i < num_tiles; i++) {
+            int solid = reader.index[i].flags == PROJECT_TILE_SOLID;
+            if (solid != (pass == 0)) continue;
+
+            int tx = (i % reader.tiles_x) * PROJECT_TILE_SIZE;
+            int ty = (i / reader.tiles_x) * PROJECT_TILE_SIZE;
+            if (project_read_tile(&reader, i, &canvas->pixels[ty * canvas->width + tx],
+                                  canvas->width) != 0) {
+                ret = -2;
+                break;
+            }
+        }
+    }
+
+    if (ret == 0 && project_read_journal(&reader, journal) != 0) ret = -2;
+    project_close(&reader);
+
+    // I pixel caricati fanno da primo keyframe: undo senza replay da zero
+    if (ret == 0) journal_keyframe(journal, canvas);
+    return ret;
+}
+
+int project_load(Journal *journal, Canvas *canvas, const char *path) {
+    int ret = project_load_file(journal, canvas, path);
+    if (ret == -1) {
+        // Crash tra remove e rename del checkpoint
+        char tmp_path[300];
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+        ret = project_load_file(journal, canvas, tmp_path);
+    }
+    if (ret == -2) {
+        // Niente stato a metà: via i tile già letti e i comandi
+        canvas_clear(canvas, canvas->bg_color);
+        journal_reset(journal);
+    }
+    return (ret < 0) ? ret : 0;
+}
+
+static void *project_loader_thread(void *arg) {
+    ProjectLoader *loader = (ProjectLoader *)arg;
+    int result = project_load(loader->journal, loader->canvas, loader->path);
+
+    pthread_mutex_lock(&loader->lock);
+    loader->result = result;
+    loader->finished = 1;
+    pthread_mutex_unlock(&loader->lock);
+    return NULL;
+}
+
+int project_load_async(ProjectLoader *loader, const char *path,
+                       Journal *journal, Canvas *canvas)
+{
+    memset(loader, 0, sizeof(ProjectLoader));
+    loader->journal = journal;
+    loader->canvas = canvas;
+    snprintf(loader->path, sizeof(loader->path), "%s", path);
+
+    pthread_mutex_init(&loader->lock, NULL);
+    if (pthread_create(&loader->thread, NULL, project_loader_thread, loader) != 0) {
+        pthread_mutex_destroy(&loader->lock);
+        return -1;
+    }
+    return 0;
+}
+
+int project_loader_done(ProjectLoader *loader) {
+    pthread_mutex_lock(&loader->lock);
+    int done = loader->finished;
+    pthread_mutex_unlock(&loader->lock);
+    return done;
+}
+
+int project_loader_finish(ProjectLoader *loader) {
+    pthread_join(loader->thread, NULL);
+    pthread_mutex_destroy(&loader->lock);
+    return loader->result;
+}
@@ -0,0 +1,94 @@
+#ifndef PROJECT_H
+#define PROJECT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "canvas.h"
+#include "journal.h"
+
+/*
+ * File di progetto a chunk:
+ *
+ *   ProjectHeader
+ *   ProjectTile[num_tiles]     indice: offset, dimensione e flag di ogni tile
+ *   dati dei tile              compressi indipendentemente (zlib)
+ *   JournalCmd[journal_count]  storia per undo/redo
+ *
+ * Ogni tile si legge con una lettura posizionale, senza caricare il resto.
+ */
+
+#define PROJECT_MAGIC     0x50575244u  // "DRWP"
+#define PROJECT_VERSION   1
+#define PROJECT_TILE_SIZE 64
+
+#define PROJECT_TILE_RAW   0
+#define PROJECT_TILE_ZLIB  1
+#define PROJECT_TILE_SOLID 2  // tile di un solo colore: nessun dato
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_size;
+    uint32_t num_tiles;
+    uint32_t bg_color;
+    uint32_t seq;
+    uint32_t journal_offset;
+    uint32_t journal_count;
+} ProjectHeader;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t flags;
+    uint32_t color;   // solo per PROJECT_TILE_SOLID
+} ProjectTile;
+
+typedef struct {
+    FILE *file;
+    ProjectHeader header;
+    ProjectTile *index;
+    int tiles_x;
+    int tiles_y;
+    unsigned char *scratch;  // buffer per i dati compressi di un tile
+} ProjectReader;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    Journal *journal;
+    Canvas *canvas;
+    char path[256];
+    int finished;
+    int result;
+} ProjectLoader;
+
+int  project_save(const char *path, const Journal *journal,
+                  const unsigned int *pixels, int width, int height);
+
+// Legge solo header e indice
+int  project_open(ProjectReader *reader, const char *path);
+void project_close(ProjectReader *reader);
+// Decodifica il tile 'tile' in dst (stride in pixel)
+int  project_read_tile(ProjectReader *reader, int tile, unsigned int *dst, int stride);
+// Decodifica il rettangolo dato in dst (w x h), leggendo solo i tile toccati
+int  project_read_region(ProjectReader *reader, int x, int y, int w, int h,
+                         unsigned int *dst, int stride);
+int  project_read_journal(ProjectReader *reader, Journal *journal);
+
+// Carica tile e storia nel canvas e nel journal. Accetta anche i vecchi
+// file solo-journal (ridisegnati da zero) e, se path manca, path.tmp.
+// Ritorna -1 se il file non c'è, -2 se c'è ma non si legge: in quel caso
+// canvas (bg_color) e journal restano vuoti.
+int  project_load(Journal *journal, Canvas *canvas, const char *path);
+
+// Come project_load ma su un thread: il canvas si riempie tile per tile
+// mentre il thread principale continua a disegnare i frame.
+int  project_load_async(ProjectLoader *loader, const char *path,
+                        Journal *journal, Canvas *canvas);
+int  project_loader_done(ProjectLoader *loader);
+int  project_loader_finish(ProjectLoader *loader);
+
+#endif
@@ -0,0 +1,666 @@
+#include "selection.h"
+#include "membudget.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SEL_SIMD 1
+typedef uint32x4_t sel_vec;
+#define sel_load(p)     vld1q_u32(p)
+#define sel_store(p, v) vst1q_u32(p, v)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SEL_SIMD 1
+typedef __m128i sel_vec;
+#define sel_load(p)     _mm_loadu_si128((const __m128i *)(p))
+#define sel_store(p, v) _mm_storeu_si128((__m128i *)(p), v)
+#endif
+
+// Forma della selezione: i comandi JCMD_SELECT e il rettangolo che li
+// contiene, già alla scala di disegno
+typedef struct {
+    const JournalCmd *cmds;
+    int count;
+    int lasso;
+    int scale;
+    int rx, ry, rw, rh;
+} SelShape;
+
+// Trasformazione inversa in 16.16: dal centro di un pixel di destinazione
+// alla posizione nella sorgente
+typedef struct {
+    int64_t cx, cy;     // centro della forma
+    int64_t tx, ty;     // centro trasformato
+    int32_t du_dx, dv_dx;
+    int32_t du_dy, dv_dy;
+    double cos_a, sin_a, sx, sy;
+} SelMapping;
+
+#define SEL_MASK 0x00FF00FFu
+
+static int64_t sel_floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0))) q--;
+    return q;
+}
+
+static int64_t sel_ceil_div(int64_t a, int64_t b) {
+    return -sel_floor_div(-a, b);
+}
+
+/* ===== FORMA ===== */
+
+static void sel_vertex(const SelShape *shape, int i, int *x, int *y) {
+    const JournalCmd *c = &shape->cmds[i >> 1];
+    int vx = (i & 1) ? c->x1 : c->x0;
+    int vy = (i & 1) ? c->y1 : c->y0;
+    // Centro del pixel, in mezzi pixel della scala di disegno
+    *x = (2 * vx + 1) * shape->scale;
+    *y = (2 * vy + 1) * shape->scale;
+}
+
+static void sel_shape_init(SelShape *shape, const JournalCmd *cmds, int count, int scale) {
+    if (count > SELECTION_MAX_POINTS / 2) count = SELECTION_MAX_POINTS / 2;
+    shape->cmds = cmds;
+    shape->count = count;
+    shape->lasso = (count > 0 && cmds[0].size == SELECT_LASSO);
+    shape->scale = scale;
+
+    int min_x = 0, min_y = 0, max_x = -1, max_y = -1;
+    for (int i = 0; i < count; i++) {
+        const JournalCmd *c = &cmds[i];
+        int lx = (c->x0 < c->x1) ? c->x0 : c->x1;
+        int hx = (c->x0 > c->x1) ? c->x0 : c->x1;
+        int ly = (c->y0 < c->y1) ? c->y0 : c->y1;
+        int hy = (c->y0 > c->y1) ? c->y0 : c->y1;
+        if (i == 0 || lx < min_x) min_x = lx;
+        if (i == 0 || hx > max_x) max_x = hx;
+        if (i == 0 || ly < min_y) min_y = ly;
+        if (i == 0 || hy > max_y) max_y = hy;
+    }
+    shape->rx = min_x * scale;
+    shape->ry = min_y * scale;
+    shape->rw = (max_x - min_x + 1) * scale;
+    shape->rh = (max_y - min_y + 1) * scale;
+}
+
+// Forma di un JCMD_TRANSFORM: i suoi comandi JCMD_SELECT lo precedono
+static void sel_shape_from_cmd(SelShape *shape, const JournalCmd *cmd, int scale) {
+    int count = (cmd->x1 > 0) ? cmd->x1 : 0;
+    sel_shape_init(shape, cmd - count, count, scale);
+}
+
+// Span [x0, x1] della riga gy dentro la forma. Il lazo è pieno con la
+// regola pari-dispari sui centri dei pixel.
+static int sel_mask_spans(const SelShape *shape, int gy, int *spans) {
+    if (gy < shape->ry || gy >= shape->ry + shape->rh) return 0;
+    if (!shape->lasso) {
+        spans[0] = shape->rx;
+        spans[1] = shape->rx + shape->rw - 1;
+        return 1;
+    }
+
+    int64_t yc = 2 * (int64_t)gy + 1;
+    int xs[SELECTION_MAX_POINTS];
+    int n = 0;
+    int nv = shape->count * 2;
+    for (int i = 0; i < nv; i++) {
+        int ax, ay, bx, by;
+        sel_vertex(shape, i, &ax, &ay);
+        sel_vertex(shape, (i + 1) % nv, &bx, &by);
+        if ((ay <= yc) == (by <= yc)) continue;
+        int x = ax + (int)(((yc - ay) * (int64_t)(bx - ax)) / (by - ay));
+        // Inserimento ordinato: le intersezioni per riga sono poche
+        int k = n++;
+        while (k > 0 && xs[k - 1] > x) {
+            xs[k] = xs[k - 1];
+            k--;
+        }
+        xs[k] = x;
+    }
+
+    int count = 0;
+    for (int i = 0; i + 1 < n; i += 2) {
+        int lo = (int)sel_floor_div(xs[i], 2);
+        int hi = (int)sel_floor_div(xs[i + 1], 2) - 1;
+        if (lo > hi) continue;
+        spans[count * 2] = lo;
+        spans[count * 2 + 1] = hi;
+        count++;
+    }
+    return count;
+}
+
+// Pixel più il bordo trasparente attorno
+static size_t sel_buffer_bytes(const SelBuffer *buf) {
+    return (size_t)buf->stride * (buf->h + 2) * sizeof(unsigned int);
+}
+
+// Copia nel buffer i pixel di src dentro la forma. src ha l'origine del
+// disegno in (src_ox, src_oy); fuori da src i pixel restano trasparenti.
+static int sel_lift(SelBuffer *buf, const SelShape *shape, const Canvas *src,
+                    int src_ox, int src_oy)
+{
+    int x0 = shape->rx, y0 = shape->ry;
+    int x1 = shape->rx + shape->rw, y1 = shape->ry + shape->rh;
+    if (x0 < -src_ox) x0 = -src_ox;
+    if (y0 < -src_oy) y0 = -src_oy;
+    if (x1 > src->width - src_ox) x1 = src->width - src_ox;
+    if (y1 > src->height - src_oy) y1 = src->height - src_oy;
+
+    memset(buf, 0, sizeof(SelBuffer));
+    buf->center_x2 = 2 * shape->rx + shape->rw;
+    buf->center_y2 = 2 * shape->ry + shape->rh;
+    if (x0 >= x1 || y0 >= y1) return 0;
+
+    buf->x = x0;
+    buf->y = y0;
+    buf->w = x1 - x0;
+    buf->h = y1 - y0;
+    buf->stride = buf->w + 2;
+    size_t bytes = sel_buffer_bytes(buf);
+    buf->pixels = (unsigned int *)mem_alloc(MEM_SELECTION, bytes);
+    if (!buf->pixels) return -1;
+    memset(buf->pixels, 0, bytes);
+
+    int spans[SELECTION_MAX_POINTS];
+    for (int y = y0; y < y1; y++) {
+        const unsigned int *src_row = &src->pixels[(y + src_oy) * src->width];
+        unsigned int *dst_row = &buf->pixels[(y - y0 + 1) * buf->stride + 1];
+        int n = sel_mask_spans(shape, y, spans);
+        for (int i = 0; i < n; i++) {
+            int a = (spans[i * 2] < x0) ? x0 : spans[i * 2];
+            int b = (spans[i * 2 + 1] >= x1) ? x1 - 1 : spans[i * 2 + 1];
+            for (int x = a; x <= b; x++) {
+                dst_row[x - x0] = src_row[x + src_ox] | 0xFF000000u;
+            }
+        }
+    }
+    return 0;
+}
+
+// Riempie con color i pixel della forma rimasti scoperti
+static void sel_fill_hole(Canvas *dst, int ox, int oy, const SelShape *shape, unsigned int color) {
+    int spans[SELECTION_MAX_POINTS];
+    for (int y = shape->ry; y < shape->ry + shape->rh; y++) {
+        if (y + oy < 0 || y + oy >= dst->height) continue;
+        unsigned int *row = &dst->pixels[(y + oy) * dst->width];
+        int n = sel_mask_spans(shape, y, spans);
+        for (int i = 0; i < n; i++) {
+            int a = spans[i * 2] + ox, b = spans[i * 2 + 1] + ox;
+            if (a < 0) a = 0;
+            if (b >= dst->width) b = dst->width - 1;
+            for (int x = a; x <= b; x++) row[x] = color;
+        }
+    }
+}
+
+/* ===== TRASFORMAZIONE ===== */
+
+static void sel_mapping(SelMapping *m, int center_x2, int center_y2,
+                        const SelTransform *t, int scale)
+{
+    int sx = t->sx, sy = t->sy;
+    if (sx < SELECTION_SCALE_MIN) sx = SELECTION_SCALE_MIN;
+    if (sy < SELECTION_SCALE_MIN) sy = SELECTION_SCALE_MIN;
+    if (sx > SELECTION_SCALE_MAX) sx = SELECTION_SCALE_MAX;
+    if (sy > SELECTION_SCALE_MAX) sy = SELECTION_SCALE_MAX;
+
+    // Seno e coseno arrotondati a 16.16: tutto il resto è intero
+    double a = (double)(t->angle & (SELECTION_ANGLE_TURN - 1)) * 6.283185307179586 /
+               SELECTION_ANGLE_TURN;
+    int32_t fcos = (int32_t)lround(cos(a) * 65536.0);
+    int32_t fsin = (int32_t)lround(sin(a) * 65536.0);
+
+    m->cx = (int64_t)center_x2 * 32768;
+    m->cy = (int64_t)center_y2 * 32768;
+    m->tx = m->cx + ((int64_t)t->dx * scale * 65536);
+    m->ty = m->cy + ((int64_t)t->dy * scale * 65536);
+    m->du_dx = (int32_t)(((int64_t)fcos * 256) / sx);
+    m->du_dy = (int32_t)(((int64_t)fsin * 256) / sx);
+    m->dv_dx = (int32_t)(-((int64_t)fsin * 256) / sy);
+    m->dv_dy = (int32_t)(((int64_t)fcos * 256) / sy);
+
+    m->cos_a = fcos / 65536.0;
+    m->sin_a = fsin / 65536.0;
+    m->sx = sx / (double)SELECTION_SCALE_ONE;
+    m->sy = sy / (double)SELECTION_SCALE_ONE;
+}
+
+// Solo per rettangoli di ingombro, non per i pixel
+static void sel_forward(const SelMapping *m, double px, double py, double *qx, double *qy) {
+    double ex = (px - m->cx / 65536.0) * m->sx;
+    double ey = (py - m->cy / 65536.0) * m->sy;
+    *qx = m->tx / 65536.0 + m->cos_a * ex - m->sin_a * ey;
+    *qy = m->ty / 65536.0 + m->sin_a * ex + m->cos_a * ey;
+}
+
+static void sel_inverse(const SelMapping *m, double qx, double qy, double *px, double *py) {
+    double ex = qx - m->tx / 65536.0;
+    double ey = qy - m->ty / 65536.0;
+    *px = m->cx / 65536.0 + (m->cos_a * ex + m->sin_a * ey) / m->sx;
+    *py = m->cy / 65536.0 + (-m->sin_a * ex + m->cos_a * ey) / m->sy;
+}
+
+// Ingombro dell'immagine del rettangolo (x, y, w, h), con margine
+static void sel_forward_bounds(const SelMapping *m, int x, int y, int w, int h,
+                               int *min_x, int *min_y, int *max_x, int *max_y)
+{
+    double lx = 0, ly = 0, hx = 0, hy = 0;
+    for (int i = 0; i < 4; i++) {
+        double qx, qy;
+        sel_forward(m, x + ((i & 1) ? w : 0), y + ((i & 2) ? h : 0), &qx, &qy);
+        if (i == 0 || qx < lx) lx = qx;
+        if (i == 0 || qx > hx) hx = qx;
+        if (i == 0 || qy < ly) ly = qy;
+        if (i == 0 || qy > hy) hy = qy;
+    }
+    *min_x = (int)floor(lx) - 2;
+    *min_y = (int)floor(ly) - 2;
+    *max_x = (int)ceil(hx) + 2;
+    *max_y = (int)ceil(hy) + 2;
+}
+
+// Restringe [kmin, kmax] ai k con lo <= u0 + du * k <= hi
+static void sel_clip_range(int64_t u0, int64_t du, int64_t lo, int64_t hi,
+                           int64_t *kmin, int64_t *kmax)
+{
+    int64_t a, b;
+    if (du == 0) {
+        if (u0 < lo || u0 > hi) *kmax = *kmin - 1;
+        return;
+    }
+    if (du > 0) {
+        a = sel_ceil_div(lo - u0, du);
+        b = sel_floor_div(hi - u0, du);
+    } else {
+        a = sel_ceil_div(hi - u0, du);
+        b = sel_floor_div(lo - u0, du);
+    }
+    if (a > *kmin) *kmin = a;
+    if (b < *kmax) *kmax = b;
+}
+
+/* ===== KERNEL DI RIGA ===== */
+
+// src premoltiplicato sopra dst
+static inline unsigned int sel_over(unsigned int src, unsigned int dst) {
+    unsigned int a = src >> 24;
+    unsigned int t = 256 - (a + (a >> 7));
+    unsigned int rb = (((dst & SEL_MASK) * t) >> 8) & SEL_MASK;
+    unsigned int ag = ((((dst >> 8) & SEL_MASK) * t) >> 8) & SEL_MASK;
+    return src + (rb | (ag << 8));
+}
+
+#if defined(SEL_SIMD)
+// Stesse operazioni della versione scalare su 4 pixel: i canali viaggiano
+// a coppie in corsie da 16 bit, t ha il peso in entrambe le metà
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static inline sel_vec sel_lerp4(sel_vec a, sel_vec b, sel_vec t) {
+    uint16x8_t mask = vreinterpretq_u16_u32(vdupq_n_u32(SEL_MASK));
+    uint16x8_t a16 = vreinterpretq_u16_u32(a);
+    uint16x8_t b16 = vreinterpretq_u16_u32(b);
+    uint16x8_t t16 = vreinterpretq_u16_u32(t);
+    uint16x8_t it = vsubq_u16(vdupq_n_u16(256), t16);
+    uint16x8_t rb = vmlaq_u16(vmulq_u16(vandq_u16(a16, mask), it), vandq_u16(b16, mask), t16);
+    uint16x8_t ag = vmlaq_u16(vmulq_u16(vshrq_n_u16(a16, 8), it), vshrq_n_u16(b16, 8), t16);
+    return vreinterpretq_u32_u16(vorrq_u16(vshrq_n_u16(rb, 8), vbicq_u16(ag, mask)));
+}
+
+static inline sel_vec sel_over4(sel_vec src, sel_vec dst) {
+    uint16x8_t mask = vreinterpretq_u16_u32(vdupq_n_u32(SEL_MASK));
+    uint32x4_t a = vshrq_n_u32(src, 24);
+    a = vaddq_u32(a, vshrq_n_u32(a, 7));
+    uint16x8_t t = vsubq_u16(vdupq_n_u16(256),
+                             vreinterpretq_u16_u32(vorrq_u32(a, vshlq_n_u32(a, 16))));
+    uint16x8_t d16 = vreinterpretq_u16_u32(dst);
+    uint16x8_t rb = vshrq_n_u16(vmulq_u16(vandq_u16(d16, mask), t), 8);
+    uint16x8_t ag = vbicq_u16(vmulq_u16(vshrq_n_u16(d16, 8), t), mask);
+    return vaddq_u32(src, vreinterpretq_u32_u16(vorrq_u16(rb, ag)));
+}
+#else
+static inline sel_vec sel_lerp4(sel_vec a, sel_vec b, sel_vec t) {
+    const __m128i mask = _mm_set1_epi32(SEL_MASK);
+    __m128i it = _mm_sub_epi16(_mm_set1_epi16(256), t);
+    __m128i rb = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(a, mask), it),
+                               _mm_mullo_epi16(_mm_and_si128(b, mask), t));
+    __m128i ag = _mm_add_epi16(_mm_mullo_epi16(_mm_srli_epi16(a, 8), it),
+                               _mm_mullo_epi16(_mm_srli_epi16(b, 8), t));
+    return _mm_or_si128(_mm_srli_epi16(rb, 8), _mm_andnot_si128(mask, ag));
+}
+
+static inline sel_vec sel_over4(sel_vec src, sel_vec dst) {
+    const __m128i mask = _mm_set1_epi32(SEL_MASK);
+    __m128i a = _mm_srli_epi32(src, 24);
+    a = _mm_add_epi32(a, _mm_srli_epi32(a, 7));
+    __m128i t = _mm_sub_epi16(_mm_set1_epi16(256), _mm_or_si128(a, _mm_slli_epi32(a, 16)));
+    __m128i rb = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(dst, mask), t), 8);
+    __m128i ag = _mm_andnot_si128(mask, _mm_mullo_epi16(_mm_srli_epi16(dst, 8), t));
+    return _mm_add_epi32(src, _mm_or_si128(rb, ag));
+}
+#endif
+#endif
+
+// u, v in 16.16 già riferiti al buffer con bordo (e arrotondati per nearest)
+static void sel_row_nearest(unsigned int *dst, int n, const unsigned int *src, int stride,
+                            int32_t u, int32_t v, int32_t du, int32_t dv)
+{
+    for (int k = 0; k < n; k++) {
+        unsigned int p = src[(v >> 16) * stride + (u >> 16)];
+        if (p) dst[k] = p;  // i pixel sollevati sono opachi, il resto è 0
+        u += du;
+        v += dv;
+    }
+}
+
+void selection_row_bilinear(unsigned int *dst, int n, const unsigned int *src, int stride,
+                            int32_t u, int32_t v, int32_t du, int32_t dv, int simd)
+{
+    int k = 0;
+#if defined(SEL_SIMD)
+    uint32_t p00[4], p01[4], p10[4], p11[4], fu[4], fv[4];
+    for (; simd && k + 4 <= n; k += 4) {
+        for (int i = 0; i < 4; i++) {
+            const unsigned int *p = &src[(v >> 16) * stride + (u >> 16)];
+            p00[i] = p[0];
+            p01[i] = p[1];
+            p10[i] = p[stride];
+            p11[i] = p[stride + 1];
+            uint32_t f = (u >> 8) & 0xFF;
+            fu[i] = f | (f << 16);
+            f = (v >> 8) & 0xFF;
+            fv[i] = f | (f << 16);
+            u += du;
+            v += dv;
+        }
+        sel_vec top = sel_lerp4(sel_load(p00), sel_load(p01), sel_load(fu));
+        sel_vec bottom = sel_lerp4(sel_load(p10), sel_load(p11), sel_load(fu));
+        sel_vec c = sel_lerp4(top, bottom, sel_load(fv));
+        sel_store((uint32_t *)&dst[k], sel_over4(c, sel_load((uint32_t *)&dst[k])));
+    }
+#endif
+    for (; k < n; k++) {
+        const unsigned int *p = &src[(v >> 16) * stride + (u >> 16)];
+        unsigned int fx = (u >> 8) & 0xFF, fy = (v >> 8) & 0xFF;
+        unsigned int top = canvas_lerp(p[0], p[1], fx);
+        unsigned int bottom = canvas_lerp(p[stride], p[stride + 1], fx);
+        dst[k] = sel_over(canvas_lerp(top, bottom, fy), dst[k]);
+        u += du;
+        v += dv;
+    }
+}
+
+void selection_draw(Canvas *dst, int ox, int oy, const SelBuffer *buf,
+                    const SelTransform *t, int scale, SelFilter filter)
+{
+    if (!buf->pixels) return;
+
+    SelMapping m;
+    sel_mapping(&m, buf->center_x2, buf->center_y2, t, scale);
+
+    int x_lo, y_lo, x_hi, y_hi;
+    sel_forward_bounds(&m, buf->x, buf->y, buf->w, buf->h, &x_lo, &y_lo, &x_hi, &y_hi);
+    if (x_lo < -ox) x_lo = -ox;
+    if (y_lo < -oy) y_lo = -oy;
+    if (x_hi >= dst->width - ox) x_hi = dst->width - ox - 1;
+    if (y_hi >= dst->height - oy) y_hi = dst->height - oy - 1;
+    if (x_lo > x_hi) return;
+
+    // Campioni validi: il tap sinistro/alto cade nel buffer con bordo
+    int64_t u_max = ((int64_t)buf->w << 16) - 1;
+    int64_t v_max = ((int64_t)buf->h << 16) - 1;
+    int32_t bias = (filter == SEL_NEAREST) ? 65536 + 32768 : 65536;
+
+    for (int y = y_lo; y <= y_hi; y++) {
+        int64_t ex = ((int64_t)x_lo * 65536) + 32768 - m.tx;
+        int64_t ey = ((int64_t)y * 65536) + 32768 - m.ty;
+        int64_t u0 = m.cx + ((m.du_dx * ex + m.du_dy * ey) >> 16) - ((int64_t)buf->x * 65536) - 32768;
+        int64_t v0 = m.cy + ((m.dv_dx * ex + m.dv_dy * ey) >> 16) - ((int64_t)buf->y * 65536) - 32768;
+
+        int64_t kmin = 0, kmax = x_hi - x_lo;
+        sel_clip_range(u0, m.du_dx, -65536, u_max, &kmin, &kmax);
+        sel_clip_range(v0, m.dv_dx, -65536, v_max, &kmin, &kmax);
+        if (kmin > kmax) continue;
+
+        int32_t u = (int32_t)(u0 + m.du_dx * kmin) + bias;
+        int32_t v = (int32_t)(v0 + m.dv_dx * kmin) + bias;
+        unsigned int *row = &dst->pixels[(y + oy) * dst->width + x_lo + ox + (int)kmin];
+        int n = (int)(kmax - kmin + 1);
+
+        if (filter == SEL_NEAREST) {
+            sel_row_nearest(row, n, buf->pixels, buf->stride, u, v, m.du_dx, m.dv_dx);
+        } else {
+            selection_row_bilinear(row, n, buf->pixels, buf->stride, u, v, m.du_dx, m.dv_dx, 1);
+        }
+    }
+}
+
+/* ===== COMANDI DEL JOURNAL ===== */
+
+static void sel_cmd_transform(const JournalCmd *cmd, SelTransform *t) {
+    t->dx = cmd->x0;
+    t->dy = cmd->y0;
+    t->sx = cmd->size;
+    t->sy = cmd->y1;
+    t->angle = (int)(cmd->seed & 0xFFFF);
+}
+
+void selection_apply_cmd(const JournalCmd *cmd, Canvas *canvas, int scale, int ox, int oy,
+                         const Canvas *src, int src_ox, int src_oy)
+{
+    SelShape shape;
+    sel_shape_from_cmd(&shape, cmd, scale);
+    if (shape.count == 0) return;
+    if (!src) {
+        src = canvas;
+        src_ox = ox;
+        src_oy = oy;
+    }
+
+    // Si solleva prima di bucare: src può essere il canvas stesso
+    SelBuffer buf;
+    if (sel_lift(&buf, &shape, src, src_ox, src_oy) != 0) return;
+    sel_fill_hole(canvas, ox, oy, &shape, cmd->color);
+
+    SelTransform t;
+    sel_cmd_transform(cmd, &t);
+    selection_draw(canvas, ox, oy, &buf, &t, scale, SEL_BILINEAR);
+    mem_free(MEM_SELECTION, buf.pixels, sel_buffer_bytes(&buf));
+}
+
+void selection_cmd_bounds(const JournalCmd *cmd, int scale,
+                          int *min_x, int *min_y, int *max_x, int *max_y)
+{
+    SelShape shape;
+    SelTransform t;
+    SelMapping m;
+    sel_shape_from_cmd(&shape, cmd, scale);
+    sel_cmd_transform(cmd, &t);
+    sel_mapping(&m, 2 * shape.rx + shape.rw, 2 * shape.ry + shape.rh, &t, scale);
+    sel_forward_bounds(&m, shape.rx, shape.ry, shape.rw, shape.rh, min_x, min_y, max_x, max_y);
+
+    if (shape.rx < *min_x) *min_x = shape.rx;
+    if (shape.ry < *min_y) *min_y = shape.ry;
+    if (shape.rx + shape.rw - 1 > *max_x) *max_x = shape.rx + shape.rw - 1;
+    if (shape.ry + shape.rh - 1 > *max_y) *max_y = shape.ry + shape.rh - 1;
+}
+
+int selection_cmd_source_rect(const JournalCmd *cmd, int scale,
+                              int x, int y, int w, int h,
+                              int *sx, int *sy, int *sw, int *sh)
+{
+    SelShape shape;
+    SelTransform t;
+    SelMapping m;
+    sel_shape_from_cmd(&shape, cmd, scale);
+    sel_cmd_transform(cmd, &t);
+    sel_mapping(&m, 2 * shape.rx + shape.rw, 2 * shape.ry + shape.rh, &t, scale);
+
+    double lx = 0, ly = 0, hx = 0, hy = 0;
+    for (int i = 0; i < 4; i++) {
+        double px, py;
+        sel_inverse(&m, x + ((i & 1) ? w : 0), y + ((i & 2) ? h : 0), &px, &py);
+        if (i == 0 || px < lx) lx = px;
+        if (i == 0 || px > hx) hx = px;
+        if (i == 0 || py < ly) ly = py;
+        if (i == 0 || py > hy) hy = py;
+    }
+    // Margine per i tap del bilineare e per l'arrotondamento
+    int x0 = (int)floor(lx) - 3, y0 = (int)floor(ly) - 3;
+    int x1 = (int)ceil(hx) + 3, y1 = (int)ceil(hy) + 3;
+    if (x0 < shape.rx) x0 = shape.rx;
+    if (y0 < shape.ry) y0 = shape.ry;
+    if (x1 > shape.rx + shape.rw) x1 = shape.rx + shape.rw;
+    if (y1 > shape.ry + shape.rh) y1 = shape.ry + shape.rh;
+    if (x0 >= x1 || y0 >= y1) return 0;
+
+    *sx = x0;
+    *sy = y0;
+    *sw = x1 - x0;
+    *sh = y1 - y0;
+    return 1;
+}
+
+/* ===== SELEZIONE INTERATTIVA ===== */
+
+void selection_init(Selection *sel) {
+    memset(sel, 0, sizeof(Selection));
+    sel->state = SEL_NONE;
+}
+
+void selection_cancel(Selection *sel) {
+    mem_free(MEM_SELECTION, sel->buffer.pixels, sel_buffer_bytes(&sel->buffer));
+    selection_init(sel);
+}
+
+static void sel_identity(SelTransform *t) {
+    t->dx = 0;
+    t->dy = 0;
+    t->sx = SELECTION_SCALE_ONE;
+    t->sy = SELECTION_SCALE_ONE;
+    t->angle = 0;
+}
+
+void selection_begin(Selection *sel, int lasso, int x, int y) {
+    selection_cancel(sel);
+    sel->state = SEL_DEFINING;
+    sel->lasso = lasso;
+
+    JournalCmd *c = &sel->cmds[0];
+    memset(c, 0, sizeof(JournalCmd));
+    c->type = JCMD_SELECT;
+    c->size = lasso ? SELECT_LASSO : SELECT_RECT;
+    c->x0 = c->x1 = (int16_t)x;
+    c->y0 = c->y1 = (int16_t)y;
+    sel->num_cmds = 1;
+    sel->num_points = 1;
+}
+
+void selection_add_point(Selection *sel, int x, int y) {
+    if (sel->state != SEL_DEFINING) return;
+    if (!sel->lasso) {
+        sel->cmds[0].x1 = (int16_t)x;
+        sel->cmds[0].y1 = (int16_t)y;
+        return;
+    }
+    if (sel->num_points >= SELECTION_MAX_POINTS) return;
+
+    // Vertici radi: il lazo segue il dito senza esplodere di punti
+    const JournalCmd *last = &sel->cmds[(sel->num_points - 1) >> 1];
+    int lx = ((sel->num_points - 1) & 1) ? last->x1 : last->x0;
+    int ly = ((sel->num_points - 1) & 1) ? last->y1 : last->y0;
+    if (abs(x - lx) < SELECTION_LASSO_STEP && abs(y - ly) < SELECTION_LASSO_STEP) return;
+
+    int i = sel->num_points++;
+    JournalCmd *c = &sel->cmds[i >> 1];
+    if (i & 1) {
+        c->x1 = (int16_t)x;
+        c->y1 = (int16_t)y;
+    } else {
+        // Nuovo comando: il secondo vertice ripete il primo finché non arriva
+        *c = sel->cmds[0];
+        c->x0 = c->x1 = (int16_t)x;
+        c->y0 = c->y1 = (int16_t)y;
+        sel->num_cmds++;
+    }
+}
+
+int selection_lift(Selection *sel, const Canvas *canvas) {
+    if (sel->state != SEL_DEFINING) return -1;
+    if (sel->lasso && sel->num_points < 3) return -1;
+
+    SelShape shape;
+    sel_shape_init(&shape, sel->cmds, sel->num_cmds, 1);
+    if (sel_lift(&sel->buffer, &shape, canvas, 0, 0) != 0 || !sel->buffer.pixels) return -1;
+
+    sel_identity(&sel->transform);
+    sel->state = SEL_FLOATING;
+    return 0;
+}
+
+int selection_hit(const Selection *sel, int x, int y) {
+    if (sel->state != SEL_FLOATING) return 0;
+    SelMapping m;
+    double px, py;
+    sel_mapping(&m, sel->buffer.center_x2, sel->buffer.center_y2, &sel->transform, 1);
+    sel_inverse(&m, x + 0.5, y + 0.5, &px, &py);
+    return px >= sel->buffer.x && px < sel->buffer.x + sel->buffer.w &&
+           py >= sel->buffer.y && py < sel->buffer.y + sel->buffer.h;
+}
+
+void selection_corners(const Selection *sel, int xs[4], int ys[4]) {
+    SelMapping m;
+    const SelBuffer *b = &sel->buffer;
+    sel_mapping(&m, b->center_x2, b->center_y2, &sel->transform, 1);
+    // In senso orario, per disegnare il contorno
+    static const int cx[4] = { 0, 1, 1, 0 }, cy[4] = { 0, 0, 1, 1 };
+    for (int i = 0; i < 4; i++) {
+        double qx, qy;
+        sel_forward(&m, b->x + cx[i] * b->w, b->y + cy[i] * b->h, &qx, &qy);
+        xs[i] = (int)lround(qx);
+        ys[i] = (int)lround(qy);
+    }
+}
+
+void selection_render_preview(const Selection *sel, Canvas *view, unsigned int hole_color) {
+    if (sel->state != SEL_FLOATING) return;
+    SelShape shape;
+    sel_shape_init(&shape, sel->cmds, sel->num_cmds, 1);
+    sel_fill_hole(view, 0, 0, &shape, hole_color);
+    selection_draw(view, 0, 0, &sel->buffer, &sel->transform, 1, SEL_NEAREST);
+}
+
+int selection_commit(Selection *sel, Journal *journal, Canvas *canvas) {
+    if (sel->state != SEL_FLOATING) return 0;
+
+    const SelTransform *t = &sel->transform;
+    int moved = t->dx || t->dy || t->sx != SELECTION_SCALE_ONE ||
+                t->sy != SELECTION_SCALE_ONE || (t->angle & (SELECTION_ANGLE_TURN - 1));
+    if (moved) {
+        JournalCmd *c = &sel->cmds[sel->num_cmds];
+        memset(c, 0, sizeof(JournalCmd));
+        c->type = JCMD_TRANSFORM;
+        c->x0 = (int16_t)t->dx;
+        c->y0 = (int16_t)t->dy;
+        c->x1 = (int16_t)sel->num_cmds;
+        c->y1 = (int16_t)t->sy;
+        c->size = (uint16_t)t->sx;
+        c->seed = (uint32_t)(t->angle & (SELECTION_ANGLE_TURN - 1));
+        c->color = canvas->bg_color;
+
+        // Se il journal non cresce ci si ferma alla prima selezione persa: il
+        // TRANSFORM con x1 = num_cmds leggerebbe comandi di un'altra forma
+        journal_begin_op(journal, canvas);
+        for (int i = 0; i <= sel->num_cmds; i++) {
+            if (journal_exec(journal, canvas, &sel->cmds[i]) < 0) {
+                moved = -1;
+                break;
+            }
+        }
+    }
+    selection_cancel(sel);
+    return moved;
+}
@@ -0,0 +1,109 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include "canvas.h"
+#include "journal.h"
+
+// Vertici del lazo (due per comando JCMD_SELECT)
+#define SELECTION_MAX_POINTS  512
+// Distanza minima fra due vertici del lazo durante il trascinamento
+#define SELECTION_LASSO_STEP  4
+// Scala in 8.8: 256 = 1x
+#define SELECTION_SCALE_ONE   256
+#define SELECTION_SCALE_MIN   32
+#define SELECTION_SCALE_MAX   2048
+// Angolo binario: SELECTION_ANGLE_TURN = giro completo
+#define SELECTION_ANGLE_TURN  65536
+
+// JCMD_SELECT: size indica la forma
+#define SELECT_RECT   0   // rettangolo (x0, y0) - (x1, y1), estremi inclusi
+#define SELECT_LASSO  1   // due vertici del poligono: (x0, y0), (x1, y1)
+
+typedef enum {
+    SEL_NEAREST,    // anteprima durante il trascinamento
+    SEL_BILINEAR    // applicazione finale
+} SelFilter;
+
+typedef enum {
+    SEL_NONE,
+    SEL_DEFINING,   // si sta tracciando rettangolo o lazo
+    SEL_FLOATING    // pixel sollevati, in trasformazione
+} SelState;
+
+typedef struct {
+    int dx, dy;     // traslazione del centro, in pixel del canvas
+    int sx, sy;     // scala 8.8
+    int angle;      // angolo binario
+} SelTransform;
+
+// Pixel sollevati (premoltiplicati: 0 fuori dalla selezione) con un bordo
+// trasparente di un pixel, così il bilineare non controlla i limiti.
+typedef struct {
+    unsigned int *pixels;
+    int stride;         // w + 2
+    int x, y, w, h;     // area coperta, in coordinate (scalate) del disegno
+    int center_x2;      // centro della forma (in mezzi pixel): perno della
+    int center_y2;      // trasformazione anche se l'area è ritagliata
+} SelBuffer;
+
+typedef struct {
+    SelState state;
+    int lasso;
+
+    // Forma come comandi JCMD_SELECT, seguiti dal JCMD_TRANSFORM finale:
+    // così l'applicazione legge sempre la forma subito prima di sé
+    JournalCmd cmds[SELECTION_MAX_POINTS / 2 + 1];
+    int num_cmds;
+    int num_points;
+
+    SelBuffer buffer;
+    SelTransform transform;
+} Selection;
+
+void selection_init(Selection *sel);
+void selection_cancel(Selection *sel);
+
+// Tracciamento: rettangolo dal primo punto, o lazo per punti successivi
+void selection_begin(Selection *sel, int lasso, int x, int y);
+void selection_add_point(Selection *sel, int x, int y);
+// Solleva i pixel del canvas nel buffer flottante. -1 se la forma è vuota.
+int  selection_lift(Selection *sel, const Canvas *canvas);
+// Il punto (x, y) cade sulla selezione trasformata?
+int  selection_hit(const Selection *sel, int x, int y);
+// Anteprima sulla superficie di visualizzazione: buco riempito con
+// hole_color e pixel trasformati in nearest. Il canvas non viene toccato.
+void selection_render_preview(const Selection *sel, Canvas *view, unsigned int hole_color);
+// Registra forma e trasformazione nel journal (applicate in bilineare).
+// Ritorna 1 se la selezione è stata spostata, 0 se no, -1 se il journal non
+// ha potuto registrarla (lo spostamento è perso, il canvas resta com'era)
+int  selection_commit(Selection *sel, Journal *journal, Canvas *canvas);
+
+// Vertici trasformati del rettangolo della selezione, per il contorno
+void selection_corners(const Selection *sel, int xs[4], int ys[4]);
+
+// Disegna buf trasformato su dst; le coordinate del disegno a scala scale
+// corrispondono a quelle di dst traslate di (ox, oy).
+void selection_draw(Canvas *dst, int ox, int oy, const SelBuffer *buf,
+                    const SelTransform *t, int scale, SelFilter filter);
+
+// Riga del bilineare: pixel premoltiplicati di src sopra dst, u e v in 16.16
+// con i tap già dentro il buffer. simd = 0 forza la versione scalare (stessi
+// risultati: drawrastercheck confronta le due).
+void selection_row_bilinear(unsigned int *dst, int n, const unsigned int *src, int stride,
+                            int32_t u, int32_t v, int32_t du, int32_t dv, int simd);
+
+// Applica un JCMD_TRANSFORM: i suoi x1 comandi JCMD_SELECT lo precedono in
+// memoria. I pixel si leggono da src (NULL = canvas stesso) con offset
+// (src_ox, src_oy), il risultato va su canvas con offset (ox, oy).
+void selection_apply_cmd(const JournalCmd *cmd, Canvas *canvas, int scale, int ox, int oy,
+                         const Canvas *src, int src_ox, int src_oy);
+// Rettangolo toccato (buco e destinazione) alla scala data
+void selection_cmd_bounds(const JournalCmd *cmd, int scale,
+                          int *min_x, int *min_y, int *max_x, int *max_y);
+// Area di origine da cui dipendono i pixel del rettangolo (x, y, w, h) di
+// destinazione; ritorna 0 se vuota
+int  selection_cmd_source_rect(const JournalCmd *cmd, int scale,
+                               int x, int y, int w, int h,
+                               int *sx, int *sy, int *sw, int *sh);
+
+#endif
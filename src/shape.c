@@ -0,0 +1,631 @@
+#include "shape.h"
+#include "membudget.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define SHAPE_PI            3.14159265358979
+// Distanza massima delle corde dagli archi, in pixel
+#define SHAPE_FLATNESS      0.125
+#define SHAPE_MIN_SEGMENTS  8
+#define SHAPE_MAX_SEGMENTS  1024
+#define SHAPE_INITIAL_EDGES 64
+
+// Lato del tracciato, già tagliato alle righe del canvas
+typedef struct {
+    int y0, y1;     // sotto-righe [y0, y1), assolute
+    int64_t x;      // x in 16.16 alla sotto-riga corrente
+    int64_t dx;     // passo per sotto-riga
+    int dir;        // +1 scende, -1 sale (regola non-zero)
+} ShapeEdge;
+
+typedef struct {
+    Canvas *canvas;
+    int samples;    // sotto-righe per pixel: 1, o SHAPE_AA_SAMPLES
+    // Origine intera dei contorni: la geometria in float è relativa, così
+    // lo stesso comando dà gli stessi pixel su bande e tile traslati
+    int ox, oy;
+
+    ShapeEdge *edges;
+    int count, capacity;
+
+    // Contorno in costruzione, coppie (x, y) relative all'origine
+    double *pts;
+    int num_pts, pts_capacity;
+    int failed;
+} ShapeRaster;
+
+static void shape_raster_init(ShapeRaster *r, Canvas *canvas, int flags, int ox, int oy) {
+    memset(r, 0, sizeof(ShapeRaster));
+    r->canvas = canvas;
+    r->samples = (flags & SHAPE_FLAG_AA) ? SHAPE_AA_SAMPLES : 1;
+    r->ox = ox;
+    r->oy = oy;
+}
+
+static void shape_raster_free(ShapeRaster *r) {
+    mem_scratch_free(r->edges);
+    mem_scratch_free(r->pts);
+}
+
+static void shape_point(ShapeRaster *r, double x, double y) {
+    if (r->num_pts >= r->pts_capacity) {
+        int cap = r->pts_capacity ? r->pts_capacity * 2 : SHAPE_INITIAL_EDGES;
+        double *p = (double *)mem_scratch_realloc(r->pts, cap * 2 * sizeof(double));
+        if (!p) {
+            r->failed = 1;
+            return;
+        }
+        r->pts = p;
+        r->pts_capacity = cap;
+    }
+    r->pts[2 * r->num_pts] = x;
+    r->pts[2 * r->num_pts + 1] = y;
+    r->num_pts++;
+}
+
+static void shape_edge(ShapeRaster *r, double ax, double ay, double bx, double by) {
+    int dir = 1;
+    if (ay == by) return;
+    if (ay > by) {
+        double t = ax; ax = bx; bx = t;
+        t = ay; ay = by; by = t;
+        dir = -1;
+    }
+    // Sotto-righe con il centro in [ay, by)
+    double sy0 = ay * r->samples, sy1 = by * r->samples;
+    int s0 = (int)ceil(sy0 - 0.5), s1 = (int)ceil(sy1 - 0.5);
+    if (s0 >= s1) return;
+
+    int base = r->oy * r->samples;
+    int height = r->canvas->height * r->samples;
+    if (base + s1 <= 0 || base + s0 >= height) return;
+
+    double slope = (bx - ax) / (sy1 - sy0);
+    int64_t dx = (int64_t)llround(slope * 65536.0);
+    int64_t x = ((int64_t)r->ox << 16) +
+                (int64_t)llround((ax + ((s0 + 0.5) - sy0) * slope) * 65536.0);
+    // Le righe sopra il canvas si saltano con lo stesso passo intero:
+    // la x di ogni riga non dipende da dove inizia il canvas
+    if (base + s0 < 0) {
+        x += (int64_t)(-base - s0) * dx;
+        s0 = -base;
+    }
+    if (base + s1 > height) s1 = height - base;
+
+    if (r->count >= r->capacity) {
+        int cap = r->capacity ? r->capacity * 2 : SHAPE_INITIAL_EDGES;
+        ShapeEdge *p = (ShapeEdge *)mem_scratch_realloc(r->edges, cap * sizeof(ShapeEdge));
+        if (!p) {
+            r->failed = 1;
+            return;
+        }
+        r->edges = p;
+        r->capacity = cap;
+    }
+    ShapeEdge *e = &r->edges[r->count++];
+    e->y0 = base + s0;
+    e->y1 = base + s1;
+    e->x = x;
+    e->dx = dx;
+    e->dir = dir;
+}
+
+// Chiude il contorno in costruzione e ne aggiunge i lati. I contorni pieni
+// girano tutti nello stesso verso, i buchi al contrario: con la regola
+// non-zero le parti piene si uniscono e i buchi le sottraggono.
+static void shape_close(ShapeRaster *r, int hole) {
+    int n = r->num_pts;
+    const double *p = r->pts;
+    double area = 0;
+    for (int i = 0; i < n; i++) {
+        int j = (i + 1 == n) ? 0 : i + 1;
+        area += p[2 * i] * p[2 * j + 1] - p[2 * j] * p[2 * i + 1];
+    }
+    int reverse = hole ? (area > 0) : (area < 0);
+    for (int i = 0; i < n; i++) {
+        int j = (i + 1 == n) ? 0 : i + 1;
+        if (reverse) {
+            shape_edge(r, p[2 * j], p[2 * j + 1], p[2 * i], p[2 * i + 1]);
+        } else {
+            shape_edge(r, p[2 * i], p[2 * i + 1], p[2 * j], p[2 * j + 1]);
+        }
+    }
+    r->num_pts = 0;
+}
+
+// Segmenti per un giro completo di raggio radius entro SHAPE_FLATNESS
+static int shape_segments(double radius) {
+    int n = SHAPE_MIN_SEGMENTS;
+    if (radius > SHAPE_FLATNESS) {
+        double step = 2.0 * acos(1.0 - SHAPE_FLATNESS / radius);
+        n = (int)ceil(2.0 * SHAPE_PI / step);
+    }
+    n = (n + 3) & ~3;   // multiplo di 4: gli archi degli angoli sono interi
+    if (n < SHAPE_MIN_SEGMENTS) n = SHAPE_MIN_SEGMENTS;
+    if (n > SHAPE_MAX_SEGMENTS) n = SHAPE_MAX_SEGMENTS;
+    return n;
+}
+
+// Arco da a0 ad a1 (radianti) in segs segmenti, estremi inclusi
+static void shape_arc(ShapeRaster *r, double cx, double cy, double rx, double ry,
+                      double a0, double a1, int segs)
+{
+    for (int i = 0; i <= segs; i++) {
+        double a = a0 + (a1 - a0) * i / segs;
+        shape_point(r, cx + rx * cos(a), cy + ry * sin(a));
+    }
+}
+
+static void shape_ellipse_contour(ShapeRaster *r, double cx, double cy, double rx, double ry,
+                                  int hole)
+{
+    if (rx <= 0 || ry <= 0) return;
+    int n = shape_segments(rx > ry ? rx : ry);
+    shape_arc(r, cx, cy, rx, ry, 0.0, 2.0 * SHAPE_PI * (n - 1) / n, n - 1);
+    shape_close(r, hole);
+}
+
+// Metà larghezza della riga dy dell'ellisse piena: il dx più grande con
+// dx² ry² + dy² rx² <= rx² ry² (dx² + dy² <= r² per il cerchio)
+static int shape_ellipse_half_width(int rx, int ry, int dy) {
+    if (ry == 0) return rx;
+    int64_t num = (int64_t)rx * rx * ((int64_t)ry * ry - (int64_t)dy * dy);
+    int64_t den = (int64_t)ry * ry;
+    int w = (int)sqrt((double)num / (double)den);
+    while (w > 0 && (int64_t)w * w * den > num) w--;
+    while ((int64_t)(w + 1) * (w + 1) * den <= num) w++;
+    return w;
+}
+
+// Contorno a scala dei pixel dell'ellisse piena di semiassi interi: con un
+// campione per pixel riempie proprio quei pixel, come canvas_draw_filled_circle
+// e la maschera dei gradienti a cerchio
+static void shape_ellipse_mask_contour(ShapeRaster *r, int rx, int ry) {
+    for (int dy = -ry; dy <= ry; dy++) {
+        int w = shape_ellipse_half_width(rx, ry, dy);
+        shape_point(r, w + 1, dy);
+        shape_point(r, w + 1, dy + 1);
+    }
+    for (int dy = ry; dy >= -ry; dy--) {
+        int w = shape_ellipse_half_width(rx, ry, dy);
+        shape_point(r, -w, dy + 1);
+        shape_point(r, -w, dy);
+    }
+    shape_close(r, 0);
+}
+
+// Rettangolo [l, rt] x [t, b] con angoli di raggio c
+static void shape_rect_contour(ShapeRaster *r, double l, double t, double rt, double b,
+                               double c, int hole)
+{
+    if (rt <= l || b <= t) return;
+    double max_c = ((rt - l) < (b - t) ? (rt - l) : (b - t)) / 2;
+    if (c > max_c) c = max_c;
+    if (c <= 0) {
+        shape_point(r, l, t);
+        shape_point(r, rt, t);
+        shape_point(r, rt, b);
+        shape_point(r, l, b);
+    } else {
+        int q = shape_segments(c) / 4;
+        shape_arc(r, l + c, t + c, c, c, SHAPE_PI, 1.5 * SHAPE_PI, q);
+        shape_arc(r, rt - c, t + c, c, c, 1.5 * SHAPE_PI, 2.0 * SHAPE_PI, q);
+        shape_arc(r, rt - c, b - c, c, c, 0.0, 0.5 * SHAPE_PI, q);
+        shape_arc(r, l + c, b - c, c, c, 0.5 * SHAPE_PI, SHAPE_PI, q);
+    }
+    shape_close(r, hole);
+}
+
+static int shape_cmp_edge(const void *a, const void *b) {
+    int ya = ((const ShapeEdge *)a)->y0, yb = ((const ShapeEdge *)b)->y0;
+    return (ya > yb) - (ya < yb);
+}
+
+// Copertura della riga di pixel in costruzione (antialiasing): cover[] è la
+// differenza delle sotto-righe piene, area[] la parte dei pixel di bordo,
+// entrambi in 1/256 di pixel per sotto-riga. spans[] tiene gli intervalli
+// toccati: l'interno vuoto di un contorno non si percorre.
+typedef struct {
+    int32_t *cover;
+    int32_t *area;
+    int *spans;
+    int num_spans;
+} ShapeCoverage;
+
+static void shape_cover_span(ShapeCoverage *cov, int width, int64_t xa, int64_t xb) {
+    int64_t lim = (int64_t)width << 16;
+    if (xa < 0) xa = 0;
+    if (xb > lim) xb = lim;
+    if (xa >= xb) return;
+    int ia = (int)(xa >> 16), ib = (int)(xb >> 16);
+    int fa = (int)((xa >> 8) & 255), fb = (int)((xb >> 8) & 255);
+    if (ia == ib) {
+        cov->area[ia] += fb - fa;
+    } else {
+        cov->area[ia] += 256 - fa;
+        cov->cover[ia + 1] += 256;
+        cov->cover[ib] -= 256;
+        cov->area[ib] += fb;
+    }
+    cov->spans[2 * cov->num_spans] = ia;
+    cov->spans[2 * cov->num_spans + 1] = ib;
+    cov->num_spans++;
+}
+
+static int shape_cmp_span(const void *a, const void *b) {
+    int xa = *(const int *)a, xb = *(const int *)b;
+    return (xa > xb) - (xa < xb);
+}
+
+// Scrive la riga y dalla copertura accumulata e la azzera
+static void shape_cover_flush(ShapeCoverage *cov, Canvas *canvas, int y, int samples,
+                              unsigned int color)
+{
+    if (cov->num_spans == 0) return;
+    unsigned int *row = canvas->pixels + y * canvas->width;
+    int full = 256 * samples;
+    qsort(cov->spans, cov->num_spans, 2 * sizeof(int), shape_cmp_span);
+
+    // Intervalli fusi: dentro ognuno i contributi a cover[] si annullano
+    int i = 0;
+    while (i < cov->num_spans) {
+        int lo = cov->spans[2 * i], hi = cov->spans[2 * i + 1];
+        for (i++; i < cov->num_spans && cov->spans[2 * i] <= hi; i++) {
+            if (cov->spans[2 * i + 1] > hi) hi = cov->spans[2 * i + 1];
+        }
+        int32_t run = 0;
+        for (int x = lo; x <= hi; x++) {
+            run += cov->cover[x];
+            int c = run + cov->area[x];
+            cov->cover[x] = 0;
+            cov->area[x] = 0;
+            if (c <= 0 || x >= canvas->width) continue;
+            if (c >= full) {
+                row[x] = color;
+            } else {
+                row[x] = canvas_lerp(row[x], color, c / samples);
+            }
+        }
+    }
+    cov->num_spans = 0;
+}
+
+// Scanline con tabella dei lati attivi: per ogni sotto-riga i lati che la
+// attraversano, ordinati per x, danno gli span dove il winding è non nullo
+static int shape_fill(ShapeRaster *r, unsigned int color) {
+    Canvas *canvas = r->canvas;
+    int samples = r->samples;
+    if (r->failed) return -1;
+    if (r->count == 0) return 0;
+
+    qsort(r->edges, r->count, sizeof(ShapeEdge), shape_cmp_edge);
+    int *active = (int *)mem_scratch_alloc(r->count * sizeof(int));
+    if (!active) return -1;
+
+    ShapeCoverage cov;
+    memset(&cov, 0, sizeof(cov));
+    if (samples > 1) {
+        // Per sotto-riga al più un intervallo ogni due lati
+        cov.cover = (int32_t *)mem_scratch_calloc((canvas->width + 2) * sizeof(int32_t));
+        cov.area = (int32_t *)mem_scratch_calloc((canvas->width + 2) * sizeof(int32_t));
+        cov.spans = (int *)mem_scratch_alloc((r->count / 2 + 1) * samples * 2 * sizeof(int));
+        if (!cov.cover || !cov.area || !cov.spans) {
+            mem_scratch_free(cov.cover);
+            mem_scratch_free(cov.area);
+            mem_scratch_free(cov.spans);
+            mem_scratch_free(active);
+            return -1;
+        }
+    }
+
+    int next = 0, num_active = 0;
+    int row_y = -1;
+    int s = r->edges[0].y0;
+    while (next < r->count || num_active > 0) {
+        // Salta le righe vuote fra un contorno e l'altro
+        if (num_active == 0 && r->edges[next].y0 > s) s = r->edges[next].y0;
+
+        if (samples > 1 && s / samples != row_y) {
+            if (row_y >= 0) shape_cover_flush(&cov, canvas, row_y, samples, color);
+            row_y = s / samples;
+        }
+
+        // Entrano i lati che iniziano qui, escono quelli finiti
+        while (next < r->count && r->edges[next].y0 <= s) active[num_active++] = next++;
+        int n = 0;
+        for (int i = 0; i < num_active; i++) {
+            if (r->edges[active[i]].y1 > s) active[n++] = active[i];
+        }
+        num_active = n;
+
+        // Ordine per x: da una riga all'altra cambia di poco
+        for (int i = 1; i < num_active; i++) {
+            int id = active[i];
+            int64_t x = r->edges[id].x;
+            int j = i - 1;
+            while (j >= 0 && r->edges[active[j]].x > x) {
+                active[j + 1] = active[j];
+                j--;
+            }
+            active[j + 1] = id;
+        }
+
+        int winding = 0;
+        int64_t xa = 0;
+        unsigned int *row = canvas->pixels + (s / samples) * canvas->width;
+        for (int i = 0; i < num_active; i++) {
+            const ShapeEdge *e = &r->edges[active[i]];
+            int was = winding;
+            winding += e->dir;
+            if (was == 0 && winding != 0) {
+                xa = e->x;
+            } else if (was != 0 && winding == 0) {
+                if (samples > 1) {
+                    shape_cover_span(&cov, canvas->width, xa, e->x);
+                } else {
+                    // Pixel con il centro in [xa, xb)
+                    int64_t lo = (xa + 0x7FFF) >> 16, hi = (e->x + 0x7FFF) >> 16;
+                    if (lo < 0) lo = 0;
+                    if (hi > canvas->width) hi = canvas->width;
+                    for (int64_t x = lo; x < hi; x++) row[x] = color;
+                }
+            }
+        }
+
+        for (int i = 0; i < num_active; i++) r->edges[active[i]].x += r->edges[active[i]].dx;
+        s++;
+    }
+    if (samples > 1 && row_y >= 0) shape_cover_flush(&cov, canvas, row_y, samples, color);
+
+    mem_scratch_free(cov.cover);
+    mem_scratch_free(cov.area);
+    mem_scratch_free(cov.spans);
+    mem_scratch_free(active);
+    return 0;
+}
+
+// Pixel [x0, x1] della riga y, tagliati al canvas
+static void shape_span(Canvas *canvas, int64_t y, int64_t x0, int64_t x1, unsigned int color) {
+    if (x0 < 0) x0 = 0;
+    if (x1 >= canvas->width) x1 = canvas->width - 1;
+    unsigned int *p = canvas->pixels + y * canvas->width + x0;
+    for (int64_t n = x1 - x0; n >= 0; n--) *p++ = color;
+}
+
+// Rettangolo senza angoli né AA direttamente a span, solo sulle righe nel
+// canvas: pieno o contorno di un pixel, con gli stessi pixel della scanline
+// (canvas_draw_filled_rect e canvas_draw_rect)
+static void shape_rect_spans(Canvas *canvas, int x0, int y0, int x1, int y1, int outline,
+                             unsigned int color)
+{
+    int64_t l = (x0 < x1) ? x0 : x1, r = (x0 < x1) ? x1 : x0;
+    int64_t t = (y0 < y1) ? y0 : y1, b = (y0 < y1) ? y1 : y0;
+    if (r < 0 || l >= canvas->width) return;
+    int64_t ya = (t > 0) ? t : 0, yb = (b < canvas->height) ? b : canvas->height - 1;
+    for (int64_t y = ya; y <= yb; y++) {
+        if (!outline || y == t || y == b) {
+            shape_span(canvas, y, l, r, color);
+        } else {
+            shape_span(canvas, y, l, l, color);
+            shape_span(canvas, y, r, r, color);
+        }
+    }
+}
+
+// Semilarghezze di righe successive dell'ellisse piena: tra righe vicine
+// cambiano di poco, si parte dalla precedente tenendo a somme
+// num = rx² (ry² - dy²), sq = w² ry² e i loro passi, senza sqrt né prodotti
+typedef struct {
+    int dy, w, ry;
+    int64_t den, rx2, num, num_step, sq, sq_step;
+} ShapeEllipseWalk;
+
+static void shape_ellipse_walk_init(ShapeEllipseWalk *e, int rx, int ry, int dy) {
+    e->dy = dy;
+    e->ry = ry;
+    e->w = shape_ellipse_half_width(rx, ry, dy);
+    e->den = (int64_t)ry * ry;
+    e->rx2 = (int64_t)rx * rx;
+    e->num = e->rx2 * (e->den - (int64_t)dy * dy);
+    e->num_step = e->rx2 * (2 * (int64_t)dy + 1);
+    e->sq = (int64_t)e->w * e->w * e->den;
+    e->sq_step = (2 * (int64_t)e->w + 1) * e->den;
+}
+
+// Passa alla riga dy + 1 (dy >= 0) e ne ritorna la semilarghezza, -1 oltre ry
+static int shape_ellipse_walk_next(ShapeEllipseWalk *e) {
+    if (e->dy++ >= e->ry) return -1;
+    e->num -= e->num_step;
+    e->num_step += 2 * e->rx2;
+    while (e->w > 0 && e->sq > e->num) {
+        e->w--;
+        e->sq_step -= 2 * e->den;
+        e->sq -= e->sq_step;
+    }
+    while (e->sq + e->sq_step <= e->num) {
+        e->sq += e->sq_step;
+        e->sq_step += 2 * e->den;
+        e->w++;
+    }
+    return e->w;
+}
+
+// Pixel della riga fuori dall'anello di un pixel: quelli entro la semilarghezza
+// w con tutti i vicini (sopra, sotto, di lato) nella maschera
+static int shape_ring_inner(int w, int w_up, int w_down) {
+    int inner = w - 1;
+    if (w_up < inner) inner = w_up;
+    if (w_down < inner) inner = w_down;
+    return inner;
+}
+
+// Riga y di un'ellisse senza AA: piena fino a w, o senza i pixel entro inner
+static void shape_ellipse_row(Canvas *canvas, int64_t y, int64_t cx, int w, int inner,
+                              unsigned int color)
+{
+    if (y < 0 || y >= canvas->height) return;
+    if (inner < 0) {
+        shape_span(canvas, y, cx - w, cx + w, color);
+    } else {
+        shape_span(canvas, y, cx - w, cx - inner - 1, color);
+        shape_span(canvas, y, cx + inner + 1, cx + w, color);
+    }
+}
+
+// Cerchio di un pixel tutto nel canvas: l'anello è simmetrico anche rispetto
+// alle diagonali, basta l'ottante dx >= dy >= 0 come canvas_draw_circle
+static void shape_circle_ring(Canvas *canvas, int cx, int cy, int r, unsigned int color) {
+    int stride = canvas->width;
+    unsigned int *c = canvas->pixels + cy * stride + cx;
+    ShapeEllipseWalk e;
+    shape_ellipse_walk_init(&e, r, r, 0);
+    int w = e.w;
+    int w_next = shape_ellipse_walk_next(&e);
+    int w_prev = w_next;  // la riga -1 è uguale alla riga 1
+    for (int dy = 0; dy <= w; dy++) {
+        int from = shape_ring_inner(w, w_prev, w_next) + 1;
+        if (from < dy) from = dy;
+        for (int dx = from; dx <= w; dx++) {
+            c[dy * stride + dx] = color;
+            c[dy * stride - dx] = color;
+            c[-dy * stride + dx] = color;
+            c[-dy * stride - dx] = color;
+            c[dx * stride + dy] = color;
+            c[dx * stride - dy] = color;
+            c[-dx * stride + dy] = color;
+            c[-dx * stride - dy] = color;
+        }
+        w_prev = w;
+        w = w_next;
+        w_next = shape_ellipse_walk_next(&e);
+    }
+}
+
+// Ellisse senza AA direttamente a span dalla maschera intera: piena, o
+// contorno di un pixel = i pixel della maschera con un vicino (sopra, sotto
+// o di lato) fuori. Le righe cy - dy e cy + dy sono uguali, si cammina solo
+// sui dy >= 0 che hanno una delle due nel canvas.
+static void shape_ellipse_spans(Canvas *canvas, int cx, int cy, int rx, int ry, int outline,
+                                unsigned int color)
+{
+    if (outline && rx == ry && cx >= rx && cy >= ry &&
+        (int64_t)cx + rx < canvas->width && (int64_t)cy + ry < canvas->height) {
+        shape_circle_ring(canvas, cx, cy, rx, color);
+        return;
+    }
+
+    int64_t ya = (int64_t)cy - ry, yb = (int64_t)cy + ry;
+    if (ya < 0) ya = 0;
+    if (yb >= canvas->height) yb = canvas->height - 1;
+    if (ya > yb || (int64_t)cx + rx < 0 || (int64_t)cx - rx >= canvas->width) return;
+    int da = (int)llabs(ya - cy), db = (int)llabs(yb - cy);
+    int dy = (ya <= cy && cy <= yb) ? 0 : ((da < db) ? da : db);
+    int dmax = (da > db) ? da : db;
+
+    ShapeEllipseWalk e;
+    shape_ellipse_walk_init(&e, rx, ry, dy);
+    int w_prev = (dy > 0) ? shape_ellipse_half_width(rx, ry, dy - 1) : -1;
+    int w = e.w;
+    for (; dy <= dmax; dy++) {
+        int w_next = shape_ellipse_walk_next(&e);
+        int inner = -1;
+        // Sulla riga centrale il vicino sopra è uguale a quello sotto
+        if (outline) inner = shape_ring_inner(w, (dy > 0) ? w_prev : w_next, w_next);
+        shape_ellipse_row(canvas, (int64_t)cy + dy, cx, w, inner, color);
+        if (dy > 0) shape_ellipse_row(canvas, (int64_t)cy - dy, cx, w, inner, color);
+        w_prev = w;
+        w = w_next;
+    }
+}
+
+int shape_draw_rect(Canvas *canvas, int x0, int y0, int x1, int y1, int corner,
+                    int thickness, unsigned int color, int flags)
+{
+    if (!(flags & SHAPE_FLAG_AA) && corner <= 0 && thickness <= 1) {
+        shape_rect_spans(canvas, x0, y0, x1, y1, thickness == 1, color);
+        return 0;
+    }
+
+    int ox = (x0 < x1) ? x0 : x1, oy = (y0 < y1) ? y0 : y1;
+    double w = abs(x1 - x0), h = abs(y1 - y0);
+    ShapeRaster r;
+    shape_raster_init(&r, canvas, flags, ox, oy);
+
+    // Tracciato sui centri dei pixel: (0.5, 0.5)-(w + 0.5, h + 0.5)
+    double half = (thickness > 0) ? thickness * 0.5 : 0.5;
+    double c = corner;
+    shape_rect_contour(&r, 0.5 - half, 0.5 - half, w + 0.5 + half, h + 0.5 + half,
+                       (c > 0) ? c + half : 0, 0);
+    if (thickness > 0) {
+        shape_rect_contour(&r, 0.5 + half, 0.5 + half, w + 0.5 - half, h + 0.5 - half,
+                           (c > half) ? c - half : 0, 1);
+    }
+    int ret = shape_fill(&r, color);
+    shape_raster_free(&r);
+    return ret;
+}
+
+int shape_draw_ellipse(Canvas *canvas, int cx, int cy, int rx, int ry,
+                       int thickness, unsigned int color, int flags)
+{
+    rx = abs(rx);
+    ry = abs(ry);
+    if (!(flags & SHAPE_FLAG_AA) && thickness <= 1) {
+        shape_ellipse_spans(canvas, cx, cy, rx, ry, thickness == 1, color);
+        return 0;
+    }
+
+    ShapeRaster r;
+    shape_raster_init(&r, canvas, flags, cx, cy);
+
+    if (thickness > 0) {
+        double half = thickness * 0.5;
+        shape_ellipse_contour(&r, 0.5, 0.5, rx + half, ry + half, 0);
+        shape_ellipse_contour(&r, 0.5, 0.5, rx - half, ry - half, 1);
+    } else {
+        // Piena: i pixel della maschera intera (come shape_ellipse_spans),
+        // il bordo morbido dell'AA si aggiunge solo fuori
+        shape_ellipse_mask_contour(&r, rx, ry);
+        if (flags & SHAPE_FLAG_AA) shape_ellipse_contour(&r, 0.5, 0.5, rx + 0.5, ry + 0.5, 0);
+    }
+    int ret = shape_fill(&r, color);
+    shape_raster_free(&r);
+    return ret;
+}
+
+int shape_draw_polygon(Canvas *canvas, const int *xs, const int *ys, int n,
+                       int thickness, unsigned int color, int flags)
+{
+    if (n <= 0) return 0;
+    ShapeRaster r;
+    shape_raster_init(&r, canvas, flags, xs[0], ys[0]);
+
+    if (thickness <= 0) {
+        for (int i = 0; i < n; i++) {
+            shape_point(&r, xs[i] - xs[0] + 0.5, ys[i] - ys[0] + 0.5);
+        }
+        shape_close(&r, 0);
+    } else {
+        // Unione di capsule: un quadrilatero per lato, un disco per vertice
+        double half = thickness * 0.5;
+        for (int i = 0; i < n; i++) {
+            int j = (i + 1 == n) ? 0 : i + 1;
+            double ax = xs[i] - xs[0] + 0.5, ay = ys[i] - ys[0] + 0.5;
+            double bx = xs[j] - xs[0] + 0.5, by = ys[j] - ys[0] + 0.5;
+            shape_ellipse_contour(&r, ax, ay, half, half, 0);
+            double dx = bx - ax, dy = by - ay;
+            double len = sqrt(dx * dx + dy * dy);
+            if (len <= 0) continue;
+            double nx = -dy / len * half, ny = dx / len * half;
+            shape_point(&r, ax + nx, ay + ny);
+            shape_point(&r, bx + nx, by + ny);
+            shape_point(&r, bx - nx, by - ny);
+            shape_point(&r, ax - nx, ay - ny);
+            shape_close(&r, 0);
+        }
+    }
+    int ret = shape_fill(&r, color);
+    shape_raster_free(&r);
+    return ret;
+}
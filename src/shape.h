@@ -0,0 +1,52 @@
+#ifndef SHAPE_H
+#define SHAPE_H
+
+#include <stdint.h>
+#include "canvas.h"
+
+// Sotto-righe per pixel dell'antialiasing (copertura verticale); in
+// orizzontale la copertura è esatta a 1/256 di pixel
+#define SHAPE_AA_SAMPLES   4
+// Vertici massimi di un poligono dello strumento
+#define SHAPE_MAX_POINTS   256
+
+// Forme di JCMD_SHAPE
+typedef enum {
+    SHAPE_RECT,      // rettangolo (x0, y0)-(x1, y1), angoli arrotondati se corner > 0
+    SHAPE_ELLIPSE,   // centro (x0, y0), semiassi |x1 - x0| e |y1 - y0|
+    SHAPE_CIRCLE,    // centro (x0, y0), raggio fino a (x1, y1)
+    SHAPE_KIND_COUNT
+} ShapeKind;
+
+#define SHAPE_FLAG_AA  1   // bordi con copertura parziale
+
+// Parametri nel seed di JCMD_SHAPE: forma, flag e raggio degli angoli
+#define SHAPE_PARAMS(kind, flags, corner) \
+    ((uint32_t)(kind) | ((uint32_t)(flags) << 8) | ((uint32_t)(corner) << 16))
+#define SHAPE_PARAM_KIND(seed)   ((ShapeKind)((seed) & 0xFF))
+#define SHAPE_PARAM_FLAGS(seed)  ((int)(((seed) >> 8) & 0xFF))
+#define SHAPE_PARAM_CORNER(seed) ((int)((seed) >> 16))
+
+// Le forme passano da un rasterizzatore a scanline (tabella dei lati attivi,
+// regola non-zero): ogni riga viene riempita una sola volta a span,
+// qualunque sia lo spessore. I contorni spessi sono anelli (bordo esterno
+// più buco), il tracciato passa per i centri dei pixel indicati.
+// Senza AA, rettangoli senza angoli ed ellissi pieni o di un pixel vanno
+// direttamente a span, senza costruire i lati.
+// thickness = 0 riempie la forma. Ritornano -1 se manca memoria.
+
+// Rettangolo con gli estremi inclusi, angoli di raggio corner
+int  shape_draw_rect(Canvas *canvas, int x0, int y0, int x1, int y1, int corner,
+                     int thickness, unsigned int color, int flags);
+// Ellisse di centro (cx, cy) e semiassi rx, ry. Piena copre i pixel con
+// dx² ry² + dy² rx² <= rx² ry², come canvas_draw_filled_circle per rx = ry;
+// con thickness = 1 e senza AA i suoi pixel con un vicino (sopra, sotto o di
+// lato) fuori
+int  shape_draw_ellipse(Canvas *canvas, int cx, int cy, int rx, int ry,
+                        int thickness, unsigned int color, int flags);
+// Poligono chiuso qualsiasi (anche intrecciato). Il contorno è l'unione
+// delle capsule dei lati: giunzioni arrotondate.
+int  shape_draw_polygon(Canvas *canvas, const int *xs, const int *ys, int n,
+                        int thickness, unsigned int color, int flags);
+
+#endif
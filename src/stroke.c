@@ -0,0 +1,533 @@
+#include "stroke.h"
+#include "membudget.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+
+// Tabelle di span: per ogni raggio r, metà larghezza delle righe 0..r.
+// Il raggio r inizia all'indice r * (r + 1) / 2.
+#define STROKE_TABLE_SIZE ((STROKE_MAX_RADIUS + 1) * (STROKE_MAX_RADIUS + 2) / 2)
+
+static unsigned short span_table[STROKE_TABLE_SIZE];
+static pthread_once_t span_once = PTHREAD_ONCE_INIT;
+
+static int stroke_compute_half_width(int r, int dy) {
+    int rem = r * r - dy * dy;
+    if (rem < 0) return -1;
+    int hw = (int)sqrtf((float)rem);
+    while (hw * hw > rem) hw--;
+    while ((hw + 1) * (hw + 1) <= rem) hw++;
+    return hw;
+}
+
+static void stroke_build_tables(void) {
+    for (int r = 0; r <= STROKE_MAX_RADIUS; r++) {
+        unsigned short *row = &span_table[r * (r + 1) / 2];
+        for (int dy = 0; dy <= r; dy++) {
+            row[dy] = (unsigned short)stroke_compute_half_width(r, dy);
+        }
+    }
+}
+
+// Tabella del raggio r, o NULL se troppo grande (si calcola al volo)
+static const unsigned short *stroke_span_row(int r) {
+    pthread_once(&span_once, stroke_build_tables);
+    return (r <= STROKE_MAX_RADIUS) ? &span_table[r * (r + 1) / 2] : NULL;
+}
+
+int stroke_half_width(int r, int dy) {
+    if (dy < 0) dy = -dy;
+    if (dy > r) return -1;
+    const unsigned short *tab = stroke_span_row(r);
+    return tab ? tab[dy] : stroke_compute_half_width(r, dy);
+}
+
+int stroke_pressure_size(int brush_size, int pressure) {
+    int k = STROKE_PRESSURE_MIN_SIZE + (256 - STROKE_PRESSURE_MIN_SIZE) * pressure / 255;
+    int size = brush_size * STROKE_SUBPIXEL * k / 256;
+    return (size < STROKE_SUBPIXEL) ? STROKE_SUBPIXEL : size;
+}
+
+int stroke_pressure_alpha(int pressure) {
+    return STROKE_PRESSURE_MIN_ALPHA + (255 - STROKE_PRESSURE_MIN_ALPHA) * pressure / 255;
+}
+
+// Raggio del timbro come in canvas_draw_brush (size / 2, un pixel sotto 2)
+static int stroke_radius(int size) {
+    return size / (2 * STROKE_SUBPIXEL);
+}
+
+static void stroke_fill_span(unsigned int *row, int lo, int hi, unsigned int color, int t) {
+    if (t >= 256) {
+        for (int x = lo; x <= hi; x++) row[x] = color;
+    } else {
+        for (int x = lo; x <= hi; x++) row[x] = canvas_lerp(row[x], color, t);
+    }
+}
+
+// Unione dei timbri lungo il segmento nelle righe [cy0, cy0 + rows):
+// per riga basta l'estremo sinistro e destro finché i timbri sono contigui.
+// Se il raggio scende più in fretta di quanto il segmento si avvicina alla
+// riga, un timbro può cadere staccato dagli altri: la riga finisce in split
+// e va ricalcolata con stroke_row_spans.
+static void stroke_collect_spans(int x0, int y0, int size0, int x1, int y1, int size1,
+                                 int cy0, int rows, int *lo, int *hi, unsigned char *split)
+{
+    int dx = abs(x1 - x0);
+    int dy = abs(y1 - y0);
+    int sx = (x0 < x1) ? 1 : -1;
+    int sy = (y0 < y1) ? 1 : -1;
+    int err = dx - dy;
+    int steps = (dx > dy) ? dx : dy;
+
+    // Spessore in 16.16 per passo di Bresenham
+    int64_t size = (int64_t)size0 << 16;
+    int64_t dsize = steps ? (((int64_t)(size1 - size0)) << 16) / steps : 0;
+
+    for (int i = 0; i < rows; i++) {
+        lo[i] = INT_MAX;
+        hi[i] = INT_MIN;
+        split[i] = 0;
+    }
+
+    while (1) {
+        int r = stroke_radius((int)(size >> 16));
+        const unsigned short *tab = stroke_span_row(r);
+        int top = y0 - r - cy0;
+        int bottom = y0 + r - cy0;
+        if (top < 0) top = 0;
+        if (bottom >= rows) bottom = rows - 1;
+
+        for (int row = top; row <= bottom; row++) {
+            int d = abs(row + cy0 - y0);
+            int hw = tab ? tab[d] : stroke_compute_half_width(r, d);
+            if (lo[row] <= hi[row] && (x0 - hw > hi[row] + 1 || x0 + hw < lo[row] - 1)) {
+                split[row] = 1;
+            }
+            if (x0 - hw < lo[row]) lo[row] = x0 - hw;
+            if (x0 + hw > hi[row]) hi[row] = x0 + hw;
+        }
+
+        if (x0 == x1 && y0 == y1) break;
+        int e2 = 2 * err;
+        if (e2 > -dy) { err -= dy; x0 += sx; }
+        if (e2 < dx)  { err += dx; y0 += sy; }
+        size += dsize;
+    }
+}
+
+// Buffer sullo stack di stroke_draw_segments (un trascinamento con 16 copie
+// ci sta; segmenti più lunghi vanno nell'arena)
+#define STROKE_BATCH_STACK    (16 * 1024)
+// Sotto questa soglia gli span si ordinano per inserimento
+#define STROKE_SORT_INSERTION 24
+
+static int stroke_compare_runs(const void *a, const void *b)
+{
+    int la = ((const int *)a)[0], lb = ((const int *)b)[0];
+    return (la > lb) - (la < lb);
+}
+
+// Ordina per estremo sinistro e fonde gli span che si toccano; ritorna
+// quanti ne restano
+static int stroke_merge_spans(int *spans, int n)
+{
+    if (n > STROKE_SORT_INSERTION) {
+        qsort(spans, n, 2 * sizeof(int), stroke_compare_runs);
+    } else {
+        // Pochi span (le copie di una riga): inserimento, senza chiamate
+        for (int i = 1; i < n; i++) {
+            int l = spans[2 * i], h = spans[2 * i + 1], j = i;
+            for (; j > 0 && spans[2 * j - 2] > l; j--) {
+                spans[2 * j] = spans[2 * j - 2];
+                spans[2 * j + 1] = spans[2 * j - 1];
+            }
+            spans[2 * j] = l;
+            spans[2 * j + 1] = h;
+        }
+    }
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        if (m > 0 && spans[2 * i] <= spans[2 * m - 1] + 1) {
+            if (spans[2 * i + 1] > spans[2 * m - 1]) spans[2 * m - 1] = spans[2 * i + 1];
+        } else {
+            spans[2 * m] = spans[2 * i];
+            spans[2 * m + 1] = spans[2 * i + 1];
+            m++;
+        }
+    }
+    return m;
+}
+
+// Pezzi della riga y in runs (coppie lo, hi; posto per un run per passo),
+// non ordinati. I timbri di passi consecutivi che toccano la riga sono
+// contigui: ogni run di passi dà un intervallo.
+static int stroke_row_runs(int x0, int y0, int size0, int x1, int y1, int size1,
+                           int y, int *runs)
+{
+    int dx = abs(x1 - x0);
+    int dy = abs(y1 - y0);
+    int sx = (x0 < x1) ? 1 : -1;
+    int sy = (y0 < y1) ? 1 : -1;
+    int err = dx - dy;
+    int steps = (dx > dy) ? dx : dy;
+    int64_t size = (int64_t)size0 << 16;
+    int64_t dsize = steps ? (((int64_t)(size1 - size0)) << 16) / steps : 0;
+    int n = 0, inside = 0;
+
+    while (1) {
+        int hw = stroke_half_width(stroke_radius((int)(size >> 16)), y - y0);
+        if (hw < 0) {
+            inside = 0;
+        } else if (!inside) {
+            runs[2 * n] = x0 - hw;
+            runs[2 * n + 1] = x0 + hw;
+            n++;
+            inside = 1;
+        } else {
+            if (x0 - hw < runs[2 * n - 2]) runs[2 * n - 2] = x0 - hw;
+            if (x0 + hw > runs[2 * n - 1]) runs[2 * n - 1] = x0 + hw;
+        }
+
+        if (x0 == x1 && y0 == y1) break;
+        int e2 = 2 * err;
+        if (e2 > -dy) { err -= dy; x0 += sx; }
+        if (e2 < dx)  { err += dx; y0 += sy; }
+        size += dsize;
+    }
+    return n;
+}
+
+// Span separati della riga y, ordinati e fusi
+static int stroke_row_spans(int x0, int y0, int size0, int x1, int y1, int size1,
+                            int y, int *runs)
+{
+    return stroke_merge_spans(runs, stroke_row_runs(x0, y0, size0, x1, y1, size1, y, runs));
+}
+
+// Riempie [l, h] della riga, meno la riga del disco iniziale se skip_hw >= 0
+static void stroke_fill_clipped(unsigned int *row, int l, int h, int x0, int skip_hw,
+                                unsigned int color, int t)
+{
+    if (l > h) return;
+    if (skip_hw < 0) {
+        stroke_fill_span(row, l, h, color, t);
+        return;
+    }
+    // Lo span meno la riga del disco iniziale: fino a due pezzi
+    int el = x0 - skip_hw, eh = x0 + skip_hw;
+    stroke_fill_span(row, l, (h < el - 1) ? h : el - 1, color, t);
+    stroke_fill_span(row, (l > eh + 1) ? l : eh + 1, h, color, t);
+}
+
+// Righe [cy0, cy0 + rows) del segmento dagli estremi raccolti. Con runs
+// (posto per un run per passo) le righe split si ricalcolano esatte, senza
+// resta l'intervallo che copre tutti i pezzi.
+static void stroke_fill_rows(Canvas *canvas, const StrokeSegment *sg, int cy0, int rows,
+                             const int *lo, const int *hi, const unsigned char *split,
+                             int skip_start, unsigned int color, int t, int *runs)
+{
+    int r0 = stroke_radius(sg->size0);
+    for (int i = 0; i < rows; i++) {
+        int y = cy0 + i;
+        int l = (lo[i] < 0) ? 0 : lo[i];
+        int h = (hi[i] >= canvas->width) ? canvas->width - 1 : hi[i];
+        if (l > h) continue;
+        unsigned int *row = &canvas->pixels[y * canvas->width];
+        int hw = skip_start ? stroke_half_width(r0, y - sg->y0) : -1;
+
+        if (!split[i] || !runs) {
+            stroke_fill_clipped(row, l, h, sg->x0, hw, color, t);
+            continue;
+        }
+        int n = stroke_row_spans(sg->x0, sg->y0, sg->size0, sg->x1, sg->y1, sg->size1, y, runs);
+        for (int k = 0; k < n; k++) {
+            int sl = (runs[2 * k] < 0) ? 0 : runs[2 * k];
+            int sh = (runs[2 * k + 1] >= canvas->width) ? canvas->width - 1 : runs[2 * k + 1];
+            stroke_fill_clipped(row, sl, sh, sg->x0, hw, color, t);
+        }
+    }
+}
+
+void stroke_draw_segment(Canvas *canvas, int x0, int y0, int size0,
+                         int x1, int y1, int size1,
+                         unsigned int color, int alpha, int skip_start)
+{
+    if (alpha <= 0) return;
+    int t = (alpha >= 255) ? 256 : alpha + (alpha >> 7);
+    StrokeSegment sg = { x0, y0, size0, x1, y1, size1 };
+
+    int r0 = stroke_radius(size0);
+    int r1 = stroke_radius(size1);
+    int rmax = (r0 > r1) ? r0 : r1;
+    int ymin = ((y0 < y1) ? y0 : y1) - rmax;
+    int ymax = ((y0 > y1) ? y0 : y1) + rmax;
+    if (ymin < 0) ymin = 0;
+    if (ymax >= canvas->height) ymax = canvas->height - 1;
+
+    int lo[STROKE_CHUNK_ROWS], hi[STROKE_CHUNK_ROWS];
+    unsigned char split[STROKE_CHUNK_ROWS];
+    int *runs = NULL;    // solo se una riga ha pezzi separati
+
+    for (int cy0 = ymin; cy0 <= ymax; cy0 += STROKE_CHUNK_ROWS) {
+        int rows = ymax - cy0 + 1;
+        if (rows > STROKE_CHUNK_ROWS) rows = STROKE_CHUNK_ROWS;
+        stroke_collect_spans(x0, y0, size0, x1, y1, size1, cy0, rows, lo, hi, split);
+
+        for (int i = 0; i < rows && !runs; i++) {
+            if (!split[i]) continue;
+            int dx = abs(x1 - x0), dy = abs(y1 - y0);
+            int steps = (dx > dy) ? dx : dy;
+            runs = (int *)mem_scratch_alloc((size_t)(steps + 1) * 2 * sizeof(int));
+        }
+        stroke_fill_rows(canvas, &sg, cy0, rows, lo, hi, split, skip_start, color, t, runs);
+    }
+    if (runs) mem_scratch_free(runs);
+}
+
+// Riempie [l, h] della riga tranne gli span di skips (ordinati e fusi)
+static void stroke_fill_except(unsigned int *row, int l, int h, const int *skips, int ns,
+                               unsigned int color, int t)
+{
+    for (int j = 0; j < ns && l <= h; j++) {
+        if (skips[2 * j + 1] < l) continue;
+        if (skips[2 * j] > h) break;
+        stroke_fill_span(row, l, skips[2 * j] - 1, color, t);
+        l = skips[2 * j + 1] + 1;
+    }
+    stroke_fill_span(row, l, h, color, t);
+}
+
+// Righe di un segmento di stroke_draw_segments: prima riga e quante (già
+// tagliate al canvas), posizione nei buffer di estremi, raggio iniziale
+typedef struct {
+    int top, rows, base, r0;
+} StrokeRows;
+
+// a è il riflesso di b attorno a x = *mx / 2 (bit 0) e/o a y = *my / 2
+// (bit 1), 0 se è identico, -1 se non è nessuno dei due. Bresenham fa gli
+// stessi passi con il verso opposto e i dischi sono simmetrici: gli span di
+// a sono quelli di b riflessi.
+static int stroke_segment_mirror(const StrokeSegment *a, const StrokeSegment *b, int *mx, int *my)
+{
+    if (a->size0 != b->size0 || a->size1 != b->size1) return -1;
+    int flags = 0;
+    *mx = a->x0 + b->x0;
+    *my = a->y0 + b->y0;
+    if (a->x0 != b->x0 || a->x1 != b->x1) {
+        if (a->x1 + b->x1 != *mx) return -1;
+        flags |= 1;
+    }
+    if (a->y0 != b->y0 || a->y1 != b->y1) {
+        if (a->y1 + b->y1 != *my) return -1;
+        flags |= 2;
+    }
+    return flags;
+}
+
+// Estremi delle righe di a riflettendo quelli di b; 0 se una riga che
+// serve è fuori da quelle raccolte per b (tagliata dal bordo)
+static int stroke_reflect_rows(const StrokeRows *a, const StrokeRows *b, int flags, int mx, int my,
+                               int *lo, int *hi, unsigned char *split)
+{
+    for (int i = 0; i < a->rows; i++) {
+        int y = a->top + i;
+        int s = ((flags & 2) ? my - y : y) - b->top;
+        if (s < 0 || s >= b->rows) return 0;
+        s += b->base;
+        split[a->base + i] = split[s];
+        if (!(flags & 1) || lo[s] > hi[s]) {
+            lo[a->base + i] = lo[s];
+            hi[a->base + i] = hi[s];
+        } else {
+            lo[a->base + i] = mx - hi[s];
+            hi[a->base + i] = mx - lo[s];
+        }
+    }
+    return 1;
+}
+
+// Segmenti che si sovrappongono: una passata per riga con i soli segmenti
+// attivi, gli span di tutti fusi e i dischi iniziali tolti una volta
+static void stroke_sweep_rows(Canvas *canvas, const StrokeSegment *segs, const StrokeRows *info,
+                              const int *box, const int *idx, int m, const int *lo, const int *hi,
+                              const unsigned char *split, int *spans, int *skips,
+                              int skip_start, unsigned int color, int t)
+{
+    int order[STROKE_BATCH_MAX], active[STROKE_BATCH_MAX];
+
+    // Per prima riga: si scorrono le righe aggiungendo e togliendo
+    for (int a = 0; a < m; a++) {
+        int k = idx[a], j = a;
+        for (; j > 0 && info[order[j - 1]].top > info[k].top; j--) order[j] = order[j - 1];
+        order[j] = k;
+    }
+
+    int next = 0, na = 0;
+    for (int y = info[order[0]].top; next < m || na > 0; y++) {
+        if (na == 0 && info[order[next]].top > y) y = info[order[next]].top;
+        // Attivi da sinistra: gli span della riga arrivano quasi ordinati
+        while (next < m && info[order[next]].top == y) {
+            int k = order[next++], a = na++;
+            for (; a > 0 && box[4 * active[a - 1]] > box[4 * k]; a--) active[a] = active[a - 1];
+            active[a] = k;
+        }
+
+        int count = 0, ns = 0;
+        for (int a = 0; a < na; a++) {
+            int k = active[a];
+            const StrokeSegment *sg = &segs[k];
+            int i = info[k].base + y - info[k].top;
+            if (lo[i] <= hi[i]) {
+                if (split[i]) {
+                    count += stroke_row_runs(sg->x0, sg->y0, sg->size0, sg->x1, sg->y1,
+                                             sg->size1, y, &spans[2 * count]);
+                } else {
+                    spans[2 * count] = lo[i];
+                    spans[2 * count + 1] = hi[i];
+                    count++;
+                }
+            }
+            int hw = skip_start ? stroke_half_width(info[k].r0, y - sg->y0) : -1;
+            if (hw >= 0) {
+                skips[2 * ns] = sg->x0 - hw;
+                skips[2 * ns + 1] = sg->x0 + hw;
+                ns++;
+            }
+        }
+
+        unsigned int *row = &canvas->pixels[y * canvas->width];
+        if (count == 1 && ns <= 1) {
+            // Una copia sola sulla riga: niente da fondere
+            int l = (spans[0] < 0) ? 0 : spans[0];
+            int h = (spans[1] >= canvas->width) ? canvas->width - 1 : spans[1];
+            if (l <= h) stroke_fill_except(row, l, h, skips, ns, color, t);
+        } else if (count > 0) {
+            // Le copie sovrapposte si fondono una volta sola
+            count = stroke_merge_spans(spans, count);
+            ns = stroke_merge_spans(skips, ns);
+            for (int j = 0; j < count; j++) {
+                int l = (spans[2 * j] < 0) ? 0 : spans[2 * j];
+                int h = (spans[2 * j + 1] >= canvas->width) ? canvas->width - 1 : spans[2 * j + 1];
+                if (l <= h) stroke_fill_except(row, l, h, skips, ns, color, t);
+            }
+        }
+
+        // Fuori i segmenti che finiscono su questa riga, l'ordine resta
+        int kept = 0;
+        for (int a = 0; a < na; a++) {
+            int k = active[a];
+            if (info[k].top + info[k].rows - 1 != y) active[kept++] = k;
+        }
+        na = kept;
+    }
+}
+
+void stroke_draw_segments(Canvas *canvas, const StrokeSegment *segs, int n,
+                          unsigned int color, int alpha, int skip_start)
+{
+    if (alpha <= 0) return;
+    // Oltre il massimo a gruppi (le sovrapposizioni fra gruppi si sommano)
+    for (; n > STROKE_BATCH_MAX; segs += STROKE_BATCH_MAX, n -= STROKE_BATCH_MAX) {
+        stroke_draw_segments(canvas, segs, STROKE_BATCH_MAX, color, alpha, skip_start);
+    }
+    if (n <= 0) return;
+    if (n == 1) {
+        stroke_draw_segment(canvas, segs[0].x0, segs[0].y0, segs[0].size0,
+                            segs[0].x1, segs[0].y1, segs[0].size1, color, alpha, skip_start);
+        return;
+    }
+    int t = (alpha >= 255) ? 256 : alpha + (alpha >> 7);
+
+    // Riquadri, righe tagliate al canvas e posto per i pezzi di una riga
+    // (al più un run per passo)
+    StrokeRows info[STROKE_BATCH_MAX];
+    int box[4 * STROKE_BATCH_MAX];
+    size_t total_rows = 0, cap = 0;
+    for (int k = 0; k < n; k++) {
+        const StrokeSegment *sg = &segs[k];
+        int r0 = stroke_radius(sg->size0), r1 = stroke_radius(sg->size1);
+        int rmax = (r0 > r1) ? r0 : r1;
+        int *b = &box[4 * k];
+        b[0] = ((sg->x0 < sg->x1) ? sg->x0 : sg->x1) - rmax;
+        b[1] = ((sg->y0 < sg->y1) ? sg->y0 : sg->y1) - rmax;
+        b[2] = ((sg->x0 > sg->x1) ? sg->x0 : sg->x1) + rmax;
+        b[3] = ((sg->y0 > sg->y1) ? sg->y0 : sg->y1) + rmax;
+        int top = (b[1] < 0) ? 0 : b[1];
+        int bottom = (b[3] >= canvas->height) ? canvas->height - 1 : b[3];
+        info[k].top = top;
+        info[k].rows = (bottom >= top) ? bottom - top + 1 : 0;
+        info[k].base = (int)total_rows;
+        info[k].r0 = r0;
+        total_rows += (size_t)info[k].rows;
+        int dx = abs(sg->x1 - sg->x0), dy = abs(sg->y1 - sg->y0);
+        cap += (size_t)((dx > dy) ? dx : dy) + 1;
+    }
+    if (total_rows == 0) return;
+
+    // Estremi e split di tutte le righe di ogni segmento, poi per riga i
+    // pezzi e i dischi iniziali
+    size_t bytes = (2 * total_rows + 2 * cap + 2 * (size_t)n) * sizeof(int) + total_rows;
+    int stack_buf[STROKE_BATCH_STACK / sizeof(int)];
+    int *buf = (bytes <= sizeof(stack_buf)) ? stack_buf : (int *)mem_scratch_alloc(bytes);
+    if (!buf) {
+        // Senza memoria un segmento alla volta: con l'opacità le
+        // sovrapposizioni delle copie si sommano
+        for (int k = 0; k < n; k++) {
+            stroke_draw_segment(canvas, segs[k].x0, segs[k].y0, segs[k].size0,
+                                segs[k].x1, segs[k].y1, segs[k].size1, color, alpha, skip_start);
+        }
+        return;
+    }
+    int *lo = buf, *hi = lo + total_rows;
+    int *spans = hi + total_rows;
+    int *skips = spans + 2 * cap;
+    unsigned char *split = (unsigned char *)(skips + 2 * n);
+
+    // Gli specchi e le copie a mezzo giro riflettono gli span di una copia
+    // già raccolta; le altre percorrono il proprio segmento
+    for (int k = 0; k < n; k++) {
+        if (info[k].rows == 0) continue;
+        int done = 0;
+        for (int j = 0; j < k && !done; j++) {
+            int mx, my;
+            int flags = stroke_segment_mirror(&segs[k], &segs[j], &mx, &my);
+            if (flags >= 0 && info[j].rows > 0) {
+                done = stroke_reflect_rows(&info[k], &info[j], flags, mx, my, lo, hi, split);
+            }
+        }
+        if (!done) {
+            const StrokeSegment *sg = &segs[k];
+            stroke_collect_spans(sg->x0, sg->y0, sg->size0, sg->x1, sg->y1, sg->size1,
+                                 info[k].top, info[k].rows, lo + info[k].base,
+                                 hi + info[k].base, split + info[k].base);
+        }
+    }
+
+    // Le copie che non toccano le altre non hanno nulla da fondere: vanno
+    // dirette, la passata comune costa di più per riga. Da opache vanno
+    // dirette tutte: ripassare un pixel con lo stesso colore non cambia nulla
+    int idx[STROKE_BATCH_MAX], m = 0;
+    for (int k = 0; k < n; k++) {
+        if (info[k].rows == 0) continue;
+        const int *a = &box[4 * k];
+        int alone = 1;
+        for (int j = 0; j < n && alone && t < 256; j++) {
+            const int *b = &box[4 * j];
+            if (j != k && a[0] <= b[2] && b[0] <= a[2] && a[1] <= b[3] && b[1] <= a[3]) alone = 0;
+        }
+        if (alone) {
+            stroke_fill_rows(canvas, &segs[k], info[k].top, info[k].rows, lo + info[k].base,
+                             hi + info[k].base, split + info[k].base, skip_start, color, t, spans);
+        } else {
+            idx[m++] = k;
+        }
+    }
+    if (m > 0) {
+        stroke_sweep_rows(canvas, segs, info, box, idx, m, lo, hi, split, spans, skips,
+                          skip_start, color, t);
+    }
+    if (buf != stack_buf) mem_scratch_free(buf);
+}
@@ -0,0 +1,54 @@
+#ifndef STROKE_H
+#define STROKE_H
+
+#include "canvas.h"
+
+// Spessori in sedicesimi di pixel: la pressione varia il tratto con continuità
+#define STROKE_SUBPIXEL    16
+// Raggi con tabella di span precalcolata (oltre si calcola al volo)
+#define STROKE_MAX_RADIUS  255
+// Righe elaborate per passata (buffer di span sullo stack)
+#define STROKE_CHUNK_ROWS  256
+// Segmenti al massimo in una passata di stroke_draw_segments
+#define STROKE_BATCH_MAX   16
+
+// Frazione (su 256) di spessore e opacità a pressione nulla
+#define STROKE_PRESSURE_MIN_SIZE   64
+#define STROKE_PRESSURE_MIN_ALPHA  48
+
+// Segmento di pennello con spessore interpolato linearmente da size0 a
+// size1 (in 1/STROKE_SUBPIXEL px) e opacità alpha (255 = pieno).
+// Produce gli stessi pixel dei timbri di canvas_draw_line, ma ogni riga
+// viene riempita una sola volta come span: il costo non dipende dall'area
+// dei dischi ripetuti. Con skip_start il disco iniziale, già disegnato dal
+// segmento precedente, non viene ripassato (evita accumuli di opacità).
+void stroke_draw_segment(Canvas *canvas, int x0, int y0, int size0,
+                         int x1, int y1, int size1,
+                         unsigned int color, int alpha, int skip_start);
+
+typedef struct {
+    int x0, y0, size0;
+    int x1, y1, size1;
+} StrokeSegment;
+
+// Più segmenti con lo stesso colore e opacità in una sola passata (le copie
+// della simmetria): per ogni riga gli span di tutti i segmenti si uniscono e
+// ogni pixel si fonde una volta sola, anche dove le copie si sovrappongono.
+// Con skip_start non si ripassano i dischi iniziali di nessun segmento.
+// Con alpha 255 non c'è nulla da fondere: il risultato è quello di
+// stroke_draw_segment su ogni segmento, ognuno senza il proprio disco.
+// Un segmento riflesso esatto di un altro (specchi, copie a mezzo giro)
+// riusa gli span dell'altro invece di ripercorrere i timbri.
+// Con un solo segmento equivale a stroke_draw_segment; oltre STROKE_BATCH_MAX
+// segmenti si procede a gruppi.
+void stroke_draw_segments(Canvas *canvas, const StrokeSegment *segs, int n,
+                          unsigned int color, int alpha, int skip_start);
+
+// Metà larghezza della riga dy di un disco di raggio r (come canvas_draw_brush)
+int  stroke_half_width(int r, int dy);
+
+// Pressione (0-255) -> spessore in 1/STROKE_SUBPIXEL px e opacità
+int  stroke_pressure_size(int brush_size, int pressure);
+int  stroke_pressure_alpha(int pressure);
+
+#endif
@@ -0,0 +1,230 @@
+#include "strokeindex.h"
+#include "membudget.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define STROKE_INITIAL_CAPACITY 256
+
+void stroke_index_init(StrokeIndex *index) {
+    memset(index, 0, sizeof(StrokeIndex));
+    index->valid = 1;
+}
+
+void stroke_index_destroy(StrokeIndex *index) {
+    mem_free(MEM_INDEX, index->objects, (size_t)index->capacity * sizeof(StrokeObject));
+    mem_free(MEM_INDEX, index->unbounded, (size_t)index->unbounded_capacity * sizeof(int));
+    mem_free(MEM_INDEX, index->query, (size_t)index->query_capacity * sizeof(int));
+    for (int cy = 0; cy < STROKE_GRID_H; cy++) {
+        for (int cx = 0; cx < STROKE_GRID_W; cx++) {
+            StrokeCell *cell = &index->cells[cy][cx];
+            mem_free(MEM_INDEX, cell->ids, (size_t)cell->capacity * sizeof(int));
+        }
+    }
+    memset(index, 0, sizeof(StrokeIndex));
+}
+
+void stroke_index_clear(StrokeIndex *index) {
+    index->count = 0;
+    index->num_unbounded = 0;
+    for (int cy = 0; cy < STROKE_GRID_H; cy++) {
+        for (int cx = 0; cx < STROKE_GRID_W; cx++) {
+            index->cells[cy][cx].count = 0;
+        }
+    }
+    index->valid = 1;
+}
+
+// Assicura spazio per n interi in *buf
+static int stroke_reserve(int **buf, int *capacity, int n) {
+    if (n <= *capacity) return 0;
+    int cap = *capacity ? *capacity : STROKE_INITIAL_CAPACITY / 16;
+    while (cap < n) cap *= 2;
+    int *p = (int *)mem_realloc(MEM_INDEX, *buf, (size_t)*capacity * sizeof(int),
+                                (size_t)cap * sizeof(int));
+    if (!p) return -1;
+    *buf = p;
+    *capacity = cap;
+    return 0;
+}
+
+static int stroke_fail(StrokeIndex *index) {
+    index->valid = 0;
+    return -1;
+}
+
+int stroke_index_begin(StrokeIndex *index, int first_cmd) {
+    if (index->count >= index->capacity) {
+        int cap = index->capacity ? index->capacity * 2 : STROKE_INITIAL_CAPACITY;
+        StrokeObject *p = (StrokeObject *)mem_realloc(MEM_INDEX, index->objects,
+                                                      (size_t)index->capacity * sizeof(StrokeObject),
+                                                      (size_t)cap * sizeof(StrokeObject));
+        if (!p) return stroke_fail(index);
+        index->objects = p;
+        index->capacity = cap;
+    }
+
+    StrokeObject *obj = &index->objects[index->count++];
+    obj->first_cmd = first_cmd;
+    obj->erased_by = -1;
+    obj->min_x = INT16_MAX;
+    obj->min_y = INT16_MAX;
+    obj->max_x = INT16_MIN;
+    obj->max_y = INT16_MIN;
+    obj->flags = 0;
+    return index->count - 1;
+}
+
+static int stroke_clamp16(int v) {
+    if (v < INT16_MIN) return INT16_MIN;
+    if (v > INT16_MAX) return INT16_MAX;
+    return v;
+}
+
+int stroke_index_extend(StrokeIndex *index, int flags,
+                        int min_x, int min_y, int max_x, int max_y)
+{
+    if (index->count == 0) return -1;
+    int id = index->count - 1;
+    StrokeObject *obj = &index->objects[id];
+    obj->flags |= (uint8_t)flags;
+    if (min_x < obj->min_x) obj->min_x = (int16_t)stroke_clamp16(min_x);
+    if (min_y < obj->min_y) obj->min_y = (int16_t)stroke_clamp16(min_y);
+    if (max_x > obj->max_x) obj->max_x = (int16_t)stroke_clamp16(max_x);
+    if (max_y > obj->max_y) obj->max_y = (int16_t)stroke_clamp16(max_y);
+
+    // Celle del solo comando: per un tratto lungo molto più stretto del suo rettangolo
+    if (max_x < 0 || max_y < 0 || min_x >= SCREEN_W || min_y >= SCREEN_H) return 0;
+    int cx0 = (min_x < 0) ? 0 : min_x >> STROKE_CELL_SHIFT;
+    int cy0 = (min_y < 0) ? 0 : min_y >> STROKE_CELL_SHIFT;
+    int cx1 = (max_x >= SCREEN_W) ? STROKE_GRID_W - 1 : max_x >> STROKE_CELL_SHIFT;
+    int cy1 = (max_y >= SCREEN_H) ? STROKE_GRID_H - 1 : max_y >> STROKE_CELL_SHIFT;
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            StrokeCell *cell = &index->cells[cy][cx];
+            // L'oggetto è sempre l'ultimo arrivato: basta guardare la coda
+            if (cell->count > 0 && cell->ids[cell->count - 1] == id) continue;
+            if (stroke_reserve(&cell->ids, &cell->capacity, cell->count + 1) < 0) {
+                return stroke_fail(index);
+            }
+            cell->ids[cell->count++] = id;
+        }
+    }
+    return 0;
+}
+
+int stroke_index_extend_unbounded(StrokeIndex *index, int flags) {
+    if (index->count == 0) return -1;
+    int id = index->count - 1;
+    StrokeObject *obj = &index->objects[id];
+    obj->flags |= (uint8_t)(flags | STROKE_UNBOUNDED);
+    obj->min_x = 0;
+    obj->min_y = 0;
+    obj->max_x = SCREEN_W - 1;
+    obj->max_y = SCREEN_H - 1;
+
+    if (index->num_unbounded > 0 && index->unbounded[index->num_unbounded - 1] == id) return 0;
+    if (stroke_reserve(&index->unbounded, &index->unbounded_capacity,
+                       index->num_unbounded + 1) < 0) {
+        return stroke_fail(index);
+    }
+    index->unbounded[index->num_unbounded++] = id;
+    return 0;
+}
+
+void stroke_index_truncate(StrokeIndex *index, int cmd_count) {
+    int n = index->count;
+    while (n > 0 && index->objects[n - 1].first_cmd >= cmd_count) n--;
+    if (n == index->count) return;
+    index->count = n;
+
+    for (int cy = 0; cy < STROKE_GRID_H; cy++) {
+        for (int cx = 0; cx < STROKE_GRID_W; cx++) {
+            StrokeCell *cell = &index->cells[cy][cx];
+            while (cell->count > 0 && cell->ids[cell->count - 1] >= n) cell->count--;
+        }
+    }
+    while (index->num_unbounded > 0 && index->unbounded[index->num_unbounded - 1] >= n) {
+        index->num_unbounded--;
+    }
+    // Le cancellazioni scartate con la coda di redo tornano visibili
+    for (int i = 0; i < n; i++) {
+        if (index->objects[i].erased_by >= cmd_count) index->objects[i].erased_by = -1;
+    }
+}
+
+int stroke_index_find(const StrokeIndex *index, int cmd) {
+    int lo = 0, hi = index->count - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (index->objects[mid].first_cmd <= cmd) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+int stroke_index_last_unbounded(const StrokeIndex *index, int end) {
+    int lo = 0, hi = index->num_unbounded - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (index->objects[index->unbounded[mid]].first_cmd < end) {
+            found = index->unbounded[mid];
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+int stroke_index_hidden(const StrokeIndex *index, int obj, int end) {
+    int by = index->objects[obj].erased_by;
+    return by >= 0 && by < end;
+}
+
+static int stroke_cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+int stroke_index_query(StrokeIndex *index, int min_x, int min_y, int max_x, int max_y,
+                       const int **ids)
+{
+    *ids = index->query;
+    if (max_x < 0 || max_y < 0 || min_x >= SCREEN_W || min_y >= SCREEN_H ||
+        min_x > max_x || min_y > max_y) return 0;
+    int cx0 = (min_x < 0) ? 0 : min_x >> STROKE_CELL_SHIFT;
+    int cy0 = (min_y < 0) ? 0 : min_y >> STROKE_CELL_SHIFT;
+    int cx1 = (max_x >= SCREEN_W) ? STROKE_GRID_W - 1 : max_x >> STROKE_CELL_SHIFT;
+    int cy1 = (max_y >= SCREEN_H) ? STROKE_GRID_H - 1 : max_y >> STROKE_CELL_SHIFT;
+
+    int total = 0;
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) total += index->cells[cy][cx].count;
+    }
+    if (total == 0) return 0;
+    if (stroke_reserve(&index->query, &index->query_capacity, total) < 0) return -1;
+
+    int n = 0;
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            const StrokeCell *cell = &index->cells[cy][cx];
+            memcpy(&index->query[n], cell->ids, cell->count * sizeof(int));
+            n += cell->count;
+        }
+    }
+    // Una cella è già ordinata: serve solo fondere quelle diverse
+    if (cx0 != cx1 || cy0 != cy1) {
+        qsort(index->query, n, sizeof(int), stroke_cmp_int);
+        int m = 0;
+        for (int i = 0; i < n; i++) {
+            if (m == 0 || index->query[m - 1] != index->query[i]) index->query[m++] = index->query[i];
+        }
+        n = m;
+    }
+    *ids = index->query;
+    return n;
+}
@@ -0,0 +1,82 @@
+#ifndef STROKEINDEX_H
+#define STROKEINDEX_H
+
+#include <stdint.h>
+#include "canvas.h"
+
+// Griglia uniforme sulle operazioni del journal: ogni cella elenca, in
+// ordine di comando, gli oggetti (tratti, forme, filtri...) che la toccano
+#define STROKE_CELL_SHIFT  5
+#define STROKE_CELL        (1 << STROKE_CELL_SHIFT)
+#define STROKE_GRID_W      ((SCREEN_W + STROKE_CELL - 1) >> STROKE_CELL_SHIFT)
+#define STROKE_GRID_H      ((SCREEN_H + STROKE_CELL - 1) >> STROKE_CELL_SHIFT)
+
+// Flag di un oggetto, accumulati sui suoi comandi
+enum {
+    STROKE_FIXED     = 1,   // non si cancella come oggetto (filtri, clear, ...)
+    STROKE_NONLOCAL  = 2,   // legge pixel fuori da quelli che scrive
+    STROKE_UNBOUNDED = 4    // copre tutto il canvas
+};
+
+typedef struct {
+    int first_cmd;      // primo comando dell'operazione nel journal
+    int erased_by;      // comando JCMD_ERASE_OBJECT che lo nasconde, o -1
+    int16_t min_x, min_y, max_x, max_y;   // area a scala 1, estremi inclusi
+    uint8_t flags;
+} StrokeObject;
+
+typedef struct {
+    int *ids;
+    int count;
+    int capacity;
+} StrokeCell;
+
+typedef struct {
+    StrokeObject *objects;   // uno per operazione, in ordine
+    int count;
+    int capacity;
+
+    StrokeCell cells[STROKE_GRID_H][STROKE_GRID_W];
+
+    // Oggetti che coprono tutto il canvas, in ordine
+    int *unbounded;
+    int num_unbounded;
+    int unbounded_capacity;
+
+    // Risultato dell'ultima query
+    int *query;
+    int query_capacity;
+
+    int valid;          // 0 dopo un'allocazione fallita: niente gomma a oggetti
+} StrokeIndex;
+
+void stroke_index_init(StrokeIndex *index);
+void stroke_index_destroy(StrokeIndex *index);
+void stroke_index_clear(StrokeIndex *index);
+
+// Apre l'oggetto dell'operazione che inizia al comando first_cmd
+int  stroke_index_begin(StrokeIndex *index, int first_cmd);
+// Aggiunge all'ultimo oggetto un comando con l'area indicata
+int  stroke_index_extend(StrokeIndex *index, int flags,
+                         int min_x, int min_y, int max_x, int max_y);
+// Aggiunge all'ultimo oggetto un comando su tutto il canvas
+int  stroke_index_extend_unbounded(StrokeIndex *index, int flags);
+
+// Toglie gli oggetti dal comando cmd_count in poi (coda di redo scartata)
+void stroke_index_truncate(StrokeIndex *index, int cmd_count);
+
+// Oggetto che contiene il comando, o -1
+int  stroke_index_find(const StrokeIndex *index, int cmd);
+
+// Ultimo oggetto su tutto il canvas che inizia prima del comando end, o -1
+int  stroke_index_last_unbounded(const StrokeIndex *index, int end);
+
+// Oggetti (indici crescenti, senza doppioni) nelle celle del rettangolo.
+// Il risultato resta valido fino alla query successiva; -1 se manca memoria.
+int  stroke_index_query(StrokeIndex *index, int min_x, int min_y, int max_x, int max_y,
+                        const int **ids);
+
+// Oggetto nascosto dalla gomma nello stato dopo i comandi [0, end)?
+int  stroke_index_hidden(const StrokeIndex *index, int obj, int end);
+
+#endif
@@ -0,0 +1,83 @@
+#include "symmetry.h"
+#include <math.h>
+
+int symmetry_copies(SymmetryMode mode, int order) {
+    switch (mode) {
+        case SYMMETRY_MIRROR_H:
+        case SYMMETRY_MIRROR_V:
+            return 2;
+        case SYMMETRY_MIRROR_HV:
+            return 4;
+        case SYMMETRY_RADIAL:
+            if (order < SYMMETRY_ORDER_MIN) return 1;
+            return (order > SYMMETRY_MAX_COPIES) ? SYMMETRY_MAX_COPIES : order;
+        default:
+            return 1;
+    }
+}
+
+static void symmetry_set(SymmetryXform *t, int32_t xx, int32_t xy, int32_t yx, int32_t yy,
+                         int cx, int cy)
+{
+    t->xx = xx;
+    t->xy = xy;
+    t->yx = yx;
+    t->yy = yy;
+    t->cx = cx;
+    t->cy = cy;
+}
+
+int symmetry_xforms(SymmetryMode mode, int order, int cx, int cy, SymmetryXform *out) {
+    const int32_t one = 65536;
+    int n = symmetry_copies(mode, order);
+
+    symmetry_set(&out[0], one, 0, 0, one, cx, cy);
+    switch (mode) {
+        case SYMMETRY_MIRROR_H:
+            symmetry_set(&out[1], -one, 0, 0, one, cx, cy);
+            break;
+        case SYMMETRY_MIRROR_V:
+            symmetry_set(&out[1], one, 0, 0, -one, cx, cy);
+            break;
+        case SYMMETRY_MIRROR_HV:
+            symmetry_set(&out[1], -one, 0, 0, one, cx, cy);
+            symmetry_set(&out[2], one, 0, 0, -one, cx, cy);
+            symmetry_set(&out[3], -one, 0, 0, -one, cx, cy);
+            break;
+        case SYMMETRY_RADIAL:
+            for (int k = 1; k < n; k++) {
+                if (n % 2 == 0 && k >= n / 2) {
+                    const SymmetryXform *h = &out[k - n / 2];
+                    // Mezzo giro dopo: l'opposta esatta, così le due copie
+                    // sono simmetriche rispetto al centro pixel per pixel
+                    symmetry_set(&out[k], -h->xx, -h->xy, -h->yx, -h->yy, cx, cy);
+                    continue;
+                }
+                // Seno e coseno arrotondati a 16.16: tutto il resto è intero
+                double a = (double)k * 6.283185307179586 / n;
+                int32_t fcos = (int32_t)lround(cos(a) * 65536.0);
+                int32_t fsin = (int32_t)lround(sin(a) * 65536.0);
+                symmetry_set(&out[k], fcos, -fsin, fsin, fcos, cx, cy);
+            }
+            break;
+        default:
+            break;
+    }
+    return n;
+}
+
+// 16.16 -> intero, metà lontano da zero: una matrice opposta dà il punto
+// opposto anche sugli arrotondamenti
+static int symmetry_round(int64_t v) {
+    return (v >= 0) ? (int)((v + 32768) >> 16) : -(int)((32768 - v) >> 16);
+}
+
+void symmetry_map(const SymmetryXform *t, int x, int y, int *ox, int *oy) {
+    int64_t dx = x - t->cx, dy = y - t->cy;
+    *ox = t->cx + symmetry_round(t->xx * dx + t->xy * dy);
+    *oy = t->cy + symmetry_round(t->yx * dx + t->yy * dy);
+}
+
+int symmetry_keeps_axes(const SymmetryXform *t) {
+    return (t->xy == 0 && t->yx == 0) || (t->xx == 0 && t->yy == 0);
+}
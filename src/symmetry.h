@@ -0,0 +1,35 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <stdint.h>
+#include "canvas.h"
+
+/*
+ * Simmetria: ogni comando di disegno viene replicato in copie trasformate
+ * attorno a un centro (specchi sugli assi per il centro, o rotazioni di
+ * 360/N gradi). La prima copia è sempre l'originale. Coordinate intere:
+ * seno e coseno arrotondati a 16.16, come le trasformazioni della
+ * selezione, così il ridisegno dal journal dà gli stessi punti ovunque.
+ */
+
+// Copie al massimo (ordine della simmetria radiale)
+#define SYMMETRY_MAX_COPIES 16
+#define SYMMETRY_ORDER_MIN  2
+
+typedef struct {
+    int32_t xx, xy;     // riga x della matrice, 16.16
+    int32_t yx, yy;
+    int cx, cy;         // centro
+} SymmetryXform;
+
+// Copie della modalità, originale compreso (1 = nessuna simmetria)
+int  symmetry_copies(SymmetryMode mode, int order);
+// Trasformazioni delle copie attorno a (cx, cy); ritorna quante sono
+int  symmetry_xforms(SymmetryMode mode, int order, int cx, int cy, SymmetryXform *out);
+// Punto (x, y) della copia, arrotondato al pixel
+void symmetry_map(const SymmetryXform *t, int x, int y, int *ox, int *oy);
+// La copia manda rettangoli allineati agli assi in rettangoli allineati
+// (specchi e rotazioni di multipli di 90 gradi)
+int  symmetry_keeps_axes(const SymmetryXform *t);
+
+#endif
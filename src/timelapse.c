@@ -0,0 +1,663 @@
+#include "timelapse.h"
+#include "project.h"
+#include "export.h"
+#include "platform.h"
+#include "membudget.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <png.h>
+
+#define TIMELAPSE_TILE_BYTES (TIMELAPSE_TILE_SIZE * TIMELAPSE_TILE_SIZE * sizeof(unsigned int))
+#define TIMELAPSE_NUM_TILES  (JOURNAL_DAMAGE_COLS * JOURNAL_DAMAGE_ROWS)
+
+// Come i checkpoint: la compressione gira durante il disegno
+#define TIMELAPSE_ZLIB_LEVEL 1
+
+static uint32_t timelapse_checksum(const TimelapseFrame *frame) {
+    // FNV-1a su tutto l'header del frame tranne il campo check
+    const uint8_t *p = (const uint8_t *)frame;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(TimelapseFrame, check); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static void timelapse_tile_rect(int width, int height, int tiles_x, int tile,
+                                int *x, int *y, int *w, int *h)
+{
+    *x = (tile % tiles_x) * TIMELAPSE_TILE_SIZE;
+    *y = (tile / tiles_x) * TIMELAPSE_TILE_SIZE;
+    *w = (*x + TIMELAPSE_TILE_SIZE <= width)  ? TIMELAPSE_TILE_SIZE : width - *x;
+    *h = (*y + TIMELAPSE_TILE_SIZE <= height) ? TIMELAPSE_TILE_SIZE : height - *y;
+}
+
+// Dati di un frame con tutti i tile cambiati, nel caso peggiore
+static size_t timelapse_frame_bound(int num_tiles) {
+    return (size_t)num_tiles * (sizeof(TimelapseTile) + compressBound(TIMELAPSE_TILE_BYTES));
+}
+
+/* ===== Lettura ===== */
+
+int timelapse_open(TimelapseReader *reader, const char *path) {
+    memset(reader, 0, sizeof(TimelapseReader));
+    reader->file = fopen(path, "rb");
+    if (!reader->file) return -1;
+
+    TimelapseHeader *h = &reader->header;
+    if (fread(h, sizeof(TimelapseHeader), 1, reader->file) != 1 ||
+        h->magic != TIMELAPSE_MAGIC || h->version != TIMELAPSE_VERSION ||
+        h->tile_size != TIMELAPSE_TILE_SIZE || h->width == 0 || h->height == 0 ||
+        h->width > 4096 || h->height > 4096) {
+        timelapse_close(reader);
+        return -2;
+    }
+    reader->tiles_x = (h->width + TIMELAPSE_TILE_SIZE - 1) / TIMELAPSE_TILE_SIZE;
+    reader->tiles_y = (h->height + TIMELAPSE_TILE_SIZE - 1) / TIMELAPSE_TILE_SIZE;
+
+    if (fseek(reader->file, 0, SEEK_END) != 0) {
+        timelapse_close(reader);
+        return -2;
+    }
+    reader->file_size = ftell(reader->file);
+    reader->offset = sizeof(TimelapseHeader);
+    fseek(reader->file, reader->offset, SEEK_SET);
+
+    // Dati del frame più un tile decompresso
+    reader->scratch_size = timelapse_frame_bound(reader->tiles_x * reader->tiles_y);
+    reader->scratch = (unsigned char *)malloc(reader->scratch_size + TIMELAPSE_TILE_BYTES);
+    if (!reader->scratch) {
+        timelapse_close(reader);
+        return -2;
+    }
+    return 0;
+}
+
+void timelapse_close(TimelapseReader *reader) {
+    if (reader->file) fclose(reader->file);
+    free(reader->scratch);
+    memset(reader, 0, sizeof(TimelapseReader));
+}
+
+static int timelapse_decode_tile(TimelapseReader *reader, const TimelapseTile *entry,
+                                 const unsigned char *data, unsigned int *pixels)
+{
+    int width = (int)reader->header.width;
+    int tx, ty, tw, th;
+    timelapse_tile_rect(width, (int)reader->header.height, reader->tiles_x,
+                        (int)entry->tile, &tx, &ty, &tw, &th);
+    size_t row_bytes = (size_t)tw * sizeof(unsigned int);
+    uLong raw_size = (uLong)(row_bytes * th);
+
+    if (entry->flags == PROJECT_TILE_SOLID) {
+        for (int y = 0; y < th; y++) {
+            unsigned int *dst = &pixels[(ty + y) * width + tx];
+            for (int x = 0; x < tw; x++) dst[x] = entry->color;
+        }
+        return 0;
+    }
+    if (entry->flags == PROJECT_TILE_ZLIB) {
+        unsigned char *tile = reader->scratch + reader->scratch_size;
+        uLongf len = raw_size;
+        if (uncompress(tile, &len, data, entry->size) != Z_OK || len != raw_size) return -1;
+        data = tile;
+    } else if (entry->flags != PROJECT_TILE_RAW || entry->size != raw_size) {
+        return -1;
+    }
+    for (int y = 0; y < th; y++) {
+        memcpy(&pixels[(ty + y) * width + tx], data + y * row_bytes, row_bytes);
+    }
+    return 0;
+}
+
+int timelapse_read_frame(TimelapseReader *reader, unsigned int *pixels) {
+    TimelapseFrame frame;
+    int num_tiles = reader->tiles_x * reader->tiles_y;
+    if (reader->offset + (long)sizeof(frame) > reader->file_size ||
+        fread(&frame, sizeof(frame), 1, reader->file) != 1) return 0;
+
+    // Header rovinato o dati oltre la fine: frame troncato da un crash
+    if (frame.check != timelapse_checksum(&frame) || frame.num_tiles > (uint32_t)num_tiles ||
+        frame.bytes > reader->scratch_size ||
+        reader->offset + (long)sizeof(frame) + (long)frame.bytes > reader->file_size) return 0;
+    if (frame.bytes > 0 && fread(reader->scratch, frame.bytes, 1, reader->file) != 1) return 0;
+
+    size_t pos = 0;
+    for (uint32_t i = 0; i < frame.num_tiles; i++) {
+        TimelapseTile entry;
+        if (pos + sizeof(entry) > frame.bytes) return -1;
+        memcpy(&entry, reader->scratch + pos, sizeof(entry));
+        pos += sizeof(entry);
+        if (entry.tile >= (uint32_t)num_tiles || entry.size > frame.bytes - pos) return -1;
+        if (timelapse_decode_tile(reader, &entry, reader->scratch + pos, pixels) != 0) return -1;
+        pos += entry.size;
+    }
+
+    reader->offset += (long)(sizeof(frame) + frame.bytes);
+    reader->time_ms = frame.time_ms;
+    reader->frames++;
+    return 1;
+}
+
+/* ===== Registrazione ===== */
+
+// Ricostruisce l'ultimo frame del file e si posiziona dopo di esso; un file
+// mancante o di un'altra risoluzione riparte da zero. Gira sul thread di I/O.
+static void timelapse_open_file(Timelapse *tl) {
+    // Le pagine dei buffer si toccano qui, non alla prima cattura
+    size_t bytes = (size_t)SCREEN_W * SCREEN_H * sizeof(unsigned int);
+    memset(tl->stage, 0, bytes);
+    memset(tl->prev, 0, bytes);
+
+    TimelapseReader reader;
+    long end = 0;
+    uint32_t base_ms = 0;
+    if (timelapse_open(&reader, tl->path) == 0) {
+        if (reader.header.width == SCREEN_W && reader.header.height == SCREEN_H) {
+            while (timelapse_read_frame(&reader, tl->prev) == 1) {}
+            end = reader.offset;
+            tl->prev_valid = reader.frames > 0;
+            if (reader.frames > 0) base_ms = reader.time_ms + reader.header.interval_ms;
+        }
+        timelapse_close(&reader);
+    }
+
+    int fd;
+    if (end > 0) {
+        // Un frame troncato in coda viene sovrascritto
+        fd = open(tl->path, O_WRONLY);
+        if (fd >= 0 && lseek(fd, end, SEEK_SET) != end) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        fd = open(tl->path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        TimelapseHeader header;
+        header.magic = TIMELAPSE_MAGIC;
+        header.version = TIMELAPSE_VERSION;
+        header.width = SCREEN_W;
+        header.height = SCREEN_H;
+        header.tile_size = TIMELAPSE_TILE_SIZE;
+        header.interval_ms = TIMELAPSE_INTERVAL_US / 1000;
+        if (fd >= 0 && write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+            close(fd);
+            fd = -1;
+        }
+        end = sizeof(header);
+        tl->prev_valid = 0;
+    }
+
+    pthread_mutex_lock(&tl->lock);
+    tl->fd = fd;
+    tl->bytes = end;
+    tl->base_ms = base_ms;
+    tl->full = (fd < 0);
+    pthread_mutex_unlock(&tl->lock);
+}
+
+// Comprime i tile di stage diversi dal frame precedente e li accoda al file
+static void timelapse_write_frame(Timelapse *tl) {
+    size_t bound = timelapse_frame_bound(TIMELAPSE_NUM_TILES);
+    unsigned char *out = tl->frame_buf + sizeof(TimelapseFrame);
+    unsigned int *tile = (unsigned int *)(tl->frame_buf + ((sizeof(TimelapseFrame) + bound + 15) & ~(size_t)15));
+    size_t pos = 0;
+    int count = 0;
+
+    for (int i = 0; i < TIMELAPSE_NUM_TILES; i++) {
+        if (!((tl->stage_damage[i / JOURNAL_DAMAGE_COLS] >> (i % JOURNAL_DAMAGE_COLS)) & 1)) continue;
+
+        int tx, ty, tw, th;
+        timelapse_tile_rect(SCREEN_W, SCREEN_H, JOURNAL_DAMAGE_COLS, i, &tx, &ty, &tw, &th);
+        size_t row_bytes = (size_t)tw * sizeof(unsigned int);
+
+        // Il danno del journal è per eccesso: i tile uguali non si scrivono
+        int same = tl->prev_valid;
+        for (int y = 0; same && y < th; y++) {
+            size_t o = (size_t)(ty + y) * SCREEN_W + tx;
+            same = memcmp(&tl->stage[o], &tl->prev[o], row_bytes) == 0;
+        }
+        if (same) continue;
+
+        int solid = 1;
+        unsigned int first = tl->stage[ty * SCREEN_W + tx];
+        for (int y = 0; y < th; y++) {
+            size_t o = (size_t)(ty + y) * SCREEN_W + tx;
+            memcpy(&tl->prev[o], &tl->stage[o], row_bytes);
+            memcpy(&tile[y * tw], &tl->stage[o], row_bytes);
+            for (int x = 0; solid && x < tw; x++) {
+                if (tl->stage[o + x] != first) solid = 0;
+            }
+        }
+
+        TimelapseTile entry;
+        entry.tile = (uint32_t)i;
+        entry.color = 0;
+        unsigned char *data = out + pos + sizeof(entry);
+        if (solid) {
+            entry.flags = PROJECT_TILE_SOLID;
+            entry.size = 0;
+            entry.color = first;
+        } else {
+            uLong raw_size = (uLong)(row_bytes * th);
+            uLongf zlen = compressBound(TIMELAPSE_TILE_BYTES);
+            if (compress2(data, &zlen, (const Bytef *)tile, raw_size, TIMELAPSE_ZLIB_LEVEL) == Z_OK &&
+                zlen < raw_size) {
+                entry.flags = PROJECT_TILE_ZLIB;
+                entry.size = (uint32_t)zlen;
+            } else {
+                entry.flags = PROJECT_TILE_RAW;
+                entry.size = (uint32_t)raw_size;
+                memcpy(data, tile, raw_size);
+            }
+        }
+        memcpy(out + pos, &entry, sizeof(entry));
+        pos += sizeof(entry) + entry.size;
+        count++;
+    }
+    tl->prev_valid = 1;
+    if (count == 0) return;
+
+    TimelapseFrame frame;
+    frame.time_ms = tl->stage_time_ms;
+    frame.num_tiles = (uint32_t)count;
+    frame.bytes = (uint32_t)pos;
+    frame.check = timelapse_checksum(&frame);
+    memcpy(tl->frame_buf, &frame, sizeof(frame));
+
+    // Il budget è un limite rigido: il frame che lo supererebbe non si scrive
+    size_t total = sizeof(frame) + pos;
+    int written = tl->bytes + (long)total <= TIMELAPSE_BUDGET_BYTES &&
+                  write(tl->fd, tl->frame_buf, total) == (ssize_t)total;
+
+    pthread_mutex_lock(&tl->lock);
+    if (written) {
+        tl->bytes += (long)total;
+        tl->frames++;
+        tl->tiles_written += count;
+    } else {
+        tl->full = 1;
+    }
+    pthread_mutex_unlock(&tl->lock);
+}
+
+static void *timelapse_thread(void *arg) {
+    Timelapse *tl = (Timelapse *)arg;
+    timelapse_open_file(tl);
+
+    pthread_mutex_lock(&tl->lock);
+    tl->stage_pending = 0;
+    for (;;) {
+        while (!tl->stop && !tl->stage_pending) {
+            pthread_cond_wait(&tl->cond, &tl->lock);
+        }
+        if (!tl->stage_pending) break;
+        pthread_mutex_unlock(&tl->lock);
+
+        if (!tl->full) timelapse_write_frame(tl);
+
+        pthread_mutex_lock(&tl->lock);
+        tl->stage_pending = 0;
+    }
+    pthread_mutex_unlock(&tl->lock);
+    return NULL;
+}
+
+// Frame compresso, poi (allineato) il tile in compressione
+static size_t timelapse_frame_buf_bytes(void) {
+    return sizeof(TimelapseFrame) + timelapse_frame_bound(TIMELAPSE_NUM_TILES) + 16 +
+           TIMELAPSE_TILE_BYTES;
+}
+
+static void timelapse_free_buffers(Timelapse *tl) {
+    size_t bytes = (size_t)SCREEN_W * SCREEN_H * sizeof(unsigned int);
+    if (tl->stage) mem_buffer_put(MEM_TIMELAPSE, tl->stage, bytes);
+    if (tl->prev) mem_buffer_put(MEM_TIMELAPSE, tl->prev, bytes);
+    mem_free(MEM_TIMELAPSE, tl->frame_buf, timelapse_frame_buf_bytes());
+    tl->stage = NULL;
+    tl->prev = NULL;
+    tl->frame_buf = NULL;
+}
+
+int timelapse_start(Timelapse *tl, const char *path) {
+    memset(tl, 0, sizeof(Timelapse));
+    tl->fd = -1;
+    snprintf(tl->path, sizeof(tl->path), "%s", path);
+
+    size_t bytes = (size_t)SCREEN_W * SCREEN_H * sizeof(unsigned int);
+    tl->stage = mem_buffer_get(MEM_TIMELAPSE, bytes);
+    tl->prev = mem_buffer_get(MEM_TIMELAPSE, bytes);
+    tl->frame_buf = (unsigned char *)mem_alloc(MEM_TIMELAPSE, timelapse_frame_buf_bytes());
+    if (!tl->stage || !tl->prev || !tl->frame_buf) goto fail;
+
+    // Occupato finché il thread non ha riaperto il file
+    tl->stage_pending = 1;
+    tl->need_full = 1;
+    tl->start_us = platform_time_us();
+    tl->next_us = tl->start_us;
+
+    pthread_mutex_init(&tl->lock, NULL);
+    pthread_cond_init(&tl->cond, NULL);
+    if (pthread_create(&tl->thread, NULL, timelapse_thread, tl) != 0) {
+        pthread_mutex_destroy(&tl->lock);
+        pthread_cond_destroy(&tl->cond);
+        goto fail;
+    }
+    tl->running = 1;
+    return 0;
+
+fail:
+    timelapse_free_buffers(tl);
+    return -1;
+}
+
+// Con paced = 0 (cattura finale) si può spendere anche la riserva
+static int timelapse_capture_paced(Timelapse *tl, Journal *journal, const Canvas *canvas,
+                                   uint32_t time_ms, int paced)
+{
+    pthread_mutex_lock(&tl->lock);
+    int busy = tl->stage_pending;
+    int full = tl->full;
+    long bytes = tl->bytes;
+    uint32_t rec_ms = tl->base_ms + time_ms;
+    pthread_mutex_unlock(&tl->lock);
+
+    if (full) return 0;
+    if (busy) {
+        tl->skipped_busy++;
+        return -1;
+    }
+
+    // Al tempo t si può aver scritto la riserva più la quota di t: in anticipo
+    // si salta il tick e i tile cambiati restano nel journal per il prossimo.
+    // Una seconda riserva resta sempre per la cattura finale.
+    long allowed = TIMELAPSE_BUDGET_BYTES - TIMELAPSE_BURST_BYTES;
+    if (rec_ms < TIMELAPSE_BUDGET_MS) {
+        allowed = TIMELAPSE_BURST_BYTES +
+                  (long)((int64_t)(TIMELAPSE_BUDGET_BYTES - 2 * TIMELAPSE_BURST_BYTES) *
+                         rec_ms / TIMELAPSE_BUDGET_MS);
+    }
+    if (paced && bytes > allowed) {
+        tl->skipped_budget++;
+        return 0;
+    }
+
+    uint32_t damage[JOURNAL_DAMAGE_ROWS];
+    uint32_t any = 0;
+    journal_take_damage(journal, damage);
+    for (int r = 0; r < JOURNAL_DAMAGE_ROWS; r++) {
+        if (tl->need_full) damage[r] = (1u << JOURNAL_DAMAGE_COLS) - 1;
+        any |= damage[r];
+    }
+    tl->need_full = 0;
+    if (!any) return 0;
+
+    // Solo i tile cambiati, una copia per ogni serie di tile adiacenti
+    uint64_t start = platform_time_us();
+    for (int r = 0; r < JOURNAL_DAMAGE_ROWS; r++) {
+        int y0 = r * TIMELAPSE_TILE_SIZE;
+        int rows = (y0 + TIMELAPSE_TILE_SIZE <= canvas->height) ? TIMELAPSE_TILE_SIZE
+                                                                : canvas->height - y0;
+        for (int c = 0; c < JOURNAL_DAMAGE_COLS; c++) {
+            if (!((damage[r] >> c) & 1)) continue;
+            int c1 = c;
+            while (c1 + 1 < JOURNAL_DAMAGE_COLS && ((damage[r] >> (c1 + 1)) & 1)) c1++;
+            int x0 = c * TIMELAPSE_TILE_SIZE;
+            int x1 = (c1 + 1) * TIMELAPSE_TILE_SIZE;
+            if (x1 > canvas->width) x1 = canvas->width;
+            for (int y = y0; y < y0 + rows; y++) {
+                memcpy(&tl->stage[y * SCREEN_W + x0], &canvas->pixels[y * canvas->width + x0],
+                       (size_t)(x1 - x0) * sizeof(unsigned int));
+            }
+            c = c1;
+        }
+    }
+    uint64_t dt = platform_time_us() - start;
+    if (dt > tl->max_copy_us) tl->max_copy_us = dt;
+
+    memcpy(tl->stage_damage, damage, sizeof(damage));
+    // Tempi non decrescenti anche se il chiamante usa un altro orologio
+    if (rec_ms > tl->stage_time_ms) tl->stage_time_ms = rec_ms;
+
+    pthread_mutex_lock(&tl->lock);
+    tl->stage_pending = 1;
+    pthread_cond_signal(&tl->cond);
+    pthread_mutex_unlock(&tl->lock);
+    return 1;
+}
+
+int timelapse_capture(Timelapse *tl, Journal *journal, const Canvas *canvas, uint32_t time_ms) {
+    return timelapse_capture_paced(tl, journal, canvas, time_ms, 1);
+}
+
+void timelapse_update(Timelapse *tl, Journal *journal, const Canvas *canvas) {
+    if (!tl->running) return;
+    uint64_t now = platform_time_us();
+    if (now < tl->next_us) return;
+
+    // Thread ancora occupato: si riprova al frame dopo, senza aspettare
+    if (timelapse_capture(tl, journal, canvas, (uint32_t)((now - tl->start_us) / 1000)) < 0) return;
+    tl->next_us = now + TIMELAPSE_INTERVAL_US;
+}
+
+void timelapse_flush(Timelapse *tl) {
+    if (!tl->running) return;
+    for (;;) {
+        pthread_mutex_lock(&tl->lock);
+        int busy = tl->stage_pending;
+        pthread_mutex_unlock(&tl->lock);
+        if (!busy) break;
+        platform_sleep_us(1000);
+    }
+}
+
+void timelapse_stop(Timelapse *tl, Journal *journal, const Canvas *canvas) {
+    if (!tl->running) return;
+
+    // L'ultimo stato del disegno, budget permettendo
+    if (journal) {
+        timelapse_flush(tl);
+        timelapse_capture_paced(tl, journal, canvas,
+                                (uint32_t)((platform_time_us() - tl->start_us) / 1000), 0);
+    }
+
+    pthread_mutex_lock(&tl->lock);
+    tl->stop = 1;
+    pthread_cond_signal(&tl->cond);
+    pthread_mutex_unlock(&tl->lock);
+    pthread_join(tl->thread, NULL);
+
+    pthread_mutex_destroy(&tl->lock);
+    pthread_cond_destroy(&tl->cond);
+    if (tl->fd >= 0) close(tl->fd);
+    timelapse_free_buffers(tl);
+    tl->fd = -1;
+    tl->running = 0;
+}
+
+/* ===== Export ===== */
+
+typedef struct {
+    TimelapseFormat format;
+    const char *out;
+    int width;
+    int height;
+    int first;              // numero del primo frame del batch
+    unsigned int **frames;  // frame ricostruiti del batch
+    unsigned char **yuv;
+    int *failed;
+} TimelapseExportJob;
+
+static int timelapse_write_png(const char *path, const unsigned int *pixels, int w, int h) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png ? png_create_info_struct(png) : NULL;
+    int ok = info != NULL;
+
+    if (ok && setjmp(png_jmpbuf(png))) {
+        ok = 0;
+    } else if (ok) {
+        png_init_io(png, f);
+        png_set_compression_level(png, EXPORT_PNG_LEVEL);
+        // Solo il filtro SUB: sui disegni il file viene anche più piccolo e
+        // la scelta adattiva per riga costava metà del tempo di codifica
+        png_set_filter(png, 0, PNG_FILTER_SUB);
+        png_set_IHDR(png, info, w, h, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+                     PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        png_write_info(png, info);
+        for (int y = 0; y < h; y++) {
+            png_write_row(png, (png_const_bytep)&pixels[y * w]);
+        }
+        png_write_end(png, NULL);
+    }
+
+    if (png) png_destroy_write_struct(&png, info ? &info : NULL);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) remove(path);
+    return ok ? 0 : -1;
+}
+
+// RGB -> Y'CbCr BT.601 a range limitato, crominanza media di ogni 2x2
+static void timelapse_yuv420(const unsigned int *pixels, int w, int h, unsigned char *out) {
+    int cw = (w + 1) / 2, ch = (h + 1) / 2;
+    unsigned char *py = out;
+    unsigned char *pu = out + (size_t)w * h;
+    unsigned char *pv = pu + (size_t)cw * ch;
+
+    for (int y = 0; y < h; y++) {
+        const unsigned int *row = &pixels[y * w];
+        for (int x = 0; x < w; x++) {
+            int r = row[x] & 0xFF, g = (row[x] >> 8) & 0xFF, b = (row[x] >> 16) & 0xFF;
+            py[y * w + x] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+    }
+    for (int cy = 0; cy < ch; cy++) {
+        int y0 = cy * 2, y1 = (y0 + 1 < h) ? y0 + 1 : y0;
+        for (int cx = 0; cx < cw; cx++) {
+            int x0 = cx * 2, x1 = (x0 + 1 < w) ? x0 + 1 : x0;
+            unsigned int q[4] = { pixels[y0 * w + x0], pixels[y0 * w + x1],
+                                  pixels[y1 * w + x0], pixels[y1 * w + x1] };
+            int r = 0, g = 0, b = 0;
+            for (int k = 0; k < 4; k++) {
+                r += q[k] & 0xFF;
+                g += (q[k] >> 8) & 0xFF;
+                b += (q[k] >> 16) & 0xFF;
+            }
+            r = (r + 2) >> 2;
+            g = (g + 2) >> 2;
+            b = (b + 2) >> 2;
+            // +32768 tiene positivo lo shift; si toglie con il 128 finale
+            pu[cy * cw + cx] = (unsigned char)((-38 * r - 74 * g + 112 * b + 32768 + 128) >> 8);
+            pv[cy * cw + cx] = (unsigned char)((112 * r - 94 * g - 18 * b + 32768 + 128) >> 8);
+        }
+    }
+}
+
+static void timelapse_export_task(void *ctx, int index, int worker) {
+    (void)worker;
+    TimelapseExportJob *job = (TimelapseExportJob *)ctx;
+    if (job->format == TIMELAPSE_PNG) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s_%05d.png", job->out, job->first + index);
+        job->failed[index] = timelapse_write_png(path, job->frames[index],
+                                                 job->width, job->height) != 0;
+    } else {
+        timelapse_yuv420(job->frames[index], job->width, job->height, job->yuv[index]);
+        job->failed[index] = 0;
+    }
+}
+
+int timelapse_export(const char *path, const char *out, TimelapseFormat format,
+                     int fps, WorkPool *pool, TimelapseStats *stats)
+{
+    if (format < 0 || format >= TIMELAPSE_FORMAT_COUNT || fps < 1) return -1;
+    uint64_t start = platform_time_us();
+
+    TimelapseReader reader;
+    if (timelapse_open(&reader, path) != 0) return -1;
+
+    TimelapseExportJob job;
+    memset(&job, 0, sizeof(job));
+    job.format = format;
+    job.out = out;
+    job.width = (int)reader.header.width;
+    job.height = (int)reader.header.height;
+
+    int workers = pool ? workpool_size(pool) : 1;
+    int batch = workers * TIMELAPSE_EXPORT_BATCH;
+    size_t frame_bytes = (size_t)job.width * job.height * sizeof(unsigned int);
+    size_t yuv_bytes = (size_t)job.width * job.height +
+                       2 * (size_t)((job.width + 1) / 2) * ((job.height + 1) / 2);
+
+    // Stato ricostruito frame dopo frame, copiato nel batch dei worker
+    unsigned int *cur = (unsigned int *)calloc(1, frame_bytes);
+    job.frames = (unsigned int **)calloc(batch, sizeof(unsigned int *));
+    job.yuv = (unsigned char **)calloc(batch, sizeof(unsigned char *));
+    job.failed = (int *)calloc(batch, sizeof(int));
+    int ok = cur && job.frames && job.yuv && job.failed;
+    for (int i = 0; ok && i < batch; i++) {
+        job.frames[i] = (unsigned int *)malloc(frame_bytes);
+        if (format == TIMELAPSE_Y4M) job.yuv[i] = (unsigned char *)malloc(yuv_bytes);
+        ok = job.frames[i] && (format != TIMELAPSE_Y4M || job.yuv[i]);
+    }
+
+    FILE *video = NULL;
+    if (ok && format == TIMELAPSE_Y4M) {
+        video = fopen(out, "wb");
+        ok = video && fprintf(video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+                              job.width, job.height, fps) > 0;
+    }
+
+    int total = 0;
+    int ret = 1;
+    while (ok && ret == 1) {
+        int n = 0;
+        while (n < batch && (ret = timelapse_read_frame(&reader, cur)) == 1) {
+            memcpy(job.frames[n++], cur, frame_bytes);
+        }
+        if (n == 0) break;
+
+        job.first = total;
+        if (pool) {
+            workpool_run(pool, n, timelapse_export_task, &job);
+        } else {
+            for (int i = 0; i < n; i++) timelapse_export_task(&job, i, 0);
+        }
+        // Il video si scrive in ordine, dopo la conversione del batch
+        for (int i = 0; i < n && ok; i++) {
+            ok = !job.failed[i];
+            if (ok && video) {
+                ok = fwrite("FRAME\n", 6, 1, video) == 1 &&
+                     fwrite(job.yuv[i], yuv_bytes, 1, video) == 1;
+            }
+        }
+        total += n;
+    }
+    // Un frame corrotto a metà file chiude il video come un crash
+    if (total == 0) ok = 0;
+
+    if (video && fclose(video) != 0) ok = 0;
+    if (!ok && video) remove(out);
+
+    for (int i = 0; i < batch; i++) {
+        if (job.frames) free(job.frames[i]);
+        if (job.yuv) free(job.yuv[i]);
+    }
+    free(job.frames);
+    free(job.yuv);
+    free(job.failed);
+    free(cur);
+    timelapse_close(&reader);
+
+    if (stats) {
+        stats->seconds = (double)(platform_time_us() - start) / 1000000.0;
+        stats->frames = total;
+        stats->workers = workers;
+    }
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,159 @@
+#ifndef TIMELAPSE_H
+#define TIMELAPSE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "canvas.h"
+#include "journal.h"
+#include "workpool.h"
+
+/*
+ * Registrazione del timelapse, un file che cresce in append:
+ *
+ *   TimelapseHeader
+ *   per ogni frame: TimelapseFrame, poi num_tiles volte TimelapseTile + dati
+ *
+ * Un frame contiene solo i tile cambiati dal frame precedente, compressi
+ * come nei progetti (PROJECT_TILE_*). Le sessioni successive continuano lo
+ * stesso file; un frame troncato da un crash viene scartato e sovrascritto.
+ */
+
+#define TIMELAPSE_MAGIC     0x54575244u  // "DRWT"
+#define TIMELAPSE_VERSION   1
+#define TIMELAPSE_TILE_SIZE JOURNAL_DAMAGE_TILE
+
+// Un frame al secondo, solo se il disegno è cambiato
+#define TIMELAPSE_INTERVAL_US  1000000
+// Spazio per un'ora di registrazione: oltre, la registrazione si ferma.
+// Durante l'ora si spende al più in proporzione al tempo trascorso, più una
+// riserva per il primo frame; i tick in anticipo slittano. Un'altra riserva
+// resta per la cattura finale di timelapse_stop.
+#define TIMELAPSE_BUDGET_BYTES (48L * 1024 * 1024)
+#define TIMELAPSE_BUDGET_MS    (3600L * 1000)
+#define TIMELAPSE_BURST_BYTES  (4L * 1024 * 1024)
+
+// Frame al secondo del video esportato
+#define TIMELAPSE_EXPORT_FPS   30
+// Frame in volo per worker durante l'export (2 MB ciascuno)
+#define TIMELAPSE_EXPORT_BATCH 2
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_size;
+    uint32_t interval_ms;
+} TimelapseHeader;
+
+typedef struct {
+    uint32_t time_ms;    // tempo di registrazione, sommato fra le sessioni
+    uint32_t num_tiles;
+    uint32_t bytes;      // TimelapseTile e dati che seguono
+    uint32_t check;      // checksum dei campi precedenti
+} TimelapseFrame;
+
+typedef struct {
+    uint32_t tile;
+    uint32_t flags;      // PROJECT_TILE_*
+    uint32_t size;
+    uint32_t color;      // solo per PROJECT_TILE_SOLID
+} TimelapseTile;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int running;
+    int stop;
+
+    // Tile cambiati copiati dal thread di frame, nelle loro posizioni
+    unsigned int *stage;
+    uint32_t stage_damage[JOURNAL_DAMAGE_ROWS];
+    uint32_t stage_time_ms;
+    int stage_pending;   // il thread di I/O sta usando stage
+    int need_full;       // la prossima cattura copia tutti i tile
+
+    // Stato del thread di I/O: l'ultimo frame registrato
+    unsigned int *prev;
+    int prev_valid;
+    unsigned char *frame_buf;
+    int fd;
+    long bytes;          // dimensione del file
+    uint32_t base_ms;    // tempo registrato nelle sessioni precedenti
+    int full;            // budget esaurito (o errore di scrittura)
+
+    uint64_t start_us;
+    uint64_t next_us;
+    char path[256];
+
+    // Statistiche
+    unsigned int frames;
+    unsigned int tiles_written;
+    unsigned int skipped_busy;    // tick rimandati: frame precedente in scrittura
+    unsigned int skipped_budget;  // tick rimandati per restare nel budget
+    uint64_t max_copy_us;         // copia più lunga sul thread di frame
+} Timelapse;
+
+typedef struct {
+    FILE *file;
+    TimelapseHeader header;
+    int tiles_x;
+    int tiles_y;
+    long file_size;
+    long offset;         // fine dell'ultimo frame letto per intero
+    uint32_t time_ms;    // tempo dell'ultimo frame letto
+    int frames;
+    unsigned char *scratch;
+    size_t scratch_size;
+} TimelapseReader;
+
+typedef enum {
+    TIMELAPSE_PNG,       // sequenza out_00000.png, out_00001.png, ...
+    TIMELAPSE_Y4M,       // video YUV 4:2:0 non compresso
+    TIMELAPSE_FORMAT_COUNT
+} TimelapseFormat;
+
+typedef struct {
+    double seconds;
+    int frames;
+    int workers;
+} TimelapseStats;
+
+// Apre (o continua) la registrazione in path. Il thread di I/O ricostruisce
+// l'ultimo frame del file prima di accettare catture.
+int  timelapse_start(Timelapse *tl, const char *path);
+
+// Da chiamare una volta per frame: allo scadere dell'intervallo copia i soli
+// tile cambiati e li passa al thread di I/O. Non aspetta mai: se il frame
+// precedente è ancora in scrittura riprova al frame dopo.
+void timelapse_update(Timelapse *tl, Journal *journal, const Canvas *canvas);
+
+// Cattura subito, con time_ms di registrazione dall'inizio della sessione.
+// Ritorna 1 se ha passato un frame al thread, 0 se non c'era nulla da
+// catturare (o il budget non lo consente), -1 se il thread è occupato.
+int  timelapse_capture(Timelapse *tl, Journal *journal, const Canvas *canvas,
+                       uint32_t time_ms);
+
+// Aspetta che il thread di I/O abbia scritto il frame in corso
+void timelapse_flush(Timelapse *tl);
+
+// Cattura finale, poi chiude il thread e il file
+void timelapse_stop(Timelapse *tl, Journal *journal, const Canvas *canvas);
+
+// Lettura frame per frame. timelapse_open ritorna -1 se il file manca,
+// -2 se non è un timelapse.
+int  timelapse_open(TimelapseReader *reader, const char *path);
+void timelapse_close(TimelapseReader *reader);
+// Applica a pixels (width x height dell'header) il frame successivo.
+// Ritorna 1, 0 a fine file (o su un frame troncato), -1 se i dati sono corrotti.
+int  timelapse_read_frame(TimelapseReader *reader, unsigned int *pixels);
+
+// Esporta tutti i frame: i delta si decodificano in sequenza, la codifica
+// (PNG o conversione in YUV) gira sui worker. Per TIMELAPSE_PNG out è il
+// prefisso dei file e fps non conta. pool e stats possono essere NULL.
+int  timelapse_export(const char *path, const char *out, TimelapseFormat format,
+                      int fps, WorkPool *pool, TimelapseStats *stats);
+
+#endif
@@ -1,4 +1,6 @@
 #include "ui.h"
+#include "membudget.h"
+#include "symmetry.h"
 #include <vita2d.h>
 #include <string.h>
 #include <stdio.h>
@@ -9,13 +11,33 @@ static vita2d_pgf *font = NULL;
 
 static const char *tool_names[TOOL_COUNT] = {
     "Pencil", "Eraser", "Line", "Rect",
-    "Circle", "FillRect", "FillCirc", "Spray"
+    "Circle", "FillRect", "FillCirc", "Spray",
+    "Select", "Lasso", "Blur", "Smudge", "Gradient",
+    "ObjErase", "Ellipse", "RndRect", "Polygon"
+};
+
+static const char *pressure_names[PRESSURE_MODE_COUNT] = {
+    "Off", "Size", "Size+Alpha"
+};
+
+static const char *gradient_names[GRADIENT_MODE_COUNT] = {
+    "Linear", "Radial", "Rect", "Circle"
+};
+
+static const char *symmetry_names[SYMMETRY_MODE_COUNT] = {
+    "Off", "H", "V", "H+V", "Radial"
+};
+
+// Indice: shape_fill | (shape_aa << 1)
+static const char *shape_style_names[4] = {
+    "Line", "Fill", "Line AA", "Fill AA"
 };
 
 void ui_init(UIState *ui) {
     ui->show_toolbar = 1;
     ui->show_palette = 1;
     ui->show_help = 0;
+    ui->show_memory = 0;
     ui->status_msg[0] = '\0';
     ui->status_timer = 0;
 
@@ -46,6 +68,9 @@ void ui_render_toolbar(const UIState *ui, const Canvas *canvas,
 
     vita2d_draw_fill_circle(20, 20, 12, palette_get_current(palette));
     vita2d_draw_rectangle(5, 5, 30, 30, COLOR_UI_BORDER);
+    // Colore secondario nell'angolo: tocca lo swatch per scambiarli
+    vita2d_draw_rectangle(24, 24, 12, 12, COLOR_UI_BORDER);
+    vita2d_draw_rectangle(25, 25, 10, 10, palette_get_secondary(palette));
 
     if (font) {
         char tool_info[128];
@@ -53,6 +78,41 @@ void ui_render_toolbar(const UIState *ui, const Canvas *canvas,
                  "Tool: %s  |  Size: %d  |  L/R: Color  |  SELECT: Help",
                  tool_names[canvas->tool], canvas->brush_size);
         vita2d_pgf_draw_text(font, 45, 25, COLOR_WHITE, 0.8f, tool_info);
+
+        vita2d_draw_line(UI_SYMMETRY_X - 10, 5, UI_SYMMETRY_X - 10,
+                         UI_TOOLBAR_HEIGHT - 5, COLOR_UI_BORDER);
+        if (canvas->symmetry_mode == SYMMETRY_RADIAL) {
+            snprintf(tool_info, sizeof(tool_info), "Sym: %dx", canvas->symmetry_order);
+        } else {
+            snprintf(tool_info, sizeof(tool_info), "Sym: %s",
+                     symmetry_names[canvas->symmetry_mode]);
+        }
+        vita2d_pgf_draw_text(font, UI_SYMMETRY_X, 25, COLOR_CYAN, 0.8f, tool_info);
+
+        vita2d_draw_line(UI_FILTER_X - 10, 5, UI_FILTER_X - 10,
+                         UI_TOOLBAR_HEIGHT - 5, COLOR_UI_BORDER);
+        vita2d_pgf_draw_text(font, UI_FILTER_X, 25, COLOR_CYAN, 0.8f, "Blur");
+        vita2d_pgf_draw_text(font, UI_FILTER_SHARPEN_X, 25, COLOR_CYAN, 0.8f, "Sharpen");
+
+        // Con il gradiente lo stesso pulsante sceglie la forma, con le
+        // forme il loro stile
+        if (canvas->tool == TOOL_GRADIENT) {
+            snprintf(tool_info, sizeof(tool_info), "Gradient: %s",
+                     gradient_names[canvas->gradient_mode]);
+        } else if (canvas->tool == TOOL_ELLIPSE || canvas->tool == TOOL_ROUND_RECT ||
+                   canvas->tool == TOOL_POLYGON) {
+            snprintf(tool_info, sizeof(tool_info), "Shape: %s",
+                     shape_style_names[canvas->shape_fill | (canvas->shape_aa << 1)]);
+        } else if (canvas->tool == TOOL_RECT || canvas->tool == TOOL_CIRCLE ||
+                   canvas->tool == TOOL_FILL_RECT || canvas->tool == TOOL_FILL_CIRCLE) {
+            snprintf(tool_info, sizeof(tool_info), "AA: %s", canvas->shape_aa ? "On" : "Off");
+        } else {
+            snprintf(tool_info, sizeof(tool_info), "Pressure: %s",
+                     pressure_names[canvas->pressure_mode]);
+        }
+        vita2d_draw_line(UI_PRESSURE_X - 10, 5, UI_PRESSURE_X - 10,
+                         UI_TOOLBAR_HEIGHT - 5, COLOR_UI_BORDER);
+        vita2d_pgf_draw_text(font, UI_PRESSURE_X, 25, COLOR_CYAN, 0.8f, tool_info);
     }
 
     if (ui->status_timer > 0 && font) {
@@ -82,6 +142,10 @@ void ui_render_palette(const UIState *ui, const ColorPalette *palette) {
             vita2d_draw_rectangle(x - 2, y - 2,
                                   box_size + 4, box_size + 4,
                                   COLOR_UI_SELECTED);
+        } else if (i == palette->secondary) {
+            vita2d_draw_rectangle(x - 2, y - 2,
+                                  box_size + 4, box_size + 4,
+                                  COLOR_CYAN);
         }
 
         vita2d_draw_rectangle(x, y, box_size, box_size, palette->colors[i]);
@@ -108,8 +172,8 @@ void ui_render_cursor(int x, int y, int brush_size, unsigned int color) {
 }
 
 void ui_render_help(void) {
-    int x = 100, y = 80;
-    int w = 760, h = 400;
+    int x = 100, y = 45;
+    int w = 760, h = 470;
 
     vita2d_draw_rectangle(x, y, w, h, RGBA8(20, 20, 20, 240));
     vita2d_draw_line(x, y, x + w, y, COLOR_UI_BORDER);
@@ -120,7 +184,7 @@ void ui_render_help(void) {
     if (!font) return;
 
     int line = y + 30;
-    int step = 28;
+    int step = 26;
 
     vita2d_pgf_draw_text(font, x + 20, line, COLOR_YELLOW, 1.0f,
                          "=== DrawApp - Help ===");
@@ -132,22 +196,37 @@ void ui_render_help(void) {
                          "D-Pad UP/DOWN: Change brush size");
     line += step;
     vita2d_pgf_draw_text(font, x + 20, line, COLOR_WHITE, 0.85f,
-                         "L/R triggers: Prev/Next color");
+                         "L/R triggers: Prev/Next color  |  Tap swatch: swap 2nd color");
     line += step;
     vita2d_pgf_draw_text(font, x + 20, line, COLOR_WHITE, 0.85f,
-                         "Triangle: Cycle tools");
+                         "Triangle: Cycle tools  |  ObjErase: remove whole strokes");
     line += step;
     vita2d_pgf_draw_text(font, x + 20, line, COLOR_WHITE, 0.85f,
                          "Square: Clear canvas");
     line += step;
     vita2d_pgf_draw_text(font, x + 20, line, COLOR_WHITE, 0.85f,
-                         "Circle: Undo last action");
+                         "Circle: Undo last action  |  D-Pad RIGHT: Redo");
+    line += step;
+    vita2d_pgf_draw_text(font, x + 20, line, COLOR_WHITE, 0.85f,
+                         "D-Pad LEFT: Export 4x PNG  |  Timelapse: always recording");
+    line += step;
+    vita2d_pgf_draw_text(font, x + 20, line, COLOR_WHITE, 0.85f,
+                         "Tap 'Pressure' in toolbar: Off / Size / Size+Alpha (shapes: fill/AA)");
+    line += step;
+    vita2d_pgf_draw_text(font, x + 20, line, COLOR_WHITE, 0.85f,
+                         "Select/Lasso: drag to move, R-stick rotate/scale, tap outside");
     line += step;
     vita2d_pgf_draw_text(font, x + 20, line, COLOR_WHITE, 0.85f,
-                         "Cross: Toggle UI visibility");
+                         "Polygon: tap each corner, tap the first one to close");
     line += step;
     vita2d_pgf_draw_text(font, x + 20, line, COLOR_WHITE, 0.85f,
-                         "SELECT: Show/Hide this help");
+                         "Blur/Smudge: brush tools  |  Tap 'Blur'/'Sharpen': whole canvas");
+    line += step;
+    vita2d_pgf_draw_text(font, x + 20, line, COLOR_WHITE, 0.85f,
+                         "Cross: Toggle UI visibility  |  Tap 'Sym': mirror H/V/H+V, radial 3-16");
+    line += step;
+    vita2d_pgf_draw_text(font, x + 20, line, COLOR_WHITE, 0.85f,
+                         "SELECT: Show/Hide this help  |  Here: Triangle latency, Square memory");
     line += step;
     vita2d_pgf_draw_text(font, x + 20, line, COLOR_WHITE, 0.85f,
                          "START: Exit application");
@@ -168,7 +247,8 @@ void ui_render_shape_preview(const Canvas *canvas, int x, int y) {
             vita2d_draw_line(sx, sy, x, y, pc);
             break;
         case TOOL_RECT:
-        case TOOL_FILL_RECT: {
+        case TOOL_FILL_RECT:
+        case TOOL_ROUND_RECT: {
             int minx = (sx < x) ? sx : x;
             int miny = (sy < y) ? sy : y;
             int w = abs(x - sx);
@@ -179,6 +259,28 @@ void ui_render_shape_preview(const Canvas *canvas, int x, int y) {
             vita2d_draw_line(minx + w, miny, minx + w, miny + h, pc);
             break;
         }
+        case TOOL_GRADIENT:
+            // Direzione del gradiente, più la forma che lo contiene
+            vita2d_draw_line(sx, sy, x, y, pc);
+            if (canvas->gradient_mode == GRADIENT_LINEAR_RECT) {
+                int minx = (sx < x) ? sx : x;
+                int miny = (sy < y) ? sy : y;
+                int maxx = (sx > x) ? sx : x;
+                int maxy = (sy > y) ? sy : y;
+                vita2d_draw_line(minx, miny, maxx, miny, pc);
+                vita2d_draw_line(minx, maxy, maxx, maxy, pc);
+                vita2d_draw_line(minx, miny, minx, maxy, pc);
+                vita2d_draw_line(maxx, miny, maxx, maxy, pc);
+            } else if (canvas->gradient_mode == GRADIENT_RADIAL_CIRCLE) {
+                int dx = x - sx;
+                int dy = y - sy;
+                int r = (int)sqrtf((float)(dx * dx + dy * dy));
+                for (float a = 0.0f; a < 6.283f; a += 0.02f) {
+                    vita2d_draw_pixel(sx + (int)((float)r * cosf(a)),
+                                      sy + (int)((float)r * sinf(a)), pc);
+                }
+            }
+            break;
         case TOOL_CIRCLE:
         case TOOL_FILL_CIRCLE: {
             int dx = x - sx;
@@ -191,11 +293,168 @@ void ui_render_shape_preview(const Canvas *canvas, int x, int y) {
             }
             break;
         }
+        case TOOL_ELLIPSE: {
+            float rx = (float)abs(x - sx);
+            float ry = (float)abs(y - sy);
+            for (float a = 0.0f; a < 6.283f; a += 0.02f) {
+                vita2d_draw_pixel(sx + (int)(rx * cosf(a)), sy + (int)(ry * sinf(a)), pc);
+            }
+            break;
+        }
         default:
             break;
     }
 }
 
+void ui_render_symmetry_guides(const Canvas *canvas) {
+    if (canvas->symmetry_mode == SYMMETRY_OFF) return;
+
+    unsigned int gc = RGBA8(0, 160, 255, 90);
+    int cx = canvas->width / 2, cy = canvas->height / 2;
+    if (canvas->symmetry_mode != SYMMETRY_RADIAL) {
+        if (canvas->symmetry_mode != SYMMETRY_MIRROR_V) {
+            vita2d_draw_line(cx, 0, cx, canvas->height, gc);
+        }
+        if (canvas->symmetry_mode != SYMMETRY_MIRROR_H) {
+            vita2d_draw_line(0, cy, canvas->width, cy, gc);
+        }
+        return;
+    }
+    // Un raggio per copia, dal centro verso l'alto ruotato
+    SymmetryXform t[SYMMETRY_MAX_COPIES];
+    int n = symmetry_xforms(canvas->symmetry_mode, canvas->symmetry_order, cx, cy, t);
+    for (int k = 0; k < n; k++) {
+        int x, y;
+        symmetry_map(&t[k], cx, cy - canvas->width, &x, &y);
+        vita2d_draw_line(cx, cy, x, y, gc);
+    }
+}
+
+void ui_render_polygon_preview(const int *xs, const int *ys, int n,
+                               int touching, int x, int y)
+{
+    unsigned int pc = RGBA8(200, 200, 200, 150);
+    for (int i = 0; i + 1 < n; i++) {
+        vita2d_draw_line(xs[i], ys[i], xs[i + 1], ys[i + 1], pc);
+    }
+    // Il lato che si aggiungerebbe toccando qui
+    if (touching && n > 0) vita2d_draw_line(xs[n - 1], ys[n - 1], x, y, pc);
+    vita2d_draw_rectangle(xs[0] - 3, ys[0] - 3, 7, 7, COLOR_CYAN);
+}
+
+void ui_render_selection(const Selection *sel) {
+    unsigned int pc = COLOR_CYAN;
+
+    if (sel->state == SEL_FLOATING) {
+        int xs[4], ys[4];
+        selection_corners(sel, xs, ys);
+        for (int i = 0; i < 4; i++) {
+            vita2d_draw_line(xs[i], ys[i], xs[(i + 1) % 4], ys[(i + 1) % 4], pc);
+        }
+        return;
+    }
+    if (sel->state != SEL_DEFINING) return;
+
+    if (!sel->lasso) {
+        const JournalCmd *c = &sel->cmds[0];
+        vita2d_draw_line(c->x0, c->y0, c->x1, c->y0, pc);
+        vita2d_draw_line(c->x0, c->y1, c->x1, c->y1, pc);
+        vita2d_draw_line(c->x0, c->y0, c->x0, c->y1, pc);
+        vita2d_draw_line(c->x1, c->y0, c->x1, c->y1, pc);
+        return;
+    }
+
+    // Lazo: vertici in coppia nei comandi JCMD_SELECT
+    for (int i = 0; i + 1 < sel->num_points; i++) {
+        const JournalCmd *a = &sel->cmds[i >> 1];
+        const JournalCmd *b = &sel->cmds[(i + 1) >> 1];
+        int ax = (i & 1) ? a->x1 : a->x0, ay = (i & 1) ? a->y1 : a->y0;
+        int bx = ((i + 1) & 1) ? b->x1 : b->x0, by = ((i + 1) & 1) ? b->y1 : b->y0;
+        vita2d_draw_line(ax, ay, bx, by, pc);
+    }
+}
+
+void ui_render_latency(const Latency *lat) {
+    int x = 10, y = UI_PALETTE_Y - 150;
+    int w = 420, h = 140;
+
+    vita2d_draw_rectangle(x, y, w, h, RGBA8(20, 20, 20, 200));
+    if (!font) return;
+
+    char line[96];
+    snprintf(line, sizeof(line), "Touch -> display latency (%u samples)",
+             (unsigned)lat->total.count);
+    vita2d_pgf_draw_text(font, x + 10, y + 20, COLOR_YELLOW, 0.8f, line);
+    // Il font non è a spaziatura fissa: una colonna per valore
+    static const char *headers[5] = { "stage", "p50", "p95", "p99", "max" };
+    for (int c = 0; c < 5; c++) {
+        vita2d_pgf_draw_text(font, c ? x + 90 + (c - 1) * 80 : x + 10, y + 42, COLOR_WHITE, 0.8f, headers[c]);
+    }
+    for (int s = 0; s <= LATENCY_STAGE_COUNT; s++) {
+        const LatencyDist *dist = (s < LATENCY_STAGE_COUNT) ? &lat->stages[s] : &lat->total;
+        unsigned int color = (s < LATENCY_STAGE_COUNT) ? COLOR_WHITE : COLOR_CYAN;
+        uint32_t values[4] = {
+            latency_percentile(dist, 50), latency_percentile(dist, 95),
+            latency_percentile(dist, 99), dist->max_us
+        };
+        int ly = y + 62 + s * 18;
+
+        vita2d_pgf_draw_text(font, x + 10, ly, color, 0.8f,
+                             (s < LATENCY_STAGE_COUNT) ? latency_stage_name((LatencyStage)s) : "total");
+        for (int c = 0; c < 4; c++) {
+            snprintf(line, sizeof(line), "%.1f", values[c] / 1000.0);
+            vita2d_pgf_draw_text(font, x + 90 + c * 80, ly, color, 0.8f, line);
+        }
+    }
+    vita2d_pgf_draw_text(font, x + w - 40, y + 20, COLOR_WHITE, 0.8f, "ms");
+}
+
+void ui_render_memory(void) {
+    int x = SCREEN_W - 430, y = UI_TOOLBAR_HEIGHT + 10;
+    int w = 420, h = 64 + MEM_SUBSYSTEM_COUNT * 18 + 40;
+
+    vita2d_draw_rectangle(x, y, w, h, RGBA8(20, 20, 20, 200));
+    if (!font) return;
+
+    MemSummary sum;
+    mem_get_summary(&sum);
+    char line[96];
+    snprintf(line, sizeof(line), "Memory budget (%.1f MB reserved)",
+             sum.reserved / (1024.0 * 1024.0));
+    vita2d_pgf_draw_text(font, x + 10, y + 20, COLOR_YELLOW, 0.8f, line);
+    static const char *headers[5] = { "subsystem", "used", "limit", "peak", "fail" };
+    for (int c = 0; c < 5; c++) {
+        vita2d_pgf_draw_text(font, c ? x + 110 + (c - 1) * 75 : x + 10, y + 42, COLOR_WHITE, 0.8f, headers[c]);
+    }
+    for (int s = 0; s < MEM_SUBSYSTEM_COUNT; s++) {
+        MemStats st;
+        mem_get_stats((MemSubsystem)s, &st);
+        // Rosso se qualcosa è stato rifiutato, ciano se ha dovuto liberare
+        unsigned int color = st.failures ? COLOR_RED : (st.reclaims ? COLOR_CYAN : COLOR_WHITE);
+        int ly = y + 62 + s * 18;
+
+        vita2d_pgf_draw_text(font, x + 10, ly, color, 0.8f, mem_subsystem_name((MemSubsystem)s));
+        size_t values[3] = { st.used, st.limit, st.peak };
+        for (int c = 0; c < 3; c++) {
+            if (c == 1 && st.limit == 0) snprintf(line, sizeof(line), "-");
+            else snprintf(line, sizeof(line), "%.1f", values[c] / (1024.0 * 1024.0));
+            vita2d_pgf_draw_text(font, x + 110 + c * 75, ly, color, 0.8f, line);
+        }
+        snprintf(line, sizeof(line), "%u", st.failures);
+        vita2d_pgf_draw_text(font, x + 110 + 3 * 75, ly, color, 0.8f, line);
+    }
+
+    int ly = y + 62 + MEM_SUBSYSTEM_COUNT * 18 + 4;
+    snprintf(line, sizeof(line), "frames %d/%d free  tiles %d/%d free  misses %u",
+             sum.frame_free, sum.frame_total, sum.tile_free, sum.tile_total, sum.pool_misses);
+    vita2d_pgf_draw_text(font, x + 10, ly, COLOR_WHITE, 0.8f, line);
+    snprintf(line, sizeof(line), "scratch frame %.1f  peak %.1f MB  heap %u",
+             sum.scratch_frame_peak / (1024.0 * 1024.0), sum.scratch_peak / (1024.0 * 1024.0),
+             sum.scratch_heap);
+    vita2d_pgf_draw_text(font, x + 10, ly + 18, COLOR_WHITE, 0.8f, line);
+    vita2d_pgf_draw_text(font, x + w - 40, y + 20, COLOR_WHITE, 0.8f, "MB");
+}
+
 int ui_palette_hit_test(const UIState *ui, int x, int y) {
     if (!ui->show_palette) return -1;
     if (y < UI_PALETTE_Y || y > UI_PALETTE_Y + UI_PALETTE_HEIGHT) return -1;
@@ -219,3 +478,21 @@ int ui_toolbar_hit_test(const UIState *ui, int x, int y) {
     if (!ui->show_toolbar) return 0;
     return (y >= UI_TOOLBAR_Y && y <= UI_TOOLBAR_Y + UI_TOOLBAR_HEIGHT);
 }
+
+int ui_pressure_hit_test(const UIState *ui, int x, int y) {
+    return ui_toolbar_hit_test(ui, x, y) && x >= UI_PRESSURE_X - 10;
+}
+
+int ui_filter_hit_test(const UIState *ui, int x, int y) {
+    if (!ui_toolbar_hit_test(ui, x, y)) return -1;
+    if (x < UI_FILTER_X - 10 || x >= UI_PRESSURE_X - 10) return -1;
+    return (x < UI_FILTER_SHARPEN_X - 5) ? FILTER_BLUR : FILTER_SHARPEN;
+}
+
+int ui_symmetry_hit_test(const UIState *ui, int x, int y) {
+    return ui_toolbar_hit_test(ui, x, y) && x >= UI_SYMMETRY_X - 10 && x < UI_FILTER_X - 10;
+}
+
+int ui_swatch_hit_test(const UIState *ui, int x, int y) {
+    return ui_toolbar_hit_test(ui, x, y) && x < 40;
+}
@@ -4,17 +4,28 @@
 #include "canvas.h"
 #include "colors.h"
 #include "input.h"
+#include "selection.h"
+#include "filter.h"
+#include "latency.h"
 
 // Posizioni UI
 #define UI_TOOLBAR_Y      0
 #define UI_TOOLBAR_HEIGHT  40
 #define UI_PALETTE_Y       (SCREEN_H - 35)
 #define UI_PALETTE_HEIGHT  35
+// Pulsante della modalità pressione, a destra nella toolbar
+#define UI_PRESSURE_X      (SCREEN_W - 190)
+// Pulsanti dei filtri a tutto canvas (Blur, Sharpen), prima della pressione
+#define UI_FILTER_X        (SCREEN_W - 330)
+#define UI_FILTER_SHARPEN_X (UI_FILTER_X + 50)
+// Pulsante della simmetria, prima dei filtri
+#define UI_SYMMETRY_X      (SCREEN_W - 430)
 
 typedef struct {
     int show_toolbar;
     int show_palette;
     int show_help;
+    int show_memory;    // overlay del budget di memoria
 
     // Status message
     char status_msg[64];
@@ -29,6 +40,17 @@ void ui_render_palette(const UIState *ui, const ColorPalette *palette);
 void ui_render_cursor(int x, int y, int brush_size, unsigned int color);
 void ui_render_help(void);
 void ui_render_shape_preview(const Canvas *canvas, int x, int y);
+// Lati del poligono in costruzione, più quello verso il dito
+void ui_render_polygon_preview(const int *xs, const int *ys, int n,
+                               int touching, int x, int y);
+// Contorno della selezione (in tracciamento o flottante)
+void ui_render_selection(const Selection *sel);
+// Assi o raggi della simmetria attiva, attraverso il centro del canvas
+void ui_render_symmetry_guides(const Canvas *canvas);
+// Overlay della modalità latenza: percentili per fase, in ms
+void ui_render_latency(const Latency *lat);
+// Overlay del budget di memoria: uso per sottosistema, pool e arena
+void ui_render_memory(void);
 
 // Controlla se il touch è nell'area della palette, ritorna indice colore o -1
 int  ui_palette_hit_test(const UIState *ui, int x, int y);
@@ -36,4 +58,16 @@ int  ui_palette_hit_test(const UIState *ui, int x, int y);
 // Controlla se il touch è nella toolbar
 int  ui_toolbar_hit_test(const UIState *ui, int x, int y);
 
+// Controlla se il touch è sul pulsante della modalità pressione
+int  ui_pressure_hit_test(const UIState *ui, int x, int y);
+
+// Controlla se il touch è sullo swatch del colore corrente
+int  ui_swatch_hit_test(const UIState *ui, int x, int y);
+
+// Filtro a tutto canvas toccato nella toolbar, o -1
+int  ui_filter_hit_test(const UIState *ui, int x, int y);
+
+// Controlla se il touch è sul pulsante della simmetria
+int  ui_symmetry_hit_test(const UIState *ui, int x, int y);
+
 #endif
@@ -0,0 +1,94 @@
+#include "workpool.h"
+#include "platform.h"
+#include <string.h>
+
+// Esegue task finché ce ne sono; lock tenuto all'ingresso e all'uscita
+static void workpool_drain(WorkPool *pool, int worker) {
+    while (pool->next < pool->count) {
+        int index = pool->next++;
+        WorkFn fn = pool->fn;
+        void *ctx = pool->ctx;
+
+        pthread_mutex_unlock(&pool->lock);
+        fn(ctx, index, worker);
+        pthread_mutex_lock(&pool->lock);
+
+        if (--pool->pending == 0) pthread_cond_broadcast(&pool->done_cond);
+    }
+}
+
+static void *workpool_thread(void *arg) {
+    WorkPoolThread *a = (WorkPoolThread *)arg;
+    WorkPool *pool = a->pool;
+    int seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stop) {
+        if (pool->generation != seen) {
+            seen = pool->generation;
+            workpool_drain(pool, a->worker);
+        }
+        if (!pool->stop && pool->generation == seen) {
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int workpool_init(WorkPool *pool, int num_workers) {
+    memset(pool, 0, sizeof(WorkPool));
+    if (num_workers <= 0) num_workers = platform_num_cpus();
+    if (num_workers > WORKPOOL_MAX_THREADS + 1) num_workers = WORKPOOL_MAX_THREADS + 1;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    for (int i = 0; i < num_workers - 1; i++) {
+        pool->thread_args[i].pool = pool;
+        pool->thread_args[i].worker = i + 1;
+        if (pthread_create(&pool->threads[i], NULL, workpool_thread, &pool->thread_args[i]) != 0)
+            break;
+        pool->num_threads++;
+    }
+    return 0;
+}
+
+void workpool_destroy(WorkPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    pool->num_threads = 0;
+}
+
+int workpool_size(const WorkPool *pool) {
+    return pool->num_threads + 1;
+}
+
+void workpool_run(WorkPool *pool, int count, WorkFn fn, void *ctx) {
+    if (count <= 0) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->count = count;
+    pool->next = 0;
+    pool->pending = count;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_cond);
+
+    workpool_drain(pool, 0);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
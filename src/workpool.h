@@ -0,0 +1,45 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <pthread.h>
+
+#define WORKPOOL_MAX_THREADS 16
+
+// index: task da eseguire, worker: 0..workpool_size()-1 (0 = chiamante)
+typedef void (*WorkFn)(void *ctx, int index, int worker);
+
+struct WorkPool;
+
+typedef struct {
+    struct WorkPool *pool;
+    int worker;
+} WorkPoolThread;
+
+typedef struct WorkPool {
+    pthread_t threads[WORKPOOL_MAX_THREADS];
+    WorkPoolThread thread_args[WORKPOOL_MAX_THREADS];
+    int num_threads;        // thread del pool, escluso il chiamante
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+
+    WorkFn fn;
+    void *ctx;
+    int count;              // task del lavoro corrente
+    int next;               // prossimo task da assegnare (in ordine crescente)
+    int pending;            // task non ancora completati
+    int generation;         // cambia a ogni workpool_run
+    int stop;
+} WorkPool;
+
+// num_workers totali incluso il chiamante; <= 0 usa tutti i core
+int  workpool_init(WorkPool *pool, int num_workers);
+void workpool_destroy(WorkPool *pool);
+int  workpool_size(const WorkPool *pool);
+
+// Esegue fn per index 0..count-1 e ritorna quando sono tutti finiti.
+// I task vengono assegnati in ordine crescente; il chiamante partecipa.
+void workpool_run(WorkPool *pool, int count, WorkFn fn, void *ctx);
+
+#endif
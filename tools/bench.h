@@ -0,0 +1,34 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include "platform.h"
+
+// Stampa una riga "suite  metrica  valore unità" su stdout
+void bench_report(const char *suite, const char *metric, double value, const char *unit);
+
+// Secondi trascorsi da start (platform_time_us)
+double bench_elapsed(uint64_t start);
+
+// Esegue fn(arg) in un processo figlio: tempo (ms) misurato nel figlio e
+// picco di RSS del solo figlio. Il chiamante deve avere poca memoria
+// residente, perché il figlio eredita le sue pagine.
+int bench_run_child(int (*fn)(void *), void *arg, double *ms, long *peak_kb);
+
+// Suite disponibili: ritornano 0 se ok
+int bench_journal(void);
+int bench_autosave(void);
+int bench_project(void);
+int bench_export(void);
+int bench_stroke(void);
+int bench_selection(void);
+int bench_filter(void);
+int bench_gradient(void);
+int bench_strokes(void);
+int bench_shapes(void);
+int bench_timelapse(void);
+int bench_latency(void);
+int bench_memory(void);
+int bench_symmetry(void);
+
+#endif
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "autosave.h"
+
+#define BENCH_PROJECT "bench_autosave.drwj"
+#define BENCH_LOG     "bench_autosave.wal"
+
+#define FRAMES        300
+#define FRAME_US      16667
+#define SEGS_PER_FRAME 4
+
+#define RECOVERY_EVENTS 100000
+
+static void cleanup_files(void) {
+    remove(BENCH_PROJECT);
+    remove(BENCH_PROJECT ".tmp");
+    remove(BENCH_LOG);
+}
+
+// Un tratto continuo a 60 fps; ritorna i frame oltre il budget
+static int run_frames(Journal *journal, Canvas *canvas, Autosave *autosave,
+                      const char *label)
+{
+    uint64_t worst = 0, total = 0;
+    int dropped = 0;
+    int x = SCREEN_W / 2, y = SCREEN_H / 2;
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        uint64_t start = platform_time_us();
+
+        if (frame % 30 == 0) {
+            journal_begin_op(journal, canvas);
+            journal_record(journal, canvas, JCMD_BRUSH, x, y, x, y, 8, RGBA8(0, 0, 0, 255));
+        }
+        for (int s = 0; s < SEGS_PER_FRAME; s++) {
+            int nx = 20 + rand() % (SCREEN_W - 40);
+            int ny = 20 + rand() % (SCREEN_H - 40);
+            nx = x + (nx - x) / 16;
+            ny = y + (ny - y) / 16;
+            journal_record(journal, canvas, JCMD_LINE, x, y, nx, ny, 8, RGBA8(0, 0, 255, 255));
+            x = nx;
+            y = ny;
+        }
+        if (autosave) autosave_update(autosave, journal, canvas);
+
+        uint64_t dt = platform_time_us() - start;
+        total += dt;
+        if (dt > worst) worst = dt;
+        if (dt > FRAME_US) dropped++;
+        if (dt < FRAME_US) platform_sleep_us((uint32_t)(FRAME_US - dt));
+    }
+
+    char metric[64];
+    snprintf(metric, sizeof(metric), "%s frame avg", label);
+    bench_report("autosave", metric, total / 1000.0 / FRAMES, "ms");
+    snprintf(metric, sizeof(metric), "%s frame max", label);
+    bench_report("autosave", metric, worst / 1000.0, "ms");
+    snprintf(metric, sizeof(metric), "%s dropped frames", label);
+    bench_report("autosave", metric, dropped, "frames");
+    return dropped;
+}
+
+static int bench_frame_time(void) {
+    Canvas canvas;
+    Journal journal;
+    Autosave autosave;
+
+    if (canvas_init(&canvas) < 0) return -1;
+    if (journal_init(&journal, canvas.bg_color) < 0) {
+        canvas_destroy(&canvas);
+        return -1;
+    }
+
+    srand(42);
+    run_frames(&journal, &canvas, NULL, "off");
+
+    if (autosave_start(&autosave, &journal, &canvas, BENCH_PROJECT, BENCH_LOG) != 0) {
+        journal_destroy(&journal);
+        canvas_destroy(&canvas);
+        return -1;
+    }
+    run_frames(&journal, &canvas, &autosave, "on");
+    autosave_stop(&autosave, &journal, &canvas);
+
+    bench_report("autosave", "batches written", autosave.batches, "");
+    bench_report("autosave", "fsync calls", autosave.syncs, "");
+    bench_report("autosave", "fsync max (I/O thread)", autosave.max_sync_us / 1000.0, "ms");
+
+    journal_destroy(&journal);
+    canvas_destroy(&canvas);
+    cleanup_files();
+    return 0;
+}
+
+static int bench_recovery(void) {
+    Canvas canvas, restored;
+    Journal journal, journal2;
+    Autosave autosave;
+
+    if (canvas_init(&canvas) < 0) return -1;
+    if (canvas_init(&restored) < 0) return -1;
+    journal_init(&journal, canvas.bg_color);
+    journal_init(&journal2, canvas.bg_color);
+
+    if (autosave_start(&autosave, &journal, &canvas, BENCH_PROJECT, BENCH_LOG) != 0) return -1;
+
+    // Sessione lunga con qualche undo/redo; la coda si svuota a ritmo di batch
+    srand(7);
+    int x = 100, y = 100;
+    for (int i = 0; i < RECOVERY_EVENTS; i++) {
+        int r = rand() % 100;
+        if (r == 0) {
+            journal_undo(&journal, &canvas);
+        } else if (r == 1) {
+            journal_redo(&journal, &canvas);
+        } else if (r < 10) {
+            journal_begin_op(&journal, &canvas);
+            x = rand() % SCREEN_W;
+            y = rand() % SCREEN_H;
+            journal_record(&journal, &canvas, JCMD_BRUSH, x, y, x, y, 4, RGBA8(r, 0, 0, 255));
+        } else {
+            int nx = x + rand() % 9 - 4, ny = y + rand() % 9 - 4;
+            journal_record(&journal, &canvas, JCMD_LINE, x, y, nx, ny, 4, RGBA8(0, r, 0, 255));
+            x = nx;
+            y = ny;
+        }
+        if (i % 2000 == 1999) platform_sleep_us(AUTOSAVE_BATCH_US / 2);
+    }
+
+    // "Crash": si svuota la coda ma senza checkpoint finale
+    autosave_stop(&autosave, NULL, NULL);
+
+    uint64_t t = platform_time_us();
+    int replayed = autosave_recover(&journal2, &restored, BENCH_PROJECT, BENCH_LOG);
+    double secs = bench_elapsed(t);
+
+    int match = memcmp(canvas.pixels, restored.pixels,
+                       SCREEN_W * SCREEN_H * sizeof(unsigned int)) == 0;
+
+    bench_report("autosave", "recovery events", replayed, "events");
+    bench_report("autosave", "recovery time", secs * 1000.0, "ms");
+    bench_report("autosave", "recovery throughput", replayed / secs, "events/s");
+    bench_report("autosave", "recovered canvas matches", match, "");
+
+    journal_destroy(&journal);
+    journal_destroy(&journal2);
+    canvas_destroy(&canvas);
+    canvas_destroy(&restored);
+    cleanup_files();
+    return match ? 0 : -1;
+}
+
+int bench_autosave(void) {
+    cleanup_files();
+    if (bench_frame_time() != 0) return -1;
+    return bench_recovery();
+}
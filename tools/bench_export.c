@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "export.h"
+
+#define BENCH_PNG "bench_export.png"
+
+static const int scales[] = { 2, 4, 8 };
+#define NUM_SCALES (int)(sizeof(scales) / sizeof(scales[0]))
+
+typedef struct {
+    const Journal *journal;
+    const Canvas *canvas;
+    int scale;
+    ExportFilter filter;
+    int workers;
+} ExportArgs;
+
+static int run_export(void *arg) {
+    ExportArgs *a = (ExportArgs *)arg;
+    WorkPool pool;
+    workpool_init(&pool, a->workers);
+    int ret = export_png(BENCH_PNG, a->journal, a->canvas, a->scale, a->filter, &pool, NULL);
+    workpool_destroy(&pool);
+    return ret;
+}
+
+// Sessione tipo: tratti medi, qualche forma
+static void make_session(Journal *journal, Canvas *canvas) {
+    srand(99);
+    for (int op = 0; op < 400; op++) {
+        int x = rand() % SCREEN_W, y = rand() % SCREEN_H;
+        unsigned int color = RGBA8(rand() & 255, rand() & 255, rand() & 255, 255);
+        journal_begin_op(journal, canvas);
+        if (op % 10 == 0) {
+            journal_record(journal, canvas, JCMD_FILL_CIRCLE, x, y, x + 20, y, 1, color);
+        } else {
+            int size = 1 + rand() % 4;
+            for (int seg = 0; seg < 10; seg++) {
+                int nx = x + rand() % 31 - 15, ny = y + rand() % 31 - 15;
+                journal_record(journal, canvas, JCMD_LINE, x, y, nx, ny, size, color);
+                x = nx;
+                y = ny;
+            }
+        }
+    }
+}
+
+int bench_export(void) {
+    static const char *filter_names[EXPORT_FILTER_COUNT] = { "reraster", "nearest", "bilinear" };
+
+    Canvas canvas;
+    Journal journal;
+    if (canvas_init(&canvas) < 0) return -1;
+    journal_init(&journal, canvas.bg_color);
+    make_session(&journal, &canvas);
+
+    int cpus = platform_num_cpus();
+    for (int f = 0; f < EXPORT_FILTER_COUNT; f++) {
+        for (int i = 0; i < NUM_SCALES; i++) {
+            ExportArgs args = { &journal, &canvas, scales[i], (ExportFilter)f, cpus };
+            double ms;
+            long kb;
+            char metric[64];
+            if (bench_run_child(run_export, &args, &ms, &kb) != 0) {
+                journal_destroy(&journal);
+                canvas_destroy(&canvas);
+                return -1;
+            }
+            snprintf(metric, sizeof(metric), "%s %dx time", filter_names[f], scales[i]);
+            bench_report("export", metric, ms, "ms");
+            snprintf(metric, sizeof(metric), "%s %dx peak rss", filter_names[f], scales[i]);
+            bench_report("export", metric, kb / 1024.0, "MiB");
+        }
+    }
+
+    // Scalabilità con i thread: re-raster 4x
+    for (int workers = 1; workers <= cpus; workers *= 2) {
+        ExportArgs args = { &journal, &canvas, 4, EXPORT_RERASTER, workers };
+        double ms;
+        long kb;
+        char metric[64];
+        if (bench_run_child(run_export, &args, &ms, &kb) == 0) {
+            snprintf(metric, sizeof(metric), "reraster 4x %d threads", workers);
+            bench_report("export", metric, ms, "ms");
+        }
+    }
+
+    bench_report("export", "full 8x frame (for reference)",
+                 SCREEN_W * 8.0 * SCREEN_H * 8.0 * 4.0 / (1024.0 * 1024.0), "MiB");
+
+    remove(BENCH_PNG);
+    journal_destroy(&journal);
+    canvas_destroy(&canvas);
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "filter.h"
+
+#define REPEATS     8
+#define FRAMES      120
+#define FRAME_US    16667
+// Spostamento massimo per frame di un trascinamento veloce
+#define DRAG_STEP   40
+
+static const int radii[] = { 1, 4, 16, FILTER_RADIUS_MAX };
+#define NUM_RADII (int)(sizeof(radii) / sizeof(radii[0]))
+
+// Tempo medio (ms) di un filtro a tutto canvas, ripartendo ogni volta da source
+static double time_filter(Canvas *canvas, const unsigned int *source, FilterType type,
+                          int radius, int amount, WorkPool *pool)
+{
+    size_t bytes = (size_t)canvas->width * canvas->height * sizeof(unsigned int);
+    double total = 0;
+    for (int i = 0; i < REPEATS; i++) {
+        memcpy(canvas->pixels, source, bytes);
+        uint64_t t = platform_time_us();
+        filter_apply(canvas, type, radius, amount, 0, 0, canvas->width, canvas->height, pool);
+        total += bench_elapsed(t);
+    }
+    return total * 1000.0 / REPEATS;
+}
+
+// Trascinamento a BRUSH_SIZE_MAX: ritorna il frame peggiore in us
+static double run_drag(Canvas *canvas, const unsigned int *source, int smudge,
+                       double *avg_ms)
+{
+    memcpy(canvas->pixels, source, (size_t)canvas->width * canvas->height * sizeof(unsigned int));
+    srand(7);
+    int x = SCREEN_W / 2, y = SCREEN_H / 2;
+    double worst = 0, total = 0;
+    for (int frame = 0; frame < FRAMES; frame++) {
+        int nx = x + rand() % (2 * DRAG_STEP + 1) - DRAG_STEP;
+        int ny = y + rand() % (2 * DRAG_STEP + 1) - DRAG_STEP;
+        if (nx < 0 || nx >= SCREEN_W) nx = x;
+        if (ny < 0 || ny >= SCREEN_H) ny = y;
+
+        uint64_t t = platform_time_us();
+        if (smudge) {
+            filter_smudge_segment(canvas, x, y, nx, ny, BRUSH_SIZE_MAX, FILTER_SMUDGE_STRENGTH);
+        } else {
+            filter_stroke_segment(canvas, FILTER_BLUR, FILTER_BLUR_RADIUS, 0,
+                                  x, y, nx, ny, BRUSH_SIZE_MAX);
+        }
+        double dt = bench_elapsed(t);
+        total += dt;
+        if (dt > worst) worst = dt;
+        x = nx;
+        y = ny;
+    }
+    *avg_ms = total * 1000.0 / FRAMES;
+    return worst * 1000000.0;
+}
+
+int bench_filter(void) {
+    Canvas canvas;
+    if (canvas_init(&canvas) < 0) return -1;
+
+    size_t bytes = SCREEN_W * SCREEN_H * sizeof(unsigned int);
+    unsigned int *source = (unsigned int *)malloc(bytes);
+    unsigned int *reference = (unsigned int *)malloc(bytes);
+    if (!source || !reference) {
+        free(source);
+        free(reference);
+        canvas_destroy(&canvas);
+        return -1;
+    }
+
+    srand(99);
+    for (int i = 0; i < 2000; i++) {
+        int x = rand() % SCREEN_W, y = rand() % SCREEN_H;
+        canvas_draw_filled_circle(&canvas, x, y, 4 + rand() % 20,
+                                  RGBA8(rand() & 255, rand() & 255, rand() & 255, 255));
+    }
+    memcpy(source, canvas.pixels, bytes);
+
+    char metric[64];
+    int failed = 0;
+
+    // Somme scorrevoli: il tempo non deve crescere con il raggio
+    for (int i = 0; i < NUM_RADII; i++) {
+        double ms = time_filter(&canvas, source, FILTER_BLUR, radii[i], 0, NULL);
+        snprintf(metric, sizeof(metric), "blur r%d 1 thread", radii[i]);
+        bench_report("filter", metric, ms, "ms");
+    }
+
+    // Scalabilità: stesso risultato con qualsiasi numero di thread
+    int cpus = platform_num_cpus();
+    int max_workers = (cpus > 4) ? cpus : 4;
+    bench_report("filter", "cpus", cpus, "");
+    for (int type = FILTER_BLUR; type < FILTER_TYPE_COUNT; type++) {
+        const char *name = (type == FILTER_BLUR) ? "blur r8" : "sharpen r1";
+        int radius = (type == FILTER_BLUR) ? 8 : FILTER_SHARPEN_RADIUS;
+        double base = 0;
+        for (int workers = 1; workers <= max_workers; workers *= 2) {
+            WorkPool pool;
+            workpool_init(&pool, workers);
+            double ms = time_filter(&canvas, source, (FilterType)type, radius,
+                                    FILTER_SHARPEN_AMOUNT, &pool);
+            workpool_destroy(&pool);
+
+            if (workers == 1) {
+                base = ms;
+                memcpy(reference, canvas.pixels, bytes);
+            } else if (memcmp(reference, canvas.pixels, bytes) != 0) {
+                failed = 1;
+            }
+            snprintf(metric, sizeof(metric), "%s %d threads", name, workers);
+            bench_report("filter", metric, ms, "ms");
+            snprintf(metric, sizeof(metric), "%s %d threads speedup", name, workers);
+            bench_report("filter", metric, base / ms, "x");
+        }
+    }
+    bench_report("filter", "threads match 1 thread", !failed, "");
+
+    // Strumenti locali: ogni frame deve stare nel budget
+    for (int smudge = 0; smudge <= 1; smudge++) {
+        double avg;
+        double worst = run_drag(&canvas, source, smudge, &avg);
+        const char *name = smudge ? "smudge" : "blur brush";
+        snprintf(metric, sizeof(metric), "%s size %d frame avg", name, BRUSH_SIZE_MAX);
+        bench_report("filter", metric, avg, "ms");
+        snprintf(metric, sizeof(metric), "%s size %d frame max", name, BRUSH_SIZE_MAX);
+        bench_report("filter", metric, worst / 1000.0, "ms");
+        if (worst >= FRAME_US) failed = 1;
+    }
+
+    free(source);
+    free(reference);
+    canvas_destroy(&canvas);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "bench.h"
+#include "gradient.h"
+
+#define REPEATS     16
+#define FRAME_US    16667
+
+static const char *mode_names[GRADIENT_MODE_COUNT] = {
+    "linear", "radial", "linear rect", "radial circle"
+};
+
+// Riferimento: un pixel alla volta con canvas_draw_pixel, t in float, senza dither
+static void naive_fill(Canvas *canvas, GradientMode mode, int x0, int y0, int x1, int y1,
+                       int radius, unsigned int c0, unsigned int c1)
+{
+    float dx = (float)(x1 - x0), dy = (float)(y1 - y0);
+    float len2 = dx * dx + dy * dy;
+    for (int y = 0; y < canvas->height; y++) {
+        for (int x = 0; x < canvas->width; x++) {
+            float px = (float)(x - x0), py = (float)(y - y0);
+            float t;
+            if (mode == GRADIENT_LINEAR || mode == GRADIENT_LINEAR_RECT) {
+                if (mode == GRADIENT_LINEAR_RECT &&
+                    (x < (x0 < x1 ? x0 : x1) || x > (x0 > x1 ? x0 : x1) ||
+                     y < (y0 < y1 ? y0 : y1) || y > (y0 > y1 ? y0 : y1))) continue;
+                t = (px * dx + py * dy) / len2;
+            } else {
+                float d = sqrtf(px * px + py * py);
+                if (mode == GRADIENT_RADIAL_CIRCLE && d > (float)radius) continue;
+                t = d / (float)radius;
+            }
+            if (t < 0.0f) t = 0.0f;
+            if (t > 1.0f) t = 1.0f;
+            unsigned int c = 0;
+            for (int ch = 0; ch < 4; ch++) {
+                float a = (float)((c0 >> (8 * ch)) & 0xFF), b = (float)((c1 >> (8 * ch)) & 0xFF);
+                c |= (unsigned int)(a + (b - a) * t + 0.5f) << (8 * ch);
+            }
+            canvas_draw_pixel(canvas, x, y, c);
+        }
+    }
+}
+
+int bench_gradient(void) {
+    Canvas canvas;
+    if (canvas_init(&canvas) < 0) return -1;
+
+    // Trascinamento lungo tutto lo schermo, come il caso peggiore dello strumento
+    int x0 = 40, y0 = 60, x1 = SCREEN_W - 40, y1 = SCREEN_H - 60;
+    int radius = (int)sqrtf((float)((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0)));
+    unsigned int c0 = RGBA8(20, 40, 200, 255), c1 = RGBA8(250, 180, 30, 255);
+    double pixels = (double)SCREEN_W * SCREEN_H;
+    char metric[64];
+    int failed = 0;
+
+    for (int mode = 0; mode < GRADIENT_MODE_COUNT; mode++) {
+        uint64_t t = platform_time_us();
+        for (int i = 0; i < REPEATS; i++) {
+            naive_fill(&canvas, (GradientMode)mode, x0, y0, x1, y1, radius, c0, c1);
+        }
+        double naive = bench_elapsed(t) * 1000.0 / REPEATS;
+
+        t = platform_time_us();
+        for (int i = 0; i < REPEATS; i++) {
+            gradient_fill(&canvas, (GradientMode)mode, x0, y0, x1, y1, radius, c0, c1);
+        }
+        double fast = bench_elapsed(t) * 1000.0 / REPEATS;
+
+        snprintf(metric, sizeof(metric), "%s per-pixel", mode_names[mode]);
+        bench_report("gradient", metric, naive, "ms");
+        snprintf(metric, sizeof(metric), "%s span", mode_names[mode]);
+        bench_report("gradient", metric, fast, "ms");
+        if (gradient_is_full((GradientMode)mode)) {
+            snprintf(metric, sizeof(metric), "%s span throughput", mode_names[mode]);
+            bench_report("gradient", metric, pixels / (fast * 1000.0), "Mpix/s");
+        }
+        snprintf(metric, sizeof(metric), "%s speedup", mode_names[mode]);
+        bench_report("gradient", metric, naive / fast, "x");
+        if (fast * 1000.0 >= FRAME_US) failed = 1;
+    }
+
+    canvas_destroy(&canvas);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "journal.h"
+
+#define SESSION_OPS 2000
+
+// Sessione sintetica: tratti di pennello, shape, spray e qualche clear
+static void make_session(Journal *journal, Canvas *canvas) {
+    srand(1234);
+    for (int op = 0; op < SESSION_OPS; op++) {
+        int kind = rand() % 16;
+        int x = rand() % SCREEN_W;
+        int y = rand() % SCREEN_H;
+        int size = BRUSH_SIZE_MIN + rand() % 8;
+        unsigned int color = RGBA8(rand() & 255, rand() & 255, rand() & 255, 255);
+
+        journal_begin_op(journal, canvas);
+        if (kind < 10) {
+            journal_record(journal, canvas, JCMD_BRUSH, x, y, x, y, size, color);
+            for (int seg = 0; seg < 20; seg++) {
+                int nx = x + rand() % 21 - 10;
+                int ny = y + rand() % 21 - 10;
+                journal_record(journal, canvas, JCMD_LINE, x, y, nx, ny, size, color);
+                x = nx;
+                y = ny;
+            }
+        } else if (kind < 14) {
+            JournalCmdType type = (JournalCmdType)(JCMD_RECT + rand() % 4);
+            journal_record(journal, canvas, type, x, y,
+                           x + rand() % 101 - 50, y + rand() % 101 - 50, size, color);
+        } else if (kind < 15) {
+            journal_record(journal, canvas, JCMD_SPRAY, x, y, x, y, size * 3, color);
+        } else if (rand() % 8 == 0) {
+            journal_record(journal, canvas, JCMD_CLEAR, 0, 0, 0, 0, 0, canvas->bg_color);
+        }
+    }
+}
+
+int bench_journal(void) {
+    Canvas canvas;
+    if (canvas_init(&canvas) < 0) return -1;
+
+    Journal journal;
+    if (journal_init(&journal, canvas.bg_color) < 0) {
+        canvas_destroy(&canvas);
+        return -1;
+    }
+
+    make_session(&journal, &canvas);
+    bench_report("journal", "commands", journal.count, "cmd");
+
+    uint64_t t = platform_time_us();
+    journal_rasterize(&journal, &canvas, 1);
+    double secs = bench_elapsed(t);
+    bench_report("journal", "replay 1x", journal.count / secs, "cmd/s");
+
+    // Undo: keyframe più vicino + coda
+    const int undos = 100;
+    t = platform_time_us();
+    for (int i = 0; i < undos; i++) journal_undo(&journal, &canvas);
+    bench_report("journal", "undo latency", bench_elapsed(t) * 1000.0 / undos, "ms");
+
+    t = platform_time_us();
+    for (int i = 0; i < undos; i++) journal_redo(&journal, &canvas);
+    bench_report("journal", "redo latency", bench_elapsed(t) * 1000.0 / undos, "ms");
+
+    const char *path = "bench_journal.drwj";
+    if (journal_save(&journal, path) == 0) {
+        FILE *f = fopen(path, "rb");
+        if (f) {
+            fseek(f, 0, SEEK_END);
+            bench_report("journal", "project file", ftell(f) / 1024.0, "KiB");
+            fclose(f);
+        }
+        remove(path);
+    }
+
+    // Re-rasterizzazione a risoluzione doppia
+    unsigned int *big = (unsigned int *)malloc((size_t)SCREEN_W * SCREEN_H * 4 * sizeof(unsigned int));
+    if (big) {
+        Canvas hires;
+        canvas_init_buffer(&hires, big, SCREEN_W * 2, SCREEN_H * 2);
+        t = platform_time_us();
+        journal_rasterize(&journal, &hires, 2);
+        secs = bench_elapsed(t);
+        bench_report("journal", "replay 2x", journal.count / secs, "cmd/s");
+        free(big);
+    }
+
+    journal_destroy(&journal);
+    canvas_destroy(&canvas);
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+#include "journal.h"
+#include "latency.h"
+#include "stroke.h"
+
+/*
+ * Latenza touch -> schermo con input sintetico: una traccia di campioni con
+ * il loro istante di acquisizione, riprodotta in tempo reale con la stessa
+ * pipeline del frame dell'app (journal, canvas_update_texture, swap) e un
+ * vblank simulato a 60 Hz. I CSV restano nella cartella corrente per il
+ * confronto fra due build.
+ */
+
+#define FRAMES     240
+#define FRAME_US   16667
+// Il touch campiona a una frequenza leggermente diversa dal display:
+// la fase fra campione e frame scorre e copre tutti i casi
+#define SAMPLE_US  16200
+#define TRACE_LEN  (FRAMES * FRAME_US / SAMPLE_US + 2)
+
+typedef struct {
+    uint32_t t_us;       // istante di acquisizione, dall'inizio della traccia
+    int x, y;
+    int pressure;        // 0-255
+} TraceSample;
+
+typedef enum {
+    WORK_PENCIL,         // tratto sottile (JCMD_LINE)
+    WORK_STROKE,         // tratto largo sensibile alla pressione
+} Workload;
+
+// Spirale che attraversa il canvas, pressione che sale e scende
+static void make_trace(TraceSample *trace) {
+    for (int i = 0; i < TRACE_LEN; i++) {
+        float a = (float)i * 0.05f;
+        float r = 60.0f + (float)(i % 200);
+        trace[i].t_us = (uint32_t)i * SAMPLE_US;
+        trace[i].x = SCREEN_W / 2 + (int)(r * cosf(a));
+        trace[i].y = SCREEN_H / 2 + (int)(r * 0.5f * sinf(a));
+        trace[i].pressure = 128 + (int)(120.0f * sinf(a * 0.3f));
+    }
+}
+
+static void wait_until(uint64_t t_us) {
+    uint64_t now = platform_time_us();
+    if (now < t_us) platform_sleep_us((uint32_t)(t_us - now));
+}
+
+static int run_trace(const TraceSample *trace, Workload work, const char *label,
+                     const char *csv)
+{
+    Canvas canvas;
+    Journal journal;
+    Latency lat;
+
+    if (latency_init(&lat) < 0) {
+        latency_destroy(&lat);
+        return -1;
+    }
+    if (canvas_init(&canvas) < 0) {
+        latency_destroy(&lat);
+        return -1;
+    }
+    if (journal_init(&journal, canvas.bg_color) < 0) {
+        canvas_destroy(&canvas);
+        latency_destroy(&lat);
+        return -1;
+    }
+    lat.enabled = 1;
+
+    uint64_t base = platform_time_us() + FRAME_US;
+    int last = -1;
+    journal_begin_op(&journal, &canvas);
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        // Vblank precedente: inizia il frame
+        wait_until(base + (uint64_t)frame * FRAME_US);
+
+        // input_update: l'ultimo campione già acquisito
+        uint64_t now = platform_time_us() - base;
+        int s = last < 0 ? 0 : last;
+        while (s + 1 < TRACE_LEN && trace[s + 1].t_us <= now) s++;
+        int fresh = trace[s].t_us <= now && s != last;
+        latency_begin(&lat, fresh ? base + trace[s].t_us : 0);
+
+        uint32_t seq = journal.seq;
+        if (fresh && last >= 0) {
+            const TraceSample *a = &trace[last], *b = &trace[s];
+            if (work == WORK_PENCIL) {
+                journal_record(&journal, &canvas, JCMD_LINE, a->x, a->y, b->x, b->y, 3,
+                               RGBA8(0, 0, 0, 255));
+            } else {
+                journal_record_stroke(&journal, &canvas,
+                                      a->x, a->y, stroke_pressure_size(48, a->pressure),
+                                      b->x, b->y, stroke_pressure_size(48, b->pressure),
+                                      RGBA8(200, 40, 40, 255), 255);
+            }
+        }
+        if (fresh) last = s;
+        if (journal.seq != seq) latency_mark(&lat, LATENCY_CANVAS);
+
+        canvas_update_texture(&canvas);
+        latency_mark(&lat, LATENCY_UPLOAD);
+        vita2d_swap_buffers();
+        latency_mark(&lat, LATENCY_SWAP);
+
+        // Il frame va a schermo al vblank successivo
+        uint64_t vblank = base + (uint64_t)(frame + 1) * FRAME_US;
+        wait_until(vblank);
+        latency_mark_at(&lat, LATENCY_VBLANK, vblank);
+        latency_end(&lat);
+    }
+
+    char metric[64];
+    for (int st = 0; st < LATENCY_STAGE_COUNT; st++) {
+        snprintf(metric, sizeof(metric), "%s %s p50", label, latency_stage_name((LatencyStage)st));
+        bench_report("latency", metric, latency_percentile(&lat.stages[st], 50) / 1000.0, "ms");
+    }
+    static const int pcts[3] = { 50, 95, 99 };
+    for (int p = 0; p < 3; p++) {
+        snprintf(metric, sizeof(metric), "%s total p%d", label, pcts[p]);
+        bench_report("latency", metric, latency_percentile(&lat.total, pcts[p]) / 1000.0, "ms");
+    }
+    snprintf(metric, sizeof(metric), "%s total max", label);
+    bench_report("latency", metric, lat.total.max_us / 1000.0, "ms");
+    snprintf(metric, sizeof(metric), "%s samples inked", label);
+    bench_report("latency", metric, lat.total.count, "");
+
+    // Il touch è più veloce del display: quasi ogni frame porta un campione
+    // nuovo a schermo (ne manca qualcuno solo se un frame parte in ritardo)
+    int failed = lat.total.count < FRAMES * 9 / 10;
+    if (latency_dump(&lat, csv) != 0) failed = 1;
+
+    latency_destroy(&lat);
+    journal_destroy(&journal);
+    canvas_destroy(&canvas);
+    return failed ? -1 : 0;
+}
+
+int bench_latency(void) {
+    TraceSample *trace = (TraceSample *)malloc(TRACE_LEN * sizeof(TraceSample));
+    if (!trace) return -1;
+    make_trace(trace);
+
+    int failed = 0;
+    if (run_trace(trace, WORK_PENCIL, "pencil", "bench_latency_pencil.csv") != 0) failed = 1;
+    if (run_trace(trace, WORK_STROKE, "stroke", "bench_latency_stroke.csv") != 0) failed = 1;
+
+    free(trace);
+    return failed ? -1 : 0;
+}
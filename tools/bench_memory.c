@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "journal.h"
+#include "filter.h"
+#include "shape.h"
+#include "stroke.h"
+#include "membudget.h"
+
+/*
+ * Budget di memoria: gli stessi percorsi del frame con l'heap (senza
+ * mem_init) e con pool e arena, poi la history con un limite stretto.
+ * Quando il limite è raggiunto il journal rinuncia ai keyframe: undo deve
+ * restare corretto (confronto con il ridisegno da zero) e nessuna
+ * operazione deve andare persa finché c'è un keyframe da scartare.
+ */
+
+#define FRAMES        120
+#define DRAG_STEP     40
+#define POLY_POINTS   24
+// Limite della history: un paio di keyframe, poi si scarta
+#define TIGHT_HISTORY (6u * 1024 * 1024)
+#define TIGHT_OPS     200
+#define UNDO_OPS      120
+// Limite che regge solo i primi due raddoppi dei comandi
+#define TINY_HISTORY  (64u * 1024)
+#define TINY_CMDS     3000
+
+// Un frame del trascinamento: blur a pennello largo e poligono AA
+static double run_frames(Canvas *canvas) {
+    int xs[POLY_POINTS], ys[POLY_POINTS];
+    srand(11);
+    int x = SCREEN_W / 2, y = SCREEN_H / 2;
+    double total = 0;
+    for (int frame = 0; frame < FRAMES; frame++) {
+        int nx = x + rand() % (2 * DRAG_STEP + 1) - DRAG_STEP;
+        int ny = y + rand() % (2 * DRAG_STEP + 1) - DRAG_STEP;
+        if (nx < 0 || nx >= SCREEN_W) nx = x;
+        if (ny < 0 || ny >= SCREEN_H) ny = y;
+        for (int i = 0; i < POLY_POINTS; i++) {
+            xs[i] = nx + rand() % 161 - 80;
+            ys[i] = ny + rand() % 161 - 80;
+        }
+
+        uint64_t t = platform_time_us();
+        filter_stroke_segment(canvas, FILTER_BLUR, FILTER_BLUR_RADIUS, 0,
+                              x, y, nx, ny, BRUSH_SIZE_MAX);
+        shape_draw_polygon(canvas, xs, ys, POLY_POINTS, 6, RGBA8(30, 90, 200, 255),
+                           SHAPE_FLAG_AA);
+        mem_frame_end();
+        total += bench_elapsed(t);
+        x = nx;
+        y = ny;
+    }
+    return total * 1000.0 / FRAMES;
+}
+
+static double time_frames(void) {
+    Canvas canvas;
+    if (canvas_init(&canvas) < 0) return -1;
+    canvas_clear(&canvas, RGBA8(240, 230, 210, 255));
+    double ms = run_frames(&canvas);
+    canvas_destroy(&canvas);
+    return ms;
+}
+
+// Operazione che l'undo deve saper ripetere: tratti, forme e filtri
+static void record_op(Journal *journal, Canvas *canvas, int i) {
+    int x = (i * 37) % SCREEN_W, y = (i * 53) % SCREEN_H;
+    journal_begin_op(journal, canvas);
+    switch (i % 4) {
+        case 0:
+            journal_record_stroke(journal, canvas, x, y, 24 * STROKE_SUBPIXEL,
+                                  SCREEN_W - x, SCREEN_H - y, 8 * STROKE_SUBPIXEL,
+                                  RGBA8(200, 40, 40, 255), 255);
+            break;
+        case 1:
+            journal_record(journal, canvas, JCMD_LINE, x, y, x + 120, y + 40, 5,
+                           RGBA8(0, 0, 0, 255));
+            break;
+        case 2:
+            journal_record_shape(journal, canvas, x, y, x + 90, y + 60, 0,
+                                 RGBA8(40, 160, 60, 255), 0);
+            break;
+        default:
+            journal_record_filter(journal, canvas, JCMD_FILTER_STROKE, x, y, x + 80, y, 30,
+                                  FILTER_PARAMS(FILTER_BLUR, FILTER_BLUR_RADIUS, 0));
+            break;
+    }
+}
+
+// Ridisegna da zero e confronta con il canvas
+static int check_canvas(const Journal *journal, const Canvas *canvas, unsigned int *scratch) {
+    Canvas ref;
+    canvas_init_buffer(&ref, scratch, SCREEN_W, SCREEN_H);
+    journal_rasterize(journal, &ref, 1);
+    return memcmp(ref.pixels, canvas->pixels,
+                  (size_t)SCREEN_W * SCREEN_H * sizeof(unsigned int)) == 0;
+}
+
+static int reclaim_history(void *user) {
+    return journal_trim((Journal *)user);
+}
+
+// History con limite stretto: keyframe scartati, undo sempre corretto
+static int run_tight_history(unsigned int *scratch) {
+    Canvas canvas;
+    Journal journal;
+    if (canvas_init(&canvas) < 0) return -1;
+    if (journal_init(&journal, canvas.bg_color) < 0) {
+        canvas_destroy(&canvas);
+        return -1;
+    }
+    mem_set_limit(MEM_HISTORY, TIGHT_HISTORY);
+    mem_set_reclaim(MEM_HISTORY, reclaim_history, &journal);
+
+    for (int i = 0; i < TIGHT_OPS; i++) record_op(&journal, &canvas, i);
+
+    int failed = 0;
+    double undo_total = 0, undo_worst = 0;
+    for (int i = 0; i < UNDO_OPS; i++) {
+        uint64_t t = platform_time_us();
+        if (journal_undo(&journal, &canvas) != 1) failed = 1;
+        double dt = bench_elapsed(t);
+        undo_total += dt;
+        if (dt > undo_worst) undo_worst = dt;
+        // Qualche punto di controllo: il ridisegno costa più dell'undo
+        if (i % 20 == 19 && !check_canvas(&journal, &canvas, scratch)) failed = 1;
+    }
+    // Redo fino in fondo, poi nuove operazioni sopra la coda troncata
+    while (journal_redo(&journal, &canvas)) {}
+    for (int i = 0; i < 32; i++) record_op(&journal, &canvas, TIGHT_OPS + i);
+    if (!check_canvas(&journal, &canvas, scratch)) failed = 1;
+
+    MemStats st;
+    mem_get_stats(MEM_HISTORY, &st);
+    bench_report("memory", "tight history peak", st.peak / (1024.0 * 1024.0), "MB");
+    bench_report("memory", "tight history reclaims", st.reclaims, "");
+    bench_report("memory", "tight history failures", st.failures, "");
+    bench_report("memory", "tight keyframes left", journal.num_keyframes, "");
+    bench_report("memory", "tight dropped cmds", journal.dropped_cmds, "");
+    bench_report("memory", "tight undo avg", undo_total * 1000.0 / UNDO_OPS, "ms");
+    bench_report("memory", "tight undo worst", undo_worst * 1000.0, "ms");
+    bench_report("memory", "tight undo matches redraw", !failed, "");
+    // Con keyframe da scartare nessuna operazione va persa
+    if (st.reclaims == 0 || journal.dropped_cmds != 0) failed = 1;
+
+    mem_set_reclaim(MEM_HISTORY, NULL, NULL);
+    journal_destroy(&journal);
+    canvas_destroy(&canvas);
+    return failed ? -1 : 0;
+}
+
+// Limite che non basta per i comandi: si disegna comunque e si contano
+static int run_tiny_history(void) {
+    Canvas canvas;
+    Journal journal;
+    if (canvas_init(&canvas) < 0) return -1;
+    mem_set_limit(MEM_HISTORY, TINY_HISTORY);
+    if (journal_init(&journal, canvas.bg_color) < 0) {
+        canvas_destroy(&canvas);
+        return -1;
+    }
+    mem_set_reclaim(MEM_HISTORY, reclaim_history, &journal);
+
+    int failed = 0;
+    for (int i = 0; i < TINY_CMDS; i++) {
+        int x = (i * 7) % SCREEN_W;
+        journal_record(&journal, &canvas, JCMD_LINE, x, 0, x, SCREEN_H - 1, 1,
+                       RGBA8(0, 0, 0, 255));
+    }
+    // L'ultima riga disegnata anche senza posto nel journal
+    int x = ((TINY_CMDS - 1) * 7) % SCREEN_W;
+    if (canvas.pixels[(SCREEN_H / 2) * SCREEN_W + x] != RGBA8(0, 0, 0, 255)) failed = 1;
+
+    bench_report("memory", "tiny recorded cmds", journal.count, "");
+    bench_report("memory", "tiny dropped cmds", journal.dropped_cmds, "");
+    if (journal.count + (int)journal.dropped_cmds != TINY_CMDS || journal.dropped_cmds == 0) {
+        failed = 1;
+    }
+
+    mem_set_reclaim(MEM_HISTORY, NULL, NULL);
+    journal_destroy(&journal);
+    canvas_destroy(&canvas);
+    return failed ? -1 : 0;
+}
+
+int bench_memory(void) {
+    // Prima senza mem_init: tutto sull'heap
+    double heap_ms = time_frames();
+    if (mem_init() != 0) return -1;
+    MemSummary before, sum;
+    mem_get_summary(&before);
+    double arena_ms = time_frames();
+    mem_get_summary(&sum);
+    bench_report("memory", "reserved", sum.reserved / (1024.0 * 1024.0), "MB");
+    bench_report("memory", "frame (heap)", heap_ms, "ms");
+    bench_report("memory", "frame (pool+arena)", arena_ms, "ms");
+    bench_report("memory", "arena peak", sum.scratch_peak / 1024.0, "KB");
+    // Il frame non deve chiedere nulla all'heap
+    unsigned int heap_calls = (sum.scratch_heap - before.scratch_heap) +
+                              (sum.pool_misses - before.pool_misses);
+    bench_report("memory", "heap calls per frame", (double)heap_calls / FRAMES, "");
+    int failed = heap_ms < 0 || arena_ms < 0 || heap_calls != 0;
+
+    // Il ridisegno di controllo sta fuori dal budget
+    unsigned int *scratch = (unsigned int *)malloc((size_t)SCREEN_W * SCREEN_H * sizeof(unsigned int));
+    if (!scratch) failed = 1;
+    if (scratch && run_tight_history(scratch) != 0) failed = 1;
+    if (run_tiny_history() != 0) failed = 1;
+    free(scratch);
+
+    for (int s = 0; s < MEM_SUBSYSTEM_COUNT; s++) {
+        MemStats st;
+        char metric[64];
+        mem_get_stats((MemSubsystem)s, &st);
+        snprintf(metric, sizeof(metric), "%s peak", mem_subsystem_name((MemSubsystem)s));
+        bench_report("memory", metric, st.peak / 1024.0, "KB");
+    }
+
+    mem_shutdown();
+    return failed ? -1 : 0;
+}
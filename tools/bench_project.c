@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+
+#include "bench.h"
+#include "project.h"
+
+#define BENCH_PROJECT "bench_project.drwj"
+#define BENCH_PNG     "bench_project.png"
+
+static const int sizes[] = { 2048, 4096, 8192 };
+#define NUM_SIZES (int)(sizeof(sizes) / sizeof(sizes[0]))
+
+static int write_png(const char *path, const unsigned int *pixels, int w, int h) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png_create_info_struct(png);
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        fclose(f);
+        return -1;
+    }
+    png_init_io(png, f);
+    png_set_IHDR(png, info, w, h, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    for (int y = 0; y < h; y++) {
+        png_write_row(png, (png_const_bytep)&pixels[(size_t)y * w]);
+    }
+    png_write_end(png, NULL);
+    png_destroy_write_struct(&png, &info);
+    fclose(f);
+    return 0;
+}
+
+// Caricamento classico: tutta l'immagine decodificata prima del primo frame
+static int load_png_first_frame(void *arg) {
+    const char *path = (const char *)arg;
+    unsigned int *frame = (unsigned int *)malloc(SCREEN_W * SCREEN_H * sizeof(unsigned int));
+    if (!frame) return -1;
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        free(frame);
+        return -1;
+    }
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png_create_info_struct(png);
+    unsigned int *image = NULL;
+    png_bytep *rows = NULL;
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, NULL);
+        fclose(f);
+        free(image);
+        free(rows);
+        free(frame);
+        return -1;
+    }
+    png_init_io(png, f);
+    png_read_info(png, info);
+    int w = png_get_image_width(png, info);
+    int h = png_get_image_height(png, info);
+
+    image = (unsigned int *)malloc((size_t)w * h * sizeof(unsigned int));
+    rows = (png_bytep *)malloc(h * sizeof(png_bytep));
+    for (int y = 0; y < h; y++) rows[y] = (png_bytep)&image[(size_t)y * w];
+    png_read_image(png, rows);
+    png_destroy_read_struct(&png, &info, NULL);
+    fclose(f);
+
+    for (int y = 0; y < SCREEN_H; y++) {
+        memcpy(&frame[y * SCREEN_W], &image[(size_t)y * w], SCREEN_W * sizeof(unsigned int));
+    }
+    free(image);
+    free(rows);
+    free(frame);
+    return 0;
+}
+
+static int load_project_first_frame(void *arg) {
+    const char *path = (const char *)arg;
+    unsigned int *frame = (unsigned int *)malloc(SCREEN_W * SCREEN_H * sizeof(unsigned int));
+    ProjectReader reader;
+    if (!frame || project_open(&reader, path) != 0) {
+        free(frame);
+        return -1;
+    }
+    int ret = project_read_region(&reader, 0, 0, SCREEN_W, SCREEN_H, frame, SCREEN_W);
+    project_close(&reader);
+    free(frame);
+    return ret;
+}
+
+static long file_kb(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size / 1024;
+}
+
+static int bench_size(int size) {
+    unsigned int *pixels = (unsigned int *)malloc((size_t)size * size * sizeof(unsigned int));
+    if (!pixels) return -1;
+
+    // Disegno sintetico: tratti e forme sparsi su fondo bianco
+    Canvas canvas;
+    canvas_init_buffer(&canvas, pixels, size, size);
+    canvas_clear(&canvas, canvas.bg_color);
+    srand(size);
+    for (int i = 0; i < size / 2; i++) {
+        int x = rand() % size, y = rand() % size;
+        unsigned int color = RGBA8(rand() & 255, rand() & 255, rand() & 255, 255);
+        if (i % 8 == 0) {
+            canvas_draw_filled_circle(&canvas, x, y, 8 + rand() % 40, color);
+        } else {
+            canvas_draw_line(&canvas, x, y, x + rand() % 201 - 100, y + rand() % 201 - 100,
+                             2 + rand() % 6, color);
+        }
+    }
+
+    Journal journal;
+    journal_init(&journal, canvas.bg_color);
+
+    uint64_t t = platform_time_us();
+    int ok = project_save(BENCH_PROJECT, &journal, pixels, size, size) == 0;
+    double save_ms = bench_elapsed(t) * 1000.0;
+    ok = ok && write_png(BENCH_PNG, pixels, size, size) == 0;
+
+    // Il padre deve essere leggero prima del fork: l'RSS ereditato conta
+    journal_destroy(&journal);
+    free(pixels);
+    if (!ok) return -1;
+
+    char metric[64];
+    double ms;
+    long kb;
+
+    snprintf(metric, sizeof(metric), "%dx%d project save", size, size);
+    bench_report("project", metric, save_ms, "ms");
+    snprintf(metric, sizeof(metric), "%dx%d file size png", size, size);
+    bench_report("project", metric, file_kb(BENCH_PNG), "KiB");
+    snprintf(metric, sizeof(metric), "%dx%d file size project", size, size);
+    bench_report("project", metric, file_kb(BENCH_PROJECT), "KiB");
+
+    if (bench_run_child(load_png_first_frame, (void *)BENCH_PNG, &ms, &kb) == 0) {
+        snprintf(metric, sizeof(metric), "%dx%d first frame png", size, size);
+        bench_report("project", metric, ms, "ms");
+        snprintf(metric, sizeof(metric), "%dx%d peak rss png", size, size);
+        bench_report("project", metric, kb / 1024.0, "MiB");
+    }
+    if (bench_run_child(load_project_first_frame, (void *)BENCH_PROJECT, &ms, &kb) == 0) {
+        snprintf(metric, sizeof(metric), "%dx%d first frame project", size, size);
+        bench_report("project", metric, ms, "ms");
+        snprintf(metric, sizeof(metric), "%dx%d peak rss project", size, size);
+        bench_report("project", metric, kb / 1024.0, "MiB");
+    }
+
+    remove(BENCH_PROJECT);
+    remove(BENCH_PNG);
+    return 0;
+}
+
+int bench_project(void) {
+    for (int i = 0; i < NUM_SIZES; i++) {
+        if (bench_size(sizes[i]) != 0) return -1;
+    }
+    return 0;
+}
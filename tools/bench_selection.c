@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "selection.h"
+
+#define FRAMES     60
+#define FRAME_US   16667
+
+typedef struct {
+    int w, h;
+} SelSize;
+
+static const SelSize sizes[] = {
+    { 64, 64 }, { 128, 128 }, { 256, 256 }, { 512, 512 }, { SCREEN_W, SCREEN_H }
+};
+#define NUM_SIZES (int)(sizeof(sizes) / sizeof(sizes[0]))
+
+// Trascinamento tipico: ruota e ingrandisce un po' a ogni frame
+static void drag_step(Selection *sel, int frame) {
+    sel->transform.dx = frame * 2;
+    sel->transform.dy = frame;
+    sel->transform.angle = frame * 150;
+    sel->transform.sx = SELECTION_SCALE_ONE + frame;
+    sel->transform.sy = SELECTION_SCALE_ONE + frame;
+}
+
+static int bench_size(Canvas *canvas, Canvas *view, const SelSize *size) {
+    Selection sel;
+    selection_init(&sel);
+    int x = (SCREEN_W - size->w) / 2, y = (SCREEN_H - size->h) / 2;
+    selection_begin(&sel, 0, x, y);
+    selection_add_point(&sel, x + size->w - 1, y + size->h - 1);
+    if (selection_lift(&sel, canvas) != 0) return -1;
+
+    double preview_worst = 0, preview_total = 0, commit_total = 0;
+    for (int frame = 0; frame < FRAMES; frame++) {
+        drag_step(&sel, frame);
+
+        // Anteprima come nel main loop, sopra la copia del canvas (non misurata)
+        memcpy(view->pixels, canvas->pixels, SCREEN_W * SCREEN_H * sizeof(unsigned int));
+        uint64_t t = platform_time_us();
+        selection_render_preview(&sel, view, canvas->bg_color);
+        double dt = bench_elapsed(t);
+        preview_total += dt;
+        if (dt > preview_worst) preview_worst = dt;
+
+        t = platform_time_us();
+        selection_draw(view, 0, 0, &sel.buffer, &sel.transform, 1, SEL_BILINEAR);
+        commit_total += bench_elapsed(t);
+    }
+
+    char metric[64];
+    double mpix = (double)size->w * size->h * FRAMES / 1000000.0;
+    snprintf(metric, sizeof(metric), "%dx%d preview avg", size->w, size->h);
+    bench_report("selection", metric, preview_total * 1000.0 / FRAMES, "ms");
+    snprintf(metric, sizeof(metric), "%dx%d preview max", size->w, size->h);
+    bench_report("selection", metric, preview_worst * 1000.0, "ms");
+    snprintf(metric, sizeof(metric), "%dx%d nearest", size->w, size->h);
+    bench_report("selection", metric, mpix / preview_total, "Mpix/s");
+    snprintf(metric, sizeof(metric), "%dx%d bilinear", size->w, size->h);
+    bench_report("selection", metric, mpix / commit_total, "Mpix/s");
+
+    selection_cancel(&sel);
+    return preview_worst * 1000000.0 < FRAME_US ? 0 : -1;
+}
+
+int bench_selection(void) {
+    Canvas canvas, view;
+    if (canvas_init(&canvas) < 0) return -1;
+    if (canvas_init(&view) < 0) {
+        canvas_destroy(&canvas);
+        return -1;
+    }
+
+    srand(99);
+    for (int i = 0; i < 2000; i++) {
+        int x = rand() % SCREEN_W, y = rand() % SCREEN_H;
+        canvas_draw_filled_circle(&canvas, x, y, 4 + rand() % 20,
+                                  RGBA8(rand() & 255, rand() & 255, rand() & 255, 255));
+    }
+
+    int failed = 0;
+    for (int i = 0; i < NUM_SIZES; i++) {
+        if (bench_size(&canvas, &view, &sizes[i]) != 0) failed = 1;
+    }
+
+    canvas_destroy(&canvas);
+    canvas_destroy(&view);
+    return failed ? -1 : 0;
+}
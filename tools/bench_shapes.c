@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "bench.h"
+#include "shape.h"
+
+#define REPEATS     16
+#define FRAME_US    16667
+#define THICK       BRUSH_SIZE_MAX
+#define STAR_POINTS 16
+
+// Riferimenti per-pixel: ogni pixel del rettangolo che contiene la forma
+// viene provato con canvas_draw_pixel, come canvas_draw_filled_circle
+static void naive_ring(Canvas *canvas, int cx, int cy, int rx, int ry, int thick) {
+    float h = (thick > 0) ? thick * 0.5f : 0.5f;
+    float ox = rx + h, oy = ry + h, ix = rx - h, iy = ry - h;
+    for (int y = cy - (int)oy; y <= cy + (int)oy; y++) {
+        for (int x = cx - (int)ox; x <= cx + (int)ox; x++) {
+            float dx = (float)(x - cx), dy = (float)(y - cy);
+            if ((dx * dx) / (ox * ox) + (dy * dy) / (oy * oy) > 1.0f) continue;
+            if (thick > 0 && ix > 0 && iy > 0 &&
+                (dx * dx) / (ix * ix) + (dy * dy) / (iy * iy) < 1.0f) continue;
+            canvas_draw_pixel(canvas, x, y, RGBA8(200, 30, 30, 255));
+        }
+    }
+}
+
+// Distanza del pixel dal bordo di un rettangolo arrotondato (negativa dentro)
+static float round_rect_dist(float x, float y, float hw, float hh, float c) {
+    float qx = fabsf(x) - hw + c, qy = fabsf(y) - hh + c;
+    float ox = (qx > 0) ? qx : 0, oy = (qy > 0) ? qy : 0;
+    float in = (qx > qy) ? qx : qy;
+    return sqrtf(ox * ox + oy * oy) + ((in < 0) ? in : 0) - c;
+}
+
+static void naive_round_rect(Canvas *canvas, int x0, int y0, int x1, int y1, int c, int thick) {
+    float hw = (x1 - x0) * 0.5f, hh = (y1 - y0) * 0.5f;
+    float mx = (x0 + x1) * 0.5f, my = (y0 + y1) * 0.5f;
+    float h = (thick > 0) ? thick * 0.5f : 0.5f;
+    for (int y = y0 - (int)h; y <= y1 + (int)h; y++) {
+        for (int x = x0 - (int)h; x <= x1 + (int)h; x++) {
+            float d = round_rect_dist(x - mx, y - my, hw, hh, (float)c);
+            if (d > h || (thick > 0 && d < -h)) continue;
+            canvas_draw_pixel(canvas, x, y, RGBA8(200, 30, 30, 255));
+        }
+    }
+}
+
+// Pari-dispari sul centro di ogni pixel del rettangolo del poligono
+static void naive_polygon(Canvas *canvas, const int *xs, const int *ys, int n) {
+    int min_x = xs[0], max_x = xs[0], min_y = ys[0], max_y = ys[0];
+    for (int i = 1; i < n; i++) {
+        if (xs[i] < min_x) min_x = xs[i];
+        if (xs[i] > max_x) max_x = xs[i];
+        if (ys[i] < min_y) min_y = ys[i];
+        if (ys[i] > max_y) max_y = ys[i];
+    }
+    for (int y = min_y; y <= max_y; y++) {
+        for (int x = min_x; x <= max_x; x++) {
+            int inside = 0;
+            for (int i = 0, j = n - 1; i < n; j = i++) {
+                if ((ys[i] > y) != (ys[j] > y) &&
+                    x < xs[j] + (float)(xs[i] - xs[j]) * (y - ys[j]) / (float)(ys[i] - ys[j])) {
+                    inside = !inside;
+                }
+            }
+            if (inside) canvas_draw_pixel(canvas, x, y, RGBA8(200, 30, 30, 255));
+        }
+    }
+}
+
+typedef enum {
+    CASE_RECT_FILL,
+    CASE_RECT_LINE,
+    CASE_RECT_THICK,
+    CASE_CIRCLE_FILL,
+    CASE_CIRCLE_LINE,
+    CASE_CIRCLE_THICK,
+    CASE_ELLIPSE_FILL,
+    CASE_ELLIPSE_THICK,
+    CASE_ROUND_RECT_FILL,
+    CASE_ROUND_RECT_THICK,
+    CASE_POLYGON_FILL,
+    CASE_POLYGON_THICK,
+    CASE_COUNT
+} ShapeCase;
+
+static const char *case_names[CASE_COUNT] = {
+    "rect fill", "rect 1px", "rect 30px", "circle fill", "circle 1px", "circle 30px",
+    "ellipse fill", "ellipse 30px", "round rect fill", "round rect 30px",
+    "star fill", "star 30px"
+};
+
+static int star_x[STAR_POINTS], star_y[STAR_POINTS];
+
+// Forme a tutto schermo: il caso peggiore di un trascinamento
+static void run_naive(Canvas *canvas, ShapeCase c) {
+    int cx = SCREEN_W / 2, cy = SCREEN_H / 2, r = SCREEN_H / 2 - 1;
+    unsigned int color = RGBA8(200, 30, 30, 255);
+    switch (c) {
+        case CASE_RECT_FILL:
+            canvas_draw_filled_rect(canvas, 0, 0, SCREEN_W - 1, SCREEN_H - 1, color);
+            break;
+        case CASE_RECT_LINE:
+            canvas_draw_rect(canvas, 0, 0, SCREEN_W - 1, SCREEN_H - 1, color);
+            break;
+        case CASE_RECT_THICK:
+            // Oggi un contorno spesso sono timbri di pennello lungo i lati
+            canvas_draw_line(canvas, 0, 0, SCREEN_W - 1, 0, THICK, color);
+            canvas_draw_line(canvas, SCREEN_W - 1, 0, SCREEN_W - 1, SCREEN_H - 1, THICK, color);
+            canvas_draw_line(canvas, SCREEN_W - 1, SCREEN_H - 1, 0, SCREEN_H - 1, THICK, color);
+            canvas_draw_line(canvas, 0, SCREEN_H - 1, 0, 0, THICK, color);
+            break;
+        case CASE_CIRCLE_FILL:
+            canvas_draw_filled_circle(canvas, cx, cy, r, color);
+            break;
+        case CASE_CIRCLE_LINE:
+            canvas_draw_circle(canvas, cx, cy, r, color);
+            break;
+        case CASE_CIRCLE_THICK:
+            naive_ring(canvas, cx, cy, r, r, THICK);
+            break;
+        case CASE_ELLIPSE_FILL:
+            naive_ring(canvas, cx, cy, SCREEN_W / 2 - 1, r, 0);
+            break;
+        case CASE_ELLIPSE_THICK:
+            naive_ring(canvas, cx, cy, SCREEN_W / 2 - 1, r, THICK);
+            break;
+        case CASE_ROUND_RECT_FILL:
+            naive_round_rect(canvas, 0, 0, SCREEN_W - 1, SCREEN_H - 1, SCREEN_H / 4, 0);
+            break;
+        case CASE_ROUND_RECT_THICK:
+            naive_round_rect(canvas, 0, 0, SCREEN_W - 1, SCREEN_H - 1, SCREEN_H / 4, THICK);
+            break;
+        case CASE_POLYGON_FILL:
+            naive_polygon(canvas, star_x, star_y, STAR_POINTS);
+            break;
+        case CASE_POLYGON_THICK:
+            // Lati come linee di pennello: i timbri si sovrappongono
+            for (int i = 0; i < STAR_POINTS; i++) {
+                int j = (i + 1) % STAR_POINTS;
+                canvas_draw_line(canvas, star_x[i], star_y[i], star_x[j], star_y[j], THICK, color);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void run_spans(Canvas *canvas, ShapeCase c, int flags) {
+    int cx = SCREEN_W / 2, cy = SCREEN_H / 2, r = SCREEN_H / 2 - 1;
+    unsigned int color = RGBA8(200, 30, 30, 255);
+    switch (c) {
+        case CASE_RECT_FILL:
+        case CASE_RECT_LINE:
+        case CASE_RECT_THICK:
+            shape_draw_rect(canvas, 0, 0, SCREEN_W - 1, SCREEN_H - 1, 0,
+                            (c == CASE_RECT_FILL) ? 0 : (c == CASE_RECT_LINE) ? 1 : THICK,
+                            color, flags);
+            break;
+        case CASE_CIRCLE_FILL:
+        case CASE_CIRCLE_LINE:
+        case CASE_CIRCLE_THICK:
+            shape_draw_ellipse(canvas, cx, cy, r, r,
+                               (c == CASE_CIRCLE_FILL) ? 0 : (c == CASE_CIRCLE_LINE) ? 1 : THICK,
+                               color, flags);
+            break;
+        case CASE_ELLIPSE_FILL:
+        case CASE_ELLIPSE_THICK:
+            shape_draw_ellipse(canvas, cx, cy, SCREEN_W / 2 - 1, r,
+                               (c == CASE_ELLIPSE_FILL) ? 0 : THICK, color, flags);
+            break;
+        case CASE_ROUND_RECT_FILL:
+        case CASE_ROUND_RECT_THICK:
+            shape_draw_rect(canvas, 0, 0, SCREEN_W - 1, SCREEN_H - 1, SCREEN_H / 4,
+                            (c == CASE_ROUND_RECT_FILL) ? 0 : THICK, color, flags);
+            break;
+        case CASE_POLYGON_FILL:
+        case CASE_POLYGON_THICK:
+            shape_draw_polygon(canvas, star_x, star_y, STAR_POINTS,
+                               (c == CASE_POLYGON_FILL) ? 0 : THICK, color, flags);
+            break;
+        default:
+            break;
+    }
+}
+
+static double time_case(Canvas *canvas, ShapeCase c, int mode) {
+    uint64_t t = platform_time_us();
+    for (int i = 0; i < REPEATS; i++) {
+        if (mode < 0) run_naive(canvas, c);
+        else run_spans(canvas, c, mode);
+    }
+    return bench_elapsed(t) * 1000.0 / REPEATS;
+}
+
+int bench_shapes(void) {
+    Canvas canvas;
+    if (canvas_init(&canvas) < 0) return -1;
+
+    // Stella a tutto schermo: lati lunghi, vertici concavi
+    for (int i = 0; i < STAR_POINTS; i++) {
+        double a = 2.0 * 3.14159265358979 * i / STAR_POINTS;
+        double k = (i & 1) ? 0.45 : 1.0;
+        star_x[i] = SCREEN_W / 2 + (int)(k * (SCREEN_W / 2 - 1) * cos(a));
+        star_y[i] = SCREEN_H / 2 + (int)(k * (SCREEN_H / 2 - 1) * sin(a));
+    }
+
+    char metric[64];
+    int failed = 0;
+    for (int c = 0; c < CASE_COUNT; c++) {
+        double naive = time_case(&canvas, (ShapeCase)c, -1);
+        double fast = time_case(&canvas, (ShapeCase)c, 0);
+        double aa = time_case(&canvas, (ShapeCase)c, SHAPE_FLAG_AA);
+
+        snprintf(metric, sizeof(metric), "%s per-pixel", case_names[c]);
+        bench_report("shapes", metric, naive, "ms");
+        snprintf(metric, sizeof(metric), "%s scanline", case_names[c]);
+        bench_report("shapes", metric, fast, "ms");
+        snprintf(metric, sizeof(metric), "%s scanline aa", case_names[c]);
+        bench_report("shapes", metric, aa, "ms");
+        snprintf(metric, sizeof(metric), "%s speedup", case_names[c]);
+        bench_report("shapes", metric, naive / fast, "x");
+        if (aa * 1000.0 >= FRAME_US) failed = 1;
+    }
+
+    canvas_destroy(&canvas);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "canvas.h"
+#include "stroke.h"
+
+// Segmenti corti come quelli di un tratto touch a 60 fps
+#define SEGMENTS    20000
+#define SEG_LEN     12
+
+static const int brush_sizes[] = { 4, 12, BRUSH_SIZE_MAX };
+#define NUM_BRUSH_SIZES (int)(sizeof(brush_sizes) / sizeof(brush_sizes[0]))
+
+typedef enum {
+    STROKE_STAMPED,    // riferimento: timbri di canvas_draw_line
+    STROKE_FIXED,      // span, spessore costante
+    STROKE_VARIABLE,   // span, spessore da pressione sintetica
+    STROKE_OPACITY     // span, spessore e opacità
+} StrokeMode;
+
+static const char *mode_names[] = { "stamped", "fixed", "variable", "opacity" };
+
+// Passeggiata casuale con pressione che oscilla; stesso seed, stessi segmenti
+static double run_strokes(Canvas *canvas, StrokeMode mode, int brush) {
+    srand(1234);
+    canvas_clear(canvas, canvas->bg_color);
+
+    int x = SCREEN_W / 2, y = SCREEN_H / 2;
+    int pressure = 128;
+    int prev_size = stroke_pressure_size(brush, pressure);
+    unsigned int color = RGBA8(20, 40, 200, 255);
+
+    uint64_t t = platform_time_us();
+    for (int i = 0; i < SEGMENTS; i++) {
+        int nx = x + rand() % (2 * SEG_LEN + 1) - SEG_LEN;
+        int ny = y + rand() % (2 * SEG_LEN + 1) - SEG_LEN;
+        if (nx < 0 || nx >= SCREEN_W) nx = x;
+        if (ny < 0 || ny >= SCREEN_H) ny = y;
+        pressure += rand() % 33 - 16;
+        if (pressure < 0) pressure = 0;
+        if (pressure > 255) pressure = 255;
+        int size = stroke_pressure_size(brush, pressure);
+
+        switch (mode) {
+            case STROKE_STAMPED:
+                canvas_draw_line(canvas, x, y, nx, ny, brush, color);
+                break;
+            case STROKE_FIXED:
+                canvas_draw_line_brush(canvas, x, y, nx, ny, brush, color);
+                break;
+            case STROKE_VARIABLE:
+                stroke_draw_segment(canvas, x, y, prev_size, nx, ny, size, color, 255, 1);
+                break;
+            case STROKE_OPACITY:
+                stroke_draw_segment(canvas, x, y, prev_size, nx, ny, size, color,
+                                    stroke_pressure_alpha(pressure), 1);
+                break;
+        }
+        x = nx;
+        y = ny;
+        prev_size = size;
+    }
+    return bench_elapsed(t);
+}
+
+int bench_stroke(void) {
+    Canvas canvas;
+    if (canvas_init(&canvas) < 0) return -1;
+
+    size_t bytes = SCREEN_W * SCREEN_H * sizeof(unsigned int);
+    unsigned int *reference = (unsigned int *)malloc(bytes);
+    if (!reference) {
+        canvas_destroy(&canvas);
+        return -1;
+    }
+
+    int match = 1;
+    char metric[64];
+    for (int b = 0; b < NUM_BRUSH_SIZES; b++) {
+        int brush = brush_sizes[b];
+        for (int m = STROKE_STAMPED; m <= STROKE_OPACITY; m++) {
+            double secs = run_strokes(&canvas, (StrokeMode)m, brush);
+            snprintf(metric, sizeof(metric), "size %d %s", brush, mode_names[m]);
+            bench_report("stroke", metric, SEGMENTS / secs / 1000.0, "kseg/s");
+
+            // Gli span a spessore costante devono coincidere con i timbri
+            if (m == STROKE_STAMPED) {
+                memcpy(reference, canvas.pixels, bytes);
+            } else if (m == STROKE_FIXED && memcmp(reference, canvas.pixels, bytes) != 0) {
+                match = 0;
+            }
+        }
+    }
+    bench_report("stroke", "fixed spans match stamped", match, "");
+
+    free(reference);
+    canvas_destroy(&canvas);
+    return match ? 0 : -1;
+}
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "journal.h"
+
+#define HIT_QUERIES    2000
+#define ERASE_ATTEMPTS 200
+#define HIT_RADIUS     8
+#define SEGMENTS       10
+
+static const int stroke_counts[] = { 1000, 5000, 10000, 20000 };
+#define NUM_COUNTS (int)(sizeof(stroke_counts) / sizeof(stroke_counts[0]))
+
+// Tratti a mano libera sparsi su tutto il canvas
+static void make_strokes(Journal *journal, Canvas *canvas, int count) {
+    srand(4321);
+    for (int s = 0; s < count; s++) {
+        int x = rand() % SCREEN_W;
+        int y = rand() % SCREEN_H;
+        int size = 2 + rand() % 11;
+        unsigned int color = RGBA8(rand() & 255, rand() & 255, rand() & 255, 255);
+
+        journal_begin_op(journal, canvas);
+        journal_record(journal, canvas, JCMD_BRUSH, x, y, x, y, size, color);
+        for (int seg = 0; seg < SEGMENTS; seg++) {
+            int nx = x + rand() % 31 - 15;
+            int ny = y + rand() % 31 - 15;
+            journal_record(journal, canvas, JCMD_LINE, x, y, nx, ny, size, color);
+            x = nx;
+            y = ny;
+        }
+    }
+}
+
+static int run_count(int count, int *failed) {
+    Canvas canvas;
+    if (canvas_init(&canvas) < 0) return -1;
+    Journal journal;
+    if (journal_init(&journal, canvas.bg_color) < 0) {
+        canvas_destroy(&canvas);
+        return -1;
+    }
+    make_strokes(&journal, &canvas, count);
+
+    char metric[64];
+    double total = 0, worst = 0;
+
+    // Hit test: le celle del dito più le capsule dei soli candidati
+    srand(77);
+    for (int i = 0; i < HIT_QUERIES; i++) {
+        int x = rand() % SCREEN_W, y = rand() % SCREEN_H;
+        uint64_t t = platform_time_us();
+        journal_hit_object(&journal, x, y, HIT_RADIUS);
+        double dt = bench_elapsed(t);
+        total += dt;
+        if (dt > worst) worst = dt;
+    }
+    snprintf(metric, sizeof(metric), "%d strokes hit avg", count);
+    bench_report("strokes", metric, total * 1e6 / HIT_QUERIES, "us");
+    snprintf(metric, sizeof(metric), "%d strokes hit max", count);
+    bench_report("strokes", metric, worst * 1e6, "us");
+    if (total * 1e3 / HIT_QUERIES >= 1.0) *failed = 1;
+
+    // Gomma a oggetti: hit test più ridisegno dell'area tolta
+    int erased = 0;
+    total = 0;
+    worst = 0;
+    for (int i = 0; i < ERASE_ATTEMPTS; i++) {
+        int x = rand() % SCREEN_W, y = rand() % SCREEN_H;
+        journal_begin_op(&journal, &canvas);
+        uint64_t t = platform_time_us();
+        int hit = journal_erase_at(&journal, &canvas, x, y, HIT_RADIUS);
+        double dt = bench_elapsed(t);
+        if (!hit) continue;
+        erased++;
+        total += dt;
+        if (dt > worst) worst = dt;
+    }
+    snprintf(metric, sizeof(metric), "%d strokes erase avg", count);
+    bench_report("strokes", metric, erased ? total * 1e3 / erased : 0, "ms");
+    snprintf(metric, sizeof(metric), "%d strokes erase max", count);
+    bench_report("strokes", metric, worst * 1e3, "ms");
+
+    // Confronto: ridisegnare tutto il journal
+    size_t bytes = (size_t)canvas.width * canvas.height * sizeof(unsigned int);
+    unsigned int *live = (unsigned int *)malloc(bytes);
+    if (live) {
+        memcpy(live, canvas.pixels, bytes);
+        uint64_t t = platform_time_us();
+        journal_rasterize(&journal, &canvas, 1);
+        snprintf(metric, sizeof(metric), "%d strokes full redraw", count);
+        bench_report("strokes", metric, bench_elapsed(t) * 1e3, "ms");
+        if (memcmp(live, canvas.pixels, bytes) != 0) *failed = 1;
+        free(live);
+    }
+
+    journal_destroy(&journal);
+    canvas_destroy(&canvas);
+    return 0;
+}
+
+int bench_strokes(void) {
+    int failed = 0;
+    for (int i = 0; i < NUM_COUNTS; i++) {
+        if (run_count(stroke_counts[i], &failed) < 0) return -1;
+    }
+    bench_report("strokes", "erase matches full redraw", !failed, "");
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "canvas.h"
+#include "stroke.h"
+#include "shape.h"
+#include "filter.h"
+#include "symmetry.h"
+#include "journal.h"
+
+/*
+ * Simmetria: costo di un segmento di tratto al crescere delle copie, con le
+ * copie in un'unica passata (stroke_draw_segments) o una alla volta. Con
+ * l'opacità piena i due modi devono dare gli stessi pixel. Poi un disegno
+ * con simmetria registrato nel journal: il ridisegno deve dare il canvas.
+ */
+
+#define SEGMENTS     4000
+#define SEG_LEN      12
+#define FRAME_US     16667.0
+// Passeggiata su tutto lo schermo o attorno al centro
+#define SPREAD_REACH 260
+#define CENTRE_REACH 30
+
+typedef struct {
+    const char *name;
+    SymmetryMode mode;
+    int order;
+} SymmetryCase;
+
+static const SymmetryCase cases[] = {
+    { "off",        SYMMETRY_OFF,       0 },
+    { "mirror H",   SYMMETRY_MIRROR_H,  0 },
+    { "mirror H+V", SYMMETRY_MIRROR_HV, 0 },
+    { "radial 3",   SYMMETRY_RADIAL,    3 },
+    { "radial 6",   SYMMETRY_RADIAL,    6 },
+    { "radial 8",   SYMMETRY_RADIAL,    8 },
+    { "radial 12",  SYMMETRY_RADIAL,    12 },
+    { "radial 16",  SYMMETRY_RADIAL,    16 },
+};
+#define NUM_CASES (int)(sizeof(cases) / sizeof(cases[0]))
+
+// Passeggiata con pressione come in bench_stroke, pennello massimo, entro
+// reach px dal centro: vicino al centro le copie si sovrappongono
+static double run_raster(Canvas *canvas, const SymmetryCase *c, int reach, int batched,
+                         int opacity)
+{
+    SymmetryXform t[SYMMETRY_MAX_COPIES];
+    StrokeSegment segs[SYMMETRY_MAX_COPIES];
+    int n = symmetry_xforms(c->mode, c->order, SCREEN_W / 2, SCREEN_H / 2, t);
+    srand(4321);
+    canvas_clear(canvas, canvas->bg_color);
+
+    int x = SCREEN_W / 2 + reach / 2, y = SCREEN_H / 2;
+    int pressure = 160;
+    int prev_size = stroke_pressure_size(BRUSH_SIZE_MAX, pressure);
+    unsigned int color = RGBA8(200, 40, 90, 255);
+
+    uint64_t start = platform_time_us();
+    for (int i = 0; i < SEGMENTS; i++) {
+        int nx = x + rand() % (2 * SEG_LEN + 1) - SEG_LEN;
+        int ny = y + rand() % (2 * SEG_LEN + 1) - SEG_LEN;
+        if (abs(nx - SCREEN_W / 2) > reach) nx = x;
+        if (abs(ny - SCREEN_H / 2) > reach) ny = y;
+        pressure += rand() % 33 - 16;
+        if (pressure < 0) pressure = 0;
+        if (pressure > 255) pressure = 255;
+        int size = stroke_pressure_size(BRUSH_SIZE_MAX, pressure);
+        int alpha = opacity ? stroke_pressure_alpha(pressure) : 255;
+
+        for (int k = 0; k < n; k++) {
+            symmetry_map(&t[k], x, y, &segs[k].x0, &segs[k].y0);
+            symmetry_map(&t[k], nx, ny, &segs[k].x1, &segs[k].y1);
+            segs[k].size0 = prev_size;
+            segs[k].size1 = size;
+        }
+        if (batched) {
+            stroke_draw_segments(canvas, segs, n, color, alpha, i > 0);
+        } else {
+            for (int k = 0; k < n; k++) {
+                stroke_draw_segment(canvas, segs[k].x0, segs[k].y0, segs[k].size0,
+                                    segs[k].x1, segs[k].y1, segs[k].size1, color, alpha, i > 0);
+            }
+        }
+        x = nx;
+        y = ny;
+        prev_size = size;
+    }
+    return bench_elapsed(start) * 1000000.0 / SEGMENTS;
+}
+
+// Un disegno con ogni tipo di comando replicabile, registrato con la
+// simmetria del canvas; ritorna il costo medio di un segmento di tratto
+static double record_drawing(Journal *journal, Canvas *canvas) {
+    int xs[5] = { 600, 660, 640, 580, 560 }, ys[5] = { 150, 170, 230, 240, 190 };
+    unsigned int color = RGBA8(30, 120, 60, 255);
+
+    journal_begin_op(journal, canvas);
+    journal_record_shape(journal, canvas, 560, 120, 700, 200, 4, color,
+                         SHAPE_PARAMS(SHAPE_RECT, SHAPE_FLAG_AA, 12));
+    journal_begin_op(journal, canvas);
+    journal_record_shape(journal, canvas, 620, 330, 680, 360, 0, color,
+                         SHAPE_PARAMS(SHAPE_ELLIPSE, SHAPE_FLAG_AA, 0));
+    journal_begin_op(journal, canvas);
+    journal_record_polygon(journal, canvas, xs, ys, 5, 3, RGBA8(10, 10, 10, 255), 0);
+    journal_begin_op(journal, canvas);
+    journal_record(journal, canvas, JCMD_SPRAY, 700, 300, 700, 300, 40, RGBA8(0, 0, 200, 255));
+
+    // Tratto a pressione, un segmento per frame
+    int x = 560, y = 280, pressure = 200;
+    int prev = stroke_pressure_size(BRUSH_SIZE_MAX, pressure);
+    journal_begin_op(journal, canvas);
+    journal_record_stroke(journal, canvas, x, y, prev, x, y, prev, RGBA8(200, 40, 90, 255),
+                          stroke_pressure_alpha(pressure));
+    uint64_t start = platform_time_us();
+    for (int i = 0; i < 200; i++) {
+        int nx = x + ((i / 40) % 2 ? -3 : 4), ny = y + ((i % 20) < 10 ? 2 : -2);
+        pressure = 120 + (i * 7) % 120;
+        int size = stroke_pressure_size(BRUSH_SIZE_MAX, pressure);
+        journal_record_stroke(journal, canvas, x, y, prev, nx, ny, size,
+                              RGBA8(200, 40, 90, 255), stroke_pressure_alpha(pressure));
+        x = nx;
+        y = ny;
+        prev = size;
+    }
+    double us = bench_elapsed(start) * 1000000.0 / 200;
+
+    journal_begin_op(journal, canvas);
+    journal_record_filter(journal, canvas, JCMD_FILTER_STROKE, 600, 200, 700, 260, 20,
+                          FILTER_PARAMS(FILTER_BLUR, FILTER_BLUR_RADIUS, 0));
+    return us;
+}
+
+static int run_journal(SymmetryMode mode, int order, const char *name, unsigned int *scratch) {
+    Canvas canvas, ref;
+    Journal journal;
+    if (canvas_init(&canvas) < 0) return -1;
+    if (journal_init(&journal, canvas.bg_color) < 0) {
+        canvas_destroy(&canvas);
+        return -1;
+    }
+    canvas.symmetry_mode = mode;
+    canvas.symmetry_order = order;
+
+    double us = record_drawing(&journal, &canvas);
+    char metric[64];
+    snprintf(metric, sizeof(metric), "journal %s segment", name);
+    bench_report("symmetry", metric, us, "us");
+
+    // Ridisegno da zero, anche dopo un undo (ripartenza da keyframe o da zero)
+    size_t bytes = (size_t)SCREEN_W * SCREEN_H * sizeof(unsigned int);
+    canvas_init_buffer(&ref, scratch, SCREEN_W, SCREEN_H);
+    journal_rasterize(&journal, &ref, 1);
+    int ok = memcmp(ref.pixels, canvas.pixels, bytes) == 0;
+    journal_undo(&journal, &canvas);
+    journal_rasterize(&journal, &ref, 1);
+    ok = ok && memcmp(ref.pixels, canvas.pixels, bytes) == 0;
+    snprintf(metric, sizeof(metric), "journal %s replay matches", name);
+    bench_report("symmetry", metric, ok, "");
+
+    journal_destroy(&journal);
+    canvas_destroy(&canvas);
+    return ok ? 0 : -1;
+}
+
+int bench_symmetry(void) {
+    Canvas canvas;
+    if (canvas_init(&canvas) < 0) return -1;
+
+    size_t bytes = (size_t)SCREEN_W * SCREEN_H * sizeof(unsigned int);
+    unsigned int *scratch = (unsigned int *)malloc(bytes);
+    if (!scratch) {
+        canvas_destroy(&canvas);
+        return -1;
+    }
+
+    int failed = 0;
+    char metric[64];
+    for (int p = 0; p < 2; p++) {
+        const char *where = p ? "centre" : "spread";
+        int reach = p ? CENTRE_REACH : SPREAD_REACH;
+        for (int i = 0; i < NUM_CASES; i++) {
+            const SymmetryCase *c = &cases[i];
+            int copies = symmetry_copies(c->mode, c->order);
+            double naive = run_raster(&canvas, c, reach, 0, 0);
+            memcpy(scratch, canvas.pixels, bytes);
+            double batched = run_raster(&canvas, c, reach, 1, 0);
+            // Con l'opacità piena l'unione degli span dà gli stessi pixel
+            if (memcmp(scratch, canvas.pixels, bytes) != 0) failed = 1;
+            double alpha = run_raster(&canvas, c, reach, 1, 1);
+
+            snprintf(metric, sizeof(metric), "%s %s naive", where, c->name);
+            bench_report("symmetry", metric, naive, "us/seg");
+            snprintf(metric, sizeof(metric), "%s %s batched", where, c->name);
+            bench_report("symmetry", metric, batched, "us/seg");
+            snprintf(metric, sizeof(metric), "%s %s per copy", where, c->name);
+            bench_report("symmetry", metric, batched / copies, "us/seg");
+            snprintf(metric, sizeof(metric), "%s %s opacity", where, c->name);
+            bench_report("symmetry", metric, alpha, "us/seg");
+            // Quota del frame a 60 fps per un segmento di input per frame
+            snprintf(metric, sizeof(metric), "%s %s frame share", where, c->name);
+            bench_report("symmetry", metric,
+                         100.0 * (batched > alpha ? batched : alpha) / FRAME_US, "%");
+        }
+    }
+    bench_report("symmetry", "batched matches copies", !failed, "");
+
+    if (run_journal(SYMMETRY_MIRROR_HV, 0, "mirror H+V", scratch) != 0) failed = 1;
+    if (run_journal(SYMMETRY_RADIAL, 8, "radial 8", scratch) != 0) failed = 1;
+    if (run_journal(SYMMETRY_RADIAL, 5, "radial 5", scratch) != 0) failed = 1;
+
+    free(scratch);
+    canvas_destroy(&canvas);
+    return failed ? -1 : 0;
+}
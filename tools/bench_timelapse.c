@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "timelapse.h"
+
+#define BENCH_TIMELAPSE "bench_timelapse.tlp"
+#define BENCH_SHORT     "bench_timelapse_short.tlp"
+#define BENCH_FRAMES    "bench_timelapse_frame"
+
+#define FRAMES          300
+#define FRAME_US        16667
+#define SEGS_PER_FRAME  4
+// Cattura ogni 15 frame (4 al secondo) invece di una al secondo: più carico
+#define CAPTURE_EVERY   15
+
+#define HOUR_TICKS      3600
+#define SHORT_TICKS     120
+#define SEGS_PER_TICK   40
+
+static void cleanup_files(int png_frames) {
+    char path[64];
+    remove(BENCH_TIMELAPSE);
+    remove(BENCH_SHORT);
+    for (int i = 0; i < png_frames; i++) {
+        snprintf(path, sizeof(path), BENCH_FRAMES "_%05d.png", i);
+        remove(path);
+    }
+}
+
+// Un tratto continuo a 60 fps; ritorna i frame oltre il budget
+static int run_frames(Journal *journal, Canvas *canvas, Timelapse *tl, const char *label) {
+    uint64_t worst = 0, total = 0;
+    int dropped = 0;
+    int x = SCREEN_W / 2, y = SCREEN_H / 2;
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        uint64_t start = platform_time_us();
+
+        if (frame % 30 == 0) {
+            journal_begin_op(journal, canvas);
+            journal_record(journal, canvas, JCMD_BRUSH, x, y, x, y, 8, RGBA8(0, 0, 0, 255));
+        }
+        for (int s = 0; s < SEGS_PER_FRAME; s++) {
+            int nx = 20 + rand() % (SCREEN_W - 40);
+            int ny = 20 + rand() % (SCREEN_H - 40);
+            nx = x + (nx - x) / 16;
+            ny = y + (ny - y) / 16;
+            journal_record(journal, canvas, JCMD_LINE, x, y, nx, ny, 8,
+                           RGBA8(rand() & 255, 0, 255, 255));
+            x = nx;
+            y = ny;
+        }
+        if (tl && frame % CAPTURE_EVERY == 0) {
+            timelapse_capture(tl, journal, canvas, (uint32_t)(frame * FRAME_US / 1000));
+        }
+
+        uint64_t dt = platform_time_us() - start;
+        total += dt;
+        if (dt > worst) worst = dt;
+        if (dt > FRAME_US) dropped++;
+        if (dt < FRAME_US) platform_sleep_us((uint32_t)(FRAME_US - dt));
+    }
+
+    char metric[64];
+    snprintf(metric, sizeof(metric), "%s frame avg", label);
+    bench_report("timelapse", metric, total / 1000.0 / FRAMES, "ms");
+    snprintf(metric, sizeof(metric), "%s frame max", label);
+    bench_report("timelapse", metric, worst / 1000.0, "ms");
+    snprintf(metric, sizeof(metric), "%s dropped frames", label);
+    bench_report("timelapse", metric, dropped, "frames");
+    return dropped;
+}
+
+static int bench_frame_time(void) {
+    Canvas canvas;
+    Journal journal;
+    Timelapse tl;
+
+    if (canvas_init(&canvas) < 0) return -1;
+    if (journal_init(&journal, canvas.bg_color) < 0) {
+        canvas_destroy(&canvas);
+        return -1;
+    }
+
+    srand(42);
+    int off = run_frames(&journal, &canvas, NULL, "off");
+
+    if (timelapse_start(&tl, BENCH_TIMELAPSE) != 0) {
+        journal_destroy(&journal);
+        canvas_destroy(&canvas);
+        return -1;
+    }
+    int on = run_frames(&journal, &canvas, &tl, "on");
+    timelapse_stop(&tl, NULL, NULL);
+
+    bench_report("timelapse", "frames written", tl.frames, "");
+    bench_report("timelapse", "ticks delayed (I/O busy)", tl.skipped_busy, "");
+    bench_report("timelapse", "tile copy max (frame)", tl.max_copy_us / 1000.0, "ms");
+
+    journal_destroy(&journal);
+    canvas_destroy(&canvas);
+    cleanup_files(0);
+    return (on > off) ? -1 : 0;
+}
+
+// Sessione simulata, un tick al secondo: tratti fitti e colorati in una zona
+// che si sposta, qualche undo, un clear ogni quarto d'ora
+static int record_session(const char *path, int ticks, Canvas *canvas, Timelapse *tl,
+                          double *copy_ms)
+{
+    Journal journal;
+    if (journal_init(&journal, canvas->bg_color) < 0) return -1;
+    canvas_clear(canvas, canvas->bg_color);
+    remove(path);
+    if (timelapse_start(tl, path) != 0) {
+        journal_destroy(&journal);
+        return -1;
+    }
+
+    srand(99);
+    int cx = SCREEN_W / 2, cy = SCREEN_H / 2;
+    uint64_t copy = 0;
+    for (int tick = 0; tick < ticks; tick++) {
+        if (tick % 900 == 899) {
+            journal_begin_op(&journal, canvas);
+            journal_record(&journal, canvas, JCMD_CLEAR, 0, 0, 0, 0, 0, canvas->bg_color);
+        } else if (tick % 97 == 96) {
+            journal_undo(&journal, canvas);
+        }
+        cx += rand() % 41 - 20;
+        cy += rand() % 41 - 20;
+        if (cx < 100 || cx > SCREEN_W - 100) cx = SCREEN_W / 2;
+        if (cy < 100 || cy > SCREEN_H - 100) cy = SCREEN_H / 2;
+
+        journal_begin_op(&journal, canvas);
+        int x = cx, y = cy;
+        for (int s = 0; s < SEGS_PER_TICK; s++) {
+            int nx = cx + rand() % 201 - 100, ny = cy + rand() % 201 - 100;
+            journal_record(&journal, canvas, JCMD_LINE, x, y, nx, ny, 2 + rand() % 11,
+                           RGBA8(rand() & 255, rand() & 255, rand() & 255, 255));
+            x = nx;
+            y = ny;
+        }
+
+        uint64_t t = platform_time_us();
+        timelapse_capture(tl, &journal, canvas, (uint32_t)tick * 1000);
+        copy += platform_time_us() - t;
+        timelapse_flush(tl);
+    }
+    // Cattura finale dello stato corrente
+    timelapse_stop(tl, &journal, canvas);
+
+    *copy_ms = copy / 1000.0 / ticks;
+    journal_destroy(&journal);
+    return 0;
+}
+
+// Ricostruisce l'ultimo frame del file e lo confronta con il canvas
+static int check_last_frame(const char *path, const Canvas *canvas, int *frames) {
+    TimelapseReader reader;
+    if (timelapse_open(&reader, path) != 0) return 0;
+    unsigned int *pixels = (unsigned int *)calloc((size_t)SCREEN_W * SCREEN_H, sizeof(unsigned int));
+    int ret = 0;
+    while (pixels && (ret = timelapse_read_frame(&reader, pixels)) == 1) {}
+    int match = pixels && ret == 0 &&
+                memcmp(pixels, canvas->pixels, (size_t)SCREEN_W * SCREEN_H * sizeof(unsigned int)) == 0;
+    *frames = reader.frames;
+    free(pixels);
+    timelapse_close(&reader);
+    return match;
+}
+
+static int bench_hour(void) {
+    Canvas canvas;
+    Timelapse tl;
+    double copy_ms;
+    if (canvas_init(&canvas) < 0) return -1;
+
+    uint64_t t = platform_time_us();
+    if (record_session(BENCH_TIMELAPSE, HOUR_TICKS, &canvas, &tl, &copy_ms) != 0) {
+        canvas_destroy(&canvas);
+        return -1;
+    }
+    double secs = bench_elapsed(t);
+    int failed = tl.bytes > TIMELAPSE_BUDGET_BYTES;
+
+    bench_report("timelapse", "1h session simulated in", secs, "s");
+    bench_report("timelapse", "1h frames written", tl.frames, "");
+    bench_report("timelapse", "1h ticks delayed (budget)", tl.skipped_budget, "");
+    bench_report("timelapse", "1h tiles written", tl.tiles_written, "");
+    bench_report("timelapse", "1h file size", tl.bytes / (1024.0 * 1024.0), "MB");
+    bench_report("timelapse", "budget", TIMELAPSE_BUDGET_BYTES / (1024.0 * 1024.0), "MB");
+    bench_report("timelapse", "full frame size (raw)",
+                 (double)SCREEN_W * SCREEN_H * 4 / (1024.0 * 1024.0), "MB");
+    bench_report("timelapse", "capture avg (frame thread)", copy_ms, "ms");
+
+    int frames = 0;
+    int match = check_last_frame(BENCH_TIMELAPSE, &canvas, &frames);
+    bench_report("timelapse", "last frame matches canvas", match, "");
+    if (!match || frames != (int)tl.frames) failed = 1;
+
+    // Export video completo: decodifica in sequenza, YUV sui worker
+    WorkPool pool;
+    workpool_init(&pool, 0);
+    TimelapseStats stats;
+    if (timelapse_export(BENCH_TIMELAPSE, "/dev/null", TIMELAPSE_Y4M, TIMELAPSE_EXPORT_FPS,
+                         NULL, &stats) == 0) {
+        bench_report("timelapse", "y4m export 1 worker", stats.frames / stats.seconds, "frames/s");
+    } else {
+        failed = 1;
+    }
+    if (timelapse_export(BENCH_TIMELAPSE, "/dev/null", TIMELAPSE_Y4M, TIMELAPSE_EXPORT_FPS,
+                         &pool, &stats) == 0) {
+        char metric[64];
+        snprintf(metric, sizeof(metric), "y4m export %d workers", stats.workers);
+        bench_report("timelapse", metric, stats.frames / stats.seconds, "frames/s");
+    } else {
+        failed = 1;
+    }
+
+    // Sequenza PNG su una sessione breve (la codifica PNG è la parte cara)
+    int png_frames = 0;
+    if (record_session(BENCH_SHORT, SHORT_TICKS, &canvas, &tl, &copy_ms) == 0) {
+        png_frames = (int)tl.frames;
+        if (timelapse_export(BENCH_SHORT, BENCH_FRAMES, TIMELAPSE_PNG, 1, NULL, &stats) == 0) {
+            bench_report("timelapse", "png export 1 worker", stats.frames / stats.seconds, "frames/s");
+        } else {
+            failed = 1;
+        }
+        if (timelapse_export(BENCH_SHORT, BENCH_FRAMES, TIMELAPSE_PNG, 1, &pool, &stats) == 0) {
+            char metric[64];
+            snprintf(metric, sizeof(metric), "png export %d workers", stats.workers);
+            bench_report("timelapse", metric, stats.frames / stats.seconds, "frames/s");
+        } else {
+            failed = 1;
+        }
+    } else {
+        failed = 1;
+    }
+
+    workpool_destroy(&pool);
+    canvas_destroy(&canvas);
+    cleanup_files(png_frames);
+    return failed ? -1 : 0;
+}
+
+int bench_timelapse(void) {
+    int failed = 0;
+    if (bench_frame_time() != 0) failed = 1;
+    if (bench_hour() != 0) failed = 1;
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * drawbench - benchmark del raster core sull'host Linux.
+ *
+ *   drawbench            esegue tutte le suite
+ *   drawbench journal    esegue solo le suite indicate
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "bench.h"
+
+typedef struct {
+    const char *name;
+    int (*run)(void);
+} BenchSuite;
+
+static const BenchSuite suites[] = {
+    { "journal",  bench_journal },
+    { "autosave", bench_autosave },
+    { "project",  bench_project },
+    { "export",   bench_export },
+    { "stroke",    bench_stroke },
+    { "selection", bench_selection },
+    { "filter",    bench_filter },
+    { "gradient",  bench_gradient },
+    { "strokes",   bench_strokes },
+    { "shapes",    bench_shapes },
+    { "timelapse", bench_timelapse },
+    { "latency",   bench_latency },
+    { "memory",    bench_memory },
+    { "symmetry",  bench_symmetry },
+};
+
+#define NUM_SUITES (int)(sizeof(suites) / sizeof(suites[0]))
+
+void bench_report(const char *suite, const char *metric, double value, const char *unit) {
+    printf("%-10s %-32s %14.3f %s\n", suite, metric, value, unit);
+    fflush(stdout);
+}
+
+double bench_elapsed(uint64_t start) {
+    return (double)(platform_time_us() - start) / 1000000.0;
+}
+
+int bench_run_child(int (*fn)(void *), void *arg, double *ms, long *peak_kb) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        uint64_t t = platform_time_us();
+        int ok = fn(arg) == 0;
+        double elapsed = bench_elapsed(t) * 1000.0;
+        if (write(fds[1], &elapsed, sizeof(elapsed)) != sizeof(elapsed)) ok = 0;
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        return -1;
+    }
+
+    int status = 0;
+    struct rusage usage;
+    int got = read(fds[0], ms, sizeof(*ms)) == sizeof(*ms);
+    close(fds[0]);
+    wait4(pid, &status, 0, &usage);
+    *peak_kb = usage.ru_maxrss;
+    return (got && WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    int failed = 0;
+
+    for (int i = 0; i < NUM_SUITES; i++) {
+        int selected = (argc < 2);
+        for (int a = 1; a < argc; a++) {
+            if (strcmp(argv[a], suites[i].name) == 0) selected = 1;
+        }
+        if (!selected) continue;
+
+        if (suites[i].run() != 0) {
+            fprintf(stderr, "suite %s failed\n", suites[i].name);
+            failed = 1;
+        }
+    }
+    return failed;
+}
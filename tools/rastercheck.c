@@ -0,0 +1,1006 @@
+/*
+ * drawrastercheck - confronto differenziale fra le primitive di riferimento
+ * (canvas_draw_*, un timbro alla volta) e i percorsi veloci (span).
+ *
+ *   drawrastercheck [-n casi] [-seed N] [-t casi]
+ *   drawrastercheck -case "prim w h x0 y0 x1 y1 size0 size1 alpha skip [order]"
+ *
+ * Genera primitive a caso: coordinate dentro, sul bordo, fuori e negative,
+ * ogni spessore fino a quelli dell'export, forme degeneri (punti, segmenti
+ * di lunghezza zero, raggi nulli, canvas di un pixel). Oltre ai tratti:
+ * copie della simmetria, rettangoli e cerchi del rasterizzatore delle forme,
+ * gradienti limitati alla forma, e il bilineare della selezione (SIMD contro
+ * scalare). Ogni caso va su due canvas con lo stesso sfondo e i pixel devono
+ * coincidere. Alla prima differenza il caso viene ridotto finché resta
+ * sbagliato e stampato come riproduttore (anche nel formato di -case). -t
+ * confronta i tempi delle due strade. Prima dei casi a caso, journal con un
+ * JCMD_TRANSFORM costruito verificano che file e .wal rotti vengano rifiutati.
+ *
+ * Con DRAWAPP_FUZZER lo stesso confronto diventa un target libFuzzer: i byte
+ * dell'input scelgono i campi del caso.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "canvas.h"
+#include "stroke.h"
+#include "export.h"
+#include "shape.h"
+#include "gradient.h"
+#include "symmetry.h"
+#include "selection.h"
+#include "journal.h"
+#include "platform.h"
+
+#define CHECK_CASES     20000
+#define CHECK_TIME      2000
+// Journal con un JCMD_TRANSFORM costruito, oltre a quelli fissi
+#define CHECK_TRANSFORMS 2000
+// Spessore massimo: il pennello più largo nell'export alla scala massima
+#define CHECK_SIZE_MAX  (BRUSH_SIZE_MAX * EXPORT_SCALE_MAX)
+// Oltre la tabella degli span (STROKE_MAX_RADIUS), solo su segmenti corti
+#define CHECK_HUGE_SIZE (2 * STROKE_MAX_RADIUS + 64)
+// Sorgente del bilineare: un buffer grande quanto lo schermo
+#define SOURCE_W        SCREEN_W
+#define SOURCE_H        SCREEN_H
+// Passo del bilineare in 1/256 di pixel: fino a 16x in riduzione
+#define CHECK_STEP_MAX  4096
+
+typedef enum {
+    PRIM_DOT,        // canvas_draw_brush / segmento di lunghezza zero
+    PRIM_LINE,       // canvas_draw_line / canvas_draw_line_brush
+    PRIM_TAPER,      // timbri a spessore interpolato / stroke_draw_segment
+    PRIM_STROKE,     // come sopra, con opacità e disco iniziale saltato
+    PRIM_MIRROR,     // stroke e i suoi specchi sul centro del canvas / stroke_draw_segments
+    PRIM_RADIAL,     // stroke e le sue copie ruotate (SYMMETRY_RADIAL) / stroke_draw_segments
+    PRIM_RECT,       // canvas_draw_rect / shape_draw_rect con spessore 1
+    PRIM_FILL_RECT,  // canvas_draw_filled_rect / shape_draw_rect pieno
+    PRIM_CIRCLE,     // canvas_draw_filled_circle / shape_draw_ellipse pieno con rx = ry
+    PRIM_ELLIPSE,    // ellisse piena pixel per pixel / shape_draw_ellipse pieno
+    PRIM_RING,       // bordo dell'ellisse piena pixel per pixel / shape_draw_ellipse di 1 px
+    PRIM_GRAD_RECT,  // GRADIENT_LINEAR sotto canvas_draw_filled_rect / GRADIENT_LINEAR_RECT
+    PRIM_GRAD_CIRCLE,// GRADIENT_RADIAL sotto canvas_draw_filled_circle / GRADIENT_RADIAL_CIRCLE
+    PRIM_SELECTION,  // bilineare della selezione: righe scalari / SIMD
+    PRIM_COUNT
+} RasterPrim;
+
+static const char *prim_names[PRIM_COUNT] = {
+    "dot", "line", "taper", "stroke", "mirror", "radial",
+    "rect", "fillrect", "circle", "ellipse", "ring", "gradrect", "gradcirc", "select"
+};
+
+// I tratti (fino a radial) hanno spessori in 1/STROKE_SUBPIXEL px
+#define PRIM_SUBPIXEL(p) ((p) >= PRIM_TAPER && (p) <= PRIM_RADIAL)
+
+typedef struct {
+    int prim;
+    int w, h;            // canvas
+    int x0, y0, x1, y1;  // estremi; cerchi ed ellissi: centro (x0, y0)
+    int size0, size1;    // dot/line in pixel; tratti in 1/STROKE_SUBPIXEL px;
+                         // cerchi ed ellissi: raggi in pixel
+    int alpha;           // tratti (altrimenti 255); select: alfa della sorgente
+    int skip;            // tratti: skip_start; select: sorgente con buchi trasparenti
+    int order;           // solo radial: copie
+} RasterCase;
+
+/* ===== RIFERIMENTO ===== */
+
+// Raggio del timbro per uno spessore in sedicesimi (come stroke.c)
+static int ref_radius(int size) {
+    return size / (2 * STROKE_SUBPIXEL);
+}
+
+// Timbri di canvas_draw_brush lungo il Bresenham di canvas_draw_line, con lo
+// spessore interpolato in 16.16 a ogni passo
+static void ref_taper(Canvas *canvas, int x0, int y0, int size0, int x1, int y1, int size1,
+                      unsigned int color)
+{
+    int dx = abs(x1 - x0);
+    int dy = abs(y1 - y0);
+    int sx = (x0 < x1) ? 1 : -1;
+    int sy = (y0 < y1) ? 1 : -1;
+    int err = dx - dy;
+    int steps = (dx > dy) ? dx : dy;
+    int64_t size = (int64_t)size0 << 16;
+    int64_t dsize = steps ? (((int64_t)(size1 - size0)) << 16) / steps : 0;
+
+    while (1) {
+        canvas_draw_brush(canvas, x0, y0, 2 * ref_radius((int)(size >> 16)), color);
+        if (x0 == x1 && y0 == y1) break;
+        int e2 = 2 * err;
+        if (e2 > -dy) { err -= dy; x0 += sx; }
+        if (e2 < dx)  { err += dx; y0 += sy; }
+        size += dsize;
+    }
+}
+
+// Fusione canale per canale: colore * t + sfondo * (256 - t), in 1/256
+static unsigned int ref_blend(unsigned int dst, unsigned int src, int t) {
+    unsigned int out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        unsigned int d = (dst >> shift) & 0xFF, s = (src >> shift) & 0xFF;
+        out |= (((d * (256 - t) + s * t) >> 8) & 0xFF) << shift;
+    }
+    return out;
+}
+
+// Sfondo a rumore: le fusioni sbagliate non si nascondono dietro un colore pieno
+static void fill_background(unsigned int *pixels, int count) {
+    unsigned int state = 0x9E3779B9u;
+    for (int i = 0; i < count; i++) {
+        state = state * 1664525u + 1013904223u;
+        pixels[i] = state | 0xFF000000u;
+    }
+}
+
+// Copie di mirror: originale, specchi orizzontale e verticale, entrambi
+#define MIRROR_COPIES 4
+
+// Segmenti del tratto: uno solo, gli specchi su (w - 1, h - 1) per mirror,
+// le rotazioni attorno a (w / 2, h / 2) per radial (come l'app). Ritorna quanti.
+static int case_segments(const RasterCase *c, StrokeSegment *segs) {
+    int n = 1;
+    if (c->prim == PRIM_RADIAL) {
+        SymmetryXform t[SYMMETRY_MAX_COPIES];
+        n = symmetry_xforms(SYMMETRY_RADIAL, c->order, c->w / 2, c->h / 2, t);
+        for (int k = 0; k < n; k++) {
+            symmetry_map(&t[k], c->x0, c->y0, &segs[k].x0, &segs[k].y0);
+            symmetry_map(&t[k], c->x1, c->y1, &segs[k].x1, &segs[k].y1);
+        }
+    } else {
+        if (c->prim == PRIM_MIRROR) n = MIRROR_COPIES;
+        for (int k = 0; k < n; k++) {
+            StrokeSegment *sg = &segs[k];
+            sg->x0 = (k & 1) ? c->w - 1 - c->x0 : c->x0;
+            sg->x1 = (k & 1) ? c->w - 1 - c->x1 : c->x1;
+            sg->y0 = (k & 2) ? c->h - 1 - c->y0 : c->y0;
+            sg->y1 = (k & 2) ? c->h - 1 - c->y1 : c->y1;
+        }
+    }
+    for (int k = 0; k < n; k++) {
+        segs[k].size0 = c->size0;
+        segs[k].size1 = c->size1;
+    }
+    return n;
+}
+
+// Maschera dei timbri di tutte le copie (meno i dischi iniziali), poi una
+// sola fusione per pixel. Opache, una copia alla volta ognuna senza il
+// proprio disco (vedi stroke_draw_segments).
+static void ref_stroke(Canvas *canvas, unsigned int *mask, const RasterCase *c, unsigned int color) {
+    Canvas m;
+    StrokeSegment segs[SYMMETRY_MAX_COPIES];
+    int n = case_segments(c, segs);
+    int passes = (c->alpha >= 255) ? n : 1;
+    canvas_init_buffer(&m, mask, c->w, c->h);
+
+    int t = (c->alpha >= 255) ? 256 : c->alpha + (c->alpha >> 7);
+    for (int p = 0; p < passes; p++) {
+        int k0 = (passes > 1) ? p : 0, k1 = (passes > 1) ? p + 1 : n;
+        canvas_clear(&m, 0);
+        for (int k = k0; k < k1; k++) {
+            ref_taper(&m, segs[k].x0, segs[k].y0, c->size0, segs[k].x1, segs[k].y1, c->size1, 1);
+        }
+        for (int k = k0; k < k1 && c->skip; k++) {
+            canvas_draw_brush(&m, segs[k].x0, segs[k].y0, 2 * ref_radius(c->size0), 0);
+        }
+        for (int i = 0; i < c->w * c->h; i++) {
+            if (mask[i]) canvas->pixels[i] = ref_blend(canvas->pixels[i], color, t);
+        }
+    }
+}
+
+// Ellisse piena provata pixel per pixel: dx² ry² + dy² rx² <= rx² ry²
+static void ref_ellipse(Canvas *canvas, int cx, int cy, int rx, int ry, unsigned int color) {
+    int64_t rx2 = (int64_t)rx * rx, ry2 = (int64_t)ry * ry;
+    int y_lo = (cy - ry > 0) ? cy - ry : 0, y_hi = (cy + ry < canvas->height) ? cy + ry : canvas->height - 1;
+    int x_lo = (cx - rx > 0) ? cx - rx : 0, x_hi = (cx + rx < canvas->width) ? cx + rx : canvas->width - 1;
+    for (int y = y_lo; y <= y_hi; y++) {
+        int64_t dy = y - cy;
+        for (int x = x_lo; x <= x_hi; x++) {
+            int64_t dx = x - cx;
+            if (dx * dx * ry2 + dy * dy * rx2 <= rx2 * ry2) canvas_draw_pixel(canvas, x, y, color);
+        }
+    }
+}
+
+static int ref_in_ellipse(int64_t dx, int64_t dy, int rx, int ry) {
+    int64_t rx2 = (int64_t)rx * rx, ry2 = (int64_t)ry * ry;
+    return dx >= -rx && dx <= rx && dy >= -ry && dy <= ry && dx * dx * ry2 + dy * dy * rx2 <= rx2 * ry2;
+}
+
+// Contorno di un pixel: i pixel dell'ellisse piena con un vicino (sopra,
+// sotto o di lato) fuori
+static void ref_ring(Canvas *canvas, int cx, int cy, int rx, int ry, unsigned int color) {
+    int y_lo = (cy - ry > 0) ? cy - ry : 0, y_hi = (cy + ry < canvas->height) ? cy + ry : canvas->height - 1;
+    int x_lo = (cx - rx > 0) ? cx - rx : 0, x_hi = (cx + rx < canvas->width) ? cx + rx : canvas->width - 1;
+    for (int y = y_lo; y <= y_hi; y++) {
+        int64_t dy = y - cy;
+        for (int x = x_lo; x <= x_hi; x++) {
+            int64_t dx = x - cx;
+            if (ref_in_ellipse(dx, dy, rx, ry) &&
+                (!ref_in_ellipse(dx - 1, dy, rx, ry) || !ref_in_ellipse(dx + 1, dy, rx, ry) ||
+                 !ref_in_ellipse(dx, dy - 1, rx, ry) || !ref_in_ellipse(dx, dy + 1, rx, ry))) {
+                canvas_draw_pixel(canvas, x, y, color);
+            }
+        }
+    }
+}
+
+static const unsigned int check_color2 = 0x40E0A010u;  // secondo colore dei gradienti
+
+// Gradiente su tutto il canvas, copiato solo dove canvas_draw_filled_rect/circle
+// disegnerebbero: i pixel (e il dither) della versione limitata alla forma
+static void ref_gradient(Canvas *canvas, unsigned int *mask, unsigned int *shape,
+                         const RasterCase *c, unsigned int color)
+{
+    Canvas g, s;
+    canvas_init_buffer(&g, mask, c->w, c->h);
+    canvas_init_buffer(&s, shape, c->w, c->h);
+    canvas_clear(&s, 0);
+    if (c->prim == PRIM_GRAD_RECT) {
+        gradient_fill(&g, GRADIENT_LINEAR, c->x0, c->y0, c->x1, c->y1, c->size0, color, check_color2);
+        canvas_draw_filled_rect(&s, c->x0, c->y0, c->x1, c->y1, 1);
+    } else {
+        gradient_fill(&g, GRADIENT_RADIAL, c->x0, c->y0, c->x1, c->y1, c->size0, color, check_color2);
+        canvas_draw_filled_circle(&s, c->x0, c->y0, c->size0, 1);
+    }
+    for (int i = 0; i < c->w * c->h; i++) {
+        if (shape[i]) canvas->pixels[i] = mask[i];
+    }
+}
+
+// Sorgente della selezione: rumore premoltiplicato con alfa c->alpha e, con
+// skip, circa un pixel su otto trasparente (i bordi di una selezione a mano)
+static void fill_source(unsigned int *src, const RasterCase *c) {
+    fill_background(src, SOURCE_W * SOURCE_H);
+    for (int i = 0; i < SOURCE_W * SOURCE_H; i++) {
+        unsigned int p = src[i];
+        unsigned int a = (c->skip && (p & 0x700) == 0) ? 0 : (unsigned int)c->alpha;
+        unsigned int out = a << 24;
+        for (int shift = 0; shift < 24; shift += 8) {
+            out |= ((((p >> shift) & 0xFF) * a / 255) & 0xFF) << shift;
+        }
+        src[i] = out;
+    }
+}
+
+// Tutti e quattro i tap del bilineare dentro la sorgente?
+static int source_tap(int64_t u, int64_t v) {
+    return u >= 0 && v >= 0 &&
+           u < ((int64_t)(SOURCE_W - 1) << 16) && v < ((int64_t)(SOURCE_H - 1) << 16);
+}
+
+// Righe del bilineare come selection_draw: la riga y parte da
+// (x0 + size0 / 65536, y0 + size1 / 65536) ruotato di y passi a 90 gradi e
+// avanza di (x1, y1) / 256 per pixel. Solo i pixel con i tap nella sorgente
+// (un tratto contiguo per riga); simd = 0 per il riferimento.
+static void draw_selection(Canvas *canvas, const unsigned int *src, const RasterCase *c, int simd) {
+    int32_t du = c->x1 * 256, dv = c->y1 * 256;
+    for (int y = 0; y < canvas->height; y++) {
+        int64_t u = (int64_t)c->x0 * 65536 + c->size0 - (int64_t)y * dv;
+        int64_t v = (int64_t)c->y0 * 65536 + c->size1 + (int64_t)y * du;
+        int k = 0, n = 0;
+        while (k < canvas->width && !source_tap(u + (int64_t)k * du, v + (int64_t)k * dv)) k++;
+        while (k + n < canvas->width &&
+               source_tap(u + (int64_t)(k + n) * du, v + (int64_t)(k + n) * dv)) n++;
+        if (n == 0) continue;
+        selection_row_bilinear(&canvas->pixels[y * canvas->width + k], n, src, SOURCE_W,
+                               (int32_t)(u + (int64_t)k * du), (int32_t)(v + (int64_t)k * dv),
+                               du, dv, simd);
+    }
+}
+
+typedef struct {
+    unsigned int *ref;
+    unsigned int *opt;
+    unsigned int *mask;
+    unsigned int *aux;   // sorgente della selezione o forma sotto il gradiente
+    int capacity;        // pixel per buffer
+} CheckBuffers;
+
+static void draw_reference(Canvas *canvas, CheckBuffers *b, const RasterCase *c,
+                           unsigned int color)
+{
+    switch (c->prim) {
+        case PRIM_DOT:
+            canvas_draw_brush(canvas, c->x0, c->y0, c->size0, color);
+            break;
+        case PRIM_LINE:
+            canvas_draw_line(canvas, c->x0, c->y0, c->x1, c->y1, c->size0, color);
+            break;
+        case PRIM_TAPER:
+            ref_taper(canvas, c->x0, c->y0, c->size0, c->x1, c->y1, c->size1, color);
+            break;
+        case PRIM_STROKE:
+        case PRIM_MIRROR:
+        case PRIM_RADIAL:
+            if (c->alpha > 0) ref_stroke(canvas, b->mask, c, color);
+            break;
+        case PRIM_RECT:
+            canvas_draw_rect(canvas, c->x0, c->y0, c->x1, c->y1, color);
+            break;
+        case PRIM_FILL_RECT:
+            canvas_draw_filled_rect(canvas, c->x0, c->y0, c->x1, c->y1, color);
+            break;
+        case PRIM_CIRCLE:
+            canvas_draw_filled_circle(canvas, c->x0, c->y0, c->size0, color);
+            break;
+        case PRIM_ELLIPSE:
+            ref_ellipse(canvas, c->x0, c->y0, c->size0, c->size1, color);
+            break;
+        case PRIM_RING:
+            ref_ring(canvas, c->x0, c->y0, c->size0, c->size1, color);
+            break;
+        case PRIM_GRAD_RECT:
+        case PRIM_GRAD_CIRCLE:
+            ref_gradient(canvas, b->mask, b->aux, c, color);
+            break;
+        default:
+            draw_selection(canvas, b->aux, c, 0);
+            break;
+    }
+}
+
+static void draw_optimized(Canvas *canvas, CheckBuffers *b, const RasterCase *c,
+                           unsigned int color)
+{
+    StrokeSegment segs[SYMMETRY_MAX_COPIES];
+    switch (c->prim) {
+        case PRIM_DOT:
+            stroke_draw_segment(canvas, c->x0, c->y0, c->size0 * STROKE_SUBPIXEL,
+                                c->x0, c->y0, c->size0 * STROKE_SUBPIXEL, color, 255, 0);
+            break;
+        case PRIM_LINE:
+            canvas_draw_line_brush(canvas, c->x0, c->y0, c->x1, c->y1, c->size0, color);
+            break;
+        case PRIM_TAPER:
+            stroke_draw_segment(canvas, c->x0, c->y0, c->size0, c->x1, c->y1, c->size1,
+                                color, 255, 0);
+            break;
+        case PRIM_STROKE:
+            stroke_draw_segment(canvas, c->x0, c->y0, c->size0, c->x1, c->y1, c->size1,
+                                color, c->alpha, c->skip);
+            break;
+        case PRIM_MIRROR:
+        case PRIM_RADIAL:
+            stroke_draw_segments(canvas, segs, case_segments(c, segs), color, c->alpha, c->skip);
+            break;
+        case PRIM_RECT:
+            shape_draw_rect(canvas, c->x0, c->y0, c->x1, c->y1, 0, 1, color, 0);
+            break;
+        case PRIM_FILL_RECT:
+            shape_draw_rect(canvas, c->x0, c->y0, c->x1, c->y1, 0, 0, color, 0);
+            break;
+        case PRIM_CIRCLE:
+            shape_draw_ellipse(canvas, c->x0, c->y0, c->size0, c->size0, 0, color, 0);
+            break;
+        case PRIM_ELLIPSE:
+            shape_draw_ellipse(canvas, c->x0, c->y0, c->size0, c->size1, 0, color, 0);
+            break;
+        case PRIM_RING:
+            shape_draw_ellipse(canvas, c->x0, c->y0, c->size0, c->size1, 1, color, 0);
+            break;
+        case PRIM_GRAD_RECT:
+            gradient_fill(canvas, GRADIENT_LINEAR_RECT, c->x0, c->y0, c->x1, c->y1, c->size0,
+                          color, check_color2);
+            break;
+        case PRIM_GRAD_CIRCLE:
+            gradient_fill(canvas, GRADIENT_RADIAL_CIRCLE, c->x0, c->y0, c->x1, c->y1, c->size0,
+                          color, check_color2);
+            break;
+        default:
+            draw_selection(canvas, b->aux, c, 1);
+            break;
+    }
+}
+
+/* ===== CONFRONTO ===== */
+
+typedef struct {
+    int count;           // pixel diversi
+    int x, y;            // il primo
+    unsigned int ref, opt;
+} CheckDiff;
+
+static const unsigned int check_color = 0xC0306090u;
+
+static int check_case(CheckBuffers *b, const RasterCase *c, CheckDiff *diff) {
+    int count = c->w * c->h;
+    Canvas ref, opt;
+    fill_background(b->ref, count);
+    memcpy(b->opt, b->ref, count * sizeof(unsigned int));
+    canvas_init_buffer(&ref, b->ref, c->w, c->h);
+    canvas_init_buffer(&opt, b->opt, c->w, c->h);
+    if (c->prim == PRIM_SELECTION) fill_source(b->aux, c);
+
+    draw_reference(&ref, b, c, check_color);
+    draw_optimized(&opt, b, c, check_color);
+
+    memset(diff, 0, sizeof(CheckDiff));
+    for (int i = 0; i < count; i++) {
+        if (b->ref[i] == b->opt[i]) continue;
+        if (diff->count++ == 0) {
+            diff->x = i % c->w;
+            diff->y = i / c->w;
+            diff->ref = b->ref[i];
+            diff->opt = b->opt[i];
+        }
+    }
+    return diff->count == 0;
+}
+
+// Il caso resta valido (spessori, passi e opacità nei limiti del generatore)?
+static int case_valid(const RasterCase *c) {
+    if (c->w < 1 || c->h < 1 || c->w > SCREEN_W || c->h > SCREEN_H ||
+        c->alpha < 0 || c->alpha > 255) {
+        return 0;
+    }
+    if (c->prim == PRIM_SELECTION) {
+        return abs(c->x0) <= 4 * SOURCE_W && abs(c->y0) <= 4 * SOURCE_H &&
+               abs(c->x1) <= CHECK_STEP_MAX && abs(c->y1) <= CHECK_STEP_MAX &&
+               c->size0 >= 0 && c->size1 >= 0 && c->size0 <= 0xFFFF && c->size1 <= 0xFFFF;
+    }
+    if (c->prim == PRIM_RADIAL && (c->order < 3 || c->order > SYMMETRY_MAX_COPIES)) return 0;
+    int size_max = PRIM_SUBPIXEL(c->prim) ? CHECK_HUGE_SIZE * STROKE_SUBPIXEL : CHECK_HUGE_SIZE;
+    return c->size0 >= 0 && c->size1 >= 0 && c->size0 <= size_max && c->size1 <= size_max;
+}
+
+// Riduce il caso sbagliato: prova valori più piccoli per ogni campo e tiene
+// quelli che sbagliano ancora, finché nessun campo si riduce più
+static void minimize_case(CheckBuffers *b, RasterCase *c) {
+    CheckDiff diff;
+    int progress = 1;
+    while (progress) {
+        progress = 0;
+        int *fields[] = { &c->w, &c->h, &c->x0, &c->y0, &c->x1, &c->y1,
+                          &c->size0, &c->size1, &c->alpha, &c->skip, &c->order };
+        for (int f = 0; f < (int)(sizeof(fields) / sizeof(fields[0])); f++) {
+            int orig = *fields[f];
+            // Zero, metà, un passo verso zero (e verso l'altro estremo per x1/y1)
+            int tries[5] = { 0, orig / 2, orig - (orig > 0) + (orig < 0), 0, 0 };
+            int num_tries = 3;
+            if (fields[f] == &c->x1) { tries[3] = c->x0; tries[4] = (c->x0 + orig) / 2; num_tries = 5; }
+            if (fields[f] == &c->y1) { tries[3] = c->y0; tries[4] = (c->y0 + orig) / 2; num_tries = 5; }
+            for (int t = 0; t < num_tries; t++) {
+                if (tries[t] == orig) continue;
+                *fields[f] = tries[t];
+                if (case_valid(c) && !check_case(b, c, &diff)) {
+                    progress = 1;
+                    break;
+                }
+                *fields[f] = orig;
+            }
+        }
+    }
+}
+
+static void print_case(const RasterCase *c) {
+    printf("  -case \"%d %d %d %d %d %d %d %d %d %d %d %d\"\n", c->prim, c->w, c->h,
+           c->x0, c->y0, c->x1, c->y1, c->size0, c->size1, c->alpha, c->skip, c->order);
+    printf("  canvas %dx%d, noise background, color 0x%08X\n", c->w, c->h, check_color);
+    switch (c->prim) {
+        case PRIM_DOT:
+            printf("  reference: canvas_draw_brush(c, %d, %d, %d, color)\n", c->x0, c->y0, c->size0);
+            printf("  optimized: stroke_draw_segment(c, %d, %d, %d, %d, %d, %d, color, 255, 0)\n",
+                   c->x0, c->y0, c->size0 * STROKE_SUBPIXEL, c->x0, c->y0,
+                   c->size0 * STROKE_SUBPIXEL);
+            break;
+        case PRIM_LINE:
+            printf("  reference: canvas_draw_line(c, %d, %d, %d, %d, %d, color)\n",
+                   c->x0, c->y0, c->x1, c->y1, c->size0);
+            printf("  optimized: canvas_draw_line_brush(c, %d, %d, %d, %d, %d, color)\n",
+                   c->x0, c->y0, c->x1, c->y1, c->size0);
+            break;
+        case PRIM_MIRROR:
+            printf("  reference: brush stamps along the line and its mirrors on (%d, %d),"
+                   " size %d -> %d (1/%d px), %s\n",
+                   c->w - 1, c->h - 1, c->size0, c->size1, STROKE_SUBPIXEL,
+                   c->alpha >= 255 ? "one copy at a time" : "masked, blended once");
+            printf("  optimized: stroke_draw_segments(c, copies of (%d, %d)-(%d, %d), 4,"
+                   " color, %d, %d)\n", c->x0, c->y0, c->x1, c->y1, c->alpha, c->skip);
+            break;
+        case PRIM_RADIAL:
+            printf("  reference: brush stamps along the line and its %d rotations around (%d, %d),"
+                   " size %d -> %d (1/%d px), %s\n",
+                   c->order, c->w / 2, c->h / 2, c->size0, c->size1, STROKE_SUBPIXEL,
+                   c->alpha >= 255 ? "one copy at a time" : "masked, blended once");
+            printf("  optimized: stroke_draw_segments(c, copies of (%d, %d)-(%d, %d), %d,"
+                   " color, %d, %d)\n", c->x0, c->y0, c->x1, c->y1, c->order, c->alpha, c->skip);
+            break;
+        case PRIM_RECT:
+        case PRIM_FILL_RECT:
+            printf("  reference: canvas_draw_%s(c, %d, %d, %d, %d, color)\n",
+                   c->prim == PRIM_RECT ? "rect" : "filled_rect", c->x0, c->y0, c->x1, c->y1);
+            printf("  optimized: shape_draw_rect(c, %d, %d, %d, %d, 0, %d, color, 0)\n",
+                   c->x0, c->y0, c->x1, c->y1, c->prim == PRIM_RECT);
+            break;
+        case PRIM_CIRCLE:
+            printf("  reference: canvas_draw_filled_circle(c, %d, %d, %d, color)\n",
+                   c->x0, c->y0, c->size0);
+            printf("  optimized: shape_draw_ellipse(c, %d, %d, %d, %d, 0, color, 0)\n",
+                   c->x0, c->y0, c->size0, c->size0);
+            break;
+        case PRIM_ELLIPSE:
+            printf("  reference: pixels with dx^2 * %d^2 + dy^2 * %d^2 <= (%d * %d)^2 around (%d, %d)\n",
+                   c->size1, c->size0, c->size0, c->size1, c->x0, c->y0);
+            printf("  optimized: shape_draw_ellipse(c, %d, %d, %d, %d, 0, color, 0)\n",
+                   c->x0, c->y0, c->size0, c->size1);
+            break;
+        case PRIM_RING:
+            printf("  reference: pixels with dx^2 * %d^2 + dy^2 * %d^2 <= (%d * %d)^2 around (%d, %d)"
+                   " and a neighbour outside\n", c->size1, c->size0, c->size0, c->size1, c->x0, c->y0);
+            printf("  optimized: shape_draw_ellipse(c, %d, %d, %d, %d, 1, color, 0)\n",
+                   c->x0, c->y0, c->size0, c->size1);
+            break;
+        case PRIM_GRAD_RECT:
+        case PRIM_GRAD_CIRCLE:
+            printf("  reference: gradient_fill(c, %s, %d, %d, %d, %d, %d, color, 0x%08X)"
+                   " where canvas_draw_filled_%s draws\n",
+                   c->prim == PRIM_GRAD_RECT ? "GRADIENT_LINEAR" : "GRADIENT_RADIAL",
+                   c->x0, c->y0, c->x1, c->y1, c->size0, check_color2,
+                   c->prim == PRIM_GRAD_RECT ? "rect" : "circle");
+            printf("  optimized: gradient_fill(c, %s, %d, %d, %d, %d, %d, color, 0x%08X)\n",
+                   c->prim == PRIM_GRAD_RECT ? "GRADIENT_LINEAR_RECT" : "GRADIENT_RADIAL_CIRCLE",
+                   c->x0, c->y0, c->x1, c->y1, c->size0, check_color2);
+            break;
+        case PRIM_SELECTION:
+            printf("  source %dx%d premultiplied noise, alpha %d%s\n", SOURCE_W, SOURCE_H,
+                   c->alpha, c->skip ? ", with transparent holes" : "");
+            printf("  rows: selection_row_bilinear from (%d + %d/65536, %d + %d/65536),"
+                   " step (%d, %d)/256, simd 0 (reference) vs 1 (optimized)\n",
+                   c->x0, c->size0, c->y0, c->size1, c->x1, c->y1);
+            break;
+        default:
+            printf("  reference: brush stamps along the line, size %d -> %d (1/%d px)%s\n",
+                   c->size0, c->size1, STROKE_SUBPIXEL,
+                   c->prim == PRIM_STROKE ? ", masked, blended once" : "");
+            printf("  optimized: stroke_draw_segment(c, %d, %d, %d, %d, %d, %d, color, %d, %d)\n",
+                   c->x0, c->y0, c->size0, c->x1, c->y1, c->size1,
+                   c->prim == PRIM_STROKE ? c->alpha : 255, c->prim == PRIM_STROKE ? c->skip : 0);
+            break;
+    }
+}
+
+static void report_mismatch(CheckBuffers *b, RasterCase *c) {
+    CheckDiff diff;
+    check_case(b, c, &diff);
+    printf("MISMATCH %s: %d pixels differ\n", prim_names[c->prim], diff.count);
+    print_case(c);
+
+    minimize_case(b, c);
+    check_case(b, c, &diff);
+    printf("minimized: %d pixels differ, first at (%d, %d): reference 0x%08X, optimized 0x%08X\n",
+           diff.count, diff.x, diff.y, diff.ref, diff.opt);
+    print_case(c);
+}
+
+/* ===== GENERATORE ===== */
+
+// Sorgente dei valori: PRNG per la modalità normale, byte dell'input per libFuzzer
+typedef struct {
+    uint64_t state;
+    const uint8_t *data;
+    size_t size, pos;
+} CaseSource;
+
+static uint32_t source_next(CaseSource *s) {
+    if (s->data) {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++) {
+            v = (v << 8) | ((s->pos < s->size) ? s->data[s->pos] : 0);
+            s->pos++;
+        }
+        return v;
+    }
+    // xorshift64*
+    s->state ^= s->state >> 12;
+    s->state ^= s->state << 25;
+    s->state ^= s->state >> 27;
+    return (uint32_t)((s->state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+// Intero in [lo, hi]
+static int source_range(CaseSource *s, int lo, int hi) {
+    return lo + (int)(source_next(s) % (uint32_t)(hi - lo + 1));
+}
+
+static int gen_dim(CaseSource *s, int full) {
+    static const int small[] = { 1, 2, 3, 7, 16, 61, 97 };
+    switch (source_range(s, 0, 3)) {
+        case 0:  return small[source_range(s, 0, 6)];
+        case 1:  return full;
+        default: return source_range(s, 1, full);
+    }
+}
+
+// Coordinata lungo un lato di n pixel, con margine m per i bordi
+static int gen_coord(CaseSource *s, int n, int m) {
+    switch (source_range(s, 0, 7)) {
+        case 0:  return source_range(s, -m - 2, m + 2);               // bordo iniziale
+        case 1:  return source_range(s, n - m - 2, n + m + 2);        // bordo finale
+        case 2:  return source_range(s, -3 * n - 64, -1);             // fuori, negativa
+        case 3:  return source_range(s, n, 4 * n + 64);               // fuori, oltre
+        default: return source_range(s, 0, n - 1);
+    }
+}
+
+// Spessore in pixel: tutti quelli del pennello, più quelli dell'export
+static int gen_size(CaseSource *s) {
+    switch (source_range(s, 0, 7)) {
+        case 0:  return source_range(s, 0, CHECK_SIZE_MAX);
+        case 1:  return source_range(s, 0, 2);
+        default: return source_range(s, BRUSH_SIZE_MIN, BRUSH_SIZE_MAX);
+    }
+}
+
+// Raggio di cerchi ed ellissi: zero, quelli del pennello e dell'export, rari
+// oltre (il riferimento dell'ellisse prova ogni pixel del riquadro)
+static int gen_radius(CaseSource *s) {
+    if (source_range(s, 0, 31) == 0) return source_range(s, CHECK_SIZE_MAX, CHECK_HUGE_SIZE);
+    return source_range(s, 0, 7) ? gen_size(s) : 0;
+}
+
+// Bilineare della selezione: partenza dentro, sul bordo o fuori dalla
+// sorgente, fase qualsiasi, passi da identità, scala o rotazione
+static void gen_selection(CaseSource *s, RasterCase *c) {
+    c->x0 = source_range(s, -64, SOURCE_W + 64);
+    c->y0 = source_range(s, -64, SOURCE_H + 64);
+    c->size0 = source_range(s, 0, 0xFFFF);
+    c->size1 = source_range(s, 0, 0xFFFF);
+    switch (source_range(s, 0, 3)) {
+        case 0:  c->x1 = 256; c->y1 = 0; break;                                      // identità
+        case 1:  c->x1 = source_range(s, -1024, 1024); c->y1 = 0; break;             // scala
+        default: c->x1 = source_range(s, -1024, 1024); c->y1 = source_range(s, -1024, 1024); break;
+    }
+    c->alpha = source_range(s, 0, 3) ? 255 : source_range(s, 0, 255);
+    c->skip = source_range(s, 0, 1);
+}
+
+// Forme e gradienti: estremi o centro come i tratti, raggi anche nulli
+static void gen_shape(CaseSource *s, RasterCase *c) {
+    int margin = CHECK_SIZE_MAX / 2 + 1;
+    c->x0 = gen_coord(s, c->w, margin);
+    c->y0 = gen_coord(s, c->h, margin);
+    c->x1 = source_range(s, 0, 7) ? gen_coord(s, c->w, margin) : c->x0;
+    c->y1 = source_range(s, 0, 7) ? gen_coord(s, c->h, margin) : c->y0;
+    c->size0 = gen_radius(s);
+    c->size1 = c->size0;
+    // L'anello a metà cerchi: senza tagli prendono la strada dell'ottante
+    if (c->prim == PRIM_ELLIPSE || (c->prim == PRIM_RING && source_range(s, 0, 1))) {
+        c->size1 = gen_radius(s);
+    }
+}
+
+// Campi del caso per prim, w e h già scelti
+static void gen_fields(CaseSource *s, RasterCase *c) {
+    c->alpha = 255;
+    if (c->prim == PRIM_SELECTION) {
+        gen_selection(s, c);
+        return;
+    }
+    if (c->prim >= PRIM_RECT) {
+        gen_shape(s, c);
+        return;
+    }
+    int subpixel = PRIM_SUBPIXEL(c->prim);
+    c->size0 = subpixel ? gen_size(s) * STROKE_SUBPIXEL + source_range(s, 0, STROKE_SUBPIXEL - 1)
+                        : gen_size(s);
+    c->size1 = subpixel ? gen_size(s) * STROKE_SUBPIXEL + source_range(s, 0, STROKE_SUBPIXEL - 1)
+                        : c->size0;
+    int margin = (subpixel ? CHECK_SIZE_MAX : c->size0) / 2 + 1;
+    c->x0 = gen_coord(s, c->w, margin);
+    c->y0 = gen_coord(s, c->h, margin);
+
+    switch (source_range(s, 0, 7)) {
+        case 0:  c->x1 = c->x0; c->y1 = c->y0; break;                        // punto
+        case 1:  c->x1 = gen_coord(s, c->w, margin); c->y1 = c->y0; break;   // orizzontale
+        case 2:  c->x1 = c->x0; c->y1 = gen_coord(s, c->h, margin); break;   // verticale
+        case 3: {                                                            // diagonale
+            int d = source_range(s, -200, 200);
+            c->x1 = c->x0 + d;
+            c->y1 = c->y0 + (source_range(s, 0, 1) ? d : -d);
+            break;
+        }
+        default: c->x1 = gen_coord(s, c->w, margin); c->y1 = gen_coord(s, c->h, margin); break;
+    }
+
+    // Raggi oltre la tabella degli span, su segmenti corti (il riferimento
+    // costa un disco intero per passo)
+    if (source_range(s, 0, 31) == 0) {
+        c->size0 = source_range(s, 2 * STROKE_MAX_RADIUS, CHECK_HUGE_SIZE);
+        if (subpixel) c->size0 *= STROKE_SUBPIXEL;
+        c->size1 = subpixel ? c->size0 / 2 : c->size0;
+        c->x1 = c->x0 + source_range(s, -4, 4);
+        c->y1 = c->y0 + source_range(s, -4, 4);
+    }
+    if (c->prim == PRIM_DOT) {
+        c->x1 = c->x0;
+        c->y1 = c->y0;
+    }
+    if (c->prim >= PRIM_STROKE) {
+        c->alpha = source_range(s, 0, 3) ? source_range(s, 0, 255) : 255;
+        c->skip = source_range(s, 0, 1);
+    }
+    if (c->prim == PRIM_RADIAL) c->order = source_range(s, 3, SYMMETRY_MAX_COPIES);
+}
+
+static void gen_case(CaseSource *s, RasterCase *c) {
+    memset(c, 0, sizeof(RasterCase));
+    c->prim = source_range(s, 0, PRIM_COUNT - 1);
+    c->w = gen_dim(s, SCREEN_W);
+    c->h = gen_dim(s, SCREEN_H);
+    gen_fields(s, c);
+}
+
+static int buffers_init(CheckBuffers *b) {
+    b->capacity = SCREEN_W * SCREEN_H;
+    b->ref = (unsigned int *)malloc(b->capacity * sizeof(unsigned int));
+    b->opt = (unsigned int *)malloc(b->capacity * sizeof(unsigned int));
+    b->mask = (unsigned int *)malloc(b->capacity * sizeof(unsigned int));
+    b->aux = (unsigned int *)malloc(b->capacity * sizeof(unsigned int));
+    return (b->ref && b->opt && b->mask && b->aux) ? 0 : -1;
+}
+
+static void buffers_destroy(CheckBuffers *b) {
+    free(b->ref);
+    free(b->opt);
+    free(b->mask);
+    free(b->aux);
+}
+
+#ifdef DRAWAPP_FUZZER
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static CheckBuffers b;
+    if (!b.ref && buffers_init(&b) != 0) return 0;
+
+    CaseSource s = { 0, data, size, 0 };
+    RasterCase c;
+    gen_case(&s, &c);
+    CheckDiff diff;
+    if (!check_case(&b, &c, &diff)) {
+        report_mismatch(&b, &c);
+        fflush(stdout);
+        abort();
+    }
+    return 0;
+}
+
+#else
+
+/* ===== COMANDI DAL FILE ===== */
+
+// Un JCMD_TRANSFORM rilegge i suoi x1 JCMD_SELECT prima di sé: da un file
+// rotto x1 può puntare prima dell'inizio del journal o su altri comandi.
+// Journal di n comandi (SELECT o LINE secondo types) più il TRANSFORM,
+// caricato come un progetto (from_file) o rieseguito come il .wal: deve
+// entrare solo se 0 < x1 <= n e i x1 comandi prima sono tutti SELECT.
+static int check_transform_case(const uint8_t *types, int n, int x1, int from_file) {
+    JournalCmd cmds[16];
+    memset(cmds, 0, sizeof(cmds));
+    for (int i = 0; i < n; i++) {
+        cmds[i].type = types[i];
+        cmds[i].size = (types[i] == JCMD_SELECT) ? SELECT_RECT : 3;
+        cmds[i].x0 = (int16_t)(4 + i);
+        cmds[i].y0 = 6;
+        cmds[i].x1 = (int16_t)(40 + i);
+        cmds[i].y1 = 30;
+        cmds[i].color = check_color;
+    }
+    JournalCmd *t = &cmds[n];
+    t->type = JCMD_TRANSFORM;
+    t->x0 = 5;
+    t->y0 = -3;
+    t->x1 = (int16_t)x1;
+    t->size = SELECTION_SCALE_ONE;
+    t->y1 = SELECTION_SCALE_ONE;
+    t->color = check_color2;
+
+    int expected = (x1 > 0 && x1 <= n);
+    for (int i = n - x1; expected && i < n; i++) expected = (types[i] == JCMD_SELECT);
+
+    static unsigned int pixels[64 * 48];
+    Canvas canvas;
+    Journal journal;
+    canvas_init_buffer(&canvas, pixels, 64, 48);
+    canvas_clear(&canvas, canvas.bg_color);
+    if (journal_init(&journal, canvas.bg_color) < 0) return 0;
+
+    int accepted = 1;
+    if (from_file) {
+        FILE *f = tmpfile();
+        if (!f) {
+            journal_destroy(&journal);
+            return 0;
+        }
+        fwrite(cmds, sizeof(JournalCmd), n + 1, f);
+        rewind(f);
+        accepted = (journal_read_cmds(&journal, f, n + 1, canvas.bg_color, 0) == 0);
+        fclose(f);
+        // Accettato: il ridisegno rilegge davvero le selezioni
+        if (accepted) journal_rasterize(&journal, &canvas, 1);
+    } else {
+        for (int i = 0; i < n; i++) journal_exec(&journal, &canvas, &cmds[i]);
+        accepted = (journal_exec(&journal, &canvas, t) == 0);
+    }
+    journal_destroy(&journal);
+
+    if (accepted != expected) {
+        printf("MISMATCH transform: x1 %d after %d commands (", x1, n);
+        for (int i = 0; i < n; i++) printf("%s%s", i ? " " : "", types[i] == JCMD_SELECT ? "select" : "line");
+        printf(") %s by %s, expected %s\n", accepted ? "accepted" : "rejected",
+               from_file ? "journal_read_cmds" : "journal_exec", expected ? "accepted" : "rejected");
+        return 0;
+    }
+    return 1;
+}
+
+// Casi costruiti (x1 oltre l'inizio, nullo, negativo, al massimo di int16,
+// su comandi che non sono selezioni) più altri a caso
+static int check_transforms(uint64_t seed, int cases) {
+    static const struct { uint8_t types[4]; int n, x1; } crafted[] = {
+        { { 0 }, 0, 1 },
+        { { JCMD_SELECT }, 1, 32767 },
+        { { JCMD_SELECT, JCMD_SELECT }, 2, 3 },
+        { { JCMD_SELECT, JCMD_SELECT }, 2, 0 },
+        { { JCMD_SELECT, JCMD_SELECT }, 2, -1 },
+        { { JCMD_LINE, JCMD_SELECT }, 2, 2 },
+        { { JCMD_SELECT, JCMD_LINE }, 2, 1 },
+        { { JCMD_LINE, JCMD_SELECT, JCMD_SELECT }, 3, 2 },
+    };
+    for (int i = 0; i < (int)(sizeof(crafted) / sizeof(crafted[0])); i++) {
+        for (int from_file = 0; from_file < 2; from_file++) {
+            if (!check_transform_case(crafted[i].types, crafted[i].n, crafted[i].x1, from_file)) return 0;
+        }
+    }
+    CaseSource s = { seed ? seed : 1, NULL, 0, 0 };
+    for (int i = 0; i < cases; i++) {
+        uint8_t types[15];
+        int n = source_range(&s, 0, 15);
+        for (int k = 0; k < n; k++) types[k] = source_range(&s, 0, 3) ? JCMD_SELECT : JCMD_LINE;
+        int x1 = source_range(&s, 0, 7) ? source_range(&s, -2, n + 2) : source_range(&s, -32768, 32767);
+        if (!check_transform_case(types, n, x1, source_range(&s, 0, 1))) return 0;
+    }
+    return 1;
+}
+
+/* ===== TEMPI ===== */
+
+// Tempi sul canvas intero, con i casi tipici del disegno (per lo più a schermo)
+static void time_prims(CheckBuffers *b, int cases, uint64_t seed) {
+    printf("%-8s %12s %12s %9s\n", "prim", "reference", "optimized", "speedup");
+    RasterCase *list = (RasterCase *)malloc(cases * sizeof(RasterCase));
+    if (!list) return;
+
+    for (int p = 0; p < PRIM_COUNT; p++) {
+        CaseSource s = { seed + p, NULL, 0, 0 };
+        for (int i = 0; i < cases; i++) {
+            RasterCase *c = &list[i];
+            memset(c, 0, sizeof(RasterCase));
+            c->prim = p;
+            c->w = SCREEN_W;
+            c->h = SCREEN_H;
+            gen_fields(&s, c);
+            if (p == PRIM_SELECTION) continue;
+            c->x0 = source_range(&s, 0, SCREEN_W - 1);
+            c->y0 = source_range(&s, 0, SCREEN_H - 1);
+            c->x1 = (p == PRIM_DOT) ? c->x0 : c->x0 + source_range(&s, -120, 120);
+            c->y1 = (p == PRIM_DOT) ? c->y0 : c->y0 + source_range(&s, -120, 120);
+            c->size0 = source_range(&s, BRUSH_SIZE_MIN, BRUSH_SIZE_MAX);
+            c->size1 = source_range(&s, BRUSH_SIZE_MIN, BRUSH_SIZE_MAX);
+            if (PRIM_SUBPIXEL(p)) {
+                c->size0 *= STROKE_SUBPIXEL;
+                c->size1 *= STROKE_SUBPIXEL;
+            }
+        }
+
+        Canvas ref, opt;
+        canvas_init_buffer(&ref, b->ref, SCREEN_W, SCREEN_H);
+        canvas_init_buffer(&opt, b->opt, SCREEN_W, SCREEN_H);
+        fill_background(b->ref, SCREEN_W * SCREEN_H);
+        fill_background(b->opt, SCREEN_W * SCREEN_H);
+        // Una sorgente per tutti i casi della selezione (alfa del primo)
+        if (p == PRIM_SELECTION) fill_source(b->aux, &list[0]);
+
+        uint64_t t = platform_time_us();
+        for (int i = 0; i < cases; i++) draw_reference(&ref, b, &list[i], check_color);
+        double ref_ms = (platform_time_us() - t) / 1000.0;
+        t = platform_time_us();
+        for (int i = 0; i < cases; i++) draw_optimized(&opt, b, &list[i], check_color);
+        double opt_ms = (platform_time_us() - t) / 1000.0;
+
+        printf("%-8s %10.1fus %10.1fus %8.1fx\n", prim_names[p],
+               ref_ms * 1000.0 / cases, opt_ms * 1000.0 / cases,
+               opt_ms > 0 ? ref_ms / opt_ms : 0.0);
+    }
+    free(list);
+}
+
+static int usage(void) {
+    fprintf(stderr, "usage: drawrastercheck [-n cases] [-seed N] [-t cases]\n"
+                    "       drawrastercheck -case \"prim w h x0 y0 x1 y1 size0 size1 alpha skip [order]\"\n");
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    int cases = CHECK_CASES;
+    int time_cases = CHECK_TIME;
+    uint64_t seed = 1;
+    const char *single = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            cases = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            time_cases = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-case") == 0 && i + 1 < argc) {
+            single = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+
+    CheckBuffers b;
+    if (buffers_init(&b) != 0) {
+        fprintf(stderr, "drawrastercheck: out of memory\n");
+        return 1;
+    }
+
+    // Un solo caso, da un riproduttore stampato in precedenza
+    if (single) {
+        RasterCase c;
+        memset(&c, 0, sizeof(c));
+        // order manca nei riproduttori di prima di radial
+        if (sscanf(single, "%d %d %d %d %d %d %d %d %d %d %d %d", &c.prim, &c.w, &c.h,
+                   &c.x0, &c.y0, &c.x1, &c.y1, &c.size0, &c.size1, &c.alpha, &c.skip,
+                   &c.order) < 11 ||
+            c.prim < 0 || c.prim >= PRIM_COUNT || !case_valid(&c)) {
+            buffers_destroy(&b);
+            return usage();
+        }
+        CheckDiff diff;
+        int ok = check_case(&b, &c, &diff);
+        if (ok) printf("ok %s\n", prim_names[c.prim]);
+        else report_mismatch(&b, &c);
+        buffers_destroy(&b);
+        return ok ? 0 : 1;
+    }
+
+    if (!check_transforms(seed, CHECK_TRANSFORMS)) {
+        buffers_destroy(&b);
+        return 1;
+    }
+    printf("%d transform cases ok\n", CHECK_TRANSFORMS);
+
+    CaseSource s = { seed ? seed : 1, NULL, 0, 0 };
+    int per_prim[PRIM_COUNT] = { 0 };
+    int failed = 0;
+    uint64_t start = platform_time_us();
+    for (int i = 0; i < cases; i++) {
+        RasterCase c;
+        gen_case(&s, &c);
+        per_prim[c.prim]++;
+        CheckDiff diff;
+        if (!check_case(&b, &c, &diff)) {
+            printf("case %d (seed %llu)\n", i, (unsigned long long)seed);
+            report_mismatch(&b, &c);
+            failed = 1;
+            break;
+        }
+    }
+    if (!failed) {
+        printf("%d cases ok in %.1f s:", cases, (platform_time_us() - start) / 1000000.0);
+        for (int p = 0; p < PRIM_COUNT; p++) printf(" %s %d", prim_names[p], per_prim[p]);
+        printf("\n");
+    }
+
+    if (time_cases > 0) time_prims(&b, time_cases, seed);
+    buffers_destroy(&b);
+    return failed ? 1 : 0;
+}
+
+#endif
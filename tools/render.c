@@ -0,0 +1,279 @@
+/*
+ * drawrender - ridisegna in batch progetti e sessioni registrate, senza display.
+ *
+ *   drawrender [-j N] [-scale N] [-n] [-o dir] input...
+ *
+ * Ogni input è un progetto (.drwj) o un log di autosave (.wal, ripetuto
+ * sopra il progetto con lo stesso nome, se c'è). Il journal viene
+ * rasterizzato da zero con il codice del canvas dell'app e scritto in
+ * dir/<nome>_<estensione>.png; -n salta i PNG (solo hash e tempi).
+ * I job vanno ai worker man mano che si liberano, i più grandi per primi;
+ * -j sceglie i worker (default: tutti i core).
+ *
+ * Per ogni job stampa l'hash FNV-1a a 64 bit dei pixel, i comandi, i tempi
+ * e se il ridisegno coincide con i pixel salvati (solo a scala 1).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "canvas.h"
+#include "journal.h"
+#include "project.h"
+#include "autosave.h"
+#include "export.h"
+#include "workpool.h"
+#include "platform.h"
+
+#define RENDER_MAX_PATH 512
+
+typedef struct {
+    const char *input;
+    char output[RENDER_MAX_PATH];
+    long input_bytes;
+
+    // Risultati
+    int ok;
+    int match;           // 1 coincide, 0 no, -1 non confrontato
+    int cmds;
+    uint64_t hash;
+    uint64_t load_us;
+    uint64_t render_us;
+    uint64_t png_us;
+} RenderJob;
+
+typedef struct {
+    long bytes;
+    int job;
+} RenderOrder;
+
+typedef struct {
+    RenderJob *jobs;
+    RenderOrder *order;  // dal job più grande
+    int scale;
+    int write_png;
+    // Per worker, chiamante compreso
+    uint64_t busy_us[WORKPOOL_MAX_THREADS + 1];
+    int done[WORKPOOL_MAX_THREADS + 1];
+} RenderBatch;
+
+static int usage(void) {
+    fprintf(stderr, "usage: drawrender [-j N] [-scale N] [-n] [-o dir] input.drwj|input.wal...\n");
+    return 2;
+}
+
+static uint64_t fnv1a64(const unsigned int *pixels, size_t count) {
+    const unsigned char *p = (const unsigned char *)pixels;
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < count * sizeof(unsigned int); i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static int has_suffix(const char *s, const char *suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+// Carica l'input nel journal e nel canvas (pixel salvati o rieseguiti)
+static int render_load(const char *input, Journal *journal, Canvas *canvas) {
+    if (!has_suffix(input, ".wal")) return project_load(journal, canvas, input);
+
+    char project[RENDER_MAX_PATH];
+    snprintf(project, sizeof(project), "%.*s.drwj", (int)(strlen(input) - 4), input);
+    return autosave_recover(journal, canvas, project, input) < 0 ? -1 : 0;
+}
+
+static void render_job(RenderJob *job, int scale, int write_png) {
+    Canvas canvas, render;
+    Journal journal;
+    size_t size = (size_t)SCREEN_W * SCREEN_H;
+    size_t render_size = size * scale * scale;
+
+    unsigned int *pixels = (unsigned int *)malloc(size * sizeof(unsigned int));
+    unsigned int *render_pixels = (unsigned int *)malloc(render_size * sizeof(unsigned int));
+    if (!pixels || !render_pixels) {
+        free(pixels);
+        free(render_pixels);
+        return;
+    }
+    canvas_init_buffer(&canvas, pixels, SCREEN_W, SCREEN_H);
+    canvas_clear(&canvas, canvas.bg_color);
+    canvas_init_buffer(&render, render_pixels, SCREEN_W * scale, SCREEN_H * scale);
+
+    if (journal_init(&journal, canvas.bg_color) < 0) {
+        free(pixels);
+        free(render_pixels);
+        return;
+    }
+
+    uint64_t t = platform_time_us();
+    int loaded = render_load(job->input, &journal, &canvas) == 0;
+    job->load_us = platform_time_us() - t;
+
+    if (loaded) {
+        // Da zero, come l'export: lo stesso codice che disegna nell'app
+        t = platform_time_us();
+        journal_rasterize(&journal, &render, scale);
+        job->render_us = platform_time_us() - t;
+
+        job->cmds = journal.cursor;
+        job->hash = fnv1a64(render.pixels, render_size);
+        job->match = (scale == 1) ? memcmp(render.pixels, canvas.pixels,
+                                           size * sizeof(unsigned int)) == 0 : -1;
+        job->ok = 1;
+
+        if (write_png) {
+            t = platform_time_us();
+            job->ok = export_png(job->output, NULL, &render, 1, EXPORT_NEAREST,
+                                 NULL, NULL) == 0;
+            job->png_us = platform_time_us() - t;
+        }
+    }
+
+    journal_destroy(&journal);
+    free(pixels);
+    free(render_pixels);
+}
+
+static void render_task(void *ctx, int index, int worker) {
+    RenderBatch *batch = (RenderBatch *)ctx;
+    RenderJob *job = &batch->jobs[batch->order[index].job];
+
+    uint64_t t = platform_time_us();
+    render_job(job, batch->scale, batch->write_png);
+    // Ogni worker scrive solo le proprie statistiche
+    batch->busy_us[worker] += platform_time_us() - t;
+    batch->done[worker]++;
+}
+
+static int compare_order(const void *a, const void *b) {
+    const RenderOrder *oa = (const RenderOrder *)a, *ob = (const RenderOrder *)b;
+    if (oa->bytes != ob->bytes) return (oa->bytes < ob->bytes) ? 1 : -1;
+    return oa->job - ob->job;
+}
+
+// dir/<nome>_<estensione>.png, con un numero se il nome è già usato
+static void make_output(RenderJob *jobs, int i, const char *dir) {
+    const char *name = strrchr(jobs[i].input, '/');
+    name = name ? name + 1 : jobs[i].input;
+
+    char base[256];
+    snprintf(base, sizeof(base), "%s", name);
+    char *dot = strrchr(base, '.');
+    if (dot) *dot = '_';
+
+    snprintf(jobs[i].output, RENDER_MAX_PATH, "%s/%s.png", dir, base);
+    for (int n = 1, j = 0; j < i; j++) {
+        if (strcmp(jobs[j].output, jobs[i].output) == 0) {
+            snprintf(jobs[i].output, RENDER_MAX_PATH, "%s/%s_%d.png", dir, base, n++);
+            j = -1;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int workers = 0;
+    int scale = 1;
+    int write_png = 1;
+    const char *dir = ".";
+    int first = argc;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-scale") == 0 && i + 1 < argc) {
+            scale = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0) {
+            write_png = 0;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (argv[i][0] != '-') {
+            first = i;
+            break;
+        } else {
+            return usage();
+        }
+    }
+    int count = argc - first;
+    if (count < 1 || scale < 1 || scale > EXPORT_SCALE_MAX) return usage();
+
+    if (write_png) mkdir(dir, 0755);   // se esiste già, nessun errore da gestire
+
+    RenderBatch batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.jobs = (RenderJob *)calloc(count, sizeof(RenderJob));
+    batch.order = (RenderOrder *)malloc(count * sizeof(RenderOrder));
+    batch.scale = scale;
+    batch.write_png = write_png;
+    if (!batch.jobs || !batch.order) {
+        fprintf(stderr, "drawrender: out of memory\n");
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        struct stat st;
+        batch.jobs[i].input = argv[first + i];
+        batch.jobs[i].input_bytes = (stat(argv[first + i], &st) == 0) ? (long)st.st_size : 0;
+        batch.jobs[i].match = -1;
+        make_output(batch.jobs, i, dir);
+        batch.order[i].bytes = batch.jobs[i].input_bytes;
+        batch.order[i].job = i;
+    }
+    // I job grandi per primi: gli ultimi a finire sono i più corti
+    qsort(batch.order, count, sizeof(RenderOrder), compare_order);
+
+    WorkPool pool;
+    if (workpool_init(&pool, workers) != 0) {
+        fprintf(stderr, "drawrender: cannot start workers\n");
+        return 1;
+    }
+    int num_workers = workpool_size(&pool);
+
+    uint64_t start = platform_time_us();
+    workpool_run(&pool, count, render_task, &batch);
+    double seconds = (double)(platform_time_us() - start) / 1000000.0;
+    workpool_destroy(&pool);
+
+    printf("%-16s %5s %8s %9s %9s %9s  %s\n", "hash", "saved", "cmds", "load", "render", "png",
+           "input");
+    int failed = 0;
+    long cmds = 0;
+    uint64_t render_us = 0, png_us = 0;
+    for (int i = 0; i < count; i++) {
+        const RenderJob *job = &batch.jobs[i];
+        if (!job->ok) {
+            printf("%-16s %5s %8s %9s %9s %9s  %s\n", "-", "FAIL", "-", "-", "-", "-", job->input);
+            failed++;
+            continue;
+        }
+        printf("%016llx %5s %8d %7.1fms %7.1fms %7.1fms  %s -> %s\n",
+               (unsigned long long)job->hash,
+               job->match < 0 ? "-" : (job->match ? "same" : "diff"),
+               job->cmds, job->load_us / 1000.0, job->render_us / 1000.0,
+               job->png_us / 1000.0, job->input, write_png ? job->output : "-");
+        cmds += job->cmds;
+        render_us += job->render_us;
+        png_us += job->png_us;
+    }
+
+    double mpix = (double)SCREEN_W * SCREEN_H * scale * scale * (count - failed) / 1e6;
+    printf("%d jobs (%d failed) in %.2f s on %d workers: %.1f jobs/s\n",
+           count, failed, seconds, num_workers, seconds > 0 ? count / seconds : 0.0);
+    printf("raster: %ld cmds, %.1f Mpix/s per worker, %.1f Mpix/s total\n", cmds,
+           render_us ? mpix / (render_us / 1000000.0) : 0.0, seconds > 0 ? mpix / seconds : 0.0);
+    if (write_png) {
+        printf("png: %.1f ms per image\n",
+               count > failed ? png_us / 1000.0 / (count - failed) : 0.0);
+    }
+    for (int w = 0; w < num_workers; w++) {
+        printf("worker %d: %d jobs, busy %.2f s\n", w, batch.done[w], batch.busy_us[w] / 1000000.0);
+    }
+
+    free(batch.jobs);
+    free(batch.order);
+    return failed ? 1 : 0;
+}